@@ -101,6 +101,23 @@ Output format (f = pdf or png, def=pdf)
 
 Show the on/off values for the fit
 
+=item B<--bm-probs>=dir
+
+Compute the reliability profile from the base match probabilities in
+dir (one file per pair of sequences, or binary file; see mlocarna
+--write-bm-probs) by locarna_reliability instead of reading it from
+the output directory. The profile is written to file
+"output".bmreliability.
+
+=item B<--am-probs>=dir
+
+Arc match probabilities for computing the reliability profile (see
+--bm-probs)
+
+=item B<--threads>=n
+
+Number of threads for computing the reliability profile
+
 =back
 
 The target directory of mlocarna is required for obtaining the
@@ -120,6 +137,7 @@ use FindBin;
 ## global constants
 
 my $LOCARNAP_FIT="$FindBin::Bin/locarnap_fit";
+my $LOCARNA_RELIABILITY="$FindBin::Bin/locarna_reliability";
 
 ##------------------------------------------------------------
 ## options
@@ -170,6 +188,9 @@ my $show_fitonoff=0;
 my $output_width=12;
 
 my $output_height=4;
+my $bm_probs;
+my $am_probs;
+my $threads=1;
 
 
 ## Getopt::Long::Configure("no_ignore_case");
@@ -198,7 +219,10 @@ GetOptions(
     "write-subseq" => \$write_subseq,
     "output-format=s" => \$output_format,
     "output-width=i" => \$output_width,
-    "output-height=i" => \$output_height
+    "output-height=i" => \$output_height,
+    "bm-probs=s" => \$bm_probs,
+    "am-probs=s" => \$am_probs,
+    "threads=i" => \$threads
     ) || pod2usage(2);
 
 pod2usage(1) if $help;
@@ -220,6 +244,16 @@ if (@ARGV==1) {
     $bmrelfile = $ARGV[1];
 }
 
+if (defined($bm_probs)) {
+    ## compute the reliability profile of the alignment directly
+    $bmrelfile = "$outfile.bmreliability";
+    
+    my $cmd = "$LOCARNA_RELIABILITY --bm-probs $bm_probs"
+	.(defined($am_probs)?" --am-probs $am_probs":"")
+	." --threads $threads --write-bm-reliability $bmrelfile $alnfile";
+    system($cmd)==0 || die "Cannot compute reliability profile: $cmd\n";
+}
+
 
 #if (!defined($seqname)) {
 #    print STDERR "Giving a sequence name is mandatory.\n";
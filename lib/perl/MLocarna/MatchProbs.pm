@@ -32,6 +32,8 @@ read_am_probs
 write_am_probs
 write_bm_reliabilities
 write_am_reliabilities
+read_bm_reliabilities
+read_am_reliabilities
 write_reliability_bars
 
 average_basematch_probs
@@ -678,9 +680,9 @@ sub compute_amreliabilities_single_seq($$$$) {
 		
 		if ($i2<$i) { next; }
 		
-		if ( substr($aln->{$nameA},$i2,1) !~ /[A-Za-z]/ ) { next; }
+		if ( substr($aln->{$nameA},$i2-1,1) !~ /[A-Za-z]/ ) { next; }
 		
-		if ( substr($aln->{$nameB},$i2,1) !~ /[A-Za-z]/ ) { next; }
+		if ( substr($aln->{$nameB},$i2-1,1) !~ /[A-Za-z]/ ) { next; }
 		
 		my $pB2 =  $col2pos{$nameB}[$i2];
 		
@@ -872,6 +874,56 @@ sub write_am_reliabilities {
     close AMREL;
 }
 
+########################################
+## read_bm_reliabilities($file filename)
+##
+## read reliabilities as written by write_bm_reliabilities (or
+## locarna_reliability)
+##
+## @returns pair \@bmrels_seq,\@bmrels_str
+##
+########################################
+sub read_bm_reliabilities {
+    my ($file) = @_;
+    
+    my @bmrels_seq;
+    my @bmrels_str;
+    
+    open(BMREL,"$file") || die "Cannot read $file";
+    while (my $line=<BMREL>) {
+	if ($line =~ /^(\d+) (\S+) (\S+)/) {
+	    $bmrels_seq[$1]=$2;
+	    $bmrels_str[$1]=$3;
+	}
+    }
+    close BMREL;
+    
+    return (\@bmrels_seq,\@bmrels_str);
+}
+
+########################################
+## read arc match reliabilities as written by write_am_reliabilities
+## (or locarna_reliability)
+##
+## @returns ref of hash of arc match reliabilities
+##
+########################################
+sub read_am_reliabilities {
+    my ($file) = @_;
+    
+    my %amrels;
+    
+    open(AMREL,"$file") || die "Cannot read $file";
+    while (my $line=<AMREL>) {
+	if ($line =~ /^(\d+) (\d+) (\S+)/) {
+	    $amrels{"$1 $2"}=$3;
+	}
+    }
+    close AMREL;
+    
+    return \%amrels;
+}
+
 ########################################
 ## write reliability plot to the screen
 ##
@@ -85,8 +85,10 @@ namespace LocARNA {
     {}
     
 
+    // the copy allocates its matrices from the heap, since it might
+    // be used by another thread than the owner of the arena
     AlignerImpl::AlignerImpl(const AlignerImpl &a)
-	: params_(new AlignerParams(*a.params_)),
+	: params_(0),
 	  scoring_(a.scoring_),
 	  mod_scoring_(0),
 	  seqA_(a.seqA_),
@@ -95,20 +97,43 @@ namespace LocARNA {
 	  bpsA_(a.bpsA_),
 	  bpsB_(a.bpsB_),
 	  r_(a.r_),
-	  Dmat_(a.Dmat_),
-	  Ms_(a.Ms_),
+	  dense_D_(a.dense_D_),
+	  right_end_lists_(a.right_end_lists_),
+	  Dmat_(a.Dmat_.begin(),a.Dmat_.end()),
+	  D_cols_(a.D_cols_),
+	  Ms_(),
 	  Es_(a.Es_),
 	  Fs_(a.Fs_),
+	  arcmatch_M_size_(a.arcmatch_M_size_),
+	  rowwise_top_level_(a.rowwise_top_level_),
+	  tl_rows_per_block_(a.tl_rows_per_block_),
+	  tl_checkpoint_M_(a.tl_checkpoint_M_),
+	  tl_checkpoint_E_(a.tl_checkpoint_E_),
+	  tl_first_col_(a.tl_first_col_),
+	  tl_context_start_(a.tl_context_start_),
+	  tl_context_col_(a.tl_context_col_),
+	  tl_context_(a.tl_context_),
+	  tl_blocks_(a.tl_blocks_),
+	  tl_lru_(a.tl_lru_),
 	  min_i_(a.min_i_),
 	  min_j_(a.min_j_),
 	  max_i_(a.max_i_),
 	  max_j_(a.max_j_),
 	  D_created_(a.D_created_),
-	  alignment_(a.alignment_),
+	  D_reused_(a.D_reused_),
+	  alignment_(a.alignment_ ? new Alignment(*a.alignment_) : 0),
 	  def_scoring_view_(this),
 	  mod_scoring_view_(this),
 	  free_endgaps_(a.free_endgaps_)
-    {}
+    {
+	AlignerParams *params = new AlignerParams(*a.params_);
+	params->arena_ = 0L;
+	params_ = params;
+
+	for (size_t k=0; k<a.Ms_.size(); k++) {
+	    Ms_.push_back(M_matrix_t(a.Ms_[k],M_matrix_t::allocator_type()));
+	}
+    }
     
     Aligner::Aligner(const AlignerParams &ap) 
 	: pimpl_(new AlignerImpl(*(ap.seqA_),*(ap.seqB_),*(ap.arc_matches_),&ap,ap.scoring_))
@@ -124,34 +149,194 @@ namespace LocARNA {
 	: params_(new AlignerParams(*ap)),
 	  scoring_(s),
 	  mod_scoring_(0),
-	  seqA_(seqA), seqB_(seqB),
-	  arc_matches_(arc_matches),
-	  bpsA_(arc_matches_.get_base_pairsA()),
-	  bpsB_(arc_matches_.get_base_pairsB()),
+	  seqA_(&seqA), seqB_(&seqB),
+	  arc_matches_(&arc_matches),
+	  bpsA_(&arc_matches.get_base_pairsA()),
+	  bpsB_(&arc_matches.get_base_pairsB()),
 	  r_(1,1,seqA.length(),seqB.length()),
+	  dense_D_(true),
+	  D_cols_(0),
+	  arcmatch_M_size_(0),
+	  rowwise_top_level_(false),
+	  tl_rows_per_block_(1),
+	  tl_lru_(0),
 	  min_i_(1),
 	  min_j_(1),
 	  max_i_(seqA.length()),
 	  max_j_(seqB.length()),
 	  D_created_(false),
-	  alignment_(seqA,seqB),
+	  D_reused_(),
+	  alignment_(params_->score_only_ ? 0 : new Alignment(seqA,seqB)),
           def_scoring_view_(this),
           mod_scoring_view_(this),
           free_endgaps_(params_->free_endgaps_)
     {
-	Ms_.resize(params_->struct_local_?8:1);
+	init_matrices();
+    }
+
+    bool
+    AlignerImpl::use_dense_D() const {
+	const size_t num_arc_matches = arc_matches_->num_arc_matches();
+	const size_t num_arc_pairs = bpsA_->num_bps()*bpsB_->num_bps();
+
+	// sparse D stores an entry, a list entry and a position per
+	// arc match. This pays off only if few arc pairs are arc
+	// matches (e.g. due to --max-diff-am or --max-diff); then,
+	// the end lists are also faster to traverse (from about a
+	// third).
+	const size_t dense_bytes = num_arc_pairs*sizeof(infty_score_t);
+	const size_t sparse_bytes =
+	    num_arc_matches*( sizeof(infty_score_t)
+			      + sizeof(ArcMatchEndLists::entry_t)
+			      + sizeof(unsigned int) );
+
+	return dense_bytes <= sparse_bytes;
+    }
+
+    bool
+    AlignerImpl::use_rowwise_top_level() const {
+	if (params_->top_level_checkpoints_) return true;
+	if (!params_->score_only_) return false;
+
+	const size_t lenA = seqA_->length();
+	const size_t lenB = seqB_->length();
+
+	const size_t rowwise_bytes =
+	    ( arcmatch_M_size_ + 2*(lenB+1) + 2*(lenA+1) ) * sizeof(infty_score_t)
+	    + tl_context_col_.size() * (sizeof(unsigned int) + sizeof(infty_score_t))
+	    + tl_context_start_.size() * sizeof(size_type);
+	const size_t top_level_bytes =
+	    std::max(arcmatch_M_size_, (lenA+1)*(lenB+1)) * sizeof(infty_score_t);
+
+	return rowwise_bytes < top_level_bytes;
+    }
+
+    void
+    AlignerImpl::init_matrices() {
+	const size_type num_arc_matches = arc_matches_->num_arc_matches();
+	const size_type num_arc_pairs = bpsA_->num_bps()*bpsB_->num_bps();
+	const size_t num_Ms = params_->struct_local_?8:1;
+
+	dense_D_ = use_dense_D();
+
+	if (dense_D_) {
+	    D_cols_ = bpsB_->num_bps();
+	    right_end_lists_.clear();
+	} else {
+	    D_cols_ = 0;
+	    right_end_lists_.init(*arc_matches_);
+	}
+	const size_t D_size = dense_D_ ? num_arc_pairs : num_arc_matches;
+    
+	// with top level checkpoints or in score-only alignment, the
+	// M matrices are restricted to the arc match in
+	// align_in_arcmatch(); reserve the space of the largest arc
+	// match (and of the top level, if it is not computed row by
+	// row), such that the matrices are allocated only once
+	arcmatch_M_size_=0;
+	size_t top_level_M_size=0;
+	if (restricted_M()) {
+	    for (size_type idx=0; idx<arc_matches_->num_arc_matches(); idx++) {
+		const ArcMatch &am = arc_matches_->arcmatch(idx);
+		arcmatch_M_size_ = std::max(arcmatch_M_size_,
+					    (size_t)(am.arcA().right()-am.arcA().left()+1)
+					    * (am.arcB().right()-am.arcB().left()+1));
+	    }
+	    init_top_level_context();
+	}
+	rowwise_top_level_ = restricted_M() && use_rowwise_top_level();
+	if (!rowwise_top_level_) {
+	    // release the top level context
+	    std::vector<size_type>().swap(tl_context_start_);
+	    std::vector<unsigned int>().swap(tl_context_col_);
+	    ScoreVector().swap(tl_context_);
+	    if (restricted_M()) {
+		top_level_M_size = (size_t)(seqA_->length()+1)*(seqB_->length()+1);
+	    }
+	}
+
+	// size of the M matrices
+	std::vector<size_t> M_sizes(num_Ms, restricted_M()
+				    ? arcmatch_M_size_
+				    : (size_t)(seqA_->length()+1)*(seqB_->length()+1));
+	M_sizes[E_NO_NO] = std::max(M_sizes[E_NO_NO],top_level_M_size);
+
+	// D and the M matrices keep their capacity (see reset()),
+	// unless the arena changes. An arena frees the blocks of
+	// grown matrices only after all its blocks are freed;
+	// therefore, if D or an M matrix has to grow, release all
+	// of them, such that the arena rewinds.
+	D_vector_t::allocator_type alloc(params_->arena_);
+	bool release = Dmat_.get_allocator()!=alloc;
+	if (!release && alloc.arena()!=NULL) {
+	    release = Dmat_.capacity() < D_size;
+	    for (size_t k=0; k<std::min(num_Ms,Ms_.size()); k++) {
+		release = release || Ms_[k].capacity() < M_sizes[k];
+	    }
+	}
+	if (release) {
+	    D_vector_t(alloc).swap(Dmat_);
+	    Ms_.clear();
+	}
+
+	Dmat_.assign(D_size,infty_score_t::neg_infty);
+
+	// clearing keeps the capacity, but lets resize re-initialize
+	// all entries
+	Ms_.resize(num_Ms,M_matrix_t(alloc));
+	for (size_t k=0; k<num_Ms; k++) {
+	    Ms_[k].clear();
+	    if (!restricted_M()) {
+		Ms_[k].resize(seqA_->length()+1,seqB_->length()+1);
+	    } else {
+		Ms_[k].reserve(M_sizes[k]);
+	    }
+	}
+	tl_blocks_.assign(2,TopLevelBlock());
 	Es_.resize(params_->struct_local_?4:1);
 	Fs_.resize(params_->struct_local_?4:1);
-    
-	Dmat_.resize(bpsA_.num_bps(),bpsB_.num_bps());
-	Dmat_.fill(infty_score_t::neg_infty);
-    
-	for (size_t k=0; k<(params_->struct_local_?8:1); k++) {
-	    Ms_[k].resize(seqA_.length()+1,seqB_.length()+1);
-	}
 	for (size_t k=0; k<(params_->struct_local_?4:1); k++) {
-	    Es_[k].resize(seqB_.length()+1);
+	    Es_[k].clear();
+	    Es_[k].resize(seqB_->length()+1);
+	}
+    }
+
+    void
+    AlignerImpl::reset(const AlignerParams &ap) {
+	// copy first, ap might refer to *params_
+	AlignerParams *params = new AlignerParams(ap);
+	delete params_;
+	params_ = params;
+
+	scoring_ = params_->scoring_;
+	if (mod_scoring_!=0) {
+	    delete mod_scoring_;
+	    mod_scoring_=0;
 	}
+
+	seqA_ = params_->seqA_;
+	seqB_ = params_->seqB_;
+	arc_matches_ = params_->arc_matches_;
+	bpsA_ = &arc_matches_->get_base_pairsA();
+	bpsB_ = &arc_matches_->get_base_pairsB();
+
+	r_ = AlignerRestriction(1,1,seqA_->length(),seqB_->length());
+	min_i_ = 1;
+	min_j_ = 1;
+	max_i_ = seqA_->length();
+	max_j_ = seqB_->length();
+	D_created_ = false;
+	D_reused_.clear();
+	delete alignment_;
+	alignment_ = params_->score_only_ ? 0 : new Alignment(*seqA_,*seqB_);
+	free_endgaps_ = FreeEndgapsDescription(params_->free_endgaps_);
+
+	init_matrices();
+    }
+
+    void
+    Aligner::reset(const AlignerParams &ap) {
+	pimpl_->reset(ap);
     }
 
 
@@ -162,6 +347,8 @@ namespace LocARNA {
     	if (mod_scoring_!=0) {
             delete mod_scoring_;
         }
+
+	delete alignment_;
     }
 
     Aligner::~Aligner() {
@@ -170,11 +357,65 @@ namespace LocARNA {
 
     
     Alignment const & 
-    Aligner::get_alignment() const {return pimpl_->alignment_;} 
+    Aligner::get_alignment() const {
+	if (pimpl_->alignment_==0) {
+	    throw failure("Aligner: no alignment in score-only mode.");
+	}
+	return *pimpl_->alignment_;
+    } 
 
     void
     Aligner::set_alignment(const Alignment &alignment) {
-	pimpl_->alignment_ = alignment;
+	if (pimpl_->alignment_==0) {
+	    pimpl_->alignment_ = new Alignment(alignment);
+	} else {
+	    *pimpl_->alignment_ = alignment;
+	}
+    }
+
+    size_t
+    AlignerImpl::dp_memory(bool full) const {
+	size_t bytes = Dmat_.capacity()*sizeof(infty_score_t)
+	    + right_end_lists_.memory();
+
+	for (size_t k=0; k<Ms_.size(); k++) {
+	    bytes += ( full
+		       ? (seqA_->length()+1)*(seqB_->length()+1)
+		       : Ms_[k].capacity() ) * sizeof(infty_score_t);
+	}
+	for (size_t k=0; k<Es_.size(); k++) {
+	    bytes += Es_[k].capacity()*sizeof(infty_score_t);
+	}
+
+	if (!full) {
+	    // row-wise top level (see align_top_level_checkpointed)
+	    bytes += ( tl_first_col_.capacity() + tl_context_.capacity() )
+		* sizeof(infty_score_t)
+		+ tl_context_start_.capacity()*sizeof(size_type)
+		+ tl_context_col_.capacity()*sizeof(unsigned int);
+	    for (size_t c=0; c<tl_checkpoint_M_.size(); c++) {
+		bytes += ( tl_checkpoint_M_[c].capacity() + tl_checkpoint_E_[c].capacity() )
+		    * sizeof(infty_score_t);
+	    }
+	    for (size_t b=0; b<tl_blocks_.size(); b++) {
+		for (size_t r=0; r<tl_blocks_[b].M.size(); r++) {
+		    bytes += ( tl_blocks_[b].M[r].capacity() + tl_blocks_[b].E[r].capacity() )
+			* sizeof(infty_score_t);
+		}
+	    }
+	}
+
+	return bytes;
+    }
+
+    size_t
+    Aligner::dp_memory() const {
+	return pimpl_->dp_memory(false);
+    }
+
+    size_t
+    Aligner::full_dp_memory() const {
+	return pimpl_->dp_memory(true);
     }
     
 
@@ -237,9 +478,9 @@ namespace LocARNA {
 	// standard case for arc match (without restriction to lonely pairs)
 	//    
     
-	if ( params_->constraints_->allowed_edge(i,j) ) {
-	    const BasePairs::RightAdjList &adjlA = bpsA_.right_adjlist(i);
-	    const BasePairs::RightAdjList &adjlB = bpsB_.right_adjlist(j);
+	if ( params_->constraints_->allowed_edge(i,j) && dense_D_ ) {
+	    const BasePairs::RightAdjList &adjlA = bpsA_->right_adjlist(i);
+	    const BasePairs::RightAdjList &adjlB = bpsB_->right_adjlist(j);
 	
 	    // for all pairs of arcs in A and B that have right ends i and j, respectively
 	    //
@@ -263,6 +504,36 @@ namespace LocARNA {
 		    }
 		}
 	    }
+	} else if ( params_->constraints_->allowed_edge(i,j) ) {
+	    const ArcMatchIdxVec &list = arc_matches_->common_right_end_list(i,j);
+	    size_type k = right_end_lists_.begin(list);
+	    const size_type end = right_end_lists_.end(list);
+	
+	    // for all arc matches with right ends i and j; since D
+	    // is stored per arc match in the order of the list, we
+	    // iterate over the (valid) arc matches only. The list is
+	    // sorted lexicographically descending by the left ends.
+	    //
+	    while ( k<end ) {
+		const ArcMatchEndLists::entry_t &entry = right_end_lists_[k];
+		
+		if ( entry.endA <= al ) break;
+		if ( entry.endB <= bl ) {
+		    // the remaining entries with this left end in A
+		    // have even smaller left ends in B
+		    k = entry.next_endA;
+		    continue;
+		}
+		
+		tainted_infty_score_t new_score =
+		    M(entry.endA-1,entry.endB-1)
+		    + sv.D_at(k);
+		
+		if (new_score > max_score) {
+		    max_score=new_score;
+		}
+		++k;
+	    }
 	}
     
 	return max_score;
@@ -438,12 +709,17 @@ namespace LocARNA {
 
 	// cout << al << " " << ar <<" " << bl << " " << br <<endl;
 
-	// When using RMatrix as type of the M matrices,
-	// the M matrix/matrices can be restricted to the range of the arc match
-	// for (pos_type state=0; state < ((allow_exclusion)?8:1); state++) {
-	//std::cout <<state<<" "<<Ms_[state].sizes().first<<" "<<Ms_[state].sizes().second<<" "<<al<<" "<<ar<<" "<<bl<<" "<<br<<std::endl; 
-	//Ms_[state].restrict(al,ar-1,bl,br-1);
-	// }
+	// With top level checkpoints or in score-only alignment, the
+	// M matrices are restricted to the range of the arc match.
+	// This is safe, since all entries of the range are written
+	// before they are read and the trace back reads M of an arc
+	// match only before it descends into the next (inner) arc
+	// match.
+	if (restricted_M()) {
+	    for (size_t state=0; state < ((allow_exclusion)?8:1); state++) {
+		Ms_[state].resize(ar-al+1,br-bl+1,al,bl);
+	    }
+	}
     
     
 	// if in a sequence the state is not open than gaps with cost scoring->gap() have to be introduced.
@@ -596,10 +872,10 @@ namespace LocARNA {
     void 
     AlignerImpl::fill_D_entries(pos_type al, pos_type bl)
     {
-	for(ArcMatchIdxVec::const_iterator it=arc_matches_.common_left_end_list(al,bl).begin();
-	    arc_matches_.common_left_end_list(al,bl).end() != it; ++it ) {
+	for(ArcMatchIdxVec::const_iterator it=arc_matches_->common_left_end_list(al,bl).begin();
+	    arc_matches_->common_left_end_list(al,bl).end() != it; ++it ) {
 	
-	    const ArcMatch &am = arc_matches_.arcmatch(*it);
+	    const ArcMatch &am = arc_matches_->arcmatch(*it);
 	
 	    const Arc &arcA=am.arcA();
 	    const Arc &arcB=am.arcB();
@@ -623,11 +899,11 @@ namespace LocARNA {
 	    //std::cout <<"["<< am.arcA() << "," <<am.arcB() <<"]:" << D(am) << std::endl;
 
 	    if (scoring_->stacking()) {
-		if (arc_matches_.exists_inner_arc_match(am)
+		if (arc_matches_->exists_inner_arc_match(am)
 		    &&
 		    scoring_->is_stackable_am(am)
 		    ) {
-		    const ArcMatch &inner_am = arc_matches_.inner_arc_match(am);
+		    const ArcMatch &inner_am = arc_matches_->inner_arc_match(am);
 		
 		    D(am) =
 			std::max(D(am),
@@ -641,10 +917,10 @@ namespace LocARNA {
     AlignerImpl::fill_D_entries_noLP(pos_type al, pos_type bl) {
 	// get adj lists of arcs starting in al-1, bl-1
     
-	for(ArcMatchIdxVec::const_iterator it=arc_matches_.common_left_end_list(al-1,bl-1).begin();
-	    arc_matches_.common_left_end_list(al-1,bl-1).end() != it; ++it ) {
+	for(ArcMatchIdxVec::const_iterator it=arc_matches_->common_left_end_list(al-1,bl-1).begin();
+	    arc_matches_->common_left_end_list(al-1,bl-1).end() != it; ++it ) {
 	
-	    const ArcMatch &am = arc_matches_.arcmatch(*it);
+	    const ArcMatch &am = arc_matches_->arcmatch(*it);
 	
 	    pos_type ar = am.arcA().right()-1;
 	    pos_type br = am.arcB().right()-1;
@@ -653,11 +929,11 @@ namespace LocARNA {
 	    // therefore check whether inner arc exists
 	    // if stacking scores are used, the am has to be stackable to the inner arc,
 	    // i.e. the joint probabilities have to be greater than 0
-	    if (arc_matches_.exists_inner_arc_match(am)
+	    if (arc_matches_->exists_inner_arc_match(am)
 		&&
 		( ! scoring_->stacking() || scoring_->is_stackable_am(am) )
 		) { 
-		const ArcMatch& inner_am = arc_matches_.inner_arc_match(am);
+		const ArcMatch& inner_am = arc_matches_->inner_arc_match(am);
 	    
 		infty_score_t m=Ms_[0](ar-1,br-1);
 		if (params_->struct_local_) {
@@ -714,6 +990,9 @@ namespace LocARNA {
 			&& params_->trace_controller_->is_valid_match(al,bl) )
 		    ) continue;
 	    
+		// skip if all D entries are reused from a related alignment
+		if (!D_reused_.empty() && all_D_reused(al,bl)) continue;
+
 		// ------------------------------------------------------------
 		// get maximal right ends of arcs with left ends al,bl 
 		// where max_diff_am conditions hold
@@ -725,7 +1004,7 @@ namespace LocARNA {
 	    
 		// get the maximal right ends of any arc match with left ends (al,bl)
 		// in noLP mode, we don't consider cases without immediately enclosing arc match
-		arc_matches_.get_max_right_ends(al,bl,
+		arc_matches_->get_max_right_ends(al,bl,
 						&max_ar,&max_br,params_->no_lonely_pairs_);
 	    
 		// check whether there is an arc match at all
@@ -753,11 +1032,56 @@ namespace LocARNA {
 	D_created_=true; // now the matrix D is built up
     }
 
+    void
+    AlignerImpl::reuse_D(const AlignerImpl &base,
+			 const std::vector<size_t> &base_idx) {
+	assert(base.D_created_);
+	assert(base_idx.size()==arc_matches_->num_arc_matches());
+
+	const size_type invalid_idx = base.arc_matches_->num_arc_matches();
+
+	D_reused_.assign(arc_matches_->num_arc_matches(),false);
+	for (size_type idx=0; idx<base_idx.size(); ++idx) {
+	    if (base_idx[idx]==invalid_idx) continue;
+	    Dmat_[D_pos(arc_matches_->arcmatch(idx))] =
+		base.Dmat_[base.D_pos(base.arc_matches_->arcmatch(base_idx[idx]))];
+	    D_reused_[idx]=true;
+	}
+	D_created_=false;
+    }
+
+    bool
+    AlignerImpl::all_D_reused(pos_type al, pos_type bl) const {
+	// in noLP mode, the entries of the arc matches with left
+	// ends al-1,bl-1 are filled (see fill_D_entries_noLP)
+	const ArcMatchIdxVec &list = params_->no_lonely_pairs_
+	    ? arc_matches_->common_left_end_list(al-1,bl-1)
+	    : arc_matches_->common_left_end_list(al,bl);
+
+	for (ArcMatchIdxVec::const_iterator it=list.begin(); list.end()!=it; ++it) {
+	    if (!D_reused_[*it]) return false;
+	}
+	return true;
+    }
+
+
+    void
+    AlignerImpl::restrict_top_level_M() {
+	if (restricted_M()) {
+	    Ms_[E_NO_NO].resize(r_.endA()-r_.startA()+2,r_.endB()-r_.startB()+2,
+				r_.startA()-1,r_.startB()-1);
+	}
+    }
 
     // align the top level in case of free end gaps
     //
     infty_score_t
     AlignerImpl::align_top_level_free_endgaps() {
+
+	if (rowwise_top_level()) {
+	    return align_top_level_checkpointed(def_scoring_view_);
+	}
+	restrict_top_level_M();
     
 	M_matrix_t &M=Ms_[E_NO_NO];
 	    
@@ -836,6 +1160,11 @@ namespace LocARNA {
     infty_score_t
     AlignerImpl::align_top_level_locally(ScoringView sv) {
 	//std::cout << r << std::endl;
+
+	if (rowwise_top_level()) {
+	    return align_top_level_checkpointed(sv);
+	}
+	restrict_top_level_M();
     
 	M_matrix_t &M=Ms_[E_NO_NO];
 	infty_score_t max_score=(infty_score_t)0; // 0 is the worst possible score of any local alignment
@@ -887,6 +1216,363 @@ namespace LocARNA {
     }
 
 
+    // ------------------------------------------------------------
+    // top level with checkpoints
+    //
+    // The top level M is computed row by row. Only every
+    // tl_rows_per_block_-th row is kept (together with the
+    // corresponding row of E); during the trace back, the rows in
+    // between are recomputed from the preceding checkpoint in
+    // blocks. Arc matches refer to the top level entry left of their
+    // left ends, which is kept in tl_context_ for each pair of left
+    // ends of arc matches; thus, no row needs to be accessed that is
+    // more than one row above the current row. The arc matches of a
+    // row are traversed via the common right end lists of
+    // ArcMatches. In score-only alignment, there is no trace back
+    // and no checkpoints are kept; then, only two rows are kept at
+    // any time (besides tl_context_). Since the context can be as
+    // large as M, the top level M is kept instead, if it is smaller
+    // (see rowwise_top_level()).
+
+    template <class ScoringView>
+    void
+    AlignerImpl::init_top_level_rows(bool globalA, bool globalB,
+				     ScoreVector &row, ScoringView sv) {
+	const pos_type al = r_.startA()-1;
+	const pos_type bl = r_.startB()-1;
+
+	Es_[E_NO_NO].assign(seqB_->length()+1,infty_score_t::neg_infty);
+    
+	// init first col bl
+	//
+	tl_first_col_.assign(seqA_->length()+1,infty_score_t::neg_infty);
+	tl_first_col_[al] = (infty_score_t)0;
+
+	infty_score_t indel_score=(infty_score_t)sv.scoring()->indel_opening();
+	if (!globalA) {
+	    indel_score = (infty_score_t)0;
+	}
+
+	for (pos_type i=al+1; i<=r_.endA(); i++) {
+	    if (params_->trace_controller_->min_col(i)>bl) break; // fill only as long as column bl is accessible
+
+	    if (!indel_score.is_neg_infty()) {
+		if (params_->constraints_->aligned_in_a(i)) {
+		    indel_score=infty_score_t::neg_infty;
+		}
+		else if (globalA) {
+		    indel_score += sv.scoring()->gapA(i);
+		}
+	    }
+	    tl_first_col_[i] = indel_score;
+	}
+
+	// init first row al
+	//
+	row.assign(seqB_->length()+1,infty_score_t::neg_infty);
+	row[bl] = (infty_score_t)0;
+
+	indel_score=(infty_score_t)sv.scoring()->indel_opening();
+	if (!globalB) {
+	    indel_score = (infty_score_t)0;
+	}
+
+	for (pos_type j=bl+1 ; j < std::min(r_.endB()+1, params_->trace_controller_->max_col(al)+1) ; j++) {
+	    if (!indel_score.is_neg_infty()) {
+		if (params_->constraints_->aligned_in_b(j)) {
+		    indel_score=infty_score_t::neg_infty;
+		}
+		else if (globalB) {
+		    indel_score += sv.scoring()->gapB(j);
+		}
+	    }
+	    row[j] = indel_score;
+	}
+    }
+
+    void
+    AlignerImpl::init_top_level_context() {
+	tl_context_start_.resize(seqA_->length()+2);
+	tl_context_col_.clear();
+	tl_context_start_[0]=0;
+	for (pos_type al=0; al<=seqA_->length(); al++) {
+	    tl_context_start_[al] = tl_context_col_.size();
+	    if (al==0) continue;
+	    for (pos_type bl=1; bl<=seqB_->length(); bl++) {
+		if (!arc_matches_->common_left_end_list(al,bl).empty()) {
+		    tl_context_col_.push_back(bl);
+		}
+	    }
+	}
+	tl_context_start_[seqA_->length()+1] = tl_context_col_.size();
+    }
+
+    size_type
+    AlignerImpl::top_level_context_pos(const ArcMatch &am) const {
+	const pos_type al = am.arcA().left();
+	const unsigned int bl = am.arcB().left();
+	return std::lower_bound(tl_context_col_.begin()+tl_context_start_[al],
+				tl_context_col_.begin()+tl_context_start_[al+1],
+				bl)
+	    - tl_context_col_.begin();
+    }
+
+    void
+    AlignerImpl::set_top_level_context(pos_type i, const ScoreVector &row) {
+	if (i+1 > seqA_->length()) return;
+
+	for (size_type k=tl_context_start_[i+1]; k<tl_context_start_[i+2]; k++) {
+	    tl_context_[k] = row[tl_context_col_[k]-1];
+	}
+    }
+
+    template <class ScoringView>
+    void
+    AlignerImpl::align_top_level_row(pos_type i, const ScoreVector &prev,
+				     ScoreVector &row, ScoringView sv) {
+	const pos_type al = r_.startA()-1;
+	const pos_type bl = r_.startB()-1;
+
+	ScoreVector &E = Es_[E_NO_NO];
+	infty_score_t &F = Fs_[E_NO_NO];
+
+	AnchorConstraints::size_pair_t left_anchor = params_->constraints_->leftmost_anchor();
+
+	// entries that are not computed are not accessible
+	// (compare init_state)
+	row.assign(seqB_->length()+1,infty_score_t::neg_infty);
+	if (params_->trace_controller_->min_col(i)<=bl) {
+	    row[bl] = tl_first_col_[i];
+	}
+
+	F=infty_score_t::neg_infty;
+
+	// limit entries due to trace controller
+	pos_type min_col = std::max(r_.startB(),params_->trace_controller_->min_col(i));
+	pos_type max_col = std::min(r_.endB(),params_->trace_controller_->max_col(i));
+
+	for (pos_type j=min_col; j<=max_col; j++) {
+	    // the following corresponds to align_noex(E_NO_NO,al,bl,i,j,sv)
+
+	    if ( (! params_->constraints_->aligned_in_a(i)) ) {
+		E[j] = 
+		    std::max( E[j] + sv.scoring()->gapA(i),
+			      prev[j] + sv.scoring()->gapA(i) + sv.scoring()->indel_opening() );
+	    } else {
+		E[j] = infty_score_t::neg_infty;
+	    }
+
+	    if ( (! params_->constraints_->aligned_in_b(j)) ) {
+		F=std::max( F + sv.scoring()->gapB(j),
+			    row[j-1] + sv.scoring()->gapB(j) + sv.scoring()->indel_opening() );
+	    } else {
+		F = infty_score_t::neg_infty;
+	    }
+
+	    tainted_infty_score_t max_score = infty_score_t::neg_infty;
+
+	    // base match
+	    if (params_->constraints_->allowed_edge(i,j)) {
+		max_score = prev[j-1] + sv.scoring()->basematch(i,j);
+	    }
+
+	    // base del
+	    max_score=std::max(max_score, (tainted_infty_score_t)E[j]);
+
+	    // base ins
+	    max_score=std::max(max_score, (tainted_infty_score_t)F);
+
+	    // arc match; the list is sorted lexicographically
+	    // descending by the left ends
+	    if ( params_->constraints_->allowed_edge(i,j) ) {
+		const ArcMatchIdxVec &list = arc_matches_->common_right_end_list(i,j);
+		for (ArcMatchIdxVec::const_iterator it=list.begin(); list.end()!=it; ++it) {
+		    const ArcMatch &am = arc_matches_->arcmatch(*it);
+
+		    if ( am.arcA().left() <= al ) break;
+		    if ( am.arcB().left() <= bl ) continue;
+
+		    tainted_infty_score_t new_score =
+			tl_context_[top_level_context_pos(am)]
+			+ sv.D(am);
+
+		    if (new_score > max_score) {
+			max_score=new_score;
+		    }
+		}
+	    }
+
+	    row[j] = max_score;
+
+	    // score can be 0 (= drop prefix alignment) only if this is allowed due to constraints
+	    if ( params_->sequ_local_ && i<left_anchor.first && j<left_anchor.second ) {
+		row[j] = std::max( (infty_score_t)0, row[j] );
+	    }
+	}
+    }
+
+    template<class ScoringView>
+    infty_score_t
+    AlignerImpl::align_top_level_checkpointed(ScoringView sv) {
+	const pos_type al = r_.startA()-1;
+
+	// blocks of sqrt(n) rows balance the space for the checkpoints
+	// and the recomputed rows
+	tl_rows_per_block_ =
+	    std::max((pos_type)1, (pos_type)ceil(sqrt((double)(r_.endA()-al))));
+
+	tl_checkpoint_M_.clear();
+	tl_checkpoint_E_.clear();
+	tl_blocks_.assign(2,TopLevelBlock());
+	tl_lru_=0;
+	tl_context_.assign(tl_context_col_.size(),infty_score_t::neg_infty);
+
+	ScoreVector prev;
+	ScoreVector row;
+
+	if (params_->sequ_local_) {
+	    init_top_level_rows(false,false,prev,sv);
+	} else {
+	    init_top_level_rows(!free_endgaps_.allow_left_2(),
+				!free_endgaps_.allow_left_1(),
+				prev,sv);
+	}
+
+	const bool checkpoints = !params_->score_only_;
+
+	if (checkpoints) {
+	    tl_checkpoint_M_.push_back(prev);
+	    tl_checkpoint_E_.push_back(Es_[E_NO_NO]);
+	}
+	set_top_level_context(al,prev);
+
+	// need to handle anchor constraints:
+	// search maximum to the right of (or at) rightmost anchor constraint
+	//
+	AnchorConstraints::size_pair_t right_anchor = params_->constraints_->rightmost_anchor();
+
+	// sequence local: 0 is the worst possible score of any local alignment
+	infty_score_t max_score=(infty_score_t)0;
+	max_i_ = r_.startA()-1;
+	max_j_ = r_.startB()-1;
+
+	// entries of the last column r_.endB() (for free end gaps)
+	ScoreVector last_col(seqA_->length()+1,infty_score_t::neg_infty);
+	last_col[al] = prev[r_.endB()];
+
+	for (pos_type i=r_.startA(); i<=r_.endA(); i++) {
+	    align_top_level_row(i,prev,row,sv);
+	    set_top_level_context(i,row);
+
+	    if (params_->sequ_local_) {
+		// limit entries due to trace controller
+		pos_type min_col = std::max(r_.startB(),params_->trace_controller_->min_col(i));
+		pos_type max_col = std::min(r_.endB(),params_->trace_controller_->max_col(i));
+
+		for (pos_type j=min_col; j<=max_col; j++) {
+		    if (i>=right_anchor.first && j>=right_anchor.second && max_score < row[j]) {
+			max_score=row[j];
+			max_i_ = i;
+			max_j_ = j;
+		    }
+		}
+	    } else {
+		last_col[i] = row[r_.endB()];
+	    }
+
+	    if (checkpoints && (i-al)%tl_rows_per_block_ == 0) {
+		tl_checkpoint_M_.push_back(row);
+		tl_checkpoint_E_.push_back(Es_[E_NO_NO]);
+	    }
+
+	    prev.swap(row);
+	}
+
+	if (params_->sequ_local_) {
+	    return max_score;
+	}
+
+	// free end gaps; here, prev is the last row r_.endA()
+	// (see align_top_level_free_endgaps)
+
+	max_score=prev[r_.endB()];
+	max_i_=r_.endA();
+	max_j_=r_.endB();
+
+	if (free_endgaps_.allow_right_2()) {
+	    for (pos_type i=std::max(right_anchor.first+1,r_.startA()); i<=r_.endA(); i++) {
+		if ( params_->trace_controller_->max_col(i)>=r_.endB() && last_col[i] > max_score ) {
+		    max_score = last_col[i];
+		    max_i_=i; 
+		    max_j_=r_.endB();
+		}
+	    }
+	}
+
+	if (free_endgaps_.allow_right_1()) {
+	    // limit entries due to trace controller
+	    pos_type min_col = std::max(std::max(right_anchor.second+1,r_.startB()),params_->trace_controller_->min_col(r_.endA()));
+	    pos_type max_col = std::min(r_.endB(),params_->trace_controller_->max_col(r_.endA()));
+
+	    for (pos_type j=min_col; j<=max_col; j++) {
+		if ( prev[j] > max_score ) {
+		    max_score = prev[j];
+		    max_i_=r_.endA();
+		    max_j_=j;
+		}
+	    }
+	}
+
+	return max_score;
+    }
+
+    template<class ScoringView>
+    infty_score_t
+    AlignerImpl::top_level_entry(pos_type i, pos_type j, bool gapA,
+				 ScoringView sv) {
+	const pos_type al = r_.startA()-1;
+	const pos_type K = tl_rows_per_block_;
+
+	assert(al<=i && i<=r_.endA());
+
+	if ((i-al)%K == 0) {
+	    const size_type c = (i-al)/K;
+	    return gapA ? tl_checkpoint_E_[c][j] : tl_checkpoint_M_[c][j];
+	}
+
+	const long b = (i-al-1)/K;
+
+	size_t slot;
+	if (tl_blocks_[0].block==b) {
+	    slot=0;
+	} else if (tl_blocks_[1].block==b) {
+	    slot=1;
+	} else {
+	    // recompute the block from its checkpoint; the trace
+	    // back moves upwards, such that usually each block is
+	    // computed once
+	    slot=tl_lru_;
+	    TopLevelBlock &blk = tl_blocks_[slot];
+	    blk.M.resize(K);
+	    blk.E.resize(K);
+
+	    Es_[E_NO_NO] = tl_checkpoint_E_[b];
+	    const ScoreVector *prev = &tl_checkpoint_M_[b];
+	    for (pos_type r=0; r<K && al+b*K+1+r<=r_.endA(); r++) {
+		align_top_level_row(al+b*K+1+r,*prev,blk.M[r],sv);
+		blk.E[r] = Es_[E_NO_NO];
+		prev = &blk.M[r];
+	    }
+	    blk.block=b;
+	}
+	tl_lru_ = 1-slot;
+
+	const TopLevelBlock &blk = tl_blocks_[slot];
+	const size_type r = (i-al-1)%K;
+	return gapA ? blk.E[r][j] : blk.M[r][j];
+    }
+
+
     /*
     // special top level alignment for the scanning version
     // ATTENTION: no special anchor constraint handling done here (seems not very useful anyway)
@@ -958,6 +1644,13 @@ namespace LocARNA {
 	return pimpl_->align();
     }
 
+    infty_score_t
+    Aligner::align_reusing(const Aligner &base,
+			   const std::vector<size_t> &base_idx) {
+	pimpl_->reuse_D(*base.pimpl_,base_idx);
+	return pimpl_->align();
+    }
+
 
     // ------------------------------------------------------------
     // Aligner: traceback
@@ -981,21 +1674,21 @@ namespace LocARNA {
 	// handle case of stacking
 	if ( scoring_->stacking() ) {
 	
-	    if (arc_matches_.exists_inner_arc_match(am)) { 
-		const ArcMatch &inner_am = arc_matches_.inner_arc_match(am);
+	    if (arc_matches_->exists_inner_arc_match(am)) { 
+		const ArcMatch &inner_am = arc_matches_->inner_arc_match(am);
 	    
 		if (D(am) == D(inner_am) + scoring_->arcmatch(am,true)) {
 		    
 		    const Arc & arcAI = inner_am.arcA();
 		    const Arc & arcBI = inner_am.arcB();
 		
-		    alignment_.add_basepairA(arcAI.left(),arcAI.right());
-		    alignment_.add_basepairB(arcBI.left(),arcBI.right());
-		    alignment_.append(arcAI.left(),arcBI.left());
+		    alignment_->add_basepairA(arcAI.left(),arcAI.right());
+		    alignment_->add_basepairB(arcBI.left(),arcBI.right());
+		    alignment_->append(arcAI.left(),arcBI.left());
 		
 		    trace_arcmatch(inner_am);
 		
-		    alignment_.append(arcAI.right(),arcBI.right());
+		    alignment_->append(arcAI.right(),arcBI.right());
 		
 		    return;
 		}
@@ -1031,16 +1724,16 @@ namespace LocARNA {
 	assert(params_->trace_controller_->is_valid_match(am.arcA().right(),am.arcB().right()));
     
     
-	assert(arc_matches_.exists_inner_arc_match(am));
+	assert(arc_matches_->exists_inner_arc_match(am));
     
-	const ArcMatch &inner_am = arc_matches_.inner_arc_match(am);
+	const ArcMatch &inner_am = arc_matches_->inner_arc_match(am);
 
 	const Arc & arcAI = inner_am.arcA();
 	const Arc & arcBI = inner_am.arcB();
     
-	alignment_.add_basepairA(arcAI.left(),arcAI.right());
-	alignment_.add_basepairB(arcBI.left(),arcBI.right());
-	alignment_.append(arcAI.left(),arcBI.left());
+	alignment_->add_basepairA(arcAI.left(),arcAI.right());
+	alignment_->add_basepairB(arcBI.left(),arcBI.right());
+	alignment_->append(arcAI.left(),arcBI.left());
     
 	if (D(am) == D(inner_am) + scoring_->arcmatch(am,scoring_->stacking())) {
 	    trace_arcmatch_noLP(inner_am);
@@ -1064,7 +1757,7 @@ namespace LocARNA {
 		}
 	    }
 	}
-	alignment_.append(arcAI.right(),arcBI.right());
+	alignment_->append(arcAI.right(),arcBI.right());
     }
 
     // trace and handle all cases that do not involve exclusions
@@ -1074,7 +1767,8 @@ namespace LocARNA {
 			    pos_type obl,pos_type j,
 			    bool tl,
 			    ScoringView sv) {
-	M_matrix_t &M=Ms_[state];
+	// on the top level, rows are possibly recomputed from checkpoints
+	const infty_score_t M_ij = M_entry(state,i,j,tl,sv);
     
 	// determine where we get M(i,j) from
     
@@ -1083,9 +1777,9 @@ namespace LocARNA {
 	// match
 	if ( params_->constraints_->allowed_edge(i,j)
 	     && params_->trace_controller_->is_valid(i-1,j-1)
-	     && M(i,j) ==  M(i-1,j-1)+sv.scoring()->basematch(i,j) ) {
+	     && M_ij == M_entry(state,i-1,j-1,tl,sv)+sv.scoring()->basematch(i,j) ) {
 	    trace_in_arcmatch(state,oal,i-1,obl,j-1,tl,sv);
-	    alignment_.append(i,j);
+	    alignment_->append(i,j);
 	    return;
 	}
 
@@ -1093,17 +1787,17 @@ namespace LocARNA {
 	    // del
 	    if ( (!params_->constraints_->aligned_in_a(i))
 		 && params_->trace_controller_->is_valid(i-1,j)
-		 && M(i,j) == M(i-1,j)+sv.scoring()->gapA(i)) {
+		 && M_ij == M_entry(state,i-1,j,tl,sv)+sv.scoring()->gapA(i)) {
 		trace_in_arcmatch(state,oal,i-1,obl,j,tl,sv);
-		alignment_.append(i,-1);
+		alignment_->append(i,-1);
 		return;
 	    }
 	    // ins
 	    if ( (!params_->constraints_->aligned_in_b(j))
 		 && params_->trace_controller_->is_valid(i,j-1)
-		 && M(i,j) == M(i,j-1)+sv.scoring()->gapB(j)) {
+		 && M_ij == M_entry(state,i,j-1,tl,sv)+sv.scoring()->gapB(j)) {
 		trace_in_arcmatch(state,oal,i,obl,j-1,tl,sv);
-		alignment_.append(-1,j);
+		alignment_->append(-1,j);
 		return;
 	    }
 	} else { // base del and ins, affine cost
@@ -1111,8 +1805,16 @@ namespace LocARNA {
 	    // we do the traceback in linear time per entry
 	    // base del
 	    score_t gap_cost=sv.scoring()->indel_opening();
+
+	    // with top level checkpoints, the scan would recompute
+	    // rows far above i; thus, scan only if M(i,j) stems from
+	    // a deletion
+	    bool scan_del = ! (tl && params_->top_level_checkpoints_)
+		|| M_ij == top_level_entry(i,j,true,sv);
+	    
 	    for (pos_type k=1;
-		 (i >= oal+k)
+		 scan_del
+		     && (i >= oal+k)
 		     && (! params_->constraints_->aligned_in_a(i-k+1));
 		 k++)
 		{
@@ -1122,11 +1824,11 @@ namespace LocARNA {
 
 		    gap_cost += sv.scoring()->gapA(i-k+1);
 	    
-		    if ( M(i,j) == M(i-k,j) + gap_cost) {
+		    if ( M_ij == M_entry(state,i-k,j,tl,sv) + gap_cost) {
 			// gap in A of length k
 			trace_in_arcmatch(state,oal,i-k,obl,j,tl,sv);
 			for (pos_type l=k;l>0;l--) {
-			    alignment_.append(i-l+1,-1);
+			    alignment_->append(i-l+1,-1);
 			}
 			return;
 		    }
@@ -1144,11 +1846,11 @@ namespace LocARNA {
 		    if (! params_->trace_controller_->is_valid(i,j-k)) break;
 
 		    gap_cost += sv.scoring()->gapB(j-k+1);
-		    if (M(i,j) == M(i,j-k) + gap_cost) {
+		    if (M_ij == M_entry(state,i,j-k,tl,sv) + gap_cost) {
 			// gap in B of length k
 			trace_in_arcmatch(state,oal,i,obl,j-k,tl,sv);
 			for (pos_type l=k;l>0;l--) {
-			    alignment_.append(-1,j-l+1);
+			    alignment_->append(-1,j-l+1);
 			}
 		
 			return;
@@ -1168,14 +1870,14 @@ namespace LocARNA {
 	const pos_type &ar=i;
 	const pos_type &br=j;
     
-	for(ArcMatchIdxVec::const_iterator it=arc_matches_.common_right_end_list(ar,br).begin();
-	    arc_matches_.common_right_end_list(ar,br).end() != it; ++it ) {
+	for(ArcMatchIdxVec::const_iterator it=arc_matches_->common_right_end_list(ar,br).begin();
+	    arc_matches_->common_right_end_list(ar,br).end() != it; ++it ) {
 	
 	    // NOTES: *it is the arc match index
 	    //        we iterate only over valid arc matches, i.e.
 	    //        constraints (including anchor c. and heuristic ones) are satisified
 	
-	    const ArcMatch &am = arc_matches_.arcmatch(*it);
+	    const ArcMatch &am = arc_matches_->arcmatch(*it);
 	
 	    const Arc &arcA=am.arcA();
 	    const Arc &arcB=am.arcB();
@@ -1185,7 +1887,13 @@ namespace LocARNA {
 	    const pos_type al=arcA.left();
 	    const pos_type bl=arcB.left();
 	    
-	    if ( M(i,j) == M(al-1,bl-1) + sv.D(am)) {
+	    // top level entry left of the arc match
+	    const infty_score_t M_left =
+		(tl && params_->top_level_checkpoints_)
+		? tl_context_[top_level_context_pos(am)]
+		: Ms_[state](al-1,bl-1);
+
+	    if ( M_ij == M_left + sv.D(am)) {
 		//
 		// do the trace for alignment left of the arc match
 		trace_in_arcmatch(state,oal,al-1,obl,bl-1,tl,sv);
@@ -1193,9 +1901,9 @@ namespace LocARNA {
 		//cout << "arcmatch "<<(al)<<","<<i<<";"<<(bl)<<","<<j<<" :: "
 		//      <<(arcA->w)<<" + "<<(arcB->w)<< " + " << tau(al,bl,i,j)  <<endl;
 	    
-		alignment_.add_basepairA(al,ar);
-		alignment_.add_basepairB(bl,br);
-		alignment_.append(al,bl);
+		alignment_->add_basepairA(al,ar);
+		alignment_->add_basepairB(bl,br);
+		alignment_->append(al,bl);
 	    
 		// do the trace below the arc match
 	    
@@ -1205,7 +1913,7 @@ namespace LocARNA {
 		    trace_arcmatch(am);
 		}
 	    
-		alignment_.append(ar,br);
+		alignment_->append(ar,br);
 	    
 		return;
 	    }
@@ -1234,7 +1942,7 @@ namespace LocARNA {
 	// * trace on toplevel
 	// * sequence local, and
 	// * entry == 0
-	if (tl && params_->sequ_local_ && M(i,j)==(infty_score_t)0) {
+	if (tl && params_->sequ_local_ && M_entry(state,i,j,tl,sv)==(infty_score_t)0) {
 	    min_i_=i;
 	    min_j_=j;
 	    return;
@@ -1249,7 +1957,7 @@ namespace LocARNA {
 		if (!(tl && 
 		      (params_->sequ_local_ || free_endgaps_.allow_left_1()))) {
 		    for (int k=bl+1;k<=j;k++) {
-			alignment_.append(-1,k);
+			alignment_->append(-1,k);
 		    }
 		}
 	    } else {
@@ -1267,7 +1975,7 @@ namespace LocARNA {
 		if (!(tl && 
 		      ( params_->sequ_local_ || free_endgaps_.allow_left_2()))) {
 		    for (int k=al+1;k<=i;k++) {
-			alignment_.append(k,-1);
+			alignment_->append(k,-1);
 		    }
 		}
 	    } else {
@@ -1339,9 +2047,13 @@ namespace LocARNA {
 	// pre: last call align_in_arcmatch(r_.startA()-1,r_.endA()+1,r_.startB()-1,r_.endB()+1);
 	//      or align_top_level_locally for sequ_local_ alignent
     
+	if (params_->score_only_) {
+	    throw failure("Aligner: no trace back in score-only mode.");
+	}
+
 	// reset the alignment strings (to empty strings)
 	// such that they can be written again during the trace
-	alignment_.clear();
+	alignment_->clear();
     
 	trace_in_arcmatch(E_NO_NO,r_.startA()-1,max_i_,r_.startB()-1,max_j_,true,sv);
     }
@@ -1491,6 +2203,10 @@ namespace LocARNA {
     infty_score_t
     Aligner::normalized_align(score_t L, bool opt_verbose) {
     
+	if (pimpl_->params_->score_only_) {
+	    throw failure("Aligner: no normalized alignment in score-only mode.");
+	}
+
 	// The D matrix is filled as in non-normalized alignment. Because
 	// alignments of the subsequences enclosed by arcs are essentially
 	// global, their scores can be optimized in the same way as for
@@ -1521,7 +2237,7 @@ namespace LocARNA {
 	
 		infty_score_t score = pimpl_->align_top_level_locally(pimpl_->mod_scoring_view_);
 	
-		pimpl_->alignment_.clear();
+		pimpl_->alignment_->clear();
 	
 		// perform a traceback for normalized alignment
 		pimpl_->trace(pimpl_->mod_scoring_view_);
@@ -1540,7 +2256,7 @@ namespace LocARNA {
 		if (opt_verbose) std::cout << "Score: "<<score<<" Length: "<<length<<" Normalized Score: "<<new_lambda<<std::endl;
 
 		if (opt_verbose) {
-		    MultipleAlignment ma(pimpl_->alignment_,true);
+		    MultipleAlignment ma(*pimpl_->alignment_,true);
 		    std::cout << "Score: "<<(infty_score_t)new_lambda<<std::endl;
 		    ma.write(std::cout,120);
 		}
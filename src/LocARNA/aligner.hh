@@ -103,9 +103,31 @@ namespace LocARNA {
 	//! destructor
 	~Aligner();
 
-	//! return the alignment that was computed by trace()
-	Alignment const & 
-	get_alignment() const; 
+	/** 
+	 * @brief Retarget the aligner to new parameters
+	 * 
+	 * @param ap parameters, typically for a new pair of sequences
+	 * with its arc matches and scoring (set via named parameters
+	 * like on construction)
+	 *
+	 * The aligner behaves like a newly constructed object,
+	 * however the dynamic programming matrices keep their
+	 * capacity; they are only reallocated if the new pair needs
+	 * more space than all previous ones. This avoids memory
+	 * allocation when aligning many pairs in a loop.
+	 *
+	 * @note as on construction, the aligner keeps references to
+	 * the objects in ap.
+	 */
+	void
+	reset(const AlignerParams &ap);
+
+	/**
+	 * @brief return the alignment that was computed by trace()
+	 * @throw failure in score-only mode (see AlignerParams::score_only())
+	 */
+	Alignment const &
+	get_alignment() const;
 
 	/** 
 	 * @brief set the alignment
@@ -121,10 +143,58 @@ namespace LocARNA {
 	//! compute the alignment score
 	infty_score_t
 	align();
+
+	/**
+	 * @brief Compute the alignment score, reusing D entries of a
+	 * related alignment
+	 *
+	 * @param base aligner of a related alignment problem (of
+	 * sequences of the same lengths), after align()
+	 * @param base_idx for each arc match of this aligner, the
+	 * index of the arc match of base with equal D entry, or
+	 * base's number of arc matches if the entry must be
+	 * recomputed
+	 *
+	 * Copies the reused entries from base and skips all pairs of
+	 * left ends, where all D entries are reused; everything else
+	 * is computed as in align(). The result is only correct if
+	 * the reused entries are equal in both problems; see
+	 * VariantAligner for deriving base_idx. Base is only read.
+	 */
+	infty_score_t
+	align_reusing(const Aligner &base,
+		      const std::vector<size_t> &base_idx);
     
-	//! offer trace as public method. Calls trace(def_scoring_view).
+	/**
+	 * @brief offer trace as public method. Calls trace(def_scoring_view).
+	 * @throw failure in score-only mode (see AlignerParams::score_only())
+	 */
 	void
 	trace();
+
+	/**
+	 * @brief Memory of the dynamic programming matrices
+	 *
+	 * @return memory in bytes, which is allocated for the D and
+	 * M matrices, the rows E, the compact end lists (for sparse
+	 * D) and the top level rows and context, if any
+	 *
+	 * @note after align(), this reports the working set of the
+	 * alignment; compare to full_dp_memory() for the savings of
+	 * top level checkpoints or score-only alignment
+	 */
+	size_t
+	dp_memory() const;
+
+	/**
+	 * @brief Memory of the dynamic programming matrices, if M is
+	 * kept for the trace back
+	 *
+	 * @return memory in bytes, which is required, if the M
+	 * matrices are not restricted (see dp_memory())
+	 */
+	size_t
+	full_dp_memory() const;
     
 	/**
 	 * set the restriction on the alignment,
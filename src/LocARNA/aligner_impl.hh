@@ -12,11 +12,12 @@
 #include "alignment.hh"
 #include "arc_matches.hh"
 #include "params.hh"
+#include "matrices.hh"
+#include "arena.hh"
 
 namespace LocARNA {
 
     class Sequence;
-    template <class T> class Matrix;
 
     /**
      * @brief Implementation of Aligner
@@ -26,8 +27,20 @@ namespace LocARNA {
 	/**
 	 * type of matrix M
 	 * @note 'typedef RMtrix<infty_score_t> M_matrix_t;' didn't improve performance
+	 * @note the offset is used to restrict M to the current arc
+	 * match in case of top level checkpoints or score-only
+	 * alignment; otherwise, it is 0
+	 * @note the entries are allocated from the arena of the
+	 * parameters, if any (see AlignerParams::arena())
 	 */
-	typedef ScoreMatrix M_matrix_t;
+	typedef OMatrix<infty_score_t, ArenaAllocator<infty_score_t> > M_matrix_t;
+
+	/**
+	 * type of matrix D (see Dmat_)
+	 * @note the entries are allocated from the arena of the
+	 * parameters, if any
+	 */
+	typedef std::vector<infty_score_t, ArenaAllocator<infty_score_t> > D_vector_t;
 
 	//! an arc
 	typedef BasePairs__Arc Arc;
@@ -37,13 +50,16 @@ namespace LocARNA {
 	const Scoring *scoring_; //!< the scores
 	Scoring *mod_scoring_; //!< used in normalized scoring, when we need to modify the scoring
 	
-	const Sequence &seqA_; //!< sequence A
-	const Sequence &seqB_; //!< sequence B
+	// pointers instead of references, such that the aligner can be
+	// retargeted to a new pair of sequences by reset()
+
+	const Sequence *seqA_; //!< sequence A
+	const Sequence *seqB_; //!< sequence B
     
-	const ArcMatches &arc_matches_; //!< the potential arc matches between A and B
+	const ArcMatches *arc_matches_; //!< the potential arc matches between A and B
     
-	const BasePairs &bpsA_; //!< base pairs of A
-	const BasePairs &bpsB_; //!< base pairs of B
+	const BasePairs *bpsA_; //!< base pairs of A
+	const BasePairs *bpsB_; //!< base pairs of B
     
 	/**
 	   \brief restriction of alignment for k-best
@@ -63,8 +79,26 @@ namespace LocARNA {
 	*/
 	AlignerRestriction r_;
 
-	//! matrix indexed by the arc indices of rnas A and B
-	ScoreMatrix Dmat_;
+	/**
+	 * whether D is indexed by the arc indices of A and B (dense
+	 * D); otherwise, D holds only the entries of the arc matches
+	 * in the order of right_end_lists_ (see use_dense_D())
+	 */
+	bool dense_D_;
+
+	//! common right end lists of the arc matches (empty for dense
+	//! D)
+	ArcMatchEndLists right_end_lists_;
+
+	/**
+	 * matrix D, either indexed by the arc indices of A and B
+	 * (row-major), or with one entry per arc match in the order of
+	 * right_end_lists_
+	 */
+	D_vector_t Dmat_;
+
+	//! number of columns of dense D (arcs in B)
+	size_type D_cols_;
     
 	/**
 	 * M matrices
@@ -88,6 +122,62 @@ namespace LocARNA {
 	 * @see Es
 	*/
 	std::vector<infty_score_t> Fs_;
+
+	//! maximal size of M for an arc match (only set with
+	//! restricted M, see restricted_M())
+	size_t arcmatch_M_size_;
+
+	//! whether the top level is computed row by row (see
+	//! rowwise_top_level())
+	bool rowwise_top_level_;
+
+	/**
+	 * @brief Block of top level rows, recomputed from a checkpoint
+	 */
+	struct TopLevelBlock {
+	    long block; //!< index of the block (-1 if not computed)
+	    std::vector<ScoreVector> M; //!< rows of M
+	    std::vector<ScoreVector> E; //!< rows of E
+
+	    //! @brief construct as not computed
+	    TopLevelBlock(): block(-1), M(), E() {}
+	};
+
+	// The following members are only used with top level
+	// checkpoints (see AlignerParams::top_level_checkpoints()).
+	// Then, the top level M is stored row by row; rows with a
+	// distance of tl_rows_per_block_ to the first row are kept
+	// as checkpoints and the rows in between are recomputed
+	// blockwise during the traceback. In score-only alignment
+	// (see AlignerParams::score_only()), the top level is
+	// computed in the same way, but no checkpoints are kept.
+
+	pos_type tl_rows_per_block_; //!< distance of checkpoint rows
+	std::vector<ScoreVector> tl_checkpoint_M_; //!< M rows at the checkpoints
+	std::vector<ScoreVector> tl_checkpoint_E_; //!< E rows at the checkpoints
+	ScoreVector tl_first_col_; //!< first column of the top level M
+
+	// The top level context of the arc matches is stored per
+	// pair of left ends (al,bl), which is shared by all arc
+	// matches with these left ends. Only the pairs with arc
+	// matches are indexed, row by row (i.e. by al).
+
+	//! start of the context pairs with left end al in A, for all
+	//! al (with sentinel)
+	std::vector<size_type> tl_context_start_;
+
+	//! left end in B of each context pair; sorted within a row
+	std::vector<unsigned int> tl_context_col_;
+
+	/**
+	 * top level M entry left of each context pair (i.e. at the
+	 * left ends minus one); this replaces access to rows that
+	 * are not kept
+	 */
+	ScoreVector tl_context_;
+
+	std::vector<TopLevelBlock> tl_blocks_; //!< cached blocks of recomputed rows
+	size_t tl_lru_; //!< index of the cached block that is replaced next
     
 	int min_i_; //!< subsequence of A left end, computed by trace back
 	int min_j_; //!< subsequence of B left end, computed by trace back
@@ -96,8 +186,12 @@ namespace LocARNA {
 	int max_j_; //!< subsequence of B right end, computed by align_top_level
     
 	bool D_created_; //!< flag, is D already created?
+
+	//! per arc match, whether its D entry is reused from a
+	//! related alignment (empty, if no entry is reused)
+	std::vector<bool> D_reused_;
     
-	Alignment alignment_; //!< resulting alignment
+	Alignment *alignment_; //!< resulting alignment (0 in score-only alignment)
     
 	/**
 	 * \brief different states for computation of structure-local alignment.
@@ -142,24 +236,36 @@ namespace LocARNA {
 	    /** 
 	     * View on matrix D
 	     * 
+	     * @param am arc match
+	     * 
+	     * @return D matrix entry for arc match am
+	     */
+	    infty_score_t D(const ArcMatch &am) const {
+		return aligner_impl_->Dmat_[aligner_impl_->D_pos(am)];
+	    }
+
+	    /** 
+	     * View on matrix D (only for dense D)
+	     * 
 	     * @param a arc in A
 	     * @param b arc in B
 	     * 
 	     * @return D matrix entry for match of a and b
 	     */
 	    infty_score_t D(const Arc &a, const Arc &b) const {
-		return aligner_impl_->Dmat_(a.idx(),b.idx());
+		return aligner_impl_->Dmat_[aligner_impl_->D_pos(a,b)];
 	    }
-	
+
 	    /** 
-	     * View on matrix D
+	     * View on matrix D by position in the right end lists
+	     * (only if D is not dense)
 	     * 
-	     * @param am arc match
+	     * @param pos position in right_end_lists_
 	     * 
-	     * @return D matrix entry for arc match am
+	     * @return D matrix entry at pos
 	     */
-	    infty_score_t D(const ArcMatch &am) const {
-		return D(am.arcA(),am.arcB());
+	    infty_score_t D_at(size_type pos) const {
+		return aligner_impl_->Dmat_[pos];
 	    }
 	};
     
@@ -221,26 +327,39 @@ namespace LocARNA {
 	    /** 
 	     * View on matrix D
 	     * 
+	     * @param am arc match
+	     * 
+	     * @return modified D matrix entry for arc match am
+	     */
+	    infty_score_t D(const ArcMatch &am) const {
+		return aligner_impl_->Dmat_[aligner_impl_->D_pos(am)]
+		    -FiniteInt(lambda_*(arc_length(am.arcA())+arc_length(am.arcB())));
+	    }
+
+	    /** 
+	     * View on matrix D (only for dense D)
+	     * 
 	     * @param a arc in A
 	     * @param b arc in B
 	     * 
 	     * @return modified D matrix entry for match of a and b
 	     */
-	    infty_score_t D(const Arc &a,const Arc &b) const {
-		return aligner_impl_->Dmat_(a.idx(),b.idx())
+	    infty_score_t D(const Arc &a, const Arc &b) const {
+		return aligner_impl_->Dmat_[aligner_impl_->D_pos(a,b)]
 		    -FiniteInt(lambda_*(arc_length(a)+arc_length(b)));
 	    }
 
 	    /** 
-	     * View on matrix D
+	     * View on matrix D by position in the right end lists
+	     * (only if D is not dense)
 	     * 
-	     * @param am arc match
+	     * @param pos position in right_end_lists_
 	     * 
-	     * @return modified D matrix entry for arc match am
+	     * @return modified D matrix entry at pos
 	     */
-	    infty_score_t D(const ArcMatch &am) const {
-		return aligner_impl_->Dmat_(am.arcA().idx(),am.arcB().idx())
-		    -FiniteInt(lambda_*(arc_length(am.arcA())+arc_length(am.arcB())));
+	    infty_score_t D_at(size_type pos) const {
+		return D(aligner_impl_->arc_matches_
+			 ->arcmatch(aligner_impl_->right_end_lists_[pos].idx));
 	    }
 	};
     
@@ -278,6 +397,88 @@ namespace LocARNA {
 	 * Destructor
 	 */
 	~AlignerImpl();
+
+	/** 
+	 * @brief Retarget to new sequences, arc matches and scoring
+	 * 
+	 * @param ap parameters (copied)
+	 *
+	 * @see Aligner::reset()
+	 */
+	void
+	reset(const AlignerParams &ap);
+
+	/**
+	 * @brief Whether M is restricted to the current arc match
+	 *
+	 * @return whether the M matrices are restricted to the range
+	 * of the current arc match and the top level is computed row
+	 * by row (with top level checkpoints or in score-only
+	 * alignment)
+	 */
+	bool
+	restricted_M() const {
+	    return params_->top_level_checkpoints_ || params_->score_only_;
+	}
+
+	/**
+	 * @brief Whether the top level is computed row by row
+	 *
+	 * @return true with top level checkpoints; in score-only
+	 * alignment, whether this needs less space than keeping
+	 * the top level M (see use_rowwise_top_level())
+	 */
+	bool
+	rowwise_top_level() const { return rowwise_top_level_; }
+
+	/**
+	 * @brief Decide whether to compute the top level row by row
+	 *
+	 * @return true with top level checkpoints; in score-only
+	 * alignment, whether the row by row computation needs less
+	 * space than keeping the top level M, which then replaces
+	 * the M of the largest arc match. The row by row
+	 * computation keeps the M of the largest arc match, the top
+	 * level context with its index (see tl_context_), two rows
+	 * and two columns.
+	 *
+	 * @pre arcmatch_M_size_ and the index of the top level
+	 * context are initialized
+	 * @note the compact end lists of sparse D are needed in
+	 * either case and are not compared
+	 */
+	bool
+	use_rowwise_top_level() const;
+
+	/**
+	 * @brief Restrict M of the top level to the restriction r_
+	 *
+	 * In score-only alignment, when the top level is not computed
+	 * row by row, M of state E_NO_NO is resized like for an arc
+	 * match enclosing the restriction.
+	 */
+	void
+	restrict_top_level_M();
+
+	/**
+	 * @brief Memory of the dynamic programming matrices
+	 *
+	 * @param full whether to count the M matrices as unrestricted
+	 * (sequence length squared), i.e. as kept for the trace back
+	 * @return allocated memory in bytes
+	 * @see Aligner::dp_memory()
+	 */
+	size_t
+	dp_memory(bool full) const;
+
+	/** 
+	 * @brief Size the matrices for the current sequences
+	 *
+	 * Matrices are (re-)initialized like freshly constructed
+	 * ones; already allocated capacity is kept.
+	 */
+	void
+	init_matrices();
 	
 	// ============================================================
 	
@@ -366,6 +567,110 @@ namespace LocARNA {
     
 	//! align top level in the scanning version
 	// infty_score_t align_top_level_localB();
+
+	/**
+	 * @brief Align the top level keeping only checkpoint rows
+	 *
+	 * Handles free end gaps as well as sequence local alignment
+	 * (depending on params_->sequ_local_); sets max_i_, max_j_
+	 * like align_top_level_free_endgaps() and
+	 * align_top_level_locally(), respectively.
+	 *
+	 * @param sv scoring view
+	 * @return the maximal score
+	 */
+	template<class ScoringView>
+	infty_score_t align_top_level_checkpointed(ScoringView sv);
+
+	/**
+	 * @brief Initialize first row and column of the top level
+	 *
+	 * Analogous to init_state() for state E_NO_NO; sets
+	 * tl_first_col_ and Es_[E_NO_NO].
+	 *
+	 * @param globalA allow no free deletion of prefix of sequence A
+	 * @param globalB analogous for sequence B
+	 * @param[out] row first row of the top level
+	 * @param sv scoring view
+	 */
+	template<class ScoringView>
+	void init_top_level_rows(bool globalA, bool globalB,
+				 ScoreVector &row, ScoringView sv);
+
+	/**
+	 * @brief Index the pairs of left ends of the arc matches
+	 *
+	 * Initializes tl_context_start_ and tl_context_col_.
+	 */
+	void init_top_level_context();
+
+	/**
+	 * @brief Position of the top level context of an arc match
+	 *
+	 * @param am arc match
+	 * @return position in tl_context_
+	 */
+	size_type top_level_context_pos(const ArcMatch &am) const;
+
+	/**
+	 * @brief Set the top level context of the arc matches with left end i+1 in A
+	 *
+	 * @param i row
+	 * @param row row i of the top level M
+	 * @see tl_context_
+	 */
+	void set_top_level_context(pos_type i, const ScoreVector &row);
+
+	/**
+	 * @brief Compute one row of the top level M
+	 *
+	 * The recursion is the one of align_noex() for state E_NO_NO,
+	 * but arc matches are scored with the entries in tl_context_.
+	 * Es_[E_NO_NO] is updated from row i-1 to row i.
+	 *
+	 * @param i the row
+	 * @param prev row i-1
+	 * @param[out] row row i
+	 * @param sv scoring view
+	 */
+	template<class ScoringView>
+	void align_top_level_row(pos_type i, const ScoreVector &prev,
+				 ScoreVector &row, ScoringView sv);
+
+	/**
+	 * @brief Entry of the top level M or E
+	 *
+	 * Recomputes the block of rows that contains i from its
+	 * checkpoint, unless it is cached.
+	 *
+	 * @param i row
+	 * @param j column
+	 * @param gapA whether to return the entry of E instead of M
+	 * @param sv scoring view (as used for the top level)
+	 * @return entry (i,j)
+	 */
+	template<class ScoringView>
+	infty_score_t top_level_entry(pos_type i, pos_type j, bool gapA,
+				      ScoringView sv);
+
+	/**
+	 * @brief Entry of M during the trace back
+	 *
+	 * @param state the state
+	 * @param i row
+	 * @param j column
+	 * @param top_level whether on top level
+	 * @param sv scoring view
+	 * @return entry (i,j) of the M matrix of state
+	 */
+	template<class ScoringView>
+	infty_score_t M_entry(int state, pos_type i, pos_type j, bool top_level,
+			      ScoringView sv) {
+	    if (top_level && params_->top_level_checkpoints_) {
+		return top_level_entry(i,j,false,sv);
+	    }
+	    return Ms_[state](i,j);
+	}
   
 	/** 
 	 * \brief trace back within an match of arcs
@@ -421,6 +726,24 @@ namespace LocARNA {
 	*/
 	void align_D();
 
+	/**
+	 * @brief Copy D entries of a related alignment
+	 * @param base aligner of the related alignment, after align()
+	 * @param base_idx for each arc match, index of the arc match
+	 * in base or base's number of arc matches (see
+	 * Aligner::align_reusing())
+	 */
+	void
+	reuse_D(const AlignerImpl &base,
+		const std::vector<size_t> &base_idx);
+
+	/**
+	 * @brief Whether all D entries, which are filled after
+	 * aligning under left ends al,bl, are reused
+	 */
+	bool
+	all_D_reused(pos_type al, pos_type bl) const;
+
 	/**
 	   fill in D the entries with left ends al,bl
 	*/
@@ -446,21 +769,49 @@ namespace LocARNA {
 	 * @return entry of D matrix for am
 	 */
 	infty_score_t &D(const ArcMatch &am) {
-	    return Dmat_(am.arcA().idx(),am.arcB().idx());
+	    return Dmat_[D_pos(am)];
 	}
 
-	/** 
-	 * Read/Write access to D matrix
-	 * 
-	 * @param arcA arc in sequence A
-	 * @param arcB arc in sequence B
-	 * 
-	 * @return entry of D matrix for match of arcA and arcB
+	/**
+	 * Position of the match of two arcs in dense D
+	 *
+	 * @param arcA arc in A
+	 * @param arcB arc in B
+	 *
+	 * @return position in Dmat_
 	 */
-	infty_score_t &D(const Arc &arcA,const Arc &arcB) {
-	    return Dmat_(arcA.idx(),arcB.idx());
+	size_type
+	D_pos(const Arc &arcA, const Arc &arcB) const {
+	    return arcA.idx()*D_cols_+arcB.idx();
 	}
 
+	/**
+	 * Position of an arc match in D
+	 *
+	 * @param am arc match
+	 *
+	 * @return position in Dmat_
+	 */
+	size_type
+	D_pos(const ArcMatch &am) const {
+	    return dense_D_
+		? D_pos(am.arcA(),am.arcB())
+		: right_end_lists_.pos(am.idx());
+	}
+
+	/**
+	 * @brief Whether to use dense D
+	 *
+	 * @return whether D is indexed by arc pairs (see dense_D_)
+	 *
+	 * Dense D is used unless sparse D, i.e. D per arc match
+	 * together with the compact common right end lists, needs
+	 * less memory. Then, only few arc pairs are arc matches, such
+	 * that traversing the end lists is faster, too.
+	 */
+	bool
+	use_dense_D() const;
+
 	/**
 	 * do the trace back through the alignment matrix
 	 * with partial recomputation
@@ -24,8 +24,10 @@ namespace LocARNA {
     // AlignerN: align / compute similarity
     //
 
+    // the copy allocates its matrices from the heap, since it might
+    // be used by another thread than the owner of the arena
     AlignerN::AlignerN(const AlignerN &a)
-	: params(new AlignerNParams(*a.params)),
+	: params(0),
 	  scoring(a.scoring),
 	  mod_scoring(0),
 	  seqA(a.seqA),
@@ -36,16 +38,18 @@ namespace LocARNA {
 	  bpsA(a.bpsA),
 	  bpsB(a.bpsB),
 	  r(a.r),
-	  Dmat(a.Dmat),
-	  IAmat(a.IAmat),
-	  IBmat(a.IBmat),
-	  IADmat(a.IADmat),
-	  IBDmat(a.IBDmat),
-	  Emat(a.Emat),
-	  Fmat(a.Fmat),
-	  M(a.M),
-	  gapCostAmat(a.gapCostAmat),
-	  gapCostBmat(a.gapCostBmat),
+	  Dmat(a.Dmat,DP_matrix_t::allocator_type()),
+	  IAmat(a.IAmat,DP_matrix_t::allocator_type()),
+	  IBmat(a.IBmat,DP_matrix_t::allocator_type()),
+	  IADmat(a.IADmat,DP_matrix_t::allocator_type()),
+	  IBDmat(a.IBDmat,DP_matrix_t::allocator_type()),
+	  Emat(a.Emat,DP_matrix_t::allocator_type()),
+	  Fmat(a.Fmat,DP_matrix_t::allocator_type()),
+	  M(a.M,DP_matrix_t::allocator_type()),
+	  gapCostAprefix(a.gapCostAprefix),
+	  gapBlockedAprefix(a.gapBlockedAprefix),
+	  gapCostBprefix(a.gapCostBprefix),
+	  gapBlockedBprefix(a.gapBlockedBprefix),
 	  min_i(a.min_i),
 	  min_j(a.min_j),
 	  max_i(a.max_i),
@@ -54,7 +58,11 @@ namespace LocARNA {
 	alignment(a.alignment),
 	def_scoring_view(this),
 	mod_scoring_view(this) 
-    {}
+    {
+	AlignerNParams *params_copy = new AlignerNParams(*a.params);
+	params_copy->arena_ = 0L;
+	params = params_copy;
+    }
 
     AlignerN::AlignerN(const AlignerParams &ap_)
 	: params(new AlignerNParams(dynamic_cast<const AlignerNParams &>(ap_))),
@@ -67,6 +75,14 @@ namespace LocARNA {
 	  bpsA(params->arc_matches_->get_base_pairsA()),
 	  bpsB(params->arc_matches_->get_base_pairsB()),
 	  r(1,1,params->seqA_->length(),params->seqB_->length()),
+	  Dmat(DP_matrix_t::allocator_type(params->arena_)),
+	  IAmat(DP_matrix_t::allocator_type(params->arena_)),
+	  IBmat(DP_matrix_t::allocator_type(params->arena_)),
+	  IADmat(DP_matrix_t::allocator_type(params->arena_)),
+	  IBDmat(DP_matrix_t::allocator_type(params->arena_)),
+	  Emat(DP_matrix_t::allocator_type(params->arena_)),
+	  Fmat(DP_matrix_t::allocator_type(params->arena_)),
+	  M(DP_matrix_t::allocator_type(params->arena_)),
 	  min_i(0),
 	  min_j(0),
 	  max_i(0),
@@ -94,10 +110,6 @@ namespace LocARNA {
 	Fmat.resize(mapperA.get_max_info_vec_size()+1, mapperB.get_max_info_vec_size()+1);
 
 
-	gapCostAmat.resize(seqA.length()+3, seqA.length()+3);
-	gapCostBmat.resize(seqB.length()+3, seqB.length()+3);
-
-
     }
 
 
@@ -108,8 +120,11 @@ namespace LocARNA {
 	if (mod_scoring!=0) delete mod_scoring;
     }
 
-    // Computes and stores score of aligning a the subsequence between
-    // different possible leftSides & rightSides to the gap
+    // Computes and stores the prefix sums of the gap costs, such that
+    // the score of aligning any subsequence to the gap is a
+    // difference of two entries. Positions that cannot be deleted
+    // (due to anchor constraints) are counted separately, since they
+    // make the cost of each range that contains them infinite.
     template <class ScoringView>
     void AlignerN::computeGapCosts(bool isA, ScoringView sv)
     {
@@ -117,28 +132,24 @@ namespace LocARNA {
 	    std::cout << "computeGapCosts " << (isA?'A':'B') << std::endl;
 	}
 	const Sequence& seqX = isA?seqA:seqB;
-	ScoreMatrix& gapCostXmat = isA?gapCostAmat:gapCostBmat;
-	for( pos_type leftSide = 0;  leftSide <= seqX.length(); leftSide++)
+	std::vector<score_t>& gapCostXprefix = isA?gapCostAprefix:gapCostBprefix;
+	std::vector<pos_type>& gapBlockedXprefix = isA?gapBlockedAprefix:gapBlockedBprefix;
+
+	gapCostXprefix.resize(seqX.length()+1);
+	gapBlockedXprefix.resize(seqX.length()+1);
+	gapCostXprefix[0] = 0;
+	gapBlockedXprefix[0] = 0;
+	for( pos_type pos = 1;  pos <= seqX.length(); pos++)
 	    {
-		infty_score_t gap_score = (infty_score_t)0;
-		gapCostXmat(leftSide, leftSide) = gap_score;
-		for( pos_type lastPos = leftSide+1;  lastPos <= seqX.length(); lastPos++)
-		    {
-			if ( (isA && params->constraints_->aligned_in_a(lastPos))
-			     || ( !isA && params->constraints_->aligned_in_b(lastPos)) ) {
-			    gap_score = infty_score_t::neg_infty;
-			    //		break;
-			}
-			else {
-			    gap_score += sv.scoring()->gapX( lastPos, isA);
-			}
-
-			gapCostXmat(leftSide,lastPos+1) = gap_score;
-		    }
-		/*for (;lastPos <= seqX.length(); lastPos++)
-		  {
-		  gapCostXmat(leftSide,lastPos+1) = gap_score;
-		  }*/
+		gapCostXprefix[pos] = gapCostXprefix[pos-1];
+		gapBlockedXprefix[pos] = gapBlockedXprefix[pos-1];
+		if ( (isA && params->constraints_->aligned_in_a(pos))
+		     || ( !isA && params->constraints_->aligned_in_b(pos)) ) {
+		    gapBlockedXprefix[pos]++;
+		}
+		else {
+		    gapCostXprefix[pos] += sv.scoring()->gapX( pos, isA);
+		}
 	    }
 	if (trace_debugging_output)
 	    std::cout << "computed computeGapCosts " << (isA?'A':'B') << std::endl;
@@ -149,14 +160,21 @@ namespace LocARNA {
     // rightSide to the gap, not including right/left side
     inline
     infty_score_t AlignerN::getGapCostBetween( pos_type leftSide, pos_type rightSide, bool isA)
-    //todo: Precompute the matrix?!
     {
 	//    if (trace_debugging_output) std::cout <<
 	//    "getGapCostBetween: leftSide:" << leftSide << "
 	//    rightSide:" << rightSide << "isA:" << isA << endl;
 	assert(leftSide < rightSide);
 
-	return (isA?gapCostAmat(leftSide,rightSide):gapCostBmat(leftSide, rightSide));
+	const std::vector<score_t>& gapCostXprefix = isA?gapCostAprefix:gapCostBprefix;
+	const std::vector<pos_type>& gapBlockedXprefix = isA?gapBlockedAprefix:gapBlockedBprefix;
+	assert(rightSide <= gapCostXprefix.size());
+
+	// the subsequence is leftSide+1..rightSide-1
+	if (gapBlockedXprefix[rightSide-1] != gapBlockedXprefix[leftSide]) {
+	    return infty_score_t::neg_infty;
+	}
+	return (infty_score_t)(gapCostXprefix[rightSide-1]-gapCostXprefix[leftSide]);
     }
 
 
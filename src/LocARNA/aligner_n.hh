@@ -15,6 +15,7 @@
 #include "scoring.hh"
 
 #include "matrix.hh"
+#include "arena.hh"
 
 #include "aligner_restriction.hh"
 
@@ -43,8 +44,15 @@ namespace LocARNA {
 
 
 
+	/**
+	 * type of the dynamic programming matrices
+	 * @note the entries are allocated from the arena of the
+	 * parameters, if any (see AlignerParams::arena())
+	 */
+	typedef Matrix<infty_score_t, ArenaAllocator<infty_score_t> > DP_matrix_t;
+
 	//! type of matrix M
-	typedef ScoreMatrix M_matrix_t;
+	typedef DP_matrix_t M_matrix_t;
 
     private:
 
@@ -67,24 +75,35 @@ namespace LocARNA {
 	//! restriction of AlignerN
 	AlignerRestriction r;
 
-	//! matrix indexed by the arc indices of rnas A and B
-	ScoreMatrix Dmat;
+	/**
+	 * matrix indexed by the arc indices of rnas A and B
+	 *
+	 * @note unlike in Aligner, D is not indexed by arc match:
+	 * the recursions of the sparsified matrices (arc deletion
+	 * in compute_IX, arc match in compute_M_entry and the trace
+	 * back) read D for pairs of arcs from the valid arcs of the
+	 * sparsification mappers, which are not arc matches in
+	 * general (then, D is -infinity). An index by arc match
+	 * would require a hash lookup of the arc pair in these
+	 * innermost loops.
+	 */
+	DP_matrix_t Dmat;
 
 	//! matrix indexed by positions of elements of the seqA positions and the arc indices of RNA B
-	ScoreMatrix IAmat;
+	DP_matrix_t IAmat;
 	//! matrix indexed by positions of elements of the seqB positions and the arc indices of RNA A
-	ScoreMatrix IBmat;
+	DP_matrix_t IBmat;
 
 
 	//! matrix indexed by positions of elements of the seqA positions and the arc indices of RNA B
-	ScoreMatrix IADmat;
+	DP_matrix_t IADmat;
 	//! matrix indexed by positions of elements of the seqB positions and the arc indices of RNA A
-	ScoreMatrix IBDmat;
+	DP_matrix_t IBDmat;
 
 	//! matrix for the affine gap cost model base deletion
-	ScoreMatrix Emat;
+	DP_matrix_t Emat;
 	//! matrix for the affine gap cost model base insertion
-	ScoreMatrix Fmat;
+	DP_matrix_t Fmat;
 
 	/**
 	 * @brief M matrix
@@ -93,15 +112,23 @@ namespace LocARNA {
 	 */
 	M_matrix_t M;
 
-	//! matrix to store cost of deleting/inserting a subsequence
-	//! of sequence A, indexed by neighboring positions of the
-	//! range
-	ScoreMatrix gapCostAmat;
+	//! prefix sums of the cost of deleting/inserting positions
+	//! of sequence A; entry p is the cost of positions 1..p,
+	//! ignoring positions that cannot be deleted
+	std::vector<score_t> gapCostAprefix;
+
+	//! prefix counts of the positions of sequence A that cannot
+	//! be deleted (due to anchor constraints); entry p counts
+	//! positions 1..p
+	std::vector<pos_type> gapBlockedAprefix;
 	
-	//! matrix to store cost of deleting/inserting a subsequence
-	//! of sequence B, indexed by neighboring positions of the
-	//! range
-	ScoreMatrix gapCostBmat; 
+	//! prefix sums of the cost of deleting/inserting positions
+	//! of sequence B, @see gapCostAprefix
+	std::vector<score_t> gapCostBprefix;
+
+	//! prefix counts of the positions of sequence B that cannot
+	//! be deleted, @see gapBlockedAprefix
+	std::vector<pos_type> gapBlockedBprefix;
 
 
 	int min_i; //!< subsequence of A left end, not used in sparse
@@ -3,6 +3,7 @@
 #include "sequence.hh"
 #include "arc_matches.hh"
 #include "trace_controller.hh"
+#include "sparse_mea_aligner.hh"
 
 #include <cmath>
 #include <cassert>
@@ -72,11 +73,16 @@ namespace LocARNA {
 	r(1, 1, seqA.length(), seqB.length()),
 	pf_scale(params->pf_scale_),
         partFunc(0.0),
-        //Dmat((pf_score_t )0),
-	//Dmatprime((pf_score_t )0),
+        Dmat(PF_matrix_t::allocator_type(params->arena_)),
         F(0.0),
+        M(PF_matrix_t::allocator_type(params->arena_)),
+        Mrev(PF_matrix_t::allocator_type(params->arena_)),
         Frev(0.0),
+        Erev_mat(PF_matrix_t::allocator_type(params->arena_)),
+        Frev_mat(PF_matrix_t::allocator_type(params->arena_)),
+        Dmatprime(PF_matrix_t::allocator_type(params->arena_)),
         Fprime(0.0),
+        Mprime(PF_matrix_t::allocator_type(params->arena_)),
 	am_prob(0.0),
 	bm_prob(0.0),
 	D_created(false),
@@ -85,8 +91,10 @@ namespace LocARNA {
     
     }
 
+    // the copy allocates its matrices from the heap, since it might
+    // be used by another thread than the owner of the arena
     AlignerP::AlignerP(const AlignerP &p) :
-	params(new AlignerPParams(*p.params)),
+	params(0),
 	scoring(p.scoring),
 	seqA(p.seqA),
 	bpsA(p.bpsA),
@@ -96,24 +104,27 @@ namespace LocARNA {
 	r(p.r),
 	pf_scale(p.pf_scale),
         partFunc(p.partFunc),
-        Dmat(p.Dmat),
+        Dmat(p.Dmat,PF_matrix_t::allocator_type()),
         E(p.E),
         F(p.F),
-        M(p.M),
-        Mrev(p.Mrev),
+        M(p.M,PF_matrix_t::allocator_type()),
+        Mrev(p.Mrev,PF_matrix_t::allocator_type()),
         Erev(p.Erev),
         Frev(p.Frev),
-        Erev_mat(p.Erev_mat),
-        Frev_mat(p.Frev_mat),
-        Dmatprime(p.Dmatprime),
+        Erev_mat(p.Erev_mat,PF_matrix_t::allocator_type()),
+        Frev_mat(p.Frev_mat,PF_matrix_t::allocator_type()),
+        Dmatprime(p.Dmatprime,PF_matrix_t::allocator_type()),
 	Eprime(p.Eprime),
         Fprime(p.Fprime),
-        Mprime(p.Mprime),
+        Mprime(p.Mprime,PF_matrix_t::allocator_type()),
         am_prob(p.am_prob),
 	bm_prob(p.bm_prob),
 	D_created(p.D_created),
 	Dprime_created(p.Dprime_created)
     {
+	AlignerPParams *params_copy = new AlignerPParams(*p.params);
+	params_copy->arena_ = 0L;
+	params = params_copy;
     }
 
     
@@ -1296,6 +1307,29 @@ namespace LocARNA {
 
 
 
+    //===========================================================================
+    // add match probabilities to sparse MEA aligner
+    //
+    void
+    AlignerP::add_match_probabilities(SparseMEAAligner &mea) const
+    {
+	for(SparsePFScoreMatrix::const_iterator it=bm_prob.begin(); bm_prob.end()!=it; ++it) {
+	    if (it->second>=params->min_bm_prob_) {
+		mea.add_basematch_prob(it->first.first,it->first.second,it->second);
+	    }
+	}
+
+	for(ArcMatches::const_iterator it=arc_matches.begin(); arc_matches.end()!=it; ++it) {
+	    const Arc &arcA=it->arcA();
+	    const Arc &arcB=it->arcB();
+	
+	    double amp = am_prob(arcA.idx(),arcB.idx());
+	    if (amp>=params->min_am_prob_) {
+		mea.add_arcmatch_prob(arcA.left(),arcA.right(),arcB.left(),arcB.right(),amp);
+	    }
+	}
+    }
+
     //===========================================================================
     // fragment match probabilities
     //
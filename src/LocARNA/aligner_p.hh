@@ -9,6 +9,7 @@
 #include "params.hh"
 
 #include "matrix.hh"
+#include "arena.hh"
 
 #include "sparse_matrix.hh"
 
@@ -22,6 +23,7 @@ namespace LocARNA {
     class BasePairs__Arc;
     class ArcMatch;
     class ArcMatches;
+    class SparseMEAAligner;
 
     //! matrix for storing probabilities
     typedef Matrix<double> ProbMatrix;
@@ -55,6 +57,14 @@ namespace LocARNA {
 	typedef std::pair<size_type,size_type> size_pair; //!< pair of size_type
     
 	typedef BasePairs__Arc Arc; //!< arc
+
+	/**
+	 * type of the matrices D, M and their reverse and outside
+	 * counterparts
+	 * @note the entries are allocated from the arena of the
+	 * parameters, if any (see AlignerParams::arena())
+	 */
+	typedef Matrix<pf_score_t, ArenaAllocator<pf_score_t> > PF_matrix_t;
     protected:
 	const AlignerPParams *params; //!< the parameter for the alignment
 	
@@ -93,7 +103,7 @@ namespace LocARNA {
 	   D(a,b) is the partition function of the subsequences seqA(al..ar) and seqB(bl..br),
 	   where the arcs a and b match
 	*/
-	PFScoreMatrix Dmat;
+	PF_matrix_t Dmat;
     
 
 	/**
@@ -122,14 +132,14 @@ namespace LocARNA {
 	   For the current pair of left arc ends (al,bl),
 	   M(i,j) is the partition function of the subsequences seqA(al+1..i) and seqB(bl+1..j)
 	*/
-	PFScoreMatrix M;
+	PF_matrix_t M;
 
 
 	/**
 	   For the current pair of left arc ends (al,bl),
 	   Mrev(i,j) is the partition function of the subsequences seqA(i+1..al-1) and seqB(j+1..bl-1)
 	*/
-	PFScoreMatrix Mrev;
+	PF_matrix_t Mrev;
   
 	/**
 	 * reverse E "matrix"
@@ -146,20 +156,20 @@ namespace LocARNA {
 	/**
 	   for outside optimization, store a complete copy of Erev and Frev
 	*/
-	PFScoreMatrix Erev_mat;
+	PF_matrix_t Erev_mat;
 	
 	/**
 	   complete copy of Frev
 	   @see Erev_mat
 	*/
-	PFScoreMatrix Frev_mat;
+	PF_matrix_t Frev_mat;
  
 
 	/**
 	   D'(a,b) is the partition function of the subsequences seqA(1..al-1,ar+1..lenA) and seqB(1..bl-1,br+1..lenB)
 	   times the contribution of the arc match (al,ar);(bl,br)
 	*/
-	PFScoreMatrix Dmatprime;
+	PF_matrix_t Dmatprime;
 
 	/**
 	   For the current pair of left arc ends (al,bl) and line i,
@@ -179,7 +189,7 @@ namespace LocARNA {
 	   For the current pair of left arc ends (al,bl),
 	   M'(i,j) is the partition function of the subsequences seqA(1..al-1,i+1..lenA) and seqB(1..bl-1,j+1..lenB)
 	*/
-	PFScoreMatrix Mprime;
+	PF_matrix_t Mprime;
         
 	//! probabilities of arc matchs, as computed by the algo
 	SparseProbMatrix am_prob;
@@ -485,6 +495,18 @@ namespace LocARNA {
 	 */
 	void
 	write_basematch_probabilities(std::ostream &out); 
+
+	/**
+	 * \brief add the match probabilities to a sparse MEA aligner
+	 *
+	 * Adds the base match and arc match probabilities, filtered by
+	 * the thresholds params->min_bm_prob and params->min_am_prob;
+	 * only the stored (sparse) entries are visited.
+	 *
+	 * @param mea sparse MEA aligner
+	 */
+	void
+	add_match_probabilities(SparseMEAAligner &mea) const;
     
 	/** 
 	 * \brief Access virtual Mprime matrix
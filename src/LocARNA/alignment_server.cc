@@ -0,0 +1,681 @@
+#include "alignment_server.hh"
+
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <cassert>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "rna_data.hh"
+#include "rna_ensemble.hh"
+#include "sequence.hh"
+#include "multiple_alignment.hh"
+#include "alignment.hh"
+#include "thread_pool.hh"
+
+namespace LocARNA {
+
+    //! @brief lock a mutex for the lifetime of the object
+    class ScopedLock {
+	pthread_mutex_t *mutex_;
+    public:
+	//! @brief lock
+	explicit
+	ScopedLock(pthread_mutex_t &mutex): mutex_(&mutex) { pthread_mutex_lock(mutex_); }
+
+	//! @brief unlock
+	~ScopedLock() { pthread_mutex_unlock(mutex_); }
+    };
+
+    // ------------------------------------------------------------
+    // JobRequest
+
+    //! @brief skip white space
+    static
+    void
+    skip_space(const std::string &s, size_t &pos) {
+	while (pos<s.length() && isspace(s[pos])) ++pos;
+    }
+
+    /**
+     * @brief parse the four hex digits of a \\u escape sequence
+     * @param s text
+     * @param[in,out] pos position of the digits; moved behind them
+     * @return code unit
+     * @throw failure if there are no four hex digits
+     */
+    static
+    unsigned long
+    parse_json_code_unit(const std::string &s, size_t &pos) {
+	unsigned long code=0;
+	for (size_t k=0; k<4; ++k, ++pos) {
+	    if (pos>=s.length() || !isxdigit((unsigned char)s[pos])) {
+		throw failure("JobRequest: invalid escape sequence.");
+	    }
+	    char c = s[pos];
+	    code = code*16 + (isdigit((unsigned char)c) ? c-'0' : tolower((unsigned char)c)-'a'+10);
+	}
+	return code;
+    }
+
+    //! @brief append a code point in UTF-8
+    static
+    void
+    append_utf8(std::string &res, unsigned long code) {
+	if (code<0x80) {
+	    res += (char)code;
+	} else if (code<0x800) {
+	    res += (char)(0xC0 | (code>>6));
+	    res += (char)(0x80 | (code & 0x3F));
+	} else if (code<0x10000) {
+	    res += (char)(0xE0 | (code>>12));
+	    res += (char)(0x80 | ((code>>6) & 0x3F));
+	    res += (char)(0x80 | (code & 0x3F));
+	} else {
+	    res += (char)(0xF0 | (code>>18));
+	    res += (char)(0x80 | ((code>>12) & 0x3F));
+	    res += (char)(0x80 | ((code>>6) & 0x3F));
+	    res += (char)(0x80 | (code & 0x3F));
+	}
+    }
+
+    //! @brief parse a JSON string starting at the opening quote
+    static
+    std::string
+    parse_json_string(const std::string &s, size_t &pos) {
+	assert(s[pos]=='"');
+	++pos;
+	std::string res;
+	while (pos<s.length() && s[pos]!='"') {
+	    char c = s[pos++];
+	    if (c!='\\') {
+		res += c;
+		continue;
+	    }
+	    if (pos>=s.length()) break;
+	    c = s[pos++];
+	    switch (c) {
+	    case '"': case '\\': case '/': res+=c; break;
+	    case 'b': res+='\b'; break;
+	    case 'f': res+='\f'; break;
+	    case 'n': res+='\n'; break;
+	    case 'r': res+='\r'; break;
+	    case 't': res+='\t'; break;
+	    case 'u': {
+		unsigned long code = parse_json_code_unit(s,pos);
+		if (0xDC00<=code && code<=0xDFFF) {
+		    throw failure("JobRequest: unpaired surrogate in escape sequence.");
+		}
+		if (0xD800<=code && code<=0xDBFF) {
+		    // code points beyond the basic plane are given by
+		    // a pair of a high and a low surrogate
+		    if (s.compare(pos,2,"\\u")!=0) {
+			throw failure("JobRequest: unpaired surrogate in escape sequence.");
+		    }
+		    pos+=2;
+		    unsigned long low = parse_json_code_unit(s,pos);
+		    if (!(0xDC00<=low && low<=0xDFFF)) {
+			throw failure("JobRequest: unpaired surrogate in escape sequence.");
+		    }
+		    code = 0x10000 + ((code-0xD800)<<10) + (low-0xDC00);
+		}
+		append_utf8(res,code);
+		break;
+	    }
+	    default:
+		throw failure("JobRequest: invalid escape sequence.");
+	    }
+	}
+	if (pos>=s.length()) {
+	    throw failure("JobRequest: unterminated string.");
+	}
+	++pos; // closing quote
+	return res;
+    }
+
+    //! @brief whether a literal is a number in JSON syntax
+    static
+    bool
+    is_json_number(const std::string &s) {
+	size_t pos=0;
+	if (pos<s.length() && s[pos]=='-') ++pos;
+	if (pos<s.length() && s[pos]=='0') {
+	    ++pos;
+	} else {
+	    if (!(pos<s.length() && isdigit((unsigned char)s[pos]))) return false;
+	    while (pos<s.length() && isdigit((unsigned char)s[pos])) ++pos;
+	}
+	if (pos<s.length() && s[pos]=='.') {
+	    ++pos;
+	    if (!(pos<s.length() && isdigit((unsigned char)s[pos]))) return false;
+	    while (pos<s.length() && isdigit((unsigned char)s[pos])) ++pos;
+	}
+	if (pos<s.length() && (s[pos]=='e' || s[pos]=='E')) {
+	    ++pos;
+	    if (pos<s.length() && (s[pos]=='+' || s[pos]=='-')) ++pos;
+	    if (!(pos<s.length() && isdigit((unsigned char)s[pos]))) return false;
+	    while (pos<s.length() && isdigit((unsigned char)s[pos])) ++pos;
+	}
+	return pos==s.length();
+    }
+
+    JobRequest::JobRequest(const std::string &line)
+	: values_()
+    {
+	size_t pos=0;
+	skip_space(line,pos);
+	if (pos>=line.length() || line[pos]!='{') {
+	    throw failure("JobRequest: expected JSON object.");
+	}
+	++pos;
+	skip_space(line,pos);
+	if (pos<line.length() && line[pos]=='}') {
+	    ++pos;
+	} else {
+	    while (true) {
+		skip_space(line,pos);
+		if (pos>=line.length() || line[pos]!='"') {
+		    throw failure("JobRequest: expected key.");
+		}
+		std::string key = parse_json_string(line,pos);
+
+		skip_space(line,pos);
+		if (pos>=line.length() || line[pos]!=':') {
+		    throw failure("JobRequest: expected ':' after key "+key+".");
+		}
+		++pos;
+		skip_space(line,pos);
+		if (pos>=line.length()) {
+		    throw failure("JobRequest: missing value of key "+key+".");
+		}
+
+		if (line[pos]=='"') {
+		    values_[key] = std::make_pair(STRING,parse_json_string(line,pos));
+		} else if (line[pos]=='{' || line[pos]=='[') {
+		    throw failure("JobRequest: nested value of key "+key+" not supported.");
+		} else {
+		    size_t start=pos;
+		    while (pos<line.length()
+			   && (isalnum(line[pos]) || line[pos]=='-'
+			       || line[pos]=='+' || line[pos]=='.')) {
+			++pos;
+		    }
+		    std::string literal = line.substr(start,pos-start);
+		    if (literal!="true" && literal!="false" && literal!="null"
+			&& !is_json_number(literal)) {
+			throw failure("JobRequest: invalid value of key "+key+".");
+		    }
+		    values_[key] = std::make_pair(LITERAL,literal);
+		}
+
+		skip_space(line,pos);
+		if (pos<line.length() && line[pos]==',') {
+		    ++pos;
+		    continue;
+		}
+		if (pos<line.length() && line[pos]=='}') {
+		    ++pos;
+		    break;
+		}
+		throw failure("JobRequest: expected ',' or '}'.");
+	    }
+	}
+	skip_space(line,pos);
+	if (pos!=line.length()) {
+	    throw failure("JobRequest: trailing characters after object.");
+	}
+    }
+
+    const std::pair<JobRequest::value_type,std::string> *
+    JobRequest::find(const std::string &key) const {
+	std::map<std::string, std::pair<value_type,std::string> >::const_iterator
+	    it = values_.find(key);
+	return it==values_.end() ? NULL : &it->second;
+    }
+
+    std::string
+    JobRequest::json(const std::string &key) const {
+	const std::pair<value_type,std::string> *value = find(key);
+	if (value==NULL) return "null";
+	return value->first==STRING ? json_quote(value->second) : value->second;
+    }
+
+    std::string
+    JobRequest::id() const {
+	const std::pair<value_type,std::string> *value = find("id");
+	if (value==NULL) return "null";
+	if (value->first!=STRING && !is_json_number(value->second)) {
+	    throw failure("JobRequest: id is neither a string nor a number.");
+	}
+	return json("id");
+    }
+
+    std::string
+    JobRequest::get_string(const std::string &key, const std::string &deflt) const {
+	const std::pair<value_type,std::string> *value = find(key);
+	if (value==NULL) return deflt;
+	if (value->first!=STRING) {
+	    throw failure("JobRequest: value of "+key+" is not a string.");
+	}
+	return value->second;
+    }
+
+    long
+    JobRequest::get_int(const std::string &key, long deflt) const {
+	const std::pair<value_type,std::string> *value = find(key);
+	if (value==NULL) return deflt;
+	const char *s = value->second.c_str();
+	char *end;
+	long x = strtol(s,&end,10);
+	if (value->first!=LITERAL || *s=='\0' || *end!='\0') {
+	    throw failure("JobRequest: value of "+key+" is not an integer.");
+	}
+	return x;
+    }
+
+    double
+    JobRequest::get_double(const std::string &key, double deflt) const {
+	const std::pair<value_type,std::string> *value = find(key);
+	if (value==NULL) return deflt;
+	const char *s = value->second.c_str();
+	char *end;
+	double x = strtod(s,&end);
+	if (value->first!=LITERAL || *s=='\0' || *end!='\0') {
+	    throw failure("JobRequest: value of "+key+" is not a number.");
+	}
+	return x;
+    }
+
+    bool
+    JobRequest::get_bool(const std::string &key, bool deflt) const {
+	const std::pair<value_type,std::string> *value = find(key);
+	if (value==NULL) return deflt;
+	if (value->first==LITERAL && value->second=="true") return true;
+	if (value->first==LITERAL && value->second=="false") return false;
+	throw failure("JobRequest: value of "+key+" is not a boolean.");
+    }
+
+    std::string
+    json_quote(const std::string &s) {
+	std::string res="\"";
+	for (size_t i=0; i<s.length(); ++i) {
+	    unsigned char c = s[i];
+	    switch (c) {
+	    case '"': res+="\\\""; break;
+	    case '\\': res+="\\\\"; break;
+	    case '\n': res+="\\n"; break;
+	    case '\r': res+="\\r"; break;
+	    case '\t': res+="\\t"; break;
+	    default:
+		if (c<0x20) {
+		    char buf[8];
+		    snprintf(buf,sizeof(buf),"\\u%04x",(unsigned int)c);
+		    res+=buf;
+		} else {
+		    res+=c;
+		}
+	    }
+	}
+	res+="\"";
+	return res;
+    }
+
+    // ------------------------------------------------------------
+    // AlignmentServer
+
+    //! @brief input RNA of jobs
+    struct AlignmentServer::Input {
+	const RnaData *rna_data; //!< the RNA (owned)
+	time_t mtime; //!< modification time of the file (if cached)
+	off_t size; //!< size of the file (if cached)
+	size_type users; //!< number of running jobs that use the input
+	size_type last_use; //!< value of input_clock_ on the last use
+	bool cached; //!< whether the input is in the cache
+    };
+
+    //! @brief run a job and write its result
+    class AlignmentServer::JobTask : public ThreadPool::Task {
+	AlignmentServer *server_;
+	std::string line_;
+	int out_fd_;
+    public:
+	JobTask(AlignmentServer *server, const std::string &line, int out_fd)
+	    : server_(server), line_(line), out_fd_(out_fd) {}
+
+	//! @note deletes the task
+	void
+	run() {
+	    server_->write_line(out_fd_,server_->run_job(line_));
+	    delete this;
+	}
+    };
+
+    AlignmentServer::AlignmentServer(const ProfileAlignmentParams &params,
+				     const PFoldParams &pfoldparams,
+				     double max_bps_length_ratio,
+				     size_type num_threads,
+				     size_type max_cached_inputs)
+	: params_(params),
+	  pfoldparams_(pfoldparams),
+	  max_bps_length_ratio_(max_bps_length_ratio),
+	  pool_(NULL),
+	  input_cache_(),
+	  max_cached_inputs_(max_cached_inputs),
+	  input_clock_(0)
+    {
+	pthread_mutex_init(&input_mutex_,NULL);
+	pthread_mutex_init(&output_mutex_,NULL);
+	pool_ = new ThreadPool(num_threads);
+    }
+
+    AlignmentServer::~AlignmentServer() {
+	delete pool_; // waits for running jobs
+	for (input_cache_t::iterator it=input_cache_.begin(); input_cache_.end()!=it; ++it) {
+	    delete it->second->rna_data;
+	    delete it->second;
+	}
+	pthread_mutex_destroy(&output_mutex_);
+	pthread_mutex_destroy(&input_mutex_);
+    }
+
+    AlignmentServer::Input *
+    AlignmentServer::acquire_input(const JobRequest &job, const std::string &side,
+				   double min_prob) {
+	std::string file_key = side=="A" ? "a" : "b";
+
+	ScopedLock lock(input_mutex_);
+
+	if (job.has(file_key)) {
+	    std::pair<std::string,double> key(job.get_string(file_key,""),min_prob);
+
+	    struct stat st;
+	    if (stat(key.first.c_str(),&st)!=0) {
+		throw failure("cannot read input file "+key.first+".");
+	    }
+
+	    input_cache_t::iterator it = input_cache_.find(key);
+	    if (it!=input_cache_.end()) {
+		Input *input = it->second;
+		if (input->mtime==st.st_mtime && input->size==st.st_size) {
+		    input->users++;
+		    input->last_use=++input_clock_;
+		    return input;
+		}
+		// the file changed since it was read
+		uncache_input(it);
+	    }
+
+	    Input *input = new Input;
+	    input->rna_data = new RnaData(key.first,
+					  min_prob,
+					  max_bps_length_ratio_,
+					  pfoldparams_);
+	    input->mtime = st.st_mtime;
+	    input->size = st.st_size;
+	    input->users = 1;
+	    input->last_use = ++input_clock_;
+	    input->cached = true;
+	    input_cache_[key] = input;
+
+	    // drop the least recently used inputs
+	    while (input_cache_.size() > max_cached_inputs_) {
+		input_cache_t::iterator lru = input_cache_.begin();
+		for (it=input_cache_.begin(); input_cache_.end()!=it; ++it) {
+		    if (it->second->last_use < lru->second->last_use) {
+			lru = it;
+		    }
+		}
+		uncache_input(lru);
+	    }
+
+	    return input;
+	}
+
+	if (job.has("seq"+side)) {
+	    MultipleAlignment ma(job.get_string("name"+side,side),
+				 job.get_string("seq"+side,""));
+	    RnaEnsemble rna_ensemble(ma,pfoldparams_,false,true);
+	    Input *input = new Input;
+	    input->rna_data = new RnaData(rna_ensemble,
+					  min_prob,
+					  max_bps_length_ratio_,
+					  pfoldparams_);
+	    input->mtime = 0;
+	    input->size = 0;
+	    input->users = 1;
+	    input->last_use = ++input_clock_;
+	    input->cached = false;
+	    return input;
+	}
+
+	throw failure("missing input "+file_key+" or seq"+side+".");
+    }
+
+    void
+    AlignmentServer::release_input(Input *input) {
+	if (input==NULL) return;
+
+	ScopedLock lock(input_mutex_);
+
+	input->users--;
+	if (!input->cached && input->users==0) {
+	    delete input->rna_data;
+	    delete input;
+	}
+    }
+
+    void
+    AlignmentServer::uncache_input(input_cache_t::iterator it) {
+	Input *input = it->second;
+	input_cache_.erase(it);
+	input->cached = false;
+	if (input->users==0) {
+	    delete input->rna_data;
+	    delete input;
+	}
+    }
+
+    std::string
+    AlignmentServer::run_job(const std::string &line) {
+	std::string id="null";
+	Input *inputA=NULL;
+	Input *inputB=NULL;
+	std::ostringstream out;
+
+	try {
+	    JobRequest job(line);
+	    id = job.id();
+
+	    ProfileAlignmentParams params(params_);
+	    params.match = job.get_int("match",params.match);
+	    params.mismatch = job.get_int("mismatch",params.mismatch);
+	    params.indel = job.get_int("indel",params.indel);
+	    params.indel_opening = job.get_int("indel-opening",params.indel_opening);
+	    params.struct_weight = job.get_int("struct-weight",params.struct_weight);
+	    params.tau_factor = job.get_int("tau",params.tau_factor);
+	    params.exclusion = job.get_int("exclusion",params.exclusion);
+	    params.exp_prob = job.get_double("exp-prob",params.exp_prob);
+	    params.no_lonely_pairs = job.get_bool("noLP",params.no_lonely_pairs);
+	    params.struct_local = job.get_bool("struct-local",params.struct_local);
+	    params.sequ_local = job.get_bool("sequ-local",params.sequ_local);
+	    params.free_endgaps = job.get_string("free-endgaps",params.free_endgaps);
+	    params.max_diff = job.get_int("max-diff",params.max_diff);
+	    params.max_diff_am = job.get_int("max-diff-am",params.max_diff_am);
+	    params.max_diff_at_am = job.get_int("max-diff-at-am",params.max_diff_at_am);
+	    params.min_prob = job.get_double("min-prob",params.min_prob);
+	    params.min_am_prob = job.get_double("min-am-prob",params.min_am_prob);
+	    params.min_bm_prob = job.get_double("min-bm-prob",params.min_bm_prob);
+
+	    bool trace = job.get_bool("trace",true);
+
+	    inputA = acquire_input(job,"A",params.min_prob);
+	    inputB = acquire_input(job,"B",params.min_prob);
+	    const RnaData &rna_dataA = *inputA->rna_data;
+	    const RnaData &rna_dataB = *inputB->rna_data;
+
+	    Alignment::edge_ends_t no_edge_ends;
+	    Alignment::edges_t edges(no_edge_ends,no_edge_ends);
+	    infty_score_t score =
+		ProgressiveAligner::align_profiles(rna_dataA, rna_dataB, params, NULL,
+						   trace ? &edges : NULL);
+
+	    out << "{\"id\":" << id << ",\"score\":";
+	    if (score.is_finite()) {
+		out << score.finite_value();
+	    } else {
+		out << "null";
+	    }
+	    if (trace) {
+		MultipleAlignment ma(edges,rna_dataA.sequence(),rna_dataB.sequence());
+		out << ",\"alignment\":[";
+		for (size_type k=0; k<ma.num_of_rows(); ++k) {
+		    const MultipleAlignment::SeqEntry &entry = ma.seqentry(k);
+		    out << (k>0?",":"") << "["
+			<< json_quote(entry.name()) << ","
+			<< json_quote(entry.seq().str()) << "]";
+		}
+		out << "]";
+	    }
+	    out << "}";
+	} catch (std::exception &e) {
+	    out.str("");
+	    out << "{\"id\":" << id << ",\"error\":" << json_quote(e.what()) << "}";
+	}
+
+	release_input(inputA);
+	release_input(inputB);
+
+	return out.str();
+    }
+
+    bool
+    AlignmentServer::write_line(int fd, const std::string &line) {
+	ScopedLock lock(output_mutex_);
+
+	std::string text = line+"\n";
+	size_t written=0;
+	while (written<text.length()) {
+	    ssize_t n = write(fd, text.data()+written, text.length()-written);
+	    if (n<0) {
+		if (errno==EINTR) continue;
+		return false;
+	    }
+	    written += n;
+	}
+	return true;
+    }
+
+    bool
+    AlignmentServer::serve(int in_fd, int out_fd) {
+	std::string buffer;
+	char chunk[4096];
+	bool shutdown=false;
+	bool eof=false;
+	std::string shutdown_id;
+
+	while (!shutdown && !eof) {
+	    ssize_t n = read(in_fd, chunk, sizeof(chunk));
+	    if (n<0 && errno==EINTR) continue;
+	    if (n<=0) {
+		// treat a missing final newline like a newline
+		eof=true;
+		buffer += '\n';
+	    } else {
+		buffer.append(chunk,n);
+	    }
+
+	    size_t start=0;
+	    size_t end;
+	    while (!shutdown && (end=buffer.find('\n',start))!=std::string::npos) {
+		std::string line = buffer.substr(start,end-start);
+		start=end+1;
+
+		if (line.find_first_not_of(" \t\r")==std::string::npos) continue;
+
+		// shutdown requests are handled here, everything
+		// else (including errors) by the job
+		try {
+		    JobRequest job(line);
+		    if (job.get_bool("shutdown",false)) {
+			shutdown=true;
+			shutdown_id=job.id();
+			continue;
+		    }
+		} catch (failure &f) {
+		    // reported by the job
+		}
+
+		pool_->submit(new JobTask(this,line,out_fd));
+	    }
+	    buffer.erase(0,start);
+	}
+
+	pool_->wait();
+
+	if (shutdown) {
+	    write_line(out_fd,"{\"id\":"+shutdown_id+",\"shutdown\":true}");
+	}
+
+	return shutdown;
+    }
+
+    void
+    AlignmentServer::serve_socket(const std::string &path) {
+	struct sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.length() >= sizeof(addr.sun_path)) {
+	    throw failure("AlignmentServer: socket path too long: "+path);
+	}
+	strncpy(addr.sun_path,path.c_str(),sizeof(addr.sun_path)-1);
+
+	int sock = socket(AF_UNIX,SOCK_STREAM,0);
+	if (sock<0) {
+	    throw failure("AlignmentServer: cannot create socket.");
+	}
+
+	// remove the socket of a previous server, but no other files
+	struct stat st;
+	if (lstat(path.c_str(),&st)==0) {
+	    if (!S_ISSOCK(st.st_mode)) {
+		close(sock);
+		throw failure("AlignmentServer: "+path+" exists and is not a socket.");
+	    }
+	    unlink(path.c_str());
+	}
+	if (bind(sock,(struct sockaddr *)&addr,sizeof(addr))<0
+	    || listen(sock,16)<0) {
+	    close(sock);
+	    throw failure("AlignmentServer: cannot listen on socket "+path+".");
+	}
+
+	// clients that disconnect early must not terminate the server
+	signal(SIGPIPE,SIG_IGN);
+
+	bool shutdown=false;
+	while (!shutdown) {
+	    int conn = accept(sock,NULL,NULL);
+	    if (conn<0) {
+		if (errno==EINTR) continue;
+		close(sock);
+		unlink(path.c_str());
+		throw failure("AlignmentServer: accept failed on socket "+path+".");
+	    }
+	    shutdown = serve(conn,conn);
+	    close(conn);
+	}
+
+	close(sock);
+	unlink(path.c_str());
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,296 @@
+#ifndef LOCARNA_ALIGNMENT_SERVER_HH
+#define LOCARNA_ALIGNMENT_SERVER_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <map>
+#include <string>
+#include <utility>
+#include <pthread.h>
+
+#include "aux.hh"
+#include "pfold_params.hh"
+#include "progressive_aligner.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+    class ThreadPool;
+
+    /**
+     * @brief Job request of the alignment server
+     *
+     * A job is one line of JSON that contains a flat object; values
+     * are strings, numbers, booleans or null. Nested objects and
+     * arrays are not supported. Escape sequences \\uXXXX are
+     * decoded to UTF-8 (including surrogate pairs).
+     *
+     * Example:
+     * @code
+     * {"id":7, "a":"seqA.pp", "b":"seqB.pp", "struct-weight":180}
+     * @endcode
+     */
+    class JobRequest {
+    public:
+	//! type of a JSON value
+	enum value_type { STRING, LITERAL };
+
+    private:
+	//! values by key; strings are unescaped, literals (numbers,
+	//! true, false, null) are kept verbatim
+	std::map<std::string, std::pair<value_type,std::string> > values_;
+
+	//! @brief value of a key or NULL
+	const std::pair<value_type,std::string> *
+	find(const std::string &key) const;
+
+    public:
+	/**
+	 * @brief Parse from one line of JSON
+	 *
+	 * @param line the JSON text
+	 * @throw failure on syntax errors and nested values
+	 */
+	explicit
+	JobRequest(const std::string &line);
+
+	//! @brief whether the job has the key
+	bool
+	has(const std::string &key) const { return find(key)!=NULL; }
+
+	/**
+	 * @brief Value as JSON text
+	 * @param key key
+	 * @return value as in the request (re-quoted for strings);
+	 * "null" if the key is missing
+	 */
+	std::string
+	json(const std::string &key) const;
+
+	/**
+	 * @brief Id of the job as JSON text
+	 * @return value of "id" as in json(); "null" if the job has
+	 * no id
+	 * @throw failure if the id is neither a string nor a number
+	 */
+	std::string
+	id() const;
+
+	/**
+	 * @brief String value
+	 * @param key key
+	 * @param deflt default, if the key is missing
+	 * @return value
+	 * @throw failure if the value is not a string
+	 */
+	std::string
+	get_string(const std::string &key, const std::string &deflt) const;
+
+	/**
+	 * @brief Integer value
+	 * @param key key
+	 * @param deflt default, if the key is missing
+	 * @return value
+	 * @throw failure if the value is not an integer
+	 */
+	long
+	get_int(const std::string &key, long deflt) const;
+
+	/**
+	 * @brief Floating point value
+	 * @param key key
+	 * @param deflt default, if the key is missing
+	 * @return value
+	 * @throw failure if the value is not a number
+	 */
+	double
+	get_double(const std::string &key, double deflt) const;
+
+	/**
+	 * @brief Boolean value
+	 * @param key key
+	 * @param deflt default, if the key is missing
+	 * @return value
+	 * @throw failure if the value is not true or false
+	 */
+	bool
+	get_bool(const std::string &key, bool deflt) const;
+    };
+
+    /**
+     * @brief Quote a string for JSON output
+     * @param s string
+     * @return s in double quotes with special characters escaped
+     */
+    std::string
+    json_quote(const std::string &s);
+
+    /**
+     * @brief Long running server for pairwise alignments
+     *
+     * The server reads jobs (see JobRequest), one per line, and runs
+     * them on a thread pool; each result is written as one line of
+     * JSON as soon as it is available. Results are therefore not
+     * ordered; they repeat the "id" of their job.
+     *
+     * Job keys:
+     *  - "id": string or number, copied to the result
+     *  - "a", "b": input files (pp, clustal or fasta), or
+     *  - "seqA", "seqB": input sequences (folded on the fly), with
+     *    optional names "nameA", "nameB"
+     *  - parameters named like the locarna options: "match",
+     *    "mismatch", "indel", "indel-opening", "struct-weight",
+     *    "tau", "exclusion", "exp-prob", "noLP", "struct-local",
+     *    "sequ-local", "free-endgaps", "max-diff", "max-diff-am",
+     *    "max-diff-at-am", "min-prob", "min-am-prob", "min-bm-prob";
+     *    missing parameters are taken from the server defaults
+     *  - "trace": whether to report the alignment (default true)
+     *  - "shutdown": if true, stop serving after this line
+     *
+     * Results have the form {"id":..,"score":..,"alignment":[[name,
+     * row],..]}, or {"id":..,"error":message} if the job failed.
+     *
+     * The scoring matrices (ribosum or ribofit) in the default
+     * parameters are shared by all jobs. Input files are kept in
+     * memory for later jobs (per file name and minimal probability);
+     * a file is read again, if its modification time or size
+     * changed. The least recently used files are dropped from the
+     * cache beyond a maximal number of cached files.
+     *
+     * @note Reading inputs, and in particular folding, is serialized,
+     * since the folding library is not thread-safe.
+     */
+    class AlignmentServer {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	ProfileAlignmentParams params_; //!< default alignment parameters
+	PFoldParams pfoldparams_; //!< folding parameters
+	double max_bps_length_ratio_; //!< filter for the input base pairs
+
+	ThreadPool *pool_; //!< workers
+
+	struct Input; //!< input RNA of jobs (see acquire_input())
+
+	//! cache of input files by name and minimal probability
+	typedef std::map<std::pair<std::string,double>, Input *> input_cache_t;
+
+	input_cache_t input_cache_; //!< cache of input files
+	size_type max_cached_inputs_; //!< maximal number of cached input files
+	size_type input_clock_; //!< counts the uses of inputs (for LRU)
+	pthread_mutex_t input_mutex_; //!< protects the inputs and folding
+	pthread_mutex_t output_mutex_; //!< serializes writing results
+
+	class JobTask;
+	friend class JobTask;
+
+	/**
+	 * @brief Run one job
+	 * @param line JSON text of the job
+	 * @return result line (without newline)
+	 */
+	std::string
+	run_job(const std::string &line);
+
+	/**
+	 * @brief Acquire the input of a job
+	 *
+	 * @param job the job
+	 * @param side "A" or "B"
+	 * @param min_prob minimal base pair probability
+	 * @return input, which must be released by release_input()
+	 * @throw failure if the input is missing or cannot be read
+	 */
+	Input *
+	acquire_input(const JobRequest &job, const std::string &side, double min_prob);
+
+	/**
+	 * @brief Release an input of a job
+	 * @param input input from acquire_input() or NULL
+	 * @note the input is deleted, if it is no longer cached or
+	 * used
+	 */
+	void
+	release_input(Input *input);
+
+	/**
+	 * @brief Remove an input from the cache
+	 * @param it position in the cache
+	 * @note the input is deleted, unless it is in use
+	 * @pre input_mutex_ is locked
+	 */
+	void
+	uncache_input(input_cache_t::iterator it);
+
+	/**
+	 * @brief Write a line to a file descriptor
+	 * @param fd file descriptor
+	 * @param line text (without newline)
+	 * @return whether the line was written completely
+	 */
+	bool
+	write_line(int fd, const std::string &line);
+
+	//! @brief no copy
+	AlignmentServer(const AlignmentServer &);
+
+	//! @brief no assignment
+	AlignmentServer &
+	operator =(const AlignmentServer &);
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param params default alignment parameters
+	 * @param pfoldparams parameters for folding inputs
+	 * @param max_bps_length_ratio maximal ratio of base pairs per
+	 * sequence length of inputs (0 for no effect)
+	 * @param num_threads number of threads (0 for number of
+	 * processors)
+	 * @param max_cached_inputs maximal number of input files that
+	 * are kept in memory
+	 */
+	AlignmentServer(const ProfileAlignmentParams &params,
+			const PFoldParams &pfoldparams,
+			double max_bps_length_ratio,
+			size_type num_threads,
+			size_type max_cached_inputs=64);
+
+	//! @brief destructor
+	~AlignmentServer();
+
+	/**
+	 * @brief Serve jobs from a file descriptor
+	 *
+	 * Reads jobs until end of input or a shutdown job, and waits
+	 * for all of them before returning.
+	 *
+	 * @param in_fd descriptor for reading jobs
+	 * @param out_fd descriptor for writing results
+	 * @return whether a shutdown job was received
+	 */
+	bool
+	serve(int in_fd, int out_fd);
+
+	/**
+	 * @brief Serve jobs on a Unix domain socket
+	 *
+	 * Accepts connections one after the other and serves the jobs
+	 * of each connection as in serve(); returns after a shutdown
+	 * job. The socket file is removed on return.
+	 *
+	 * @param path path of the socket
+	 * @throw failure if the socket cannot be created, or if
+	 * path exists and is not a socket
+	 */
+	void
+	serve_socket(const std::string &path);
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_ALIGNMENT_SERVER_HH
@@ -174,23 +174,46 @@ namespace LocARNA {
 
 	for(size_type i=0; i<bpsA->num_bps(); i++) {
 	    const Arc *arcA = &bpsA->arc(i);
-		    
-	    for(size_type j=0; j<bpsB->num_bps(); j++) {
-			
-		const Arc *arcB = &bpsB->arc(j);
-	    
-		// check whether arc match is valid
-		if (!is_valid_arcmatch(*arcA,*arcB)) continue;    
 	    
-		size_type idx = arc_matches_vec.size();
+	    // Visit only arcs of B with left end at distance at most
+	    // max_diff_at_am and span differing by at most
+	    // max_length_diff. The arcs are visited in the order of
+	    // their indices (decreasing left ends, increasing right
+	    // ends), such that the arc matches are the same as in a
+	    // traversal of all pairs of arcs. For bounded base pair
+	    // span (local folding), this avoids the quadratic
+	    // traversal of all arc pairs.
+	    size_type spanA = arcA->right()-arcA->left();
+	    size_type min_leftB = (arcA->left()>max_diff_at_am) ? arcA->left()-max_diff_at_am : 1;
+	    size_type max_leftB = lenB;
+	    if (arcA->left()<lenB && lenB-arcA->left()>max_diff_at_am) {
+		max_leftB = arcA->left()+max_diff_at_am;
+	    }
+	    size_type min_spanB = (spanA>max_length_diff) ? spanA-max_length_diff : 0;
 	    
-		// make entry in arc matches
-		arc_matches_vec.push_back(ArcMatch(arcA,arcB,idx));
-		number_of_arcmatches++;
+	    for(size_type leftB=max_leftB; leftB>=min_leftB && leftB>0; leftB--) {
+		const BasePairs::LeftAdjList &adjlB = bpsB->left_adjlist(leftB);
 		
-		// make entries in adjacency lists
-		common_left_end_lists(arcA->left(),arcB->left()).push_back(idx);
-		common_right_end_lists(arcA->right(),arcB->right()).push_back(idx);
+		for(BasePairs::LeftAdjList::const_iterator it=adjlB.begin(); adjlB.end()!=it; ++it) {
+		    size_type spanB = it->right()-it->left();
+		    if (spanB<min_spanB) continue;
+		    if (spanB>spanA && spanB-spanA>max_length_diff) break;
+		    
+		    const Arc *arcB = &bpsB->arc(it->idx());
+		    
+		    // check whether arc match is valid
+		    if (!is_valid_arcmatch(*arcA,*arcB)) continue;    
+	    
+		    size_type idx = arc_matches_vec.size();
+		    
+		    // make entry in arc matches
+		    arc_matches_vec.push_back(ArcMatch(arcA,arcB,idx));
+		    number_of_arcmatches++;
+		    
+		    // make entries in adjacency lists
+		    common_left_end_lists(arcA->left(),arcB->left()).push_back(idx);
+		    common_right_end_lists(arcA->right(),arcB->right()).push_back(idx);
+		}
 	    }
 	}
 
@@ -399,6 +422,41 @@ namespace LocARNA {
 	// add an invalid arc match entry
 	arc_matches_vec.push_back(ArcMatch(NULL,NULL,invalid_am_index()));
     }
-    
+
+    void
+    ArcMatchEndLists::init(const ArcMatches &arc_matches) {
+	size_type lenA = arc_matches.get_base_pairsA().seqlen();
+	size_type lenB = arc_matches.get_base_pairsB().seqlen();
+
+	entries_.clear();
+	pos_.resize(arc_matches.num_arc_matches());
+
+	for (size_type i=0; i<=lenA; i++) {
+	    for (size_type j=0; j<=lenB; j++) {
+		const ArcMatchIdxVec &list = arc_matches.common_right_end_list(i,j);
+
+		size_type start = entries_.size();
+		for (ArcMatchIdxVec::const_iterator it=list.begin(); list.end()!=it; ++it) {
+		    const ArcMatch &am = arc_matches.arcmatch(*it);
+		    entry_t entry;
+		    entry.endA = am.arcA().left();
+		    entry.endB = am.arcB().left();
+		    entry.idx = *it;
+		    pos_[*it] = entries_.size();
+		    entries_.push_back(entry);
+		}
+
+		// link entries to the next endA group
+		size_type next = entries_.size();
+		for (size_type k=entries_.size(); k>start; k--) {
+		    if (k<entries_.size() && entries_[k-1].endA != entries_[k].endA) {
+			next = k;
+		    }
+		    entries_[k-1].next_endA = next;
+		}
+	    }
+	}
+    }
 
 } // end of namespace LocARNA
+
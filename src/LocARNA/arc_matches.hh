@@ -629,6 +629,98 @@ namespace LocARNA {
 	}
     };
 
+
+    /**
+     * @brief Compact copy of the common right end lists of arc matches
+     *
+     * Concatenates the lists of arc matches with common right ends
+     * of an ArcMatches object in the order of the ends (i,j). Each
+     * entry holds the left ends and the index of an arc match, such
+     * that iterating a list does not dereference the arc matches and
+     * their arcs. The recursion of Aligner traverses these lists in
+     * its innermost loop, if only few pairs of arcs are arc matches.
+     *
+     * The lists are sorted lexicographically descending by the left
+     * ends (as in ArcMatches). Each entry links to the next group of
+     * entries with a different left end in A, such that scans can
+     * skip the rest of a group once the left end in B is out of
+     * range.
+     *
+     * The range of the list of (i,j) is found via the position of
+     * the first arc match of the corresponding list of ArcMatches,
+     * such that no start is stored per pair of positions.
+     */
+    class ArcMatchEndLists {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! @brief entry of a list
+	struct entry_t {
+	    unsigned int endA; //!< left end in A
+	    unsigned int endB; //!< left end in B
+	    unsigned int idx; //!< arc match index
+	    //! position of the next entry of the list with different
+	    //! endA (or end of the list)
+	    unsigned int next_endA;
+	};
+
+    private:
+	std::vector<entry_t> entries_; //!< concatenated lists
+	std::vector<unsigned int> pos_; //!< position of each arc match (by index) in entries_
+
+    public:
+	//! @brief construct empty
+	ArcMatchEndLists(): entries_(), pos_() {}
+
+	/**
+	 * @brief (Re-)build from arc matches
+	 *
+	 * @param arc_matches arc matches
+	 */
+	void
+	init(const ArcMatches &arc_matches);
+
+	/**
+	 * @brief Clear (keeps the capacity)
+	 */
+	void
+	clear() { entries_.clear(); pos_.clear(); }
+
+	//! @brief start position of a list
+	//! @param list common right end list of the arc matches
+	size_type
+	begin(const ArcMatchIdxVec &list) const {
+	    return list.empty() ? 0 : pos_[list.front()];
+	}
+
+	//! @brief end position of a list
+	//! @param list common right end list of the arc matches
+	size_type
+	end(const ArcMatchIdxVec &list) const {
+	    return begin(list)+list.size();
+	}
+
+	//! @brief position of an arc match
+	//! @param idx arc match index
+	size_type
+	pos(size_type idx) const { return pos_[idx]; }
+
+	//! @brief entry at position k
+	const entry_t &
+	operator [](size_type k) const { return entries_[k]; }
+
+	//! @brief total number of entries
+	size_type
+	size() const { return entries_.size(); }
+
+	//! @brief allocated memory in bytes
+	size_type
+	memory() const {
+	    return entries_.capacity()*sizeof(entry_t)
+		+ pos_.capacity()*sizeof(unsigned int);
+	}
+    };
+
 } // end namespace LocARNA
 
 #endif // LOCARNA_ARC_MATCHES_HH
@@ -0,0 +1,133 @@
+#include "arena.hh"
+
+#include <cstdlib>
+#include <algorithm>
+#include <pthread.h>
+
+namespace LocARNA {
+
+    //! alignment of the blocks of an arena
+    static const size_t block_alignment = 16;
+
+    //! @brief round up to multiple of block_alignment
+    static
+    size_t
+    align_up(size_t bytes) {
+	return (bytes + block_alignment - 1) & ~(block_alignment - 1);
+    }
+
+    // ------------------------------------------------------------
+    // thread specific arenas
+
+    static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+    static pthread_key_t thread_arena_key; //!< arena owned by thread
+
+    //! @brief destroy arena of exiting thread
+    static
+    void
+    delete_thread_arena(void *arena) {
+	delete static_cast<Arena *>(arena);
+    }
+
+    //! @brief create thread specific key
+    static
+    void
+    create_key() {
+	pthread_key_create(&thread_arena_key, delete_thread_arena);
+    }
+
+    Arena &
+    Arena::thread_arena() {
+	pthread_once(&key_once, create_key);
+	Arena *arena = static_cast<Arena *>(pthread_getspecific(thread_arena_key));
+	if (arena==NULL) {
+	    arena = new Arena();
+	    pthread_setspecific(thread_arena_key, arena);
+	}
+	return *arena;
+    }
+
+    // ------------------------------------------------------------
+    // Arena
+
+    Arena::Arena(size_type min_slab_size)
+	: slabs_(),
+	  used_(0),
+	  total_(0),
+	  peak_(0),
+	  live_(0),
+	  min_slab_size_(align_up(min_slab_size))
+    {}
+
+    Arena::~Arena() {
+	for (size_type i=0; i<slabs_.size(); ++i) {
+	    free(slabs_[i].begin);
+	}
+    }
+
+    void
+    Arena::add_slab(size_type size) {
+	size = std::max(size, min_slab_size_);
+	// grow geometrically for small blocks; a large block gets a
+	// slab of its own size
+	if (!slabs_.empty() && size <= slabs_.back().size) {
+	    size = 2*slabs_.back().size;
+	}
+	char *begin = static_cast<char *>(malloc(size));
+	if (begin==NULL) throw std::bad_alloc();
+	slabs_.push_back(slab_t(begin,size));
+	used_=0;
+    }
+
+    void
+    Arena::rewind() {
+	if (slabs_.size()>1) {
+	    // coalesce, such that the same run fits into one slab
+	    for (size_type i=0; i<slabs_.size(); ++i) {
+		free(slabs_[i].begin);
+	    }
+	    slabs_.clear();
+	    add_slab(peak_);
+	}
+	used_=0;
+	total_=0;
+	peak_=0;
+    }
+
+    void *
+    Arena::allocate(size_type bytes) {
+	bytes = align_up(bytes);
+	if (slabs_.empty() || used_+bytes > slabs_.back().size) {
+	    add_slab(bytes);
+	}
+	void *p = slabs_.back().begin + used_;
+	used_ += bytes;
+	total_ += bytes;
+	peak_ = std::max(peak_,total_);
+	live_++;
+	return p;
+    }
+
+    void
+    Arena::deallocate(void *p, size_type bytes) {
+	bytes = align_up(bytes);
+	// return the most recent block immediately
+	if (static_cast<char *>(p) + bytes == slabs_.back().begin + used_) {
+	    used_ -= bytes;
+	    total_ -= bytes;
+	}
+	if (--live_ == 0) {
+	    rewind();
+	}
+    }
+
+    Arena::size_type
+    Arena::capacity() const {
+	size_type size=0;
+	for (size_type i=0; i<slabs_.size(); ++i) {
+	    size += slabs_[i].size;
+	}
+	return size;
+    }
+
+} // end namespace LocARNA
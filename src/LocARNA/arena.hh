@@ -0,0 +1,210 @@
+#ifndef LOCARNA_ARENA_HH
+#define LOCARNA_ARENA_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace LocARNA {
+
+    /**
+     * @brief Region allocator for the temporaries of one alignment
+     *
+     * Memory is handed out from large slabs by incrementing a
+     * pointer. Freeing the most recent block returns it immediately;
+     * as soon as all blocks are freed, the arena rewinds and the
+     * next alignment reuses the same (already touched) memory. If an
+     * alignment needed several slabs, they are coalesced into one
+     * slab of the total size on rewinding. After the first few
+     * alignments, successive alignments of similar size do not call
+     * malloc/free at all.
+     *
+     * The arena is passed explicitly to the containers that allocate
+     * from it by an ArenaAllocator.
+     *
+     * @note An arena is not thread-safe; it is meant to be owned by
+     * one (worker) thread, see thread_arena(). All memory of an
+     * arena must be allocated and freed by the owning thread before
+     * the arena is destroyed.
+     */
+    class Arena {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	//! slab of memory
+	struct slab_t {
+	    char *begin; //!< start of slab
+	    size_type size; //!< size in bytes
+	    //! @brief construct
+	    slab_t(char *begin_, size_type size_): begin(begin_), size(size_) {}
+	};
+
+	std::vector<slab_t> slabs_; //!< slabs; the last one is in use
+	size_type used_; //!< used bytes in the last slab
+	size_type total_; //!< bytes used in all slabs since rewinding
+	size_type peak_; //!< maximum of total_ since rewinding
+	size_type live_; //!< number of live blocks
+	size_type min_slab_size_; //!< minimal size of new slabs
+
+	//! @brief add slab of at least the given size
+	void
+	add_slab(size_type size);
+
+	//! @brief rewind; coalesce slabs if more than one was used
+	void
+	rewind();
+
+	//! @brief no copy
+	Arena(const Arena &);
+
+	//! @brief no assignment
+	Arena &
+	operator =(const Arena &);
+
+    public:
+	/**
+	 * @brief Construct empty arena
+	 *
+	 * @param min_slab_size minimal size of slabs in bytes
+	 */
+	explicit
+	Arena(size_type min_slab_size=1<<20);
+
+	//! @brief destructor; frees all slabs
+	~Arena();
+
+	/**
+	 * @brief Allocate memory
+	 *
+	 * @param bytes number of bytes
+	 * @return pointer to memory aligned for any fundamental type
+	 */
+	void *
+	allocate(size_type bytes);
+
+	/**
+	 * @brief Free memory allocated by allocate()
+	 *
+	 * @param p pointer to memory of size bytes
+	 * @param bytes size of the block
+	 */
+	void
+	deallocate(void *p, size_type bytes);
+
+	//! @brief total size of all slabs in bytes
+	size_type
+	capacity() const;
+
+	//! @brief number of live blocks
+	size_type
+	live() const { return live_; }
+
+	/**
+	 * @brief Arena of the calling thread
+	 *
+	 * @return arena that is owned by the calling thread; it is
+	 * created on first use and destroyed when the thread exits
+	 */
+	static
+	Arena &
+	thread_arena();
+    };
+
+    /**
+     * @brief STL allocator using an arena
+     *
+     * Allocates from the given arena, or from the heap if the arena
+     * is NULL. Containers with the allocator must be destroyed on
+     * the thread that owns the arena.
+     */
+    template <class T>
+    class ArenaAllocator {
+	Arena *arena_; //!< arena or NULL for heap
+    public:
+	typedef T value_type; //!< value type
+	typedef T *pointer; //!< pointer
+	typedef const T *const_pointer; //!< const pointer
+	typedef T &reference; //!< reference
+	typedef const T &const_reference; //!< const reference
+	typedef size_t size_type; //!< size type
+	typedef ptrdiff_t difference_type; //!< difference type
+
+	//! @brief rebind to other type
+	template <class U>
+	struct rebind { typedef ArenaAllocator<U> other; };
+
+	/**
+	 * @brief construct
+	 * @param arena arena or NULL for heap
+	 */
+	explicit
+	ArenaAllocator(Arena *arena=NULL): arena_(arena) {}
+
+	//! @brief construct from allocator of other type
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U> &a): arena_(a.arena()) {}
+
+	//! @brief arena or NULL for heap
+	Arena *
+	arena() const { return arena_; }
+
+	//! @brief address of reference
+	pointer address(reference x) const { return &x; }
+
+	//! @brief address of const reference
+	const_pointer address(const_reference x) const { return &x; }
+
+	//! @brief allocate n objects
+	pointer
+	allocate(size_type n, const void * =0) {
+	    if (arena_==NULL) {
+		return static_cast<pointer>(::operator new(n*sizeof(T)));
+	    }
+	    return static_cast<pointer>(arena_->allocate(n*sizeof(T)));
+	}
+
+	//! @brief deallocate n objects
+	void
+	deallocate(pointer p, size_type n) {
+	    if (arena_==NULL) {
+		::operator delete(p);
+	    } else {
+		arena_->deallocate(p,n*sizeof(T));
+	    }
+	}
+
+	//! @brief maximal number of objects
+	size_type
+	max_size() const { return size_type(-1)/sizeof(T); }
+
+	//! @brief construct object
+	void
+	construct(pointer p, const T &val) { new(static_cast<void *>(p)) T(val); }
+
+	//! @brief destroy object
+	void
+	destroy(pointer p) { p->~T(); }
+    };
+
+    //! @brief equality of arena allocators (same arena)
+    template <class T, class U>
+    bool
+    operator ==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+	return a.arena()==b.arena();
+    }
+
+    //! @brief inequality of arena allocators
+    template <class T, class U>
+    bool
+    operator !=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+	return !(a==b);
+    }
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_ARENA_HH
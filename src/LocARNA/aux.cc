@@ -76,6 +76,24 @@ namespace LocARNA {
 	}
     }
 
+    void
+    reverse_complement_rna_sequence(std::string &seq) {
+	std::reverse(seq.begin(),seq.end());
+	for (size_type i=0; i<seq.length(); i++) {
+	    switch(seq[i]) {
+	    case 'A': seq[i]='U'; break;
+	    case 'C': seq[i]='G'; break;
+	    case 'G': seq[i]='C'; break;
+	    case 'U': case 'T': seq[i]='A'; break;
+	    case 'a': seq[i]='u'; break;
+	    case 'c': seq[i]='g'; break;
+	    case 'g': seq[i]='c'; break;
+	    case 'u': case 't': seq[i]='a'; break;
+	    default: break;
+	    }
+	}
+    }
+
     bool
     has_prefix(const std::string &s, const std::string &p, size_t start) {
 	if (s.length()<p.length()-start) {
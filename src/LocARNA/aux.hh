@@ -249,6 +249,16 @@ namespace LocARNA {
     void 
     normalize_rna_sequence(std::string &seq);
 
+    //! \brief Reverse complement an RNA sequence string
+    //! 
+    //! Reverses the string and complements A-U, C-G (T is
+    //! complemented to A); the case of characters is kept,
+    //! all other characters (e.g. gaps or N) are not changed.
+    //!
+    //! @param seq sequence string
+    void 
+    reverse_complement_rna_sequence(std::string &seq);
+
 
     /**
      * @brief Tokenize string at separator symbol
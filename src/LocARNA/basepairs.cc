@@ -2,6 +2,7 @@
 #include <string>
 #include <fstream>
 #include <map>
+#include <algorithm>
 
 #include <iostream>
 #include <fstream>
@@ -39,10 +40,11 @@ namespace LocARNA {
        - arc_vec_
        The arcs indexed with the same indices as in arcs_
        for each arc, we record the left and right end, the weight, and the "stacking" weight 
-       - left_
-       left_[i] is a list of arcs that have left end i, list only indices
-       - right_
-       right_[j] is a list of arcs that have right end j, list only indices
+       - left_, left_start_
+       the arcs that have left end i are left_[left_start_[i]..left_start_[i+1]-1]
+       (compressed sparse row format)
+       - right_, right_start_
+       the arcs that have right end j are right_[right_start_[j]..right_start_[j+1]-1]
 
        there is a further structure for stacking probabilites
 
@@ -59,46 +61,44 @@ namespace LocARNA {
 
       * while reading insert into SparseMatrix
   
-      * afterwards construct traversal structures
+      * afterwards construct traversal structures by iterating over
+        the stored base pairs and bucket sorting them
 
       */
 
 
-    void BasePairs::resize(size_type seq_len) {
-	left_.resize(seq_len+1);
-	right_.resize(seq_len+1);
-    }
-
     double BasePairs::prob_min() const {
 	return min_prob_;
     }
 
-    /*
-      possible simplification:
-      store in LeftAdjEntry and RightAdjEntry only the index
-      consequence: sorting has to be rewritten (cannot easily use stl's sort anymore)
-    */
-
-    /*! compare right ends of arcs (for sorting) */
-    bool operator < (const BasePairs::LeftAdjEntry &e1,const BasePairs::LeftAdjEntry &e2) {
-	return e1.right()<e2.right();
-    }
-
-    /*! compare left ends of arcs (for sorting) */
-    bool operator < (const BasePairs::RightAdjEntry &e1,const BasePairs::RightAdjEntry &e2) {
-	return e1.left()>e2.left();
-    }
-
-
-    //! sort all adjacency lists in left_ and right_
-    void BasePairs::sortAdjLists() {
-
-	for (size_type i=0; i<left_.size(); ++i) {
-	    sort(left_[i].begin(),left_[i].end());
+    /**
+     * @brief Stable bucket sort
+     *
+     * @param keys key of each item
+     * @param items items
+     * @param max_key maximal key
+     * @param[out] start start of the bucket of each key in sorted
+     * (size max_key+2; the end of the last bucket is start[max_key+1])
+     * @param[out] sorted items sorted by keys, equal keys in input order
+     */
+    static
+    void
+    bucket_sort(const std::vector<size_t> &keys,
+		const std::vector<size_t> &items,
+		size_t max_key,
+		std::vector<size_t> &start,
+		std::vector<size_t> &sorted) {
+	start.assign(max_key+2,0);
+	for (size_t k=0; k<keys.size(); ++k) {
+	    ++start[keys[k]+1];
 	}
-
-	for (size_type i=0; i<right_.size(); ++i) {
-	    sort(right_[i].begin(),right_[i].end());
+	for (size_t key=1; key<start.size(); ++key) {
+	    start[key] += start[key-1];
+	}
+	std::vector<size_t> next(start.begin(),start.end()-1);
+	sorted.resize(items.size());
+	for (size_t k=0; k<items.size(); ++k) {
+	    sorted[next[keys[k]]++] = items[k];
 	}
     }
 
@@ -109,65 +109,103 @@ namespace LocARNA {
 	int idx=arc_vec_.size();
     
 	arc_vec_.push_back(Arc(idx,i,j));
-	//std::cout <<"Left and right of arc registered " <<LeftAdjEntry(arc_vec_[idx])<<"   "<<RightAdjEntry(arc_vec_[idx])<<std::endl;
-	left_[i].push_back(LeftAdjEntry(arc_vec_[idx]));
-	right_[j].push_back(RightAdjEntry(arc_vec_[idx]));
-    
-	//std::cout<<"left and right  built: for locations "<<i<<"  and "<<j<<" size of left "<<left_[i].size()<<"  of right"<<right_[j].size()<<std::endl;
 	arcs_.set(i,j,idx);
-	//if(left_[i].size()<=0)std::cout<<"left list empty"<<std::endl; else std::cout<<"left list non-empty"<<std::endl;
-	//if(right_[j].size()<=0)std::cout<<"right list empty"<<std::endl; else std::cout<<"right list non-empty"<<std::endl;
-	//std::cout<<"left list of "<<i<<" size : "<<left_[i].size()<<std::endl;
-	//std::cout<<"right list of "<<j<<" size : "<<right_[j].size()<<std::endl;
     }
 
-    //! generate the lists arc_vec_, left_, right_ from the matrices arc_probs_
-    //! and arc_probs_stack_
+    void BasePairs::build_adj_lists() {
+	size_type len = seqlen();
+	size_type num_arcs = arc_vec_.size();
+	
+	std::vector<size_type> keys(num_arcs);
+	std::vector<size_type> items(num_arcs);
+	std::vector<size_type> start;
+	
+	// arcs by increasing right ends
+	std::vector<size_type> by_right;
+	for (size_type idx=0; idx<num_arcs; ++idx) {
+	    keys[idx] = arc_vec_[idx].right();
+	    items[idx] = idx;
+	}
+	bucket_sort(keys,items,len,start,by_right);
+
+	// left adjacency lists, each by increasing right ends
+	std::vector<size_type> by_left;
+	for (size_type k=0; k<num_arcs; ++k) {
+	    keys[k] = arc_vec_[by_right[k]].left();
+	}
+	bucket_sort(keys,by_right,len,left_start_,by_left);
+	
+	left_.clear();
+	left_.reserve(num_arcs);
+	for (size_type k=0; k<num_arcs; ++k) {
+	    left_.push_back(LeftAdjEntry(arc_vec_[by_left[k]]));
+	}
+	
+	// right adjacency lists, each by decreasing left ends
+	std::vector<size_type> by_left_desc;
+	by_left_desc.reserve(num_arcs);
+	for (size_type i=len+1; i>0; --i) {
+	    for (size_type k=left_start_[i-1]; k<left_start_[i]; ++k) {
+		by_left_desc.push_back(by_left[k]);
+	    }
+	}
+	for (size_type k=0; k<num_arcs; ++k) {
+	    keys[k] = arc_vec_[by_left_desc[k]].right();
+	}
+	std::vector<size_type> by_right_left_desc;
+	bucket_sort(keys,by_left_desc,len,right_start_,by_right_left_desc);
+	
+	right_.clear();
+	right_.reserve(num_arcs);
+	for (size_type k=0; k<num_arcs; ++k) {
+	    right_.push_back(RightAdjEntry(arc_vec_[by_right_left_desc[k]]));
+	}
+    }
 
+    //! generate the lists arc_vec_, left_, right_ from the base pair
+    //! probabilities of rna_data
     void BasePairs::generateBPLists(const RnaData &rna_data) {
-	resize(len_);
-	//std::cout<<"getbplists : sequence lengthj "<<len_<<std::endl;
-	// traverse the entries in the prob matrices
-    
-	// handle all arcs
-	for (int i=len_-3; i>=1 ; i--) {
-	    for (int j=i+3; j<=(int)len_; j++) {
-	    
-		double p = rna_data.arc_prob(i,j);
-	    
-		/*
-		double p2=0;
-		double p_cond=0;
-
-		if ( rna_data.get_arc_prob(i+1,j-1) > 0 && rna_data.get_arc_2_prob(i,j)>0 ) {
-		    p2 = rna_data.get_arc_2_prob(i,j);
-		    p_cond = p2/rna_data.get_arc_prob(i+1,j-1);
-		}
-		*/
-	    
-		if ( (p >= min_prob_) /* || (p2 >= min_prob_) */ ) {
-		
-		    // debugging output
-		    // double pe = 2.0/(len_);
-		    //
-		    // if (p_cond!=0) { 
-		    // 		    std::cout << i << " " << j << " "  
-		    // 			      << p << " " 
-		    // 			      << rna_data.get_arc_prob(i+1,j-1) << " "
-		    // 			      << p_cond << " "
-		    // 			      << pe << " "
-		    // 			      << round(200 * (1-log(p)/log(pe)))	<< " "
-		    // 			      << round(200 * (1-log(rna_data.get_arc_prob(i+1,j-1))/log(pe)))	<< " "
-		    // 			      << round(200 * (1-log(p_cond)/log(pe)))	<< " "
-		    // 			      << std::endl;
-		    // 		}
-		
-		    register_arc(i,j);
-		
-		}
+	size_type len = seqlen();
+	
+	// collect the arcs above threshold in O(number of stored base
+	// pairs), instead of probing all (i,j)
+	std::vector<size_type> lefts;
+	std::vector<size_type> rights;
+	for (RnaData::arc_probs_const_iterator it=rna_data.arc_probs_begin();
+	     rna_data.arc_probs_end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    if ( i>=1 && j<=len && i+3<=j && it->second >= min_prob_ ) {
+		lefts.push_back(i);
+		rights.push_back(j);
+	    }
+	}
+	
+	// register the arcs by decreasing left ends and increasing
+	// right ends; this yields the same arc indices as traversing
+	// all (i,j) in this order
+	std::vector<size_type> items(lefts.size());
+	for (size_type k=0; k<items.size(); ++k) {
+	    items[k] = k;
+	}
+	std::vector<size_type> start;
+	std::vector<size_type> by_right;
+	bucket_sort(rights,items,len,start,by_right);
+	
+	std::vector<size_type> keys(by_right.size());
+	for (size_type k=0; k<by_right.size(); ++k) {
+	    keys[k] = lefts[by_right[k]];
+	}
+	std::vector<size_type> by_left;
+	bucket_sort(keys,by_right,len,start,by_left);
+	
+	for (size_type i=len+1; i>0; --i) {
+	    for (size_type k=start[i-1]; k<start[i]; ++k) {
+		register_arc(lefts[by_left[k]],rights[by_left[k]]);
 	    }
 	}
-	sortAdjLists();
+	
+	build_adj_lists();
     }
 
     BasePairs::size_type
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <set>
+#include <iterator>
 #include <assert.h>
 
 #include "params.hh"
@@ -156,17 +157,65 @@ namespace LocARNA {
 	//! Vector of arcs
 	typedef std::vector<Arc> arc_vec_t;
 	
+	/**
+	 * @brief Adjacency list
+	 *
+	 * Range of the entries of one position in the compressed
+	 * (CSR) adjacency structure; supports iteration like a
+	 * vector.
+	 */
+	template<class Entry>
+	class AdjList {
+	    const Entry *begin_; //!< first entry
+	    const Entry *end_; //!< end of entries
+	public:
+	    typedef const Entry *const_iterator; //!< constant iterator
+	    //! constant reverse iterator
+	    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	    
+	    /** 
+	     * Construct from range of entries
+	     * 
+	     * @param begin first entry
+	     * @param end end of entries
+	     */
+	    AdjList(const Entry *begin, const Entry *end)
+		: begin_(begin), end_(end) {}
+	    
+	    //! @brief begin of entries
+	    const_iterator begin() const {return begin_;}
+	    
+	    //! @brief end of entries
+	    const_iterator end() const {return end_;}
+
+	    //! @brief begin of entries in reverse order
+	    const_reverse_iterator rbegin() const {return const_reverse_iterator(end_);}
+
+	    //! @brief end of entries in reverse order
+	    const_reverse_iterator rend() const {return const_reverse_iterator(begin_);}
+	    
+	    //! @brief whether there are no entries
+	    bool empty() const {return begin_==end_;}
+	    
+	    //! @brief number of entries
+	    size_type size() const {return end_-begin_;}
+	    
+	    //! @brief access to entry
+	    const Entry &operator [](size_type k) const {return begin_[k];}
+	};
+	
 	/* types for data structures for the access of an arc in the structure,
 	   by its right end, its left end, or left and right end 
 	
-	   the access structure is implemented as a hash map,
+	   the adjacency lists are ranges in a compressed sparse row
+	   structure; the access by both ends is implemented as a hash map,
 	*/
 	
 	//! type of left adjacency list
-	typedef std::vector<LeftAdjEntry> LeftAdjList; 
+	typedef AdjList<LeftAdjEntry> LeftAdjList; 
 	
 	//! type of right adjacency list
-	typedef std::vector<RightAdjEntry> RightAdjList; 
+	typedef AdjList<RightAdjEntry> RightAdjList; 
 	
 	//! type for matrix of arcs (actually arc indices)
 	typedef SparseMatrix<int> arc_matrix_t;
@@ -178,30 +227,40 @@ namespace LocARNA {
 	typedef std::set<bpair_t> bpair_set_t;
     
     private:
-	std::vector<LeftAdjList> left_;
-	std::vector<RightAdjList> right_;
+	//! entries of all left adjacency lists; the list of position
+	//! i is the range from left_start_[i] to left_start_[i+1]
+	std::vector<LeftAdjEntry> left_;
+	std::vector<size_type> left_start_; //!< start of left adjacency lists
+	
+	//! entries of all right adjacency lists (analogous to left_)
+	std::vector<RightAdjEntry> right_;
+	std::vector<size_type> right_start_; //!< start of right adjacency lists
 
 	arc_vec_t arc_vec_;
 	arc_matrix_t arcs_;
     
+	//! generate the datastructures that allow fast access to arcs
+	void
+	generateBPLists(const RnaData &rna_data);
+    
 	/**
-	 * @brief resize data structures
-	 * @param seq_len length of sequence
+	 * @brief build the adjacency lists from arc_vec_
 	 *
-	 * Resizes the data structures left_ and right_ that allow
-	 * fast acces to an arc arcs by its left end, its right end,
-	 * or its left and right end
+	 * Sorts the lists as expected by the alignment algorithm,
+	 * i.e. left adjacency lists by increasing right ends and right
+	 * adjacency lists by decreasing left ends. Uses bucket sort in
+	 * O(number of arcs + sequence length).
 	 */
 	void
-	resize(size_type seq_len);
+	build_adj_lists();
 	
-	//! generate the datastructures that allow fast access to arcs
-	void
-	generateBPLists(const RnaData &rna_data);
-    
-	//! sort the adjacency lists as expected by the alignment algorithm
+	/**
+	 * registers a basepair (i,j),
+	 * maintains the basepair access data structures except for
+	 * the adjacency lists (see build_adj_lists())
+	 */
 	void
-	sortAdjLists();
+	register_arc(int i, int j);
     
     public:
 	
@@ -220,7 +279,9 @@ namespace LocARNA {
 	    min_prob_(min_prob),
 	    len_(get_length_from_rna_data()),
 	    left_(),
+	    left_start_(),
 	    right_(),
+	    right_start_(),
 	    arc_vec_(),
 	    arcs_(-1)
 	{
@@ -238,15 +299,16 @@ namespace LocARNA {
 	    min_prob_(1.0),
 	    len_(len),
 	    left_(),
+	    left_start_(),
 	    right_(),
+	    right_start_(),
 	    arc_vec_(),
 	    arcs_(-1)
 	{
-	    resize(seqlen());
 	    for (bpair_set_t::const_iterator it=bps.begin(); bps.end()!=it; ++it) {
 		register_arc(it->first,it->second);
 	    }
-	    sortAdjLists();
+	    build_adj_lists();
 	}
 	
 	// /**
@@ -260,23 +322,17 @@ namespace LocARNA {
 	// BasePairs &
 	// operator =(const BasePairs &bps);
 
-	/**
-	 * registers a basepair (i,j),
-	 * maintains the basepair access data structures
-	 */
-	void
-	register_arc(int i, int j);
-
-	//! returns the list of arcs with right end i
-	const LeftAdjList &
+	//! returns the list of arcs with left end i
+	LeftAdjList
 	left_adjlist(int i) const {
-	    //std::cout<<"size of left adjlist of "<<i<<"is "<<left_[i].size()<<std::endl; 
-	    return left_[i];
+	    return adj_list(left_,left_start_,i);
 	}
 	
-	//! returns the list of arcs with left end i
-	const RightAdjList &
-	right_adjlist(int i) const { return right_[i];}
+	//! returns the list of arcs with right end i
+	RightAdjList
+	right_adjlist(int i) const {
+	    return adj_list(right_,right_start_,i);
+	}
 
 	//! accesses basepair by (i,j)
 	const Arc &
@@ -321,6 +377,18 @@ namespace LocARNA {
 
     private:
 	
+	//! @brief adjacency list of position i in CSR structure
+	template<class Entry>
+	static
+	AdjList<Entry>
+	adj_list(const std::vector<Entry> &entries,
+		 const std::vector<size_type> &start,
+		 int i) {
+	    if (entries.empty()) return AdjList<Entry>(NULL,NULL);
+	    const Entry *first = &entries[0];
+	    return AdjList<Entry>(first+start[i],first+start[i+1]);
+	}
+	
 	// return length from rna data
 	// pre: rna data available
 	size_type
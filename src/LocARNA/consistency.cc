@@ -0,0 +1,498 @@
+#include "consistency.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+
+#include "aux.hh"
+#include "match_probs.hh"
+#include "thread_pool.hh"
+
+namespace LocARNA {
+
+    //! magic string at the start of binary files
+    static const std::string binary_magic = "LocARNA-match-probs-1";
+
+    //! @brief write a value in binary format
+    template <class T>
+    static
+    void
+    write_binary_value(std::ostream &out, const T &x) {
+	out.write(reinterpret_cast<const char *>(&x),sizeof(T));
+    }
+
+    //! @brief read a value in binary format
+    template <class T>
+    static
+    void
+    read_binary_value(std::istream &in, T &x) {
+	if (!in.read(reinterpret_cast<char *>(&x),sizeof(T))) {
+	    throw failure("MatchProbsSet: unexpected end of binary input.");
+	}
+    }
+
+    MatchProbsSet::MatchProbsSet(const std::vector<std::string> &names,
+				 bool arc_matches)
+	: names_(names),
+	  arc_matches_(arc_matches),
+	  arcs_(arc_matches?names.size():0),
+	  arc_idx_(arc_matches?names.size():0),
+	  num_items_(names.size(),0),
+	  rows_(names.size()*names.size())
+    {
+    }
+
+    MatchProbsSet::size_type
+    MatchProbsSet::item(size_type s, size_type i, size_type j) {
+	if (!arc_matches_) {
+	    num_items_[s] = std::max(num_items_[s],i+1);
+	    return i;
+	}
+
+	arc_t arc(i,j);
+	std::map<arc_t,size_type>::const_iterator it = arc_idx_[s].find(arc);
+	if (it!=arc_idx_[s].end()) {
+	    return it->second;
+	}
+
+	size_type idx = arcs_[s].size();
+	arcs_[s].push_back(arc);
+	arc_idx_[s][arc] = idx;
+	num_items_[s] = idx+1;
+	return idx;
+    }
+
+    void
+    MatchProbsSet::set_prob(size_type a, size_type b,
+			    size_type item_a, size_type item_b,
+			    double p) {
+	rows_t &ab = rows_ref(a,b);
+	if (ab.size()<=item_a) ab.resize(item_a+1);
+	ab[item_a].push_back(entry_t(item_b,p));
+
+	rows_t &ba = rows_ref(b,a);
+	if (ba.size()<=item_b) ba.resize(item_b+1);
+	ba[item_b].push_back(entry_t(item_a,p));
+    }
+
+    double
+    MatchProbsSet::prob(size_type a, size_type b,
+			size_type item_a, size_type item_b) const {
+	const rows_t &ab = rows(a,b);
+	if (item_a>=ab.size()) return 0.0;
+
+	for (row_t::const_iterator it=ab[item_a].begin(); ab[item_a].end()!=it; ++it) {
+	    if (it->first==item_b) return it->second;
+	}
+	return 0.0;
+    }
+
+    void
+    MatchProbsSet::set_base_match_probs(size_type a, size_type b,
+					const MatchProbs &match_probs,
+					double min_prob) {
+	assert(!arc_matches_);
+	for (size_type i=1; i<match_probs.get_lenA(); ++i) {
+	    for (size_type j=1; j<match_probs.get_lenB(); ++j) {
+		double p = match_probs.prob(i,j);
+		if (p>0 && p>=min_prob) {
+		    set_prob(a,b,item(a,i),item(b,j),p);
+		}
+	    }
+	}
+    }
+
+    void
+    MatchProbsSet::sort_rows() {
+	for (std::vector<rows_t>::iterator it=rows_.begin(); rows_.end()!=it; ++it) {
+	    for (rows_t::iterator it2=it->begin(); it->end()!=it2; ++it2) {
+		std::sort(it2->begin(),it2->end());
+	    }
+	}
+    }
+
+    double
+    MatchProbsSet::sum_probs() const {
+	double sum=0.0;
+	for (std::vector<rows_t>::const_iterator it=rows_.begin(); rows_.end()!=it; ++it) {
+	    for (rows_t::const_iterator it2=it->begin(); it->end()!=it2; ++it2) {
+		for (row_t::const_iterator it3=it2->begin(); it2->end()!=it3; ++it3) {
+		    sum += it3->second;
+		}
+	    }
+	}
+	return sum;
+    }
+
+    void
+    MatchProbsSet::scale(double factor) {
+	for (std::vector<rows_t>::iterator it=rows_.begin(); rows_.end()!=it; ++it) {
+	    for (rows_t::iterator it2=it->begin(); it->end()!=it2; ++it2) {
+		for (row_t::iterator it3=it2->begin(); it2->end()!=it3; ++it3) {
+		    it3->second *= factor;
+		}
+	    }
+	}
+    }
+
+    // ------------------------------------------------------------
+    // text input and output
+
+    void
+    MatchProbsSet::read_pair(size_type a, size_type b, std::istream &in, bool transposed) {
+	if (transposed) {
+	    std::swap(a,b);
+	}
+
+	std::string line;
+	size_type lineno=0;
+	while (std::getline(in,line)) {
+	    lineno++;
+	    std::istringstream ls(line);
+	    size_type i, j, k=0, l=0;
+	    double p;
+
+	    if (!(ls >> i)) continue; // skip empty lines
+
+	    bool ok = arc_matches_
+		? (ls >> j >> k >> l >> p)
+		: (ls >> k >> p);
+	    if (!ok) {
+		std::ostringstream err;
+		err << "MatchProbsSet: cannot parse line "<<lineno<<" of match probabilities.";
+		throw failure(err.str());
+	    }
+
+	    if (arc_matches_) {
+		set_prob(a,b,item(a,i,j),item(b,k,l),p);
+	    } else {
+		set_prob(a,b,item(a,i),item(b,k),p);
+	    }
+	}
+    }
+
+    void
+    MatchProbsSet::read_dir(const std::string &dir) {
+	for (size_type a=0; a<num_seqs(); ++a) {
+	    for (size_type b=a+1; b<num_seqs(); ++b) {
+		std::ifstream in((dir+"/"+names_[a]+"-"+names_[b]).c_str());
+		if (in.is_open()) {
+		    read_pair(a,b,in,false);
+		    continue;
+		}
+		std::ifstream in_t((dir+"/"+names_[b]+"-"+names_[a]).c_str());
+		if (in_t.is_open()) {
+		    read_pair(a,b,in_t,true);
+		}
+	    }
+	}
+	sort_rows();
+    }
+
+    std::ostream &
+    MatchProbsSet::write_pair(size_type a, size_type b, std::ostream &out) const {
+	const rows_t &ab = rows(a,b);
+
+	out << std::fixed << std::setprecision(8);
+	for (size_type x=0; x<ab.size(); ++x) {
+	    for (row_t::const_iterator it=ab[x].begin(); ab[x].end()!=it; ++it) {
+		if (arc_matches_) {
+		    const arc_t &arcA = arcs_[a][x];
+		    const arc_t &arcB = arcs_[b][it->first];
+		    out << arcA.first << " " << arcA.second << " "
+			<< arcB.first << " " << arcB.second << " ";
+		} else {
+		    out << x << " " << it->first << " ";
+		}
+		out << it->second << std::endl;
+	    }
+	}
+	return out;
+    }
+
+    void
+    MatchProbsSet::write_dir(const std::string &dir) const {
+	if (mkdir(dir.c_str(),0777)!=0 && errno!=EEXIST) {
+	    throw failure("MatchProbsSet: cannot create directory "+dir+".");
+	}
+
+	for (size_type a=0; a<num_seqs(); ++a) {
+	    for (size_type b=0; b<num_seqs(); ++b) {
+		if (a==b) continue;
+		std::string filename = dir+"/"+names_[a]+"-"+names_[b];
+		std::ofstream out(filename.c_str());
+		if (!out.is_open()) {
+		    throw failure("MatchProbsSet: cannot write to "+filename+".");
+		}
+		write_pair(a,b,out);
+	    }
+	}
+    }
+
+    // ------------------------------------------------------------
+    // binary input and output
+
+    void
+    MatchProbsSet::write_binary(std::ostream &out) const {
+	out.write(binary_magic.c_str(),binary_magic.length());
+
+	write_binary_value(out,(unsigned int)num_seqs());
+	write_binary_value(out,(unsigned char)arc_matches_);
+
+	for (size_type s=0; s<num_seqs(); ++s) {
+	    write_binary_value(out,(unsigned int)names_[s].length());
+	    out.write(names_[s].c_str(),names_[s].length());
+	    write_binary_value(out,(unsigned int)num_items_[s]);
+	    if (arc_matches_) {
+		for (size_type x=0; x<arcs_[s].size(); ++x) {
+		    write_binary_value(out,(unsigned int)arcs_[s][x].first);
+		    write_binary_value(out,(unsigned int)arcs_[s][x].second);
+		}
+	    }
+	}
+
+	// only the pairs (a,b) with a<b; the transposes are implied
+	for (size_type a=0; a<num_seqs(); ++a) {
+	    for (size_type b=a+1; b<num_seqs(); ++b) {
+		const rows_t &ab = rows(a,b);
+		unsigned long long nnz=0;
+		for (size_type x=0; x<ab.size(); ++x) {
+		    nnz += ab[x].size();
+		}
+		write_binary_value(out,nnz);
+		for (size_type x=0; x<ab.size(); ++x) {
+		    for (row_t::const_iterator it=ab[x].begin(); ab[x].end()!=it; ++it) {
+			write_binary_value(out,(unsigned int)x);
+			write_binary_value(out,(unsigned int)it->first);
+			write_binary_value(out,it->second);
+		    }
+		}
+	    }
+	}
+    }
+
+    void
+    MatchProbsSet::read_binary(std::istream &in) {
+	std::string magic(binary_magic.length(),' ');
+	if (!in.read(&magic[0],magic.length()) || magic!=binary_magic) {
+	    throw failure("MatchProbsSet: input is not in binary match probability format.");
+	}
+
+	unsigned int n;
+	unsigned char arc_matches;
+	read_binary_value(in,n);
+	read_binary_value(in,arc_matches);
+
+	*this = MatchProbsSet(std::vector<std::string>(n),arc_matches!=0);
+
+	for (size_type s=0; s<n; ++s) {
+	    unsigned int len;
+	    read_binary_value(in,len);
+	    names_[s].resize(len);
+	    if (len>0 && !in.read(&names_[s][0],len)) {
+		throw failure("MatchProbsSet: unexpected end of binary input.");
+	    }
+	    unsigned int items;
+	    read_binary_value(in,items);
+	    num_items_[s]=items;
+	    if (arc_matches_) {
+		for (size_type x=0; x<items; ++x) {
+		    unsigned int i,j;
+		    read_binary_value(in,i);
+		    read_binary_value(in,j);
+		    item(s,i,j);
+		}
+	    }
+	}
+
+	for (size_type a=0; a<num_seqs(); ++a) {
+	    for (size_type b=a+1; b<num_seqs(); ++b) {
+		unsigned long long nnz;
+		read_binary_value(in,nnz);
+		for (unsigned long long e=0; e<nnz; ++e) {
+		    unsigned int x,y;
+		    double p;
+		    read_binary_value(in,x);
+		    read_binary_value(in,y);
+		    read_binary_value(in,p);
+		    if (x>=num_items_[a] || y>=num_items_[b]) {
+			throw failure("MatchProbsSet: invalid item in binary input.");
+		    }
+		    set_prob(a,b,x,y,p);
+		}
+	    }
+	}
+	sort_rows();
+    }
+
+    void
+    MatchProbsSet::read(const std::string &input) {
+	struct stat st;
+	if (stat(input.c_str(),&st)!=0) {
+	    throw failure("MatchProbsSet: cannot read from "+input+".");
+	}
+	if (S_ISDIR(st.st_mode)) {
+	    read_dir(input);
+	    return;
+	}
+
+	std::ifstream in(input.c_str(),std::ios::binary);
+	if (!in.good()) {
+	    throw failure("MatchProbsSet: cannot read from "+input+".");
+	}
+	bool arc_matches = arc_matches_;
+	std::vector<std::string> names = names_;
+	read_binary(in);
+	if (names_!=names || arc_matches_!=arc_matches) {
+	    throw failure("MatchProbsSet: probabilities in "+input+" do not fit the sequence names.");
+	}
+    }
+
+    void
+    MatchProbsSet::write(const std::string &output, bool binary) const {
+	if (!binary) {
+	    write_dir(output);
+	    return;
+	}
+	std::ofstream out(output.c_str(),std::ios::binary);
+	if (!out.good()) {
+	    throw failure("MatchProbsSet: cannot write to "+output+".");
+	}
+	write_binary(out);
+    }
+
+    // ------------------------------------------------------------
+    // consistency transformation
+
+    void
+    MatchProbsSet::transform_pair(MatchProbsSet &transformed,
+				  size_type a,
+				  size_type b,
+				  double min_prob) const {
+	size_type n = num_seqs();
+	const rows_t &ab = rows(a,b);
+
+	// dense accumulator for one row of the product and the
+	// (unsorted) list of its touched entries
+	std::vector<double> acc(num_items_[b],0.0);
+	std::vector<size_type> touched;
+
+	rows_t &result_ab = transformed.rows_ref(a,b);
+	rows_t &result_ba = transformed.rows_ref(b,a);
+
+	for (size_type x=0; x<num_items_[a]; ++x) {
+	    // via C=A and C=B, the pair contributes itself twice
+	    if (x<ab.size()) {
+		for (row_t::const_iterator it=ab[x].begin(); ab[x].end()!=it; ++it) {
+		    if (acc[it->first]==0.0) touched.push_back(it->first);
+		    acc[it->first] += 2*it->second;
+		}
+	    }
+
+	    // via all other sequences C
+	    for (size_type c=0; c<n; ++c) {
+		if (c==a || c==b) continue;
+		const rows_t &ac = rows(a,c);
+		const rows_t &cb = rows(c,b);
+		if (x>=ac.size()) continue;
+
+		for (row_t::const_iterator it=ac[x].begin(); ac[x].end()!=it; ++it) {
+		    if (it->first>=cb.size()) continue;
+		    const row_t &row = cb[it->first];
+		    double p = it->second;
+		    for (row_t::const_iterator it2=row.begin(); row.end()!=it2; ++it2) {
+			if (acc[it2->first]==0.0) touched.push_back(it2->first);
+			acc[it2->first] += p * it2->second;
+		    }
+		}
+	    }
+
+	    std::sort(touched.begin(),touched.end());
+	    touched.erase(std::unique(touched.begin(),touched.end()),touched.end());
+
+	    for (std::vector<size_type>::const_iterator it=touched.begin(); touched.end()!=it; ++it) {
+		double p = acc[*it]/n;
+		acc[*it]=0.0;
+		if (p>=min_prob) {
+		    // entries are appended in increasing order of
+		    // items, such that both rows stay sorted
+		    result_ab[x].push_back(entry_t(*it,p));
+		    result_ba[*it].push_back(entry_t(x,p));
+		}
+	    }
+	    touched.clear();
+	}
+    }
+
+    //! @brief task of transforming one pair
+    class ConsistencyTransformTask : public ThreadPool::Task {
+	const MatchProbsSet &probs_;
+	MatchProbsSet &transformed_;
+	size_t a_;
+	size_t b_;
+	double min_prob_;
+    public:
+	//! @brief construct for pair (a,b)
+	ConsistencyTransformTask(const MatchProbsSet &probs,
+				 MatchProbsSet &transformed,
+				 size_t a, size_t b,
+				 double min_prob)
+	    : probs_(probs),transformed_(transformed),a_(a),b_(b),min_prob_(min_prob)
+	{}
+
+	void
+	run() {
+	    probs_.transform_pair(transformed_,a_,b_,min_prob_);
+	}
+    };
+
+    void
+    MatchProbsSet::consistency_transform(MatchProbsSet &transformed,
+					 double min_prob,
+					 size_type num_threads,
+					 bool scale_after) const {
+	size_type n = num_seqs();
+
+	// same sequences and items, no probabilities
+	transformed.names_ = names_;
+	transformed.arc_matches_ = arc_matches_;
+	transformed.arcs_ = arcs_;
+	transformed.arc_idx_ = arc_idx_;
+	transformed.num_items_ = num_items_;
+	transformed.rows_.assign(n*n,rows_t());
+	for (size_type a=0; a<n; ++a) {
+	    for (size_type b=0; b<n; ++b) {
+		if (a!=b) transformed.rows_ref(a,b).resize(num_items_[a]);
+	    }
+	}
+
+	// each task writes only the rows of its pair and the transpose
+	std::vector<ConsistencyTransformTask> tasks;
+	tasks.reserve(n*(n-1)/2);
+	for (size_type a=0; a<n; ++a) {
+	    for (size_type b=a+1; b<n; ++b) {
+		tasks.push_back(ConsistencyTransformTask(*this,transformed,a,b,min_prob));
+	    }
+	}
+
+	ThreadPool pool(num_threads);
+	for (size_type k=0; k<tasks.size(); ++k) {
+	    pool.submit(&tasks[k]);
+	}
+	pool.wait();
+
+	if (scale_after) {
+	    double sum = transformed.sum_probs();
+	    if (sum>0) {
+		transformed.scale(sum_probs()/sum);
+	    }
+	}
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,358 @@
+#ifndef LOCARNA_CONSISTENCY_HH
+#define LOCARNA_CONSISTENCY_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+namespace LocARNA {
+
+    class MatchProbs;
+    class ConsistencyTransformTask;
+
+    /**
+     * @brief Sparse match probabilities between all pairs of a set
+     * of RNAs
+     *
+     * Holds either base match probabilities or arc match
+     * probabilities, as computed by AlignerP, for all pairs of
+     * sequences of a multiple alignment problem, and performs the
+     * probabilistic consistency transformation on them (as in
+     * T-Coffee/ProbCons; formerly done by mlocarna in Perl).
+     *
+     * Probabilities are stored per pair of items, where items are
+     * sequence positions (base matches) or arcs (arc matches). For
+     * arc matches, each sequence has its own registry that maps the
+     * arcs occuring in any of its probabilities to item indices.
+     *
+     * For each ordered pair (a,b) of sequences, the probabilities are
+     * kept as sparse rows, i.e. for each item of a the sorted list of
+     * items of b with non-zero probability. Both orientations (a,b)
+     * and (b,a) are kept, such that the transformation works on
+     * rows only.
+     *
+     * Text input and output is in the format of AlignerP (lines
+     * "i j p" for base matches, "i j k l p" for arc matches) with one
+     * file nameA-nameB per pair in a directory (as used by
+     * mlocarna). Binary input and output stores all pairs in one
+     * file.
+     *
+     * @note the binary format uses the native byte order
+     */
+    class MatchProbsSet {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! entry of a sparse row: item of the second sequence and probability
+	typedef std::pair<size_type,double> entry_t;
+
+	//! sparse row, sorted by items
+	typedef std::vector<entry_t> row_t;
+
+	//! sparse matrix as vector of rows
+	typedef std::vector<row_t> rows_t;
+
+	//! arc as pair of left and right end
+	typedef std::pair<size_type,size_type> arc_t;
+
+    private:
+	std::vector<std::string> names_; //!< names of the sequences
+	bool arc_matches_; //!< whether items are arcs
+
+	//! for each sequence, the arcs of its items (arc matches only)
+	std::vector<std::vector<arc_t> > arcs_;
+
+	//! for each sequence, the item indices of its arcs (arc matches only)
+	std::vector<std::map<arc_t,size_type> > arc_idx_;
+
+	//! for each sequence, the number of items
+	std::vector<size_type> num_items_;
+
+	//! sparse matrices of the ordered pairs (a,b) at index a*num_seqs()+b
+	std::vector<rows_t> rows_;
+
+	/**
+	 * @brief Matrix of an ordered pair (write access)
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @return rows of the pair
+	 */
+	rows_t &
+	rows_ref(size_type a, size_type b) {
+	    return rows_[a*names_.size()+b];
+	}
+
+	/**
+	 * @brief Transform the probabilities of one pair
+	 *
+	 * Computes the pair (a,b) and its transpose (b,a) of the
+	 * transformed set.
+	 *
+	 * @param[in,out] transformed transformed set
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @param min_prob minimal probability of the transformed set
+	 */
+	void
+	transform_pair(MatchProbsSet &transformed,
+		       size_type a,
+		       size_type b,
+		       double min_prob) const;
+
+	//! @brief sort all rows by items
+	void
+	sort_rows();
+
+	friend class ConsistencyTransformTask;
+
+	/**
+	 * @brief Read the probabilities of one pair from a stream
+	 *
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @param in input stream in AlignerP format
+	 * @param transposed whether the stream has the probabilities
+	 * of the pair (b,a)
+	 *
+	 * @throw failure on syntax errors
+	 */
+	void
+	read_pair(size_type a, size_type b, std::istream &in, bool transposed);
+
+    public:
+	/**
+	 * @brief Construct empty set
+	 *
+	 * @param names names of the sequences
+	 * @param arc_matches whether the items are arcs (otherwise,
+	 * positions)
+	 */
+	MatchProbsSet(const std::vector<std::string> &names, bool arc_matches);
+
+	//! @brief names of the sequences
+	const std::vector<std::string> &
+	names() const {return names_;}
+
+	//! @brief number of sequences
+	size_type
+	num_seqs() const {return names_.size();}
+
+	//! @brief whether the items are arcs
+	bool
+	arc_matches() const {return arc_matches_;}
+
+	/**
+	 * @brief Number of items of a sequence
+	 * @param s sequence
+	 * @return number of items (for base matches, maximal position+1)
+	 */
+	size_type
+	num_items(size_type s) const {return num_items_[s];}
+
+	/**
+	 * @brief Item of a position or arc
+	 *
+	 * Registers the arc if it is new.
+	 *
+	 * @param s sequence
+	 * @param i position or left end
+	 * @param j right end (arc matches only)
+	 * @return item index
+	 */
+	size_type
+	item(size_type s, size_type i, size_type j=0);
+
+	/**
+	 * @brief Arc of an item
+	 * @param s sequence
+	 * @param item item index
+	 * @return arc
+	 * @pre arc matches
+	 */
+	const arc_t &
+	arc(size_type s, size_type item) const {return arcs_[s][item];}
+
+	/**
+	 * @brief Sparse matrix of an ordered pair
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @return rows indexed by the items of a
+	 */
+	const rows_t &
+	rows(size_type a, size_type b) const {
+	    return rows_[a*names_.size()+b];
+	}
+
+	/**
+	 * @brief Set probability of a pair of items
+	 *
+	 * Sets the entry of (a,b) and (b,a).
+	 *
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @param item_a item of a
+	 * @param item_b item of b
+	 * @param p probability
+	 *
+	 * @note the entry must be new; rows are unsorted until the
+	 * set is read or transformed
+	 */
+	void
+	set_prob(size_type a, size_type b,
+		 size_type item_a, size_type item_b,
+		 double p);
+
+	/**
+	 * @brief Get probability of a pair of items
+	 *
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @param item_a item of a
+	 * @param item_b item of b
+	 * @return probability (0 if not set)
+	 */
+	double
+	prob(size_type a, size_type b,
+	     size_type item_a, size_type item_b) const;
+
+	/**
+	 * @brief Set base match probabilities of a pair
+	 *
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @param match_probs base match probabilities of a and b
+	 * @param min_prob minimal probability of kept entries
+	 *
+	 * @pre no arc matches; no probabilities of (a,b) set before
+	 */
+	void
+	set_base_match_probs(size_type a, size_type b,
+			     const MatchProbs &match_probs,
+			     double min_prob);
+
+	//! @brief sum of the probabilities of all ordered pairs
+	double
+	sum_probs() const;
+
+	/**
+	 * @brief Multiply all probabilities by a factor
+	 * @param factor factor
+	 */
+	void
+	scale(double factor);
+
+	/**
+	 * @brief Read probabilities of all pairs from a directory
+	 *
+	 * For each pair of sequences, reads the file nameA-nameB or,
+	 * if it does not exist, nameB-nameA. Missing pairs have no
+	 * probabilities.
+	 *
+	 * @param dir directory name
+	 *
+	 * @throw failure on syntax errors
+	 */
+	void
+	read_dir(const std::string &dir);
+
+	/**
+	 * @brief Write probabilities of all ordered pairs to a directory
+	 *
+	 * Creates the directory if necessary and writes one file
+	 * nameA-nameB per ordered pair.
+	 *
+	 * @param dir directory name
+	 *
+	 * @throw failure if a file cannot be written
+	 */
+	void
+	write_dir(const std::string &dir) const;
+
+	/**
+	 * @brief Write probabilities of an ordered pair in AlignerP format
+	 * @param a first sequence
+	 * @param b second sequence
+	 * @param out output stream
+	 * @return stream
+	 */
+	std::ostream &
+	write_pair(size_type a, size_type b, std::ostream &out) const;
+
+	/**
+	 * @brief Read set from binary stream
+	 *
+	 * Replaces names, item registries and probabilities.
+	 *
+	 * @param in input stream
+	 *
+	 * @throw failure if the stream is not in binary format
+	 */
+	void
+	read_binary(std::istream &in);
+
+	/**
+	 * @brief Write set to binary stream
+	 * @param out output stream
+	 */
+	void
+	write_binary(std::ostream &out) const;
+
+	/**
+	 * @brief Read probabilities from a directory or binary file
+	 *
+	 * @param input directory (see read_dir()) or binary file (see
+	 * read_binary())
+	 *
+	 * @throw failure if input cannot be read or binary input does
+	 * not fit the names
+	 */
+	void
+	read(const std::string &input);
+
+	/**
+	 * @brief Write probabilities to a directory or binary file
+	 *
+	 * @param output directory (see write_dir()) or binary file
+	 * (see write_binary())
+	 * @param binary whether to write a binary file
+	 *
+	 * @throw failure if output cannot be written
+	 */
+	void
+	write(const std::string &output, bool binary) const;
+
+	/**
+	 * @brief Consistency transformation
+	 *
+	 * Re-estimates the match probabilities of each pair (A,B) via
+	 * all other sequences C:
+	 *
+	 *   P'_AB(x,y) = 1/N ( 2 P_AB(x,y) + sum_{C!=A,B} sum_z P_AC(x,z) P_CB(z,y) ),
+	 *
+	 * where N is the number of sequences and entries below
+	 * min_prob are dropped (as the transformation of
+	 * mlocarna). The products are computed row-wise over the
+	 * sparse rows; the pairs are distributed over threads.
+	 *
+	 * @param[out] transformed transformed set
+	 * @param min_prob minimal probability of the transformed set
+	 * @param num_threads number of threads (0 for number of processors)
+	 * @param scale_after whether to scale the transformed
+	 * probabilities to the sum of the original ones
+	 */
+	void
+	consistency_transform(MatchProbsSet &transformed,
+			      double min_prob,
+			      size_type num_threads,
+			      bool scale_after) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_CONSISTENCY_HH
@@ -6,6 +6,8 @@
 #endif
 
 #include <iosfwd>
+#include <vector>
+#include <pthread.h>
 #include "ext_rna_data.hh"
 #include "sequence.hh"
 #include "sparse_vector.hh"
@@ -57,6 +59,40 @@ namespace LocARNA {
 	//! used in initialization, to check whether in loop probs
 	//! still have to be computed
 	bool has_in_loop_probs_;
+
+	//! RNA ensemble for the lazy computation of in loop
+	//! probabilities (owned); NULL, if all in loop probabilities
+	//! are available
+	RnaEnsemble *rna_ensemble_;
+
+	//! right ends of the arcs in the arc probabilities, sorted,
+	//! for each left end (used for computing in loop probabilities)
+	std::vector<std::vector<size_t> > right_ends_;
+
+	//! index of the loops (closed by arcs of the arc
+	//! probabilities, or external) in in_loop_computed_, or
+	//! no_loop (lazy computation)
+	//!
+	//! @note not changed, while in loop probabilities are
+	//! queried; neither are the keys of arc_in_loop_probs_ and
+	//! unpaired_in_loop_probs_, which contain an entry for each
+	//! loop. Thus, computed loops can be read without locking.
+	SparseMatrix<size_t> lazy_loop_idx_;
+
+	//! for each loop, whether its in loop probabilities are
+	//! computed (lazy computation); set atomically after
+	//! computing them
+	std::vector<int> in_loop_computed_;
+
+	//! index of non-loops in lazy_loop_idx_
+	static const size_t no_loop = (size_t)-1;
+
+	//! ratio of drop_worst_bpil_precise(), which is applied on
+	//! lazy computation (0 for no effect)
+	double lazy_bpil_length_ratio_;
+
+	//! protects the lazy computation of in loop probabilities
+	pthread_mutex_t mutex_;
 	
 	// ----------------------------------------
 	// CONSTRUCTORS
@@ -74,6 +110,9 @@ namespace LocARNA {
 	ExtRnaDataImpl(ExtRnaData *self,
 		       double p_bpilcut,
 		       double p_uilcut);
+
+	//! @brief destructor
+	~ExtRnaDataImpl();
 	
 	// ----------------------------------------
 	// METHODS
@@ -87,6 +126,59 @@ namespace LocARNA {
 	init_fixed_basepairs_in_loop(size_t i,
 				     size_t j,
 				     const RnaStructure &structure);
+
+	//! @brief no copy
+	ExtRnaDataImpl(const ExtRnaDataImpl &);
+
+	//! @brief no assignment
+	ExtRnaDataImpl &
+	operator =(const ExtRnaDataImpl &);
+
+	/**
+	 * @brief initialize right_ends_ from the arc probabilities
+	 */
+	void
+	init_right_ends();
+
+	/**
+	 * @brief compute the in loop probabilities of one loop
+	 *
+	 * @param rna_ensemble rna ensemble with in loop probabilities
+	 * @param i left end of the loop
+	 * @param j right end of the loop
+	 *
+	 * The loop (0,length+1) is the external loop.
+	 *
+	 * @pre right_ends_ is initialized
+	 */
+	void
+	compute_in_loop_probs(const RnaEnsemble &rna_ensemble,
+			      size_t i, size_t j);
+
+	/**
+	 * @brief initialize the loops for lazy computation
+	 *
+	 * Indexes the loops and adds an (empty) entry for each loop
+	 * to the in loop probabilities. The state of loops that are
+	 * computed already is kept.
+	 *
+	 * @pre right_ends_ is initialized
+	 */
+	void
+	init_lazy_loops();
+
+	/**
+	 * @brief make available the in loop probabilities of one loop
+	 *
+	 * Computes them on first access, if they are computed
+	 * lazily. Only the computation is locked; once a loop is
+	 * computed, this does not lock.
+	 *
+	 * @param i left end of the loop
+	 * @param j right end of the loop
+	 */
+	void
+	provide_in_loop_probs(size_t i, size_t j);
     public:
 
 	
@@ -113,6 +205,61 @@ namespace LocARNA {
 	void
 	init_from_ext_rna_ensemble(const RnaEnsemble &rna_ensemble);	
 
+	/**
+	 * @brief initialize for lazy computation from rna ensemble
+	 *
+	 * The in loop probabilities of a loop are computed from the
+	 * McCaskill matrices of the ensemble on first access and then
+	 * kept. This is much cheaper than init_from_ext_rna_ensemble(),
+	 * if only a part of the loops is accessed (as in sparsified
+	 * alignment).
+	 *
+	 * @param rna_ensemble rna ensemble; the object takes
+	 * ownership
+	 *
+	 * @note must be called after RnaDataImpl::init_from_rna_ensemble
+	 * @note rna_ensemble must have in loop probabilities
+	 */
+	void
+	init_lazy_from_ext_rna_ensemble(RnaEnsemble *rna_ensemble);
+
+	/**
+	 * @brief compute all in loop probabilities, which are not
+	 * computed yet
+	 *
+	 * Required before accessing all in loop probabilities at
+	 * once. No-op, if there is no lazy computation.
+	 */
+	void
+	compute_all_in_loop_probs();
+
+	/**
+	 * @brief in loop probability of a base pair
+	 *
+	 * @param ip left end of inner base pair
+	 * @param jp right end of inner base pair
+	 * @param i left end of the loop
+	 * @param j right end of the loop
+	 *
+	 * @return probability of (ip,jp) in the loop closed by (i,j)
+	 * @note thread-safe
+	 */
+	double
+	arc_in_loop_prob(size_t ip, size_t jp, size_t i, size_t j);
+
+	/**
+	 * @brief in loop probability of an unpaired base
+	 *
+	 * @param k unpaired base
+	 * @param i left end of the loop
+	 * @param j right end of the loop
+	 *
+	 * @return probability of unpaired k in the loop closed by (i,j)
+	 * @note thread-safe
+	 */
+	double
+	unpaired_in_loop_prob(size_t k, size_t i, size_t j);
+
 	/**
 	 * @brief read in loop probability section of pp-format
 	 *
@@ -237,10 +384,24 @@ namespace LocARNA {
 	 *  loop length
 	 *
 	 * @param ratio limit on number of base pairs closed by a loop divided by loop length
+	 *
+	 * @note with lazy computation, the limit is applied to each
+	 * loop, when its in loop probabilities are computed
 	 */
 	void
 	drop_worst_bpil_precise(double ratio);
 
+	/**
+	 * @brief Drop base pairs in the loop (i,j) with lowest
+	 * probability based on loop length
+	 *
+	 * @param i left end of the loop
+	 * @param j right end of the loop
+	 * @param ratio limit on number of base pairs closed by a loop divided by loop length
+	 */
+	void
+	drop_worst_bpil_precise(size_t i, size_t j, double ratio);
+
     }; // end ExtRnaDataImpl
 
 
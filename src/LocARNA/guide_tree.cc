@@ -0,0 +1,387 @@
+#include "guide_tree.hh"
+#include "aux.hh"
+#include "thread_pool.hh"
+
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+namespace LocARNA {
+
+    const GuideTree::size_type GuideTree::none = std::numeric_limits<size_type>::max();
+
+    /**
+     * @brief Task of searching the best partners of a range of rows
+     *
+     * For each row of the range, searches the partner of maximal
+     * score among the rows of later clusters; the score is the
+     * similarity (UPGMA) or the negative Q-criterion (neighbor
+     * joining, if row sums are given).
+     */
+    class GuideTree::RowScanTask : public ThreadPool::Task {
+	const Matrix<double> &m_; //!< similarities or distances
+	const std::vector<size_type> &clusters_; //!< rows of the active clusters
+	const std::vector<double> *rowsum_; //!< row sums of distances (NULL for UPGMA)
+	const std::vector<size_type> &positions_; //!< positions in clusters to scan
+	size_type begin_; //!< begin of range in positions
+	size_type end_; //!< end of range in positions
+	std::vector<double> &best_; //!< best score per row
+	std::vector<size_type> &partner_; //!< best partner per row (or none)
+    public:
+	//! @brief construct for positions[begin..end-1]
+	RowScanTask(const Matrix<double> &m,
+		    const std::vector<size_type> &clusters,
+		    const std::vector<double> *rowsum,
+		    const std::vector<size_type> &positions,
+		    size_type begin, size_type end,
+		    std::vector<double> &best,
+		    std::vector<size_type> &partner)
+	    : m_(m), clusters_(clusters), rowsum_(rowsum),
+	      positions_(positions), begin_(begin), end_(end),
+	      best_(best), partner_(partner)
+	{}
+
+	void
+	run() {
+	    size_type n = clusters_.size();
+	    for (size_type k=begin_; k<end_; ++k) {
+		size_type i = positions_[k];
+		size_type ri = clusters_[i];
+		double max_score = -std::numeric_limits<double>::infinity();
+		size_type max_r = none;
+		if (rowsum_==NULL) {
+		    for (size_type j=i+1; j<n; ++j) {
+			double s = m_(ri,clusters_[j]);
+			if (s > max_score) {
+			    max_score = s;
+			    max_r = clusters_[j];
+			}
+		    }
+		} else {
+		    const std::vector<double> &rowsum = *rowsum_;
+		    for (size_type j=i+1; j<n; ++j) {
+			size_type rj = clusters_[j];
+			double s = -((n-2)*m_(ri,rj) - rowsum[ri] - rowsum[rj]);
+			if (s > max_score) {
+			    max_score = s;
+			    max_r = rj;
+			}
+		    }
+		}
+		best_[ri] = max_score;
+		partner_[ri] = max_r;
+	    }
+	}
+    };
+
+    void
+    GuideTree::scan_rows(ThreadPool &pool,
+			 const Matrix<double> &m,
+			 const std::vector<size_type> &clusters,
+			 const std::vector<double> *rowsum,
+			 const std::vector<size_type> &positions,
+			 std::vector<double> &best,
+			 std::vector<size_type> &partner) {
+	size_type n = positions.size();
+	if (n==0) return;
+
+	// several contiguous ranges per thread for load balance
+	size_type chunks = std::min(n, 8*pool.size());
+	std::vector<RowScanTask *> tasks;
+	for (size_type k=0; k<chunks; ++k) {
+	    tasks.push_back(new RowScanTask(m, clusters, rowsum, positions,
+					    n*k/chunks, n*(k+1)/chunks,
+					    best, partner));
+	    pool.submit(tasks.back());
+	}
+	try {
+	    pool.wait();
+	} catch (failure &f) {
+	    for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+	    throw;
+	}
+	for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+    }
+
+    /**
+     * @brief Select the best pair of clusters
+     *
+     * @param clusters rows of the active clusters
+     * @param best best score per row
+     * @param partner best partner per row
+     * @return row of the first cluster of the best pair
+     */
+    static
+    size_t
+    select_best_row(const std::vector<size_t> &clusters,
+		    const std::vector<double> &best,
+		    const std::vector<size_t> &partner) {
+	size_t max_r = clusters[0];
+	double max_score = -std::numeric_limits<double>::infinity();
+	// the last cluster has no later partner
+	for (size_t i=0; i+1<clusters.size(); ++i) {
+	    size_t r = clusters[i];
+	    if (best[r] > max_score) {
+		max_score = best[r];
+		max_r = r;
+	    }
+	}
+	// if all scores are -infinity, pair the first two clusters
+	if (partner[max_r]==GuideTree::none) {
+	    return clusters[0];
+	}
+	return max_r;
+    }
+
+    GuideTree::GuideTree(const Matrix<double> &scores, method_t method,
+			 size_type num_threads)
+	: nodes_(),
+	  num_leaves_(scores.sizes().first)
+    {
+	if (num_leaves_==0 || scores.sizes().second!=num_leaves_) {
+	    throw failure("GuideTree: score matrix must be square and non-empty.");
+	}
+
+	nodes_.reserve(2*num_leaves_-1);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    nodes_.push_back(node_t(none,none,1));
+	}
+
+	if (method==UPGMA) {
+	    upgma(scores,num_threads);
+	} else {
+	    neighbor_joining(scores,num_threads);
+	}
+    }
+
+    GuideTree::method_t
+    GuideTree::method_from_string(const std::string &name) {
+	if (name=="upgma") return UPGMA;
+	if (name=="nj") return NJ;
+	throw failure("Unknown guide tree method "+name+" (use upgma or nj).");
+    }
+
+    GuideTree::size_type
+    GuideTree::join(size_type x, size_type y) {
+	size_type z = nodes_.size();
+	nodes_.push_back(node_t(x,y,nodes_[x].size+nodes_[y].size));
+	nodes_[x].parent = z;
+	nodes_[y].parent = z;
+	return z;
+    }
+
+    void
+    GuideTree::upgma(const Matrix<double> &scores, size_type num_threads) {
+	Matrix<double> sim(scores);
+
+	// clusters[k] is the matrix row of the k-th active cluster,
+	// node[r] is the tree node of the cluster in row r; the
+	// clusters stay sorted by rows
+	std::vector<size_type> clusters(num_leaves_);
+	std::vector<size_type> node(num_leaves_);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    clusters[i]=i;
+	    node[i]=i;
+	}
+
+	// best partner of each row among the later rows
+	std::vector<double> best(num_leaves_);
+	std::vector<size_type> partner(num_leaves_,none);
+
+	ThreadPool pool(num_threads);
+
+	scan_rows(pool,sim,clusters,NULL,clusters,best,partner);
+
+	std::vector<size_type> rescan;
+
+	while (clusters.size()>1) {
+	    // the most similar pair of clusters
+	    size_type ri = select_best_row(clusters,best,partner);
+	    size_type rj = (partner[ri]!=none) ? partner[ri] : clusters[1];
+
+	    double si = (double)nodes_[node[ri]].size;
+	    double sj = (double)nodes_[node[rj]].size;
+
+	    // the joined cluster reuses row ri
+	    for (size_type k=0; k<clusters.size(); ++k) {
+		size_type r = clusters[k];
+		if (r==ri || r==rj) continue;
+		double s = (si*sim(ri,r) + sj*sim(rj,r)) / (si+sj);
+		sim(ri,r) = s;
+		sim(r,ri) = s;
+	    }
+
+	    node[ri] = join(node[ri],node[rj]);
+	    clusters.erase(std::lower_bound(clusters.begin(),clusters.end(),rj));
+
+	    // update the best partners: rows that lost their partner
+	    // and row ri are searched again; earlier rows may find a
+	    // better partner in ri
+	    rescan.clear();
+	    for (size_type k=0; k<clusters.size(); ++k) {
+		size_type r = clusters[k];
+		if (r==ri || partner[r]==ri || partner[r]==rj) {
+		    rescan.push_back(k);
+		} else if (r<ri) {
+		    double s = sim(r,ri);
+		    if (s > best[r] || (s==best[r] && ri<partner[r])) {
+			best[r] = s;
+			partner[r] = ri;
+		    }
+		}
+	    }
+	    scan_rows(pool,sim,clusters,NULL,rescan,best,partner);
+	}
+    }
+
+    void
+    GuideTree::neighbor_joining(const Matrix<double> &scores, size_type num_threads) {
+	// transform similarities to distances
+	double max_score=-std::numeric_limits<double>::infinity();
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    for (size_type j=i+1; j<num_leaves_; ++j) {
+		max_score = std::max(max_score,scores(i,j));
+	    }
+	}
+
+	Matrix<double> dist(num_leaves_,num_leaves_);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    dist(i,i)=0.0;
+	    for (size_type j=i+1; j<num_leaves_; ++j) {
+		double d = max_score - 0.5*(scores(i,j)+scores(j,i));
+		dist(i,j)=d;
+		dist(j,i)=d;
+	    }
+	}
+
+	std::vector<size_type> clusters(num_leaves_);
+	std::vector<size_type> node(num_leaves_);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    clusters[i]=i;
+	    node[i]=i;
+	}
+
+	std::vector<double> rowsum(num_leaves_,0.0);
+	for (size_type i=0; i<num_leaves_; ++i) {
+	    for (size_type j=0; j<num_leaves_; ++j) {
+		rowsum[i] += dist(i,j);
+	    }
+	}
+
+	std::vector<double> best(num_leaves_);
+	std::vector<size_type> partner(num_leaves_,none);
+	std::vector<size_type> positions;
+
+	ThreadPool pool(num_threads);
+
+	while (clusters.size()>1) {
+	    size_type n = clusters.size();
+
+	    // minimize the Q-criterion; since all row sums change in
+	    // each step, all rows are searched
+	    positions.resize(n);
+	    for (size_type i=0; i<n; ++i) positions[i]=i;
+	    scan_rows(pool,dist,clusters,&rowsum,positions,best,partner);
+
+	    size_type ri = select_best_row(clusters,best,partner);
+	    size_type rj = (partner[ri]!=none) ? partner[ri] : clusters[1];
+	    double dij = dist(ri,rj);
+
+	    // the joined cluster reuses row ri
+	    double sum=0.0;
+	    for (size_type k=0; k<n; ++k) {
+		size_type r = clusters[k];
+		if (r==ri || r==rj) continue;
+		double d = 0.5*(dist(ri,r) + dist(rj,r) - dij);
+		rowsum[r] += d - dist(ri,r) - dist(rj,r);
+		sum += d;
+		dist(ri,r) = d;
+		dist(r,ri) = d;
+	    }
+	    rowsum[ri] = sum;
+
+	    node[ri] = join(node[ri],node[rj]);
+	    clusters.erase(std::lower_bound(clusters.begin(),clusters.end(),rj));
+	}
+    }
+
+    std::vector<GuideTree::size_type>
+    GuideTree::leaves(size_type x) const {
+	std::vector<size_type> result;
+	std::vector<size_type> stack;
+	stack.push_back(x);
+	while (!stack.empty()) {
+	    size_type y = stack.back();
+	    stack.pop_back();
+	    if (is_leaf(y)) {
+		result.push_back(y);
+	    } else {
+		// push right first to report leaves from left to right
+		stack.push_back(nodes_[y].right);
+		stack.push_back(nodes_[y].left);
+	    }
+	}
+	return result;
+    }
+
+    std::vector<std::vector<GuideTree::size_type> >
+    GuideTree::merge_schedule() const {
+	std::vector<std::vector<size_type> > schedule;
+	std::vector<size_type> level(nodes_.size(),0);
+	// children precede their parents
+	for (size_type x=num_leaves_; x<nodes_.size(); ++x) {
+	    level[x] = 1+std::max(level[nodes_[x].left],level[nodes_[x].right]);
+	    if (schedule.size()<level[x]) {
+		schedule.resize(level[x]);
+	    }
+	    schedule[level[x]-1].push_back(x);
+	}
+	return schedule;
+    }
+
+    //! @brief label of a leaf in Newick format
+    static
+    std::string
+    newick_label(const std::string &name) {
+	if (!name.empty() && name.find_first_of(" \t\n()[]':;,")==std::string::npos) {
+	    return name;
+	}
+	std::string label="'";
+	for (size_t k=0; k<name.length(); ++k) {
+	    if (name[k]=='\'') label += '\'';
+	    label += name[k];
+	}
+	return label+"'";
+    }
+
+    void
+    GuideTree::write_newick(std::ostream &out, const std::vector<std::string> &names) const {
+	if (names.size()!=num_leaves_) {
+	    throw failure("GuideTree: number of names does not match the number of leaves.");
+	}
+
+	// iterative traversal; the second component counts the visits
+	// of an inner node
+	std::vector<std::pair<size_type,int> > stack;
+	stack.push_back(std::make_pair(root(),0));
+	while (!stack.empty()) {
+	    size_type x = stack.back().first;
+	    int visits = stack.back().second++;
+	    if (is_leaf(x)) {
+		out << newick_label(names[x]);
+		stack.pop_back();
+	    } else if (visits==0) {
+		out << "(";
+		stack.push_back(std::make_pair(nodes_[x].left,0));
+	    } else if (visits==1) {
+		out << ",";
+		stack.push_back(std::make_pair(nodes_[x].right,0));
+	    } else {
+		out << ")";
+		stack.pop_back();
+	    }
+	}
+	out << ";";
+    }
+
+} // end namespace LocARNA
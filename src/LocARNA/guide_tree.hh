@@ -0,0 +1,197 @@
+#ifndef LOCARNA_GUIDE_TREE_HH
+#define LOCARNA_GUIDE_TREE_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+#include <string>
+#include <iosfwd>
+#include "matrix.hh"
+
+namespace LocARNA {
+
+    class ThreadPool;
+
+    /**
+     * @brief Binary guide tree for progressive multiple alignment
+     *
+     * The tree is built by UPGMA or neighbor joining from a symmetric
+     * matrix of pairwise similarity scores (e.g. pairwise alignment
+     * scores). Leaves are the nodes 0..n-1 and correspond to the rows
+     * of the score matrix. Inner nodes are numbered n..2n-2 in the
+     * order of their construction; thus, each inner node has a larger
+     * index than its children and the root is the last node.
+     *
+     * UPGMA works directly on the similarities (average linkage, as
+     * in mlocarna). Neighbor joining requires distances; these are
+     * obtained as the difference of the maximal similarity and the
+     * similarity of each pair. The neighbor joining tree is rooted at
+     * its last join.
+     *
+     * Both methods use O(n^2) memory for n leaves. The searches for
+     * the best partner of each row of the matrix run in parallel.
+     * UPGMA caches the best partner of each row, such that after a
+     * join only the affected rows are searched again; neighbor
+     * joining maintains the row sums of the distances incrementally.
+     * Ties are broken as in the naive search (first pair in the order
+     * of the rows), such that the tree does not depend on the number
+     * of threads.
+     */
+    class GuideTree {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! tree construction methods
+	enum method_t {
+	    UPGMA, //!< unweighted pair group method with arithmetic mean
+	    NJ //!< neighbor joining
+	};
+
+	//! index value for 'no node'
+	static const size_type none;
+
+    private:
+	class RowScanTask;
+
+	//! @brief node of the tree
+	struct node_t {
+	    size_type left; //!< left child or none
+	    size_type right; //!< right child or none
+	    size_type parent; //!< parent or none
+	    size_type size; //!< number of leaves below the node
+	    node_t(size_type left_, size_type right_, size_type size_)
+		: left(left_), right(right_), parent(none), size(size_) {}
+	};
+
+	std::vector<node_t> nodes_; //!< all nodes, leaves first
+	size_type num_leaves_; //!< number of leaves
+
+	//! @brief append inner node joining two nodes
+	//! @return index of new node
+	size_type
+	join(size_type x, size_type y);
+
+	/**
+	 * @brief Search the best partners of rows in parallel
+	 *
+	 * @param pool thread pool
+	 * @param m similarities or distances
+	 * @param clusters rows of the active clusters (sorted)
+	 * @param rowsum row sums of distances (NULL for UPGMA)
+	 * @param positions positions in clusters to search
+	 * @param[out] best best score per row
+	 * @param[out] partner best partner per row (or none)
+	 */
+	static
+	void
+	scan_rows(ThreadPool &pool,
+		  const Matrix<double> &m,
+		  const std::vector<size_type> &clusters,
+		  const std::vector<double> *rowsum,
+		  const std::vector<size_type> &positions,
+		  std::vector<double> &best,
+		  std::vector<size_type> &partner);
+
+	//! @brief construct by UPGMA
+	void
+	upgma(const Matrix<double> &scores, size_type num_threads);
+
+	//! @brief construct by neighbor joining
+	void
+	neighbor_joining(const Matrix<double> &scores, size_type num_threads);
+
+    public:
+	/**
+	 * @brief Construct from similarity matrix
+	 *
+	 * @param scores symmetric matrix of pairwise similarities
+	 * (diagonal is ignored)
+	 * @param method construction method
+	 * @param num_threads number of threads (0 for number of processors)
+	 *
+	 * @throw failure if the score matrix is empty or not square
+	 */
+	GuideTree(const Matrix<double> &scores, method_t method,
+		  size_type num_threads=1);
+
+	/**
+	 * @brief Parse method name
+	 *
+	 * @param name "upgma" or "nj"
+	 * @return method
+	 * @throw failure for unknown names
+	 */
+	static
+	method_t
+	method_from_string(const std::string &name);
+
+	//! @brief number of leaves
+	size_type
+	num_leaves() const { return num_leaves_; }
+
+	//! @brief number of nodes
+	size_type
+	num_nodes() const { return nodes_.size(); }
+
+	//! @brief root node
+	size_type
+	root() const { return nodes_.size()-1; }
+
+	//! @brief test for leaf
+	bool
+	is_leaf(size_type x) const { return x<num_leaves_; }
+
+	//! @brief left child (or none)
+	size_type
+	left(size_type x) const { return nodes_[x].left; }
+
+	//! @brief right child (or none)
+	size_type
+	right(size_type x) const { return nodes_[x].right; }
+
+	//! @brief parent (or none for root)
+	size_type
+	parent(size_type x) const { return nodes_[x].parent; }
+
+	//! @brief number of leaves in the subtree of x
+	size_type
+	size(size_type x) const { return nodes_[x].size; }
+
+	/**
+	 * @brief Leaves of a subtree
+	 *
+	 * @param x node
+	 * @return leaves below x from left to right
+	 */
+	std::vector<size_type>
+	leaves(size_type x) const;
+
+	/**
+	 * @brief Merge schedule of the progressive alignment
+	 *
+	 * @return inner nodes grouped by levels; the children of the
+	 * nodes in level k are leaves or nodes of lower levels. Thus,
+	 * the merges of one level are independent of each other and can
+	 * be aligned concurrently.
+	 */
+	std::vector<std::vector<size_type> >
+	merge_schedule() const;
+
+	/**
+	 * @brief Write tree in Newick format
+	 *
+	 * @param out output stream
+	 * @param names names of the leaves; names with special
+	 * characters are quoted by single quotes
+	 *
+	 * @throw failure if the number of names does not match
+	 */
+	void
+	write_newick(std::ostream &out, const std::vector<std::string> &names) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_GUIDE_TREE_HH
@@ -0,0 +1,160 @@
+#include "library_extension.hh"
+
+#include <cmath>
+
+#include "aux.hh"
+#include "rna_data.hh"
+#include "sparse_matrix.hh"
+#include "thread_pool.hh"
+
+namespace LocARNA {
+
+    //! @brief task of collecting the support within one pair of RNAs
+    class LibraryExtensionTask : public ThreadPool::Task {
+    public:
+	typedef LibraryExtension::size_type size_type; //!< size type
+
+	//! support of a base pair: base pair and exponent factor
+	typedef std::pair<std::pair<pos_type,pos_type>,double> support_t;
+
+	size_type a_; //!< first RNA
+	size_type b_; //!< second RNA
+	std::vector<support_t> support_a_; //!< support of base pairs of a by b
+	std::vector<support_t> support_b_; //!< support of base pairs of b by a
+
+    private:
+	const LibraryExtension *ext_;
+
+	//! @brief collect support of the base pairs of x by y
+	void
+	collect(size_type x, size_type y, std::vector<support_t> &support) const {
+	    const RnaData &rna_x = *ext_->inputs_[x];
+	    const RnaData &rna_y = *ext_->inputs_[y];
+	    const std::vector<pos_type> &map = ext_->position_map(x,y);
+
+	    for (RnaData::arc_probs_const_iterator it=rna_x.arc_probs_begin();
+		 rna_x.arc_probs_end()!=it; ++it) {
+		if (it->second <= ext_->min_prob_) continue;
+		pos_type k = map[it->first.first];
+		pos_type l = map[it->first.second];
+		if (k==0 || l==0) continue;
+		double p_y = rna_y.arc_prob(k,l);
+		if (p_y > ext_->min_prob_) {
+		    support.push_back(support_t(it->first,1.0/(1.0+p_y)));
+		}
+	    }
+	}
+
+    public:
+	//! @brief construct for pair (a,b)
+	LibraryExtensionTask(const LibraryExtension *ext, size_type a, size_type b)
+	    : a_(a), b_(b), ext_(ext)
+	{}
+
+	void
+	run() {
+	    collect(a_,b_,support_a_);
+	    collect(b_,a_,support_b_);
+	}
+    };
+
+    //! @brief multiply the exponent of a base pair by its support
+    static
+    void
+    multiply(SparseMatrix<double> &exponents,
+	     const LibraryExtensionTask::support_t &support) {
+	pos_type i = support.first.first;
+	pos_type j = support.first.second;
+	double x = exponents(i,j);
+	exponents.set(i,j,x*support.second);
+    }
+
+    LibraryExtension::LibraryExtension(const std::vector<const RnaData *> &inputs,
+				       double min_prob)
+	: inputs_(inputs),
+	  min_prob_(min_prob),
+	  maps_(inputs.size()*inputs.size()),
+	  extended_()
+    {}
+
+    LibraryExtension::~LibraryExtension() {
+	for (size_type a=0; a<extended_.size(); ++a) {
+	    delete extended_[a];
+	}
+    }
+
+    void
+    LibraryExtension::set_alignment(size_type a, size_type b, const Alignment::edges_t &edges) {
+	assert(a!=b);
+	std::vector<pos_type> &map_ab = maps_[a*inputs_.size()+b];
+	std::vector<pos_type> &map_ba = maps_[b*inputs_.size()+a];
+	map_ab.assign(inputs_[a]->length()+1,0);
+	map_ba.assign(inputs_[b]->length()+1,0);
+
+	for (size_type k=0; k<edges.size(); ++k) {
+	    if (edges.first[k].is_pos() && edges.second[k].is_pos()) {
+		pos_type i = edges.first[k];
+		pos_type j = edges.second[k];
+		if (i>=map_ab.size() || j>=map_ba.size()) {
+		    throw failure("LibraryExtension: alignment does not fit the RNAs.");
+		}
+		map_ab[i] = j;
+		map_ba[j] = i;
+	    }
+	}
+    }
+
+    void
+    LibraryExtension::extend(size_type num_threads) {
+	size_type n = inputs_.size();
+
+	std::vector<LibraryExtensionTask> tasks;
+	for (size_type a=0; a<n; ++a) {
+	    for (size_type b=a+1; b<n; ++b) {
+		if (!position_map(a,b).empty()) {
+		    tasks.push_back(LibraryExtensionTask(this,a,b));
+		}
+	    }
+	}
+
+	ThreadPool pool(num_threads);
+	for (size_type k=0; k<tasks.size(); ++k) {
+	    pool.submit(&tasks[k]);
+	}
+	pool.wait();
+
+	// multiply the exponent factors in the order of the pairs,
+	// such that the result does not depend on the number of
+	// threads
+	std::vector<SparseMatrix<double> > exponents(n,SparseMatrix<double>(1.0));
+	for (size_type k=0; k<tasks.size(); ++k) {
+	    const LibraryExtensionTask &task = tasks[k];
+	    for (size_type s=0; s<task.support_a_.size(); ++s) {
+		multiply(exponents[task.a_],task.support_a_[s]);
+	    }
+	    for (size_type s=0; s<task.support_b_.size(); ++s) {
+		multiply(exponents[task.b_],task.support_b_[s]);
+	    }
+	}
+
+	for (size_type a=0; a<extended_.size(); ++a) {
+	    delete extended_[a];
+	}
+	extended_.resize(n);
+
+	for (size_type a=0; a<n; ++a) {
+	    const RnaData &rna = *inputs_[a];
+	    const SparseMatrix<double> &e = exponents[a];
+
+	    RnaData::arc_prob_matrix_t arc_probs(0.0);
+	    for (RnaData::arc_probs_const_iterator it=rna.arc_probs_begin();
+		 rna.arc_probs_end()!=it; ++it) {
+		double p = it->second;
+		double x = e(it->first.first,it->first.second);
+		arc_probs.set(it->first.first,it->first.second,x==1.0 ? p : pow(p,x));
+	    }
+	    extended_[a] = new RnaData(rna,arc_probs);
+	}
+    }
+
+} // end namespace LocARNA
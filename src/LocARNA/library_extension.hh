@@ -0,0 +1,119 @@
+#ifndef LOCARNA_LIBRARY_EXTENSION_HH
+#define LOCARNA_LIBRARY_EXTENSION_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+
+#include "aux.hh"
+#include "alignment.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+    class LibraryExtensionTask;
+
+    /**
+     * @brief T-Coffee-style extension of base pair probabilities
+     *
+     * Extends the base pair probabilities of a set of RNAs by the
+     * evidence from their pairwise alignments (formerly done by
+     * mlocarna --ext-library in Perl): a base pair (i,j) of A with
+     * probability p_A(i,j) is supported by each other RNA B, where i
+     * and j are aligned to a base pair (k,l) with probability
+     * p_B(k,l). The extended probability is
+     *
+     *   p'_A(i,j) = p_A(i,j) ^ prod_B 1/(1+p_B(k,l)),
+     *
+     * where the product runs over all B that support (i,j); only
+     * probabilities above the minimal probability are considered.
+     * Since the exponents of all supporting RNAs multiply, the result
+     * does not depend on the order of the RNAs; consequently, the
+     * pairs of RNAs are processed in parallel. The exponents are
+     * accumulated sparsely, i.e. per stored base pair.
+     *
+     * Typical usage: construct, set_alignment() for all pairs,
+     * extend(), and then use extended().
+     */
+    class LibraryExtension {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	std::vector<const RnaData *> inputs_; //!< input RNAs (not owned)
+	double min_prob_; //!< minimal probability of considered base pairs
+
+	//! for each ordered pair (a,b) at index a*n+b (n number of
+	//! RNAs), the position of b aligned to each position of a (0
+	//! for gaps); empty if the alignment is not set
+	std::vector<std::vector<pos_type> > maps_;
+
+	std::vector<RnaData *> extended_; //!< extended RNAs (owned)
+
+	friend class LibraryExtensionTask;
+
+	//! @brief position map of pair (a,b)
+	const std::vector<pos_type> &
+	position_map(size_type a, size_type b) const {
+	    return maps_[a*inputs_.size()+b];
+	}
+
+	//! @brief no copy
+	LibraryExtension(const LibraryExtension &);
+
+	//! @brief no assignment
+	LibraryExtension &
+	operator =(const LibraryExtension &);
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param inputs input RNAs (must live as long as the object)
+	 * @param min_prob minimal probability of considered base pairs
+	 */
+	LibraryExtension(const std::vector<const RnaData *> &inputs,
+			 double min_prob);
+
+	//! @brief destructor
+	~LibraryExtension();
+
+	/**
+	 * @brief Set the pairwise alignment of two RNAs
+	 *
+	 * @param a first RNA
+	 * @param b second RNA
+	 * @param edges alignment edges of a (first) and b (second)
+	 *
+	 * @pre a!=b; edges is an alignment of the RNAs a and b
+	 */
+	void
+	set_alignment(size_type a, size_type b, const Alignment::edges_t &edges);
+
+	/**
+	 * @brief Extend the base pair probabilities
+	 *
+	 * @param num_threads number of threads (0 for number of processors)
+	 *
+	 * Pairs without alignment do not support each other.
+	 */
+	void
+	extend(size_type num_threads);
+
+	/**
+	 * @brief Extended RNA
+	 *
+	 * @param a RNA
+	 * @return RNA with extended base pair probabilities
+	 *
+	 * @pre extend() was called
+	 */
+	const RnaData &
+	extended(size_type a) const {return *extended_[a];}
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_LIBRARY_EXTENSION_HH
@@ -183,8 +183,8 @@ namespace LocARNA {
 
     // ----------------------------------------
     //! @brief Simple matrix class with offset
-    template <class elem_t>
-    class OMatrix : public Matrix<elem_t> {
+    template <class elem_t, class Alloc=std::allocator<elem_t> >
+    class OMatrix : public Matrix<elem_t,Alloc> {
     protected:
 	size_t off_; //!< combined offset for vector access
 	size_t xoff_; //!< offset in first dimension
@@ -215,10 +215,34 @@ namespace LocARNA {
 	 * @return 
 	 */
 	OMatrix()
-	    : Matrix<elem_t>(),
+	    : Matrix<elem_t,Alloc>(),
 	      off_(0), 
 	      xoff_(0),yoff_(0) {
 	}
+
+	/**
+	 * Construct as 0x0-matrix with allocator
+	 *
+	 * @param alloc allocator of the entries
+	 */
+	explicit
+	OMatrix(const Alloc &alloc)
+	    : Matrix<elem_t,Alloc>(alloc),
+	      off_(0),
+	      xoff_(0),yoff_(0) {
+	}
+
+	/**
+	 * Copy constructor with allocator
+	 *
+	 * @param m matrix to be copied
+	 * @param alloc allocator of the entries of the copy
+	 */
+	OMatrix(const OMatrix &m, const Alloc &alloc)
+	    : Matrix<elem_t,Alloc>(m,alloc),
+	      off_(m.off_),
+	      xoff_(m.xoff_),yoff_(m.yoff_) {
+	}
         
 	/** 
 	 * Resize matrix
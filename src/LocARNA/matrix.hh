@@ -26,17 +26,23 @@ namespace LocARNA {
       in the overlapping sub-matrix
     */
 
-    //! simple 2D matrix class, provides access via operator (int,int) 
-    template <class T>
+    /**
+     * @brief simple 2D matrix class, provides access via operator (int,int)
+     *
+     * @note the allocator of the entries can be set, e.g. to
+     * ArenaAllocator for temporaries of one alignment
+     */
+    template <class T, class Alloc=std::allocator<T> >
     class Matrix {
     public:
 	typedef T elem_t; //!< type of elements
-	typedef typename std::vector<elem_t>::size_type size_type; //!< size type (from underlying vector)
+	typedef Alloc allocator_type; //!< allocator type
+	typedef typename std::vector<elem_t,Alloc>::size_type size_type; //!< size type (from underlying vector)
 	
 	typedef std::pair<size_type,size_type> size_pair_type; //!< type for pair of sizes
     
     protected:
-	std::vector<elem_t> mat_; //!< vector storing the matrix entries
+	std::vector<elem_t,Alloc> mat_; //!< vector storing the matrix entries
 	size_type xdim_; //!< first dimension
 	size_type ydim_; //!< second dimension
     
@@ -63,6 +69,28 @@ namespace LocARNA {
 	Matrix() 
 	    : mat_(),xdim_(0),ydim_(0) {
 	}
+
+	/**
+	 * Empty constructor with allocator
+	 *
+	 * @param alloc allocator of the entries
+	 */
+	explicit
+	Matrix(const allocator_type &alloc)
+	    : mat_(alloc),xdim_(0),ydim_(0) {
+	}
+
+	/**
+	 * Copy constructor with allocator
+	 *
+	 * @param m matrix to be copied
+	 * @param alloc allocator of the entries of the copy
+	 *
+	 * @note e.g. copies a matrix from an arena to the heap
+	 */
+	Matrix(const Matrix &m, const allocator_type &alloc)
+	    : mat_(m.mat_.begin(),m.mat_.end(),alloc),xdim_(m.xdim_),ydim_(m.ydim_) {
+	}
     
 	/** 
 	 * Construct with dimensions, optionally initialize from array  
@@ -94,6 +122,35 @@ namespace LocARNA {
 	    return size_pair_type(xdim_,ydim_);
 	}
 
+	//! @brief allocator of the entries
+	allocator_type
+	get_allocator() const {
+	    return mat_.get_allocator();
+	}
+
+	/**
+	 * @brief Number of allocated entries
+	 *
+	 * @return capacity of the underlying vector (at least
+	 * xdim*ydim; kept by resize() and clear())
+	 */
+	size_type
+	capacity() const {
+	    return mat_.capacity();
+	}
+
+	/**
+	 * @brief Reserve memory for entries
+	 *
+	 * @param n number of entries
+	 * @note avoids reallocation (with overallocation) when the
+	 * matrix grows by resize() to at most n entries
+	 */
+	void
+	reserve(size_type n) {
+	    mat_.reserve(n);
+	}
+
 	/** 
 	 * Resize both dimensions
 	 *
@@ -202,12 +259,12 @@ namespace LocARNA {
      * 
      * @return output stream after writing matrix mat
      */
-    template <class T>
-    std::ostream & operator << (std::ostream &out, Matrix<T> mat) {
-	typename Matrix<T>::size_pair_type sizes = mat.sizes();
+    template <class T, class Alloc>
+    std::ostream & operator << (std::ostream &out, const Matrix<T,Alloc> &mat) {
+	typename Matrix<T,Alloc>::size_pair_type sizes = mat.sizes();
     
-	for (typename Matrix<T>::size_type i=0; i<sizes.first; i++) {
-	    for (typename Matrix<T>::size_type j=0; j<sizes.second; j++) {
+	for (typename Matrix<T,Alloc>::size_type i=0; i<sizes.first; i++) {
+	    for (typename Matrix<T,Alloc>::size_type j=0; j<sizes.second; j++) {
 		out << mat(i,j) << " ";
 	    }
 	    out << std::endl;
@@ -223,11 +280,11 @@ namespace LocARNA {
      * 
      * @return input stream after reading matrix mat
      */
-    template <class T>
-    std::istream & operator >> (std::istream &in, Matrix<T> &mat) {
-	typename Matrix<T>::size_pair_type sizes = mat.sizes();
-	for (typename Matrix<T>::size_type i=0; i<=mat.sizes().first; i++) {
-	    for (typename Matrix<T>::size_type j=0; j<=mat.sizes().second; j++) {
+    template <class T, class Alloc>
+    std::istream & operator >> (std::istream &in, Matrix<T,Alloc> &mat) {
+	typename Matrix<T,Alloc>::size_pair_type sizes = mat.sizes();
+	for (typename Matrix<T,Alloc>::size_type i=0; i<=mat.sizes().first; i++) {
+	    for (typename Matrix<T,Alloc>::size_type j=0; j<=mat.sizes().second; j++) {
 		in >> mat(i,j);
 	    }
 	}
@@ -1,5 +1,11 @@
 #include <iostream>
 #include <cstdlib> // import free()
+#include <sstream>
+#include <algorithm>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "aux.hh"
 
@@ -36,6 +42,97 @@ namespace LocARNA {
 	return p;
     }
 
+    McC_band_storage::McC_band_storage()
+	: length_(0),
+	  max_span_(0),
+	  elem_size_(0),
+	  offset_(),
+	  data_(0),
+	  size_(0),
+	  mapped_(false)
+    {}
+
+    McC_band_storage::~McC_band_storage() {
+	if (data_) {
+	    if (mapped_) {
+		munmap(data_,size_);
+	    } else {
+		free(data_);
+	    }
+	}
+    }
+
+    void
+    McC_band_storage::init(size_t length, size_t max_span, size_t elem_size,
+			   const std::string &spill_dir) {
+	assert(data_==0);
+
+	length_=length;
+	max_span_=max_span;
+	elem_size_=elem_size;
+
+	// row i holds the entries (i,i) ... (i,min(length,i+max_span))
+	offset_.resize(length_+2);
+	offset_[1]=0;
+	for (size_t i=1; i<=length_; i++) {
+	    offset_[i+1] = offset_[i] + std::min(max_span_,length_-i) + 1;
+	}
+	size_ = offset_[length_+1]*elem_size_;
+	
+	if (size_==0) return;
+
+	if (spill_dir.empty()) {
+	    data_ = (char *) calloc(size_,1);
+	    if (data_==0) {
+		throw failure("Cannot allocate McCaskill matrices.");
+	    }
+	    return;
+	}
+
+	// map a temporary file, which is removed from the directory
+	// immediately; it is freed with the mapping
+	std::string filename = spill_dir + "/locarna-mcc-XXXXXX";
+	std::vector<char> c_filename(filename.begin(),filename.end());
+	c_filename.push_back(0);
+	
+	int fd = mkstemp(&c_filename[0]);
+	if (fd<0) {
+	    std::ostringstream err;
+	    err << "Cannot create temporary file in "<<spill_dir<<".";
+	    throw failure(err.str());
+	}
+	unlink(&c_filename[0]);
+	
+	if (ftruncate(fd,size_)!=0) {
+	    close(fd);
+	    std::ostringstream err;
+	    err << "Cannot write temporary file in "<<spill_dir<<".";
+	    throw failure(err.str());
+	}
+	
+	void *p = mmap(0,size_,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if (p==MAP_FAILED) {
+	    throw failure("Cannot map temporary file of McCaskill matrices.");
+	}
+	data_ = (char *) p;
+	mapped_ = true;
+    }
+
+    void
+    McC_pf_band_matrix::init(size_t length, const McCRetention &retention) {
+	size_t max_span = retention.max_span()>0 ? retention.max_span() : length;
+
+	single_precision_ = retention.single_precision();
+	if (single_precision_) {
+	    single_.init(length,max_span,retention.spill_dir());
+	} else {
+	    double_.init(length,max_span,retention.spill_dir());
+	}
+    }
+    
+    // ----------------------------------------
+
     McC_matrices_base::McC_matrices_base()
 	: length_(0),
 	  local_copy_(false),
@@ -43,6 +140,8 @@ namespace LocARNA {
 	  qm_(0),
 	  bppm_(0),
 	  iindx_(0),
+	  compact_(false),
+	  max_span_(0),
 	  q1k_(0),
 	  qln_(0),
 	  pf_params_(0)
@@ -51,6 +150,7 @@ namespace LocARNA {
     void
     McC_matrices_base::init(size_t length) {
 	length_=length;
+	max_span_=length;
 	
 	qb_=0;
 	qm_=0;
@@ -77,6 +177,35 @@ namespace LocARNA {
 	qln_= (FLT_OR_DBL *) space_memcpy(McCmat.qln_,sizeof(FLT_OR_DBL)*(length_+2));
 	pf_params_= (pf_paramT *) space_memcpy(McCmat.pf_params_,sizeof(pf_paramT));
 
+	iindx_= get_iindx(length_);
+	max_span_=length_;
+    }
+
+    void
+    McC_matrices_base::compact_copy(const McC_matrices_base &McCmat,
+				    const McCRetention &retention) {
+	local_copy_=true;
+	compact_=true;
+
+	length_=McCmat.length_;
+	max_span_ = retention.max_span()>0 ? retention.max_span() : length_;
+
+	compact_qb_.init(length_,retention);
+	compact_qm_.init(length_,retention);
+	compact_bppm_.init(length_,retention);
+	
+	for (size_t i=1; i<=length_; i++) {
+	    for (size_t j=i; j<=length_ && in_band(i,j); j++) {
+		compact_qb_.set(i,j,McCmat.qb(i,j));
+		compact_qm_.set(i,j,McCmat.qm(i,j));
+		compact_bppm_.set(i,j,McCmat.bppm(i,j));
+	    }
+	}
+	
+	q1k_= (FLT_OR_DBL *) space_memcpy(McCmat.q1k_,sizeof(FLT_OR_DBL)*(length_+1));
+	qln_= (FLT_OR_DBL *) space_memcpy(McCmat.qln_,sizeof(FLT_OR_DBL)*(length_+2));
+	pf_params_= (pf_paramT *) space_memcpy(McCmat.pf_params_,sizeof(pf_paramT));
+
 	iindx_= get_iindx(length_);
     }
 
@@ -99,12 +228,18 @@ namespace LocARNA {
     // ----------------------------------------
 
 
-    McC_matrices_t::McC_matrices_t(char *sequence, bool local_copy)
-	:McC_matrices_base()
+    McC_matrices_t::McC_matrices_t(char *sequence, bool local_copy,
+				   const McCRetention &retention)
+	:McC_matrices_base(),
+	 ptype_(0)
     {	
 	if (local_copy) {
 	    McC_matrices_t McCmat_tmp(sequence,false);
-	    deep_copy(McCmat_tmp);
+	    if (retention.compact()) {
+		compact_copy(McCmat_tmp,retention);
+	    } else {
+		deep_copy(McCmat_tmp);
+	    }
 	} else {
 	    McC_matrices_base::init(strlen(sequence));
 	    
@@ -141,6 +276,23 @@ namespace LocARNA {
 	ptype_= (char *) space_memcpy(McCmat.ptype_,sizeof(char)*((length_+1)*(length_+2)/2));
     }
 
+    void
+    McC_matrices_t::compact_copy(const McC_matrices_t &McCmat,
+				 const McCRetention &retention) {
+	McC_matrices_base::compact_copy(McCmat,retention);
+	
+	sequence_ = (char *) space_memcpy(McCmat.sequence_,sizeof(char)*(length_+1));
+	S_ = (short *) space_memcpy(McCmat.S_,sizeof(short)*(length_+2));
+	S1_ = (short *) space_memcpy(McCmat.S1_,sizeof(short)*(length_+2));
+
+	compact_ptype_.init(length_,max_span_,retention.spill_dir());
+	for (size_t i=1; i<=length_; i++) {
+	    for (size_t j=i; j<=length_ && in_band(i,j); j++) {
+		compact_ptype_.set(i,j,McCmat.ptype(i,j));
+	    }
+	}
+    }
+
     McC_matrices_t::~McC_matrices_t() {
 	if (local_copy_) {
 	    free_all();
@@ -156,12 +308,18 @@ namespace LocARNA {
     }
 
     // ----------------------------------------
-    McC_ali_matrices_t::McC_ali_matrices_t(size_t n_seq, size_t length, bool local_copy)
-	: n_seq_(n_seq)
+    McC_ali_matrices_t::McC_ali_matrices_t(size_t n_seq, size_t length, bool local_copy,
+					   const McCRetention &retention)
+	: n_seq_(n_seq),
+	  pscore_(0)
     {	
 	if (local_copy) {
 	    McC_ali_matrices_t McCmat_tmp(n_seq,length,false);
-	    deep_copy(McCmat_tmp);
+	    if (retention.compact()) {
+		compact_copy(McCmat_tmp,retention);
+	    } else {
+		deep_copy(McCmat_tmp);
+	    }
 	} else {
 	    McC_matrices_base::init(length);
 	    
@@ -209,6 +367,35 @@ namespace LocARNA {
 				       ((length_+1)*(length_+2))/2 * sizeof(short));
     }
 
+    void
+    McC_ali_matrices_t::compact_copy(const McC_ali_matrices_t &McCmat,
+				     const McCRetention &retention) {
+	McC_matrices_base::compact_copy(McCmat,retention);
+		
+	n_seq_ = McCmat.n_seq_;
+
+	S_    = (short **)          space(n_seq_ * sizeof(short *));
+	S5_   = (short **)          space(n_seq_ * sizeof(short *));
+	S3_   = (short **)          space(n_seq_ * sizeof(short *));
+	a2s_  = (unsigned short **) space(n_seq_ * sizeof(unsigned short *));
+	Ss_   = (char **)           space(n_seq_ * sizeof(char *));
+
+	for (size_t i=0; i<n_seq_; i++) {
+	    S_[i]   = (short *)          space_memcpy(McCmat.S_[i],  (length_+2) * sizeof(short));
+	    S5_[i]  = (short *)          space_memcpy(McCmat.S5_[i], (length_+2) * sizeof(short));
+	    S3_[i]  = (short *)          space_memcpy(McCmat.S3_[i], (length_+2) * sizeof(short));
+	    a2s_[i] = (unsigned short *) space_memcpy(McCmat.a2s_[i],(length_+2) * sizeof(unsigned short));
+	    Ss_[i]  = (char *)           space_memcpy(McCmat.Ss_[i], (length_+2) * sizeof(char));
+	}
+
+	compact_pscore_.init(length_,max_span_,retention.spill_dir());
+	for (size_t i=1; i<=length_; i++) {
+	    for (size_t j=i; j<=length_ && in_band(i,j); j++) {
+		compact_pscore_.set(i,j,McCmat.pscore(i,j));
+	    }
+	}
+    }
+
     McC_ali_matrices_t::~McC_ali_matrices_t() {
 	if (local_copy_) {
 	    free_all();
@@ -6,6 +6,10 @@
 #endif
 
 #include <assert.h>
+#include <vector>
+#include <string>
+
+#include "pfold_params.hh"
 
 #define PUBLIC // for Vienna
 extern "C" {
@@ -14,6 +18,149 @@ extern "C" {
 
 namespace LocARNA {
 
+    /**
+     * @brief Storage of the band of a triangular matrix
+     *
+     * Stores the entries (i,j), 1<=i<=j<=length, with j-i<=max_span
+     * row by row. The memory is allocated on the heap or, if a
+     * spill directory is given, mapped from an (unlinked) temporary
+     * file in this directory.
+     */
+    class McC_band_storage {
+	size_t length_; //!< matrix dimension
+	size_t max_span_; //!< maximal span of stored entries
+	size_t elem_size_; //!< size of an entry in bytes
+	std::vector<size_t> offset_; //!< offsets of the rows
+	char *data_; //!< entries
+	size_t size_; //!< size of data_ in bytes
+	bool mapped_; //!< whether data_ is mapped from a file
+
+	//! @brief no copy
+	McC_band_storage(const McC_band_storage &);
+
+	//! @brief no assignment
+	McC_band_storage &
+	operator =(const McC_band_storage &);
+
+    public:
+	//! @brief construct empty
+	McC_band_storage();
+
+	//! @brief destruct, free or unmap memory
+	~McC_band_storage();
+
+	/**
+	 * @brief allocate (zero initialized)
+	 *
+	 * @param length matrix dimension
+	 * @param max_span maximal span j-i of stored entries
+	 * @param elem_size size of an entry in bytes
+	 * @param spill_dir directory for the temporary file; empty
+	 * for heap memory
+	 *
+	 * @throw failure if the temporary file cannot be created
+	 */
+	void
+	init(size_t length, size_t max_span, size_t elem_size,
+	     const std::string &spill_dir);
+
+	//! @brief whether (i,j) is stored
+	bool
+	in_band(size_t i, size_t j) const { return j-i <= max_span_; }
+
+	//! @brief pointer to stored entry (i,j)
+	void *
+	entry(size_t i, size_t j) const {
+	    assert(1<=i); assert(i<=j); assert(j<=length_);
+	    assert(in_band(i,j));
+	    return data_ + (offset_[i]+(j-i))*elem_size_;
+	}
+    };
+
+    /**
+     * @brief Band of a triangular matrix with entries of type T
+     *
+     * Entries outside of the band read as T().
+     */
+    template<class T>
+    class McC_band_matrix {
+	McC_band_storage storage_; //!< storage
+    public:
+	/**
+	 * @brief allocate
+	 *
+	 * @param length matrix dimension
+	 * @param max_span maximal span of stored entries
+	 * @param spill_dir directory for the temporary file (or empty)
+	 */
+	void
+	init(size_t length, size_t max_span, const std::string &spill_dir) {
+	    storage_.init(length,max_span,sizeof(T),spill_dir);
+	}
+
+	//! @brief whether (i,j) is stored
+	bool
+	in_band(size_t i, size_t j) const { return storage_.in_band(i,j); }
+
+	//! @brief read entry (i,j)
+	T
+	get(size_t i, size_t j) const {
+	    if (!in_band(i,j)) return T();
+	    return *static_cast<T *>(storage_.entry(i,j));
+	}
+
+	//! @brief write entry (i,j) in the band
+	void
+	set(size_t i, size_t j, const T &x) {
+	    *static_cast<T *>(storage_.entry(i,j)) = x;
+	}
+    };
+
+    /**
+     * @brief Band of a matrix of partition functions or probabilities
+     *
+     * Stores entries in single or double precision.
+     */
+    class McC_pf_band_matrix {
+	bool single_precision_; //!< whether entries are stored as float
+	McC_band_matrix<float> single_; //!< single precision entries
+	McC_band_matrix<FLT_OR_DBL> double_; //!< double precision entries
+    public:
+	//! @brief construct empty
+	McC_pf_band_matrix(): single_precision_(false) {}
+
+	/**
+	 * @brief allocate
+	 *
+	 * @param length matrix dimension
+	 * @param retention retention parameters
+	 */
+	void
+	init(size_t length, const McCRetention &retention);
+
+	//! @brief whether (i,j) is stored
+	bool
+	in_band(size_t i, size_t j) const {
+	    return single_precision_ ? single_.in_band(i,j) : double_.in_band(i,j);
+	}
+
+	//! @brief read entry (i,j); 0 outside of the band
+	FLT_OR_DBL
+	get(size_t i, size_t j) const {
+	    return single_precision_ ? single_.get(i,j) : double_.get(i,j);
+	}
+
+	//! @brief write entry (i,j) in the band
+	void
+	set(size_t i, size_t j, FLT_OR_DBL x) {
+	    if (single_precision_) {
+		single_.set(i,j,(float)x);
+	    } else {
+		double_.set(i,j,x);
+	    }
+	}
+    };
+
     class McC_matrices_base {
     protected:
     	size_t length_;     //!< sequence length
@@ -25,6 +172,18 @@ namespace LocARNA {
 	FLT_OR_DBL *bppm_;  //!< base pair probability matrix
 	
     	int* iindx_;        //!< iindx from librna's get_iindx()
+
+	//! whether the matrices are retained compactly; then, qb_,
+	//! qm_ and bppm_ are replaced by compact_qb_, compact_qm_
+	//! and compact_bppm_
+	bool compact_;
+	
+	McC_pf_band_matrix compact_qb_; //!< compact Q<sup>B</sup> matrix
+	McC_pf_band_matrix compact_qm_; //!< compact Q<sup>M</sup> matrix
+	McC_pf_band_matrix compact_bppm_; //!< compact base pair probability matrix
+
+	size_t max_span_; //!< maximal span of retained entries
+
     	/** 
 	 * @brief construct empty
 	 */
@@ -69,7 +228,10 @@ namespace LocARNA {
 	 * 
 	 * @return matrix entry 
 	 */
-	FLT_OR_DBL bppm(size_t i, size_t j) const { return bppm_[iidx(i,j)]; }
+	FLT_OR_DBL
+	bppm(size_t i, size_t j) const {
+	    return compact_ ? compact_bppm_.get(i,j) : bppm_[iidx(i,j)];
+	}
 
 	/** 
 	 * @brief Read access matrix qb
@@ -79,7 +241,10 @@ namespace LocARNA {
 	 * 
 	 * @return matrix entry 
 	 */
-	FLT_OR_DBL qb(size_t i, size_t j) const { return qb_[iidx(i,j)]; }
+	FLT_OR_DBL
+	qb(size_t i, size_t j) const {
+	    return compact_ ? compact_qb_.get(i,j) : qb_[iidx(i,j)];
+	}
 
 	/** 
 	 * @brief Read access matrix qm
@@ -89,7 +254,26 @@ namespace LocARNA {
 	 * 
 	 * @return matrix entry 
 	 */
-	FLT_OR_DBL qm(size_t i, size_t j) const { return qm_[iidx(i,j)]; }
+	FLT_OR_DBL
+	qm(size_t i, size_t j) const {
+	    return compact_ ? compact_qm_.get(i,j) : qm_[iidx(i,j)];
+	}
+
+	/**
+	 * @brief Whether entry (i,j) is retained
+	 *
+	 * @param i first index
+	 * @param j second index
+	 *
+	 * @return whether j-i is at most the maximal retained span
+	 */
+	bool in_band(size_t i, size_t j) const { return j-i <= max_span_; }
+
+	/**
+	 * @brief Whether matrices are retained compactly
+	 * @return compact flag
+	 */
+	bool compact() const { return compact_; }
 	    
     protected:
 	
@@ -101,6 +285,16 @@ namespace LocARNA {
 	//! \brief deep copy all data structures 
 	void
 	deep_copy(const McC_matrices_base &McCmat);
+
+	/**
+	 * @brief compact copy of all data structures
+	 *
+	 * @param McCmat object to copy
+	 * @param retention retention parameters
+	 */
+	void
+	compact_copy(const McC_matrices_base &McCmat,
+		     const McCRetention &retention);
     };
     
     //! @brief  structure for McCaskill matrices pointers
@@ -109,6 +303,7 @@ namespace LocARNA {
     //! get_pf_arrays() and get_bppm() of Vienna librna
     class McC_matrices_t : public McC_matrices_base {
 	char *ptype_;	   //!< pair type matrix					
+	McC_band_matrix<char> compact_ptype_; //!< compact pair type matrix
 	
     public:
 
@@ -121,8 +316,10 @@ namespace LocARNA {
 	 * 
 	 * @param sequence the sequence as 0-terminated C-string 
 	 * @param local_copy  if TRUE, copy the data structures; otherwise, only store pointers
+	 * @param retention retention of the local copy
 	 */
-	McC_matrices_t(char *sequence, bool local_copy);
+	McC_matrices_t(char *sequence, bool local_copy,
+		       const McCRetention &retention=McCRetention());
 	
 	/** 
 	 * @brief destruct, optionally free local copy
@@ -139,7 +336,10 @@ namespace LocARNA {
 	 * 
 	 * @return matrix entry 
 	 */
-	char ptype(size_t i, size_t j) const { return ptype_[iidx(i,j)]; }
+	char
+	ptype(size_t i, size_t j) const {
+	    return compact_ ? compact_ptype_.get(i,j) : ptype_[iidx(i,j)];
+	}
 
 	/** 
 	 * @brief Reverse ptype
@@ -162,6 +362,15 @@ namespace LocARNA {
 	//! \brief deep copy all data structures 
 	void
 	deep_copy(const McC_matrices_t &McCmat);
+
+	/**
+	 * @brief compact copy of all data structures
+	 * @param McCmat object to copy
+	 * @param retention retention parameters
+	 */
+	void
+	compact_copy(const McC_matrices_t &McCmat,
+		     const McCRetention &retention);
     };
 
      //! @brief  structure for Alifold-McCaskill matrices pointers
@@ -182,6 +391,7 @@ namespace LocARNA {
 	
     protected:
 	short *pscore_; //!< alifold covariance/conservation scores
+	McC_band_matrix<short> compact_pscore_; //!< compact pscore matrix
     public:
 	/** 
 	 * @brief construct by call to VRNA lib functions and optionally make local copy
@@ -189,8 +399,10 @@ namespace LocARNA {
 	 * @param n_seq number of sequenes in alignment
 	 * @param length length of sequences in alignment 
 	 * @param local_copy  if TRUE, copy the data structures; otherwise, only store pointers
+	 * @param retention retention of the local copy
 	 */
-	McC_ali_matrices_t(size_t n_seq, size_t length, bool local_copy);
+	McC_ali_matrices_t(size_t n_seq, size_t length, bool local_copy,
+			   const McCRetention &retention=McCRetention());
 	
 	/** 
 	 * @brief destruct, optionally free local copy
@@ -207,7 +419,10 @@ namespace LocARNA {
 	 * 
 	 * @return matrix entry 
 	 */
-	short pscore(size_t i, size_t j) const { return pscore_[iidx(i,j)]; }
+	short
+	pscore(size_t i, size_t j) const {
+	    return compact_ ? compact_pscore_.get(i,j) : pscore_[iidx(i,j)];
+	}
 
 
     protected:
@@ -223,6 +438,15 @@ namespace LocARNA {
 	 */
 	void
 	deep_copy(const McC_ali_matrices_t &McCmat);
+
+	/**
+	 * @brief compact copy of all data structures
+	 * @param McCmat object to copy
+	 * @param retention retention parameters
+	 */
+	void
+	compact_copy(const McC_ali_matrices_t &McCmat,
+		     const McCRetention &retention);
     };
     
 } // end namespace LocARNA
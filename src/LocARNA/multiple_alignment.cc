@@ -1021,6 +1021,16 @@ namespace LocARNA {
 	}
     }
     
+    void 
+    MultipleAlignment::reverse_complement() {
+	for (std::vector<SeqEntry>::iterator it=alig_.begin(); alig_.end()!=it; ++it) {
+	    std::string seq = it->seq().str();
+	    reverse_complement_rna_sequence(seq);
+	    it->set_seq( string1(seq) );
+	}
+	annotations_.clear();
+    }
+    
     bool 
     MultipleAlignment::checkAlphabet(const Alphabet<char> &alphabet) const {
 	for (const_iterator it=begin(); end()!=it; ++it) {
@@ -763,6 +763,16 @@ public:
     void
     reverse();
 
+    /**
+     * @brief reverse complement the multiple alignment
+     *
+     * Reverse complements all rows (see
+     * reverse_complement_rna_sequence()). The annotations refer to
+     * the original strand; they are removed.
+     */
+    void
+    reverse_complement();
+
 
     // ------------------------------------------------------------
     // output
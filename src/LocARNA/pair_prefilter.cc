@@ -0,0 +1,219 @@
+#include "pair_prefilter.hh"
+
+#include <cmath>
+#include <algorithm>
+
+#include "rna_data.hh"
+#include "multiple_alignment.hh"
+#include "thread_pool.hh"
+
+namespace LocARNA {
+
+    const PairPrefilter::size_type PairPrefilter::num_bins;
+
+    //! @brief order neighbors by decreasing similarity, then by index
+    static
+    bool
+    more_similar(const std::pair<double,size_t> &x,
+		 const std::pair<double,size_t> &y) {
+	return x.first > y.first || (x.first == y.first && x.second < y.second);
+    }
+
+    //! @brief task of searching the nearest neighbors of a range of RNAs
+    class PairPrefilter::NeighborTask : public ThreadPool::Task {
+	const PairPrefilter *pf_;
+	size_type begin_;
+	size_type end_;
+	size_type k_;
+	std::vector<std::vector<size_type> > &neighbors_;
+    public:
+	NeighborTask(const PairPrefilter *pf, size_type begin, size_type end,
+		     size_type k, std::vector<std::vector<size_type> > &neighbors)
+	    : pf_(pf), begin_(begin), end_(end), k_(k), neighbors_(neighbors)
+	{}
+
+	void
+	run() {
+	    size_type n = pf_->num_rnas_;
+	    size_type k = std::min(k_,n-1);
+	    std::vector<std::pair<double,size_type> > sims;
+	    sims.reserve(n);
+	    for (size_type a=begin_; a<end_; ++a) {
+		sims.clear();
+		for (size_type b=0; b<n; ++b) {
+		    if (b==a) continue;
+		    sims.push_back(std::make_pair(pf_->similarity(a,b),b));
+		}
+		std::partial_sort(sims.begin(),sims.begin()+k,sims.end(),more_similar);
+		neighbors_[a].resize(k);
+		for (size_type i=0; i<k; ++i) {
+		    neighbors_[a][i] = sims[i].second;
+		}
+	    }
+	}
+    };
+
+    PairPrefilter::PairPrefilter(const std::vector<const RnaData *> &inputs,
+				 size_type kmer_length,
+				 double struct_weight)
+	: num_rnas_(inputs.size()),
+	  kmer_length_(kmer_length),
+	  num_kmers_(1),
+	  struct_weight_(struct_weight),
+	  kmer_profiles_(),
+	  kmer_starts_(),
+	  kmer_norms_(),
+	  pairing_profiles_()
+    {
+	if (kmer_length<1 || kmer_length>8) {
+	    throw failure("PairPrefilter: k-mer length must be between 1 and 8.");
+	}
+	if (struct_weight<0.0 || struct_weight>1.0) {
+	    throw failure("PairPrefilter: structure weight must be between 0 and 1.");
+	}
+
+	num_kmers_ = (size_type)1 << (2*kmer_length_);
+
+	kmer_starts_.reserve(num_rnas_+1);
+	kmer_norms_.reserve(num_rnas_);
+	pairing_profiles_.resize(num_rnas_*num_bins,0.0);
+
+	for (size_type a=0; a<num_rnas_; ++a) {
+	    kmer_starts_.push_back(kmer_profiles_.size());
+	    kmer_norms_.push_back(compute_kmer_profile(*inputs[a]));
+	    compute_pairing_profile(*inputs[a],&pairing_profiles_[a*num_bins]);
+	}
+	kmer_starts_.push_back(kmer_profiles_.size());
+    }
+
+    double
+    PairPrefilter::compute_kmer_profile(const RnaData &rna) {
+	const MultipleAlignment &ma = rna.multiple_alignment();
+	size_type mask = num_kmers_-1;
+
+	// all occurrences of k-mers
+	std::vector<size_type> codes;
+
+	for (size_type row=0; row<ma.num_of_rows(); ++row) {
+	    const std::string &seq = ma.seqentry(row).seq().str();
+
+	    // code of the last kmer_length_ nucleotides (gaps are
+	    // skipped, other symbols start a new k-mer)
+	    size_type code=0;
+	    size_type valid=0;
+	    for (size_type i=0; i<seq.length(); ++i) {
+		size_type x;
+		switch (seq[i]) {
+		case 'A': case 'a': x=0; break;
+		case 'C': case 'c': x=1; break;
+		case 'G': case 'g': x=2; break;
+		case 'U': case 'u': case 'T': case 't': x=3; break;
+		case '-': case '.': case '_': case '~': continue;
+		default: valid=0; continue;
+		}
+		code = ((code<<2) | x) & mask;
+		if (++valid >= kmer_length_) {
+		    codes.push_back(code);
+		}
+	    }
+	}
+
+	// count runs of equal k-mers
+	std::sort(codes.begin(),codes.end());
+	double norm=0.0;
+	for (size_type i=0; i<codes.size(); ) {
+	    size_type j=i+1;
+	    while (j<codes.size() && codes[j]==codes[i]) ++j;
+	    kmer_profiles_.push_back(kmer_count_t(codes[i],j-i));
+	    norm += (double)(j-i)*(j-i);
+	    i=j;
+	}
+	return sqrt(norm);
+    }
+
+    void
+    PairPrefilter::compute_pairing_profile(const RnaData &rna, double *profile) const {
+	size_type len = rna.length();
+	if (len==0) return;
+
+	std::vector<double> paired(len+1,0.0);
+	for (RnaData::arc_probs_const_iterator it=rna.arc_probs_begin();
+	     rna.arc_probs_end()!=it; ++it) {
+	    paired[it->first.first] += it->second;
+	    paired[it->first.second] += it->second;
+	}
+
+	std::vector<size_type> counts(num_bins,0);
+	for (size_type i=1; i<=len; ++i) {
+	    size_type bin = (i-1)*num_bins/len;
+	    profile[bin] += std::min(paired[i],1.0);
+	    counts[bin]++;
+	}
+	for (size_type bin=0; bin<num_bins; ++bin) {
+	    if (counts[bin]>0) profile[bin] /= counts[bin];
+	}
+    }
+
+    double
+    PairPrefilter::similarity(size_type a, size_type b) const {
+	// cosine similarity of the k-mer counts; merge the sorted
+	// profiles (the dot product is exact and symmetric)
+	typedef std::vector<kmer_count_t>::const_iterator iter_t;
+	iter_t ka = kmer_profiles_.begin() + kmer_starts_[a];
+	iter_t ka_end = kmer_profiles_.begin() + kmer_starts_[a+1];
+	iter_t kb = kmer_profiles_.begin() + kmer_starts_[b];
+	iter_t kb_end = kmer_profiles_.begin() + kmer_starts_[b+1];
+	size_type dot=0;
+	while (ka!=ka_end && kb!=kb_end) {
+	    if (ka->first < kb->first) {
+		++ka;
+	    } else if (kb->first < ka->first) {
+		++kb;
+	    } else {
+		dot += ka->second * kb->second;
+		++ka; ++kb;
+	    }
+	}
+	double kmer_sim=0.0;
+	if (dot>0) {
+	    kmer_sim = dot / (kmer_norms_[a]*kmer_norms_[b]);
+	}
+
+	const double *pa = &pairing_profiles_[a*num_bins];
+	const double *pb = &pairing_profiles_[b*num_bins];
+	double diff=0.0;
+	for (size_type bin=0; bin<num_bins; ++bin) {
+	    diff += std::fabs(pa[bin]-pb[bin]);
+	}
+	double struct_sim = 1.0 - diff/num_bins;
+
+	return (1.0-struct_weight_)*kmer_sim + struct_weight_*struct_sim;
+    }
+
+    std::vector<std::vector<PairPrefilter::size_type> >
+    PairPrefilter::neighbors(size_type k, size_type num_threads) const {
+	std::vector<std::vector<size_type> > result(num_rnas_);
+	if (num_rnas_<2 || k==0) return result;
+
+	ThreadPool pool(num_threads);
+
+	// several contiguous ranges per thread for load balance
+	size_type chunks = std::min(num_rnas_, 8*pool.size());
+	std::vector<NeighborTask *> tasks;
+	for (size_type c=0; c<chunks; ++c) {
+	    tasks.push_back(new NeighborTask(this, num_rnas_*c/chunks, num_rnas_*(c+1)/chunks,
+					     k, result));
+	    pool.submit(tasks.back());
+	}
+	try {
+	    pool.wait();
+	} catch (failure &f) {
+	    for (size_type c=0; c<tasks.size(); ++c) delete tasks[c];
+	    throw;
+	}
+	for (size_type c=0; c<tasks.size(); ++c) delete tasks[c];
+
+	return result;
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,121 @@
+#ifndef LOCARNA_PAIR_PREFILTER_HH
+#define LOCARNA_PAIR_PREFILTER_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+
+#include "aux.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+
+    /**
+     * @brief Alignment-free similarity of RNAs for selecting the
+     * pairs to align
+     *
+     * Computes a cheap similarity for all pairs of a set of RNAs,
+     * such that only the most similar pairs need to be aligned for
+     * the guide tree. The similarity combines
+     *
+     * - the cosine similarity of the k-mer profiles of the sequences
+     *   (k-mers over ACGU; for alignments, averaged over the rows) and
+     *
+     * - the similarity of the pairing profiles, i.e. the average
+     *   probabilities that the positions in each of num_bins
+     *   equally sized segments of the RNA are paired (1 minus the
+     *   mean absolute difference).
+     *
+     * The k-mer profiles are stored sparsely as the (k-mer, count)
+     * pairs of the occurring k-mers, sorted by k-mer, such that the
+     * similarity of two RNAs reduces to merging two sorted arrays;
+     * the pairing profiles are dense vectors of fixed length. The
+     * search for the nearest neighbors runs in parallel over the
+     * RNAs. Memory is linear in the total length of the RNAs.
+     */
+    class PairPrefilter {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! number of segments of the pairing profiles
+	static const size_type num_bins = 16;
+
+    private:
+	size_type num_rnas_; //!< number of RNAs
+	size_type kmer_length_; //!< k-mer length
+	size_type num_kmers_; //!< number of different k-mers
+	double struct_weight_; //!< weight of the pairing profile similarity
+
+	//! k-mer and its number of occurrences
+	typedef std::pair<size_type,size_type> kmer_count_t;
+
+	//! k-mer profiles of all RNAs, each sorted by k-mer; the
+	//! profile of RNA a is in [kmer_starts_[a],kmer_starts_[a+1])
+	std::vector<kmer_count_t> kmer_profiles_;
+
+	//! start of the k-mer profile per RNA (and end of the last one)
+	std::vector<size_type> kmer_starts_;
+
+	//! euclidean norms of the k-mer profiles
+	std::vector<double> kmer_norms_;
+
+	//! pairing profiles, one per RNA
+	std::vector<double> pairing_profiles_;
+
+	class NeighborTask;
+
+	//! @brief compute the k-mer profile of an RNA and append it
+	//! to kmer_profiles_
+	//! @return norm of the profile
+	double
+	compute_kmer_profile(const RnaData &rna);
+
+	//! @brief compute the pairing profile of an RNA
+	void
+	compute_pairing_profile(const RnaData &rna, double *profile) const;
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param inputs input RNAs (only used during construction)
+	 * @param kmer_length k-mer length (1..8)
+	 * @param struct_weight weight of the pairing profile similarity
+	 * (between 0 and 1); the k-mer similarity has weight
+	 * 1-struct_weight
+	 *
+	 * @throw failure if parameters are out of range
+	 */
+	PairPrefilter(const std::vector<const RnaData *> &inputs,
+		      size_type kmer_length,
+		      double struct_weight);
+
+	/**
+	 * @brief Similarity of two RNAs
+	 *
+	 * @param a first RNA
+	 * @param b second RNA
+	 * @return similarity between 0 and 1
+	 */
+	double
+	similarity(size_type a, size_type b) const;
+
+	/**
+	 * @brief Nearest neighbors of all RNAs
+	 *
+	 * @param k number of neighbors per RNA
+	 * @param num_threads number of threads (0 for number of processors)
+	 *
+	 * @return for each RNA, the (at most) k most similar other RNAs
+	 * by decreasing similarity; ties are broken by index
+	 */
+	std::vector<std::vector<size_type> >
+	neighbors(size_type k, size_type num_threads) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_PAIR_PREFILTER_HH
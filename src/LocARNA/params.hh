@@ -18,6 +18,7 @@ namespace LocARNA {
     class AnchorConstraints;
     class TraceController;
     class SparsificationMapper;
+    class Arena;
 
     /**
        \brief Description of free end gaps.
@@ -135,6 +136,11 @@ namespace LocARNA {
 
 	const AnchorConstraints *constraints_; //!< anchor constraints
 
+	bool top_level_checkpoints_; //!< whether to keep only checkpoint rows of the top level matrix
+
+	bool score_only_; //!< whether to compute only the score (no trace back)
+
+	Arena *arena_; //!< arena for the D and M matrices (NULL for heap)
 
     public:
 	
@@ -253,6 +259,54 @@ namespace LocARNA {
 	AlignerParams &
 	constraints(const AnchorConstraints &constraints) {
 	    constraints_=&constraints; return *this;}
+
+	/**
+	 * @brief set parameter top_level_checkpoints
+	 *
+	 * If set, the aligner keeps only O(sqrt(n)) rows of the
+	 * top level matrix (as checkpoints) and recomputes the rows
+	 * between them during the traceback; the M matrices within
+	 * arc matches are restricted to the arc match. This trades
+	 * time in the traceback for memory, if one sequence is much
+	 * longer than its base pairs.
+	 *
+	 * @param top_level_checkpoints whether to use checkpoints
+	 */
+	AlignerParams &
+	top_level_checkpoints(bool top_level_checkpoints) {
+	    top_level_checkpoints_=top_level_checkpoints; return *this;}
+
+	/**
+	 * @brief set parameter score_only
+	 *
+	 * If set, the aligner computes only the score: the M
+	 * matrices within arc matches are restricted to the arc
+	 * match, the top level is computed row by row (unless its M
+	 * is smaller than the context of the arc matches) and no
+	 * alignment object is created. Then, the aligner does not
+	 * support the traceback; in particular, trace(),
+	 * suboptimal(), normalized_align() and penalized_align() fail.
+	 *
+	 * @param score_only whether to compute only the score
+	 */
+	AlignerParams &
+	score_only(bool score_only) {
+	    score_only_=score_only; return *this;}
+
+	/**
+	 * @brief set parameter arena
+	 *
+	 * If set, the dynamic programming matrices (D and M) of
+	 * Aligner, AlignerP and AlignerN are allocated from the arena
+	 * (see Arena). The aligner must be constructed and destroyed
+	 * by the thread that owns the arena; copies of the aligner
+	 * allocate from the heap.
+	 *
+	 * @param arena arena of the calling thread
+	 */
+	AlignerParams &
+	arena(Arena &arena) {
+	    arena_=&arena; return *this;}
 	
 	
     protected:
@@ -275,7 +329,10 @@ namespace LocARNA {
 	    min_am_prob_(0), 
 	    min_bm_prob_(0),	   
 	    stacking_(false),
-	    constraints_(0L)
+	    constraints_(0L),
+	    top_level_checkpoints_(false),
+	    score_only_(false),
+	    arena_(0L)
 	{}
 
     public:
@@ -5,8 +5,69 @@
 #  include <config.h>
 #endif
 
+#include <cstddef>
+#include <string>
+
 namespace LocARNA {
 
+    /**
+     * @brief Retention of McCaskill matrices
+     *
+     * Describes how RnaEnsemble keeps the dynamic programming
+     * matrices of the McCaskill algorithm, which are required for
+     * computing in loop probabilities after folding. By default, the
+     * matrices are copied completely in double precision.
+     *
+     * Compact retention keeps only the band of entries (i,j) with
+     * j-i<=max_span, optionally stores partition functions and
+     * probabilities in single precision and optionally keeps the
+     * matrices in memory mapped temporary files, which the operating
+     * system can write out under memory pressure.
+     *
+     * @note Base pairs spanning more than max_span have probability
+     * 0 in an ensemble with compact retention.
+     *
+     * @see McC_matrices_base
+     */
+    class McCRetention {
+	bool single_precision_;
+	size_t max_span_;
+	std::string spill_dir_;
+    public:
+	/**
+	 * @brief Construct with all parameters
+	 *
+	 * @param single_precision store partition functions and
+	 * probabilities as float
+	 * @param max_span maximal span j-i of kept entries (i,j); 0
+	 * for no limit
+	 * @param spill_dir directory for temporary files of the
+	 * matrices; empty for keeping them in main memory
+	 */
+	McCRetention(bool single_precision=false,
+		     size_t max_span=0,
+		     const std::string &spill_dir="")
+	    : single_precision_(single_precision),
+	      max_span_(max_span),
+	      spill_dir_(spill_dir)
+	{}
+
+	//! @brief whether values are stored in single precision
+	bool single_precision() const {return single_precision_;}
+
+	//! @brief maximal span of kept entries (0 for no limit)
+	size_t max_span() const {return max_span_;}
+
+	//! @brief directory for temporary files (empty for none)
+	const std::string &spill_dir() const {return spill_dir_;}
+
+	//! @brief whether retention is compact
+	bool
+	compact() const {
+	    return single_precision_ || max_span_>0 || !spill_dir_.empty();
+	}
+    };
+
     /**
      * \brief Parameters for partition folding
      *
@@ -20,20 +81,37 @@ namespace LocARNA {
 	bool noLP_;
 	bool stacking_;
 	int dangling_;
+	McCRetention McC_retention_;
+	size_t max_bp_span_;
+	size_t window_size_;
     public:
 	/** 
 	 * Construct with all parameters
 	 * 
 	 * @param noLP
 	 * @param stacking 
+	 * @param dangling
+	 * @param McC_retention retention of McCaskill matrices
+	 * @param max_bp_span maximal span j-i of base pairs (i,j); 0
+	 * for no limit
+	 * @param window_size window size for local folding
+	 * (RNAplfold-style); 0 for global folding
+	 *
+	 * @see RnaEnsemble for the folding modes
 	 */
 	PFoldParams(bool noLP,
 		    bool stacking,
-		    int dangling=2
+		    int dangling=2,
+		    const McCRetention &McC_retention=McCRetention(),
+		    size_t max_bp_span=0,
+		    size_t window_size=0
 		    )
 	    : noLP_(noLP),
 	      stacking_(stacking),
-	      dangling_(dangling)
+	      dangling_(dangling),
+	      McC_retention_(McC_retention),
+	      max_bp_span_(max_bp_span),
+	      window_size_(window_size)
 	{}
 	
 	/** 
@@ -57,6 +135,35 @@ namespace LocARNA {
 	 */
 	int dangling() const {return dangling_;}
 
+	/**
+	 * @brief Get retention of McCaskill matrices
+	 *
+	 * @return retention
+	 */
+	const McCRetention &McC_retention() const {return McC_retention_;}
+
+	/**
+	 * @brief Get maximal base pair span
+	 *
+	 * @return maximal span j-i of base pairs (i,j); 0 for no limit
+	 */
+	size_t max_bp_span() const {return max_bp_span_;}
+
+	/**
+	 * @brief Get window size for local folding
+	 *
+	 * @return window size; 0 for global folding
+	 */
+	size_t window_size() const {return window_size_;}
+
+	/**
+	 * @brief Whether folding is local
+	 *
+	 * @return whether the window size or the maximal base pair
+	 * span is limited
+	 */
+	bool local_folding() const {return max_bp_span_>0 || window_size_>0;}
+
     };
 
 
@@ -0,0 +1,185 @@
+#include "pp_archive.hh"
+
+#include <cstring>
+
+namespace LocARNA {
+
+    //! magic at the start of a pp archive
+    static const char archive_magic[] = "LPPARCH1";
+
+    //! magic at the end of a pp archive
+    static const char index_magic[] = "LPPINDEX";
+
+    //! length of the magic strings
+    static const size_t magic_length = 8;
+
+    //! length of the trailer (index offset, number of entries, magic)
+    static const size_t trailer_length = 8+8+magic_length;
+
+    //! @brief write unsigned number of given byte width (little endian)
+    static
+    void
+    write_number(std::ostream &out, unsigned long long x, size_t width) {
+	for (size_t k=0; k<width; ++k) {
+	    out.put((char)(x & 0xff));
+	    x >>= 8;
+	}
+    }
+
+    //! @brief read unsigned number of given byte width (little endian)
+    static
+    unsigned long long
+    read_number(std::istream &in, size_t width) {
+	unsigned long long x=0;
+	for (size_t k=0; k<width; ++k) {
+	    int c = in.get();
+	    if (c==EOF) {
+		throw failure("Unexpected end of pp archive.");
+	    }
+	    x |= (unsigned long long)(unsigned char)c << (8*k);
+	}
+	return x;
+    }
+
+    // ------------------------------------------------------------
+    // PPArchiveWriter
+
+    PPArchiveWriter::PPArchiveWriter(const std::string &filename)
+	: filename_(filename),
+	  out_(filename.c_str(), std::ios::out | std::ios::binary),
+	  index_(),
+	  offset_(magic_length),
+	  closed_(false)
+    {
+	if (!out_.good()) {
+	    throw failure("Cannot write to "+filename+".");
+	}
+	out_.write(archive_magic,magic_length);
+    }
+
+    PPArchiveWriter::~PPArchiveWriter() {
+	if (!closed_) {
+	    try {
+		close();
+	    } catch (failure &f) {
+		// destructors must not throw
+	    }
+	}
+    }
+
+    void
+    PPArchiveWriter::add(const std::string &name, const std::string &text) {
+	if (closed_) {
+	    throw failure("Cannot add to closed pp archive "+filename_+".");
+	}
+	entry_t entry;
+	entry.name = name;
+	entry.offset = offset_;
+	entry.length = text.length();
+
+	out_.write(text.data(),text.length());
+	if (!out_.good()) {
+	    throw failure("Cannot write to "+filename_+".");
+	}
+	offset_ += text.length();
+	index_.push_back(entry);
+    }
+
+    void
+    PPArchiveWriter::close() {
+	if (closed_) return;
+	closed_=true;
+
+	unsigned long long index_offset = offset_;
+	for (size_type i=0; i<index_.size(); ++i) {
+	    write_number(out_,index_[i].name.length(),4);
+	    out_.write(index_[i].name.data(),index_[i].name.length());
+	    write_number(out_,index_[i].offset,8);
+	    write_number(out_,index_[i].length,8);
+	}
+	write_number(out_,index_offset,8);
+	write_number(out_,index_.size(),8);
+	out_.write(index_magic,magic_length);
+
+	out_.close();
+	if (out_.fail()) {
+	    throw failure("Cannot write to "+filename_+".");
+	}
+    }
+
+    // ------------------------------------------------------------
+    // PPArchiveReader
+
+    PPArchiveReader::PPArchiveReader(const std::string &filename)
+	: filename_(filename),
+	  in_(filename.c_str(), std::ios::in | std::ios::binary),
+	  names_(),
+	  offsets_(),
+	  lengths_()
+    {
+	if (!in_.good()) {
+	    throw failure("Cannot read from "+filename+".");
+	}
+
+	char magic[magic_length];
+	in_.read(magic,magic_length);
+	if (!in_.good() || strncmp(magic,archive_magic,magic_length)!=0) {
+	    throw failure(filename+" is not a pp archive.");
+	}
+
+	in_.seekg(0,std::ios::end);
+	unsigned long long file_length = in_.tellg();
+	if (file_length < magic_length+trailer_length) {
+	    throw failure(filename+" is not a pp archive.");
+	}
+
+	in_.seekg(file_length-trailer_length);
+	unsigned long long index_offset = read_number(in_,8);
+	unsigned long long num_entries = read_number(in_,8);
+	in_.read(magic,magic_length);
+	if (!in_.good() || strncmp(magic,index_magic,magic_length)!=0
+	    || index_offset<magic_length || index_offset>file_length-trailer_length) {
+	    throw failure(filename+" is not a pp archive (no index).");
+	}
+
+	in_.seekg(index_offset);
+	for (unsigned long long i=0; i<num_entries; ++i) {
+	    size_type name_length = read_number(in_,4);
+	    std::string name(name_length,' ');
+	    if (name_length>0) {
+		in_.read(&name[0],name_length);
+	    }
+	    unsigned long long offset = read_number(in_,8);
+	    unsigned long long length = read_number(in_,8);
+	    if (!in_.good() || offset+length>index_offset) {
+		throw failure("Corrupt index of pp archive "+filename+".");
+	    }
+	    names_.push_back(name);
+	    offsets_.push_back(offset);
+	    lengths_.push_back(length);
+	}
+    }
+
+    std::string
+    PPArchiveReader::text(size_type i) const {
+	std::string text(lengths_[i],' ');
+	in_.clear();
+	in_.seekg(offsets_[i]);
+	if (lengths_[i]>0) {
+	    in_.read(&text[0],lengths_[i]);
+	}
+	if (!in_.good()) {
+	    throw failure("Cannot read from "+filename_+".");
+	}
+	return text;
+    }
+
+    PPArchiveReader::size_type
+    PPArchiveReader::find(const std::string &name) const {
+	for (size_type i=0; i<names_.size(); ++i) {
+	    if (names_[i]==name) return i;
+	}
+	return names_.size();
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,174 @@
+#ifndef LOCARNA_PP_ARCHIVE_HH
+#define LOCARNA_PP_ARCHIVE_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "aux.hh"
+
+namespace LocARNA {
+
+    /**
+     * @brief Writes many pp files into a single indexed archive
+     *
+     * The archive is a binary file that stores the pp texts one
+     * after the other, followed by an index and a fixed size
+     * trailer:
+     *
+     * - magic "LPPARCH1"
+     * - the pp texts
+     * - for each entry: the name length (4 bytes), the name, the
+     *   offset and the length of the text (8 bytes each)
+     * - the offset of the index and the number of entries (8 bytes
+     *   each), magic "LPPINDEX"
+     *
+     * All numbers are unsigned little endian. Since the index comes
+     * last, entries can be written as soon as they are available,
+     * e.g. while folding a stream of sequences.
+     *
+     * @see PPArchiveReader
+     */
+    class PPArchiveWriter {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	//! @brief index entry
+	struct entry_t {
+	    std::string name; //!< name of the entry
+	    unsigned long long offset; //!< offset of the text
+	    unsigned long long length; //!< length of the text
+	};
+
+	std::string filename_; //!< name of the archive file
+	std::ofstream out_; //!< output stream
+	std::vector<entry_t> index_; //!< index of written entries
+	unsigned long long offset_; //!< current write offset
+	bool closed_; //!< whether the index is written
+
+	//! @brief no copy
+	PPArchiveWriter(const PPArchiveWriter &);
+
+	//! @brief no assignment
+	PPArchiveWriter &
+	operator =(const PPArchiveWriter &);
+
+    public:
+	/**
+	 * @brief Construct and open archive for writing
+	 *
+	 * @param filename name of the archive file
+	 *
+	 * @throw failure if the file cannot be written
+	 */
+	explicit
+	PPArchiveWriter(const std::string &filename);
+
+	/**
+	 * @brief Destructor
+	 *
+	 * Writes the index, unless the archive is already closed.
+	 */
+	~PPArchiveWriter();
+
+	/**
+	 * @brief Append an entry
+	 *
+	 * @param name name of the entry
+	 * @param text pp text
+	 *
+	 * @throw failure if the archive is closed or writing fails
+	 */
+	void
+	add(const std::string &name, const std::string &text);
+
+	/**
+	 * @brief Number of written entries
+	 * @return number of entries
+	 */
+	size_type
+	size() const { return index_.size(); }
+
+	/**
+	 * @brief Write the index and close the archive
+	 *
+	 * @throw failure if writing fails
+	 */
+	void
+	close();
+    };
+
+    /**
+     * @brief Reads pp files from an indexed archive
+     *
+     * Only the index is read on construction; texts are read on
+     * demand.
+     *
+     * @see PPArchiveWriter for the format
+     */
+    class PPArchiveReader {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	std::string filename_; //!< name of the archive file
+	mutable std::ifstream in_; //!< input stream
+	std::vector<std::string> names_; //!< names of the entries
+	std::vector<unsigned long long> offsets_; //!< offsets of the texts
+	std::vector<unsigned long long> lengths_; //!< lengths of the texts
+
+    public:
+	/**
+	 * @brief Construct and read the index
+	 *
+	 * @param filename name of the archive file
+	 *
+	 * @throw failure if the file cannot be read or is no pp archive
+	 */
+	explicit
+	PPArchiveReader(const std::string &filename);
+
+	/**
+	 * @brief Number of entries
+	 * @return number of entries
+	 */
+	size_type
+	size() const { return names_.size(); }
+
+	/**
+	 * @brief Name of an entry
+	 * @param i index of entry (0-based, in order of writing)
+	 * @return name
+	 */
+	const std::string &
+	name(size_type i) const { return names_[i]; }
+
+	/**
+	 * @brief Text of an entry
+	 *
+	 * @param i index of entry (0-based, in order of writing)
+	 * @return pp text
+	 *
+	 * @throw failure if reading fails
+	 */
+	std::string
+	text(size_type i) const;
+
+	/**
+	 * @brief Index of the first entry with a given name
+	 *
+	 * @param name name of entry
+	 * @return index of entry or size() if there is no such entry
+	 */
+	size_type
+	find(const std::string &name) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_PP_ARCHIVE_HH
@@ -0,0 +1,120 @@
+#include "profile_dot_plot.hh"
+
+#include <algorithm>
+
+#include "rna_data.hh"
+#include "sequence.hh"
+
+namespace LocARNA {
+
+    ProfileDotPlot::ProfileDotPlot(const RnaData &rna_data, double p_exp)
+	: sequence_(rna_data.multiple_alignment()),
+	  weight_(rna_data.sequence().num_of_rows()),
+	  log_floor_sum_(),
+	  log_cut_sum_(),
+	  has_stacking_(rna_data.has_stacking()),
+	  sums_(0.0),
+	  stacking_sums_(0.0)
+    {
+	double p_cut = rna_data.arc_cutoff_prob();
+	double log_floor = log(std::min(p_exp, p_cut*0.75));
+
+	log_floor_sum_ = weight_ * log_floor;
+	log_cut_sum_ = weight_ * log(p_cut);
+
+	for (RnaData::arc_probs_const_iterator it=rna_data.arc_probs_begin();
+	     rna_data.arc_probs_end()!=it; ++it) {
+	    double p = it->second;
+	    if (!(log(p) > log_floor)) continue;
+
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    sums_(i,j) = weight_ * (log(p) - log_floor);
+
+	    if (has_stacking_) {
+		double st_p = rna_data.joint_arc_prob(i,j);
+		if (st_p>0 && log(st_p) > log_floor) {
+		    stacking_sums_(i,j) = weight_ * (log(st_p) - log_floor);
+		}
+	    }
+	}
+    }
+
+    ProfileDotPlot::ProfileDotPlot(const ProfileDotPlot &dot_plotA,
+				   const ProfileDotPlot &dot_plotB,
+				   const Alignment::edges_t &edges)
+	: sequence_(edges,dot_plotA.sequence(),dot_plotB.sequence()),
+	  weight_(dot_plotA.weight_ + dot_plotB.weight_),
+	  log_floor_sum_(dot_plotA.log_floor_sum_ + dot_plotB.log_floor_sum_),
+	  log_cut_sum_(dot_plotA.log_cut_sum_ + dot_plotB.log_cut_sum_),
+	  has_stacking_(dot_plotA.has_stacking_ && dot_plotB.has_stacking_),
+	  sums_(0.0),
+	  stacking_sums_(0.0)
+    {
+	std::vector<pos_type> mapA = column_map(edges.first,dot_plotA.length());
+	std::vector<pos_type> mapB = column_map(edges.second,dot_plotB.length());
+
+	sum_matrix_t sums(0.0);
+	add_remapped(dot_plotA.sums_,mapA,sums);
+	add_remapped(dot_plotB.sums_,mapB,sums);
+
+	sum_matrix_t stacking_sums(0.0);
+	if (has_stacking_) {
+	    add_remapped(dot_plotA.stacking_sums_,mapA,stacking_sums);
+	    add_remapped(dot_plotB.stacking_sums_,mapB,stacking_sums);
+	}
+
+	// keep only pairs above the consensus cutoff; compare in log
+	// space to avoid normalizing every entry
+	double min_sum = log_cut_sum_ - log_floor_sum_;
+
+	for (const_iterator it=sums.begin(); sums.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    double st_sum = has_stacking_ ? stacking_sums(i,j) : 0.0;
+
+	    if (it->second > min_sum || st_sum > min_sum) {
+		sums_(i,j) = it->second;
+		if (st_sum > 0) {
+		    stacking_sums_(i,j) = st_sum;
+		}
+	    }
+	}
+    }
+
+    std::vector<pos_type>
+    ProfileDotPlot::column_map(const Alignment::edge_ends_t &edge_ends, size_type len) {
+	std::vector<pos_type> map(len+1,0);
+	for (size_type k=0; k<edge_ends.size(); ++k) {
+	    if (edge_ends[k].is_pos()) {
+		map[edge_ends[k]] = k+1;
+	    }
+	}
+	return map;
+    }
+
+    void
+    ProfileDotPlot::add_remapped(const sum_matrix_t &src,
+				 const std::vector<pos_type> &map,
+				 sum_matrix_t &dest) {
+	for (const_iterator it=src.begin(); src.end()!=it; ++it) {
+	    pos_type i = map[it->first.first];
+	    pos_type j = map[it->first.second];
+	    if (i==0 || j==0) continue; // not in the (local) alignment
+	    dest(i,j) += it->second;
+	}
+    }
+
+    double
+    ProfileDotPlot::arc_prob(pos_type i, pos_type j) const {
+	double sum = sums_(i,j);
+	return sum>0 ? normalize(sum) : 0.0;
+    }
+
+    double
+    ProfileDotPlot::joint_arc_prob(pos_type i, pos_type j) const {
+	if (!has_stacking_ || !(sums_(i,j)>0)) return 0.0;
+	return normalize(stacking_sums_(i,j));
+    }
+
+} // end namespace LocARNA
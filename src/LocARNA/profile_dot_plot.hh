@@ -0,0 +1,189 @@
+#ifndef LOCARNA_PROFILE_DOT_PLOT_HH
+#define LOCARNA_PROFILE_DOT_PLOT_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+
+#include "aux.hh"
+#include "sparse_matrix.hh"
+#include "alignment.hh"
+#include "multiple_alignment.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+    class Sequence;
+
+    /**
+     * @brief Incrementally maintained consensus dot plot of a profile
+     *
+     * Represents the consensus base pair probabilities of an
+     * alignment profile as in RnaData(const RnaData &, const RnaData
+     * &, const Alignment &, double, double, bool), i.e. as weighted
+     * geometric mean of the (floored) probabilities of the single
+     * sequences. However, the class keeps the per-sequence weighted
+     * sums of log probabilities instead of the normalized
+     * probabilities. Probabilities are normalized lazily on access.
+     *
+     * For each sequence k (weight w_k, floor probability f_k), only
+     * pairs with probability p_k(i,j)>f_k contribute
+     *
+     *   sum(i,j) = sum_k w_k (log p_k(i,j) - log f_k),
+     *
+     * such that the consensus probability is
+     *
+     *   p(i,j) = exp( (sum_k w_k log f_k + sum(i,j)) / sum_k w_k ).
+     *
+     * Consequently, merging two profiles along an alignment only
+     * remaps and adds the sparse sums of both sides; this costs
+     * O(number of base pairs) and does not need any dense
+     * intermediate matrix. Pairs with consensus probability (and
+     * stacking probability) below the consensus cutoff are dropped
+     * after each merge, as in the consensus constructor of RnaData.
+     *
+     * @note In contrast to the consensus constructor of RnaData, the
+     * floor probability is fixed once per input profile (from its
+     * expected probability and cutoff) and not recomputed at each
+     * merge.
+     */
+    class ProfileDotPlot {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! sparse matrix of weighted log probability sums
+	typedef SparseMatrix<double> sum_matrix_t;
+
+	//! constant iterator over the stored base pairs
+	typedef sum_matrix_t::const_iterator const_iterator;
+
+    private:
+	MultipleAlignment sequence_; //!< the (aligned) sequences
+
+	double weight_; //!< total weight (number of rows)
+	double log_floor_sum_; //!< weighted sum of log floor probabilities
+	double log_cut_sum_; //!< weighted sum of log cutoff probabilities
+
+	bool has_stacking_; //!< whether stacking sums are available
+
+	sum_matrix_t sums_; //!< weighted sums for base pairs
+
+	//! weighted sums for stacked base pairs; has entry (i,j)
+	//! implies sums_ has entry (i,j)
+	sum_matrix_t stacking_sums_;
+
+	//! @brief normalize a weighted sum to a probability
+	double
+	normalize(double sum) const {
+	    return exp((log_floor_sum_+sum)/weight_);
+	}
+
+	/**
+	 * @brief Add remapped sums of one side of a merge
+	 *
+	 * @param src sums of the side
+	 * @param map position map from side to merged columns (0 if dropped)
+	 * @param[in,out] dest sums of the merged profile
+	 */
+	static
+	void
+	add_remapped(const sum_matrix_t &src,
+		     const std::vector<pos_type> &map,
+		     sum_matrix_t &dest);
+
+	/**
+	 * @brief Position map from one side of an alignment to the
+	 * merged columns
+	 *
+	 * @param edge_ends edge ends of the side
+	 * @param len length of the side
+	 * @return map (entry 0 for positions that are not aligned)
+	 */
+	static
+	std::vector<pos_type>
+	column_map(const Alignment::edge_ends_t &edge_ends, size_type len);
+
+    public:
+	/**
+	 * @brief Construct from RNA data
+	 *
+	 * @param rna_data RNA data (single sequence or alignment)
+	 * @param p_exp expected base pair probability
+	 *
+	 * The data is weighted by its number of rows; its floor
+	 * probability is min(p_exp, 0.75*cutoff probability).
+	 */
+	ProfileDotPlot(const RnaData &rna_data, double p_exp);
+
+	/**
+	 * @brief Construct as merge of two aligned profiles
+	 *
+	 * @param dot_plotA profile A
+	 * @param dot_plotB profile B
+	 * @param edges alignment edges of A and B
+	 *
+	 * Stacking sums are kept iff both profiles have them.
+	 * Complexity O(number of stored base pairs) plus the
+	 * construction of the merged multiple alignment.
+	 */
+	ProfileDotPlot(const ProfileDotPlot &dot_plotA,
+		       const ProfileDotPlot &dot_plotB,
+		       const Alignment::edges_t &edges);
+
+	//! @brief the aligned sequences of the profile
+	const Sequence &
+	sequence() const { return sequence_.as_sequence(); }
+
+	//! @brief number of alignment columns
+	size_type
+	length() const { return sequence_.length(); }
+
+	//! @brief total weight of the profile
+	double
+	weight() const { return weight_; }
+
+	//! @brief whether stacking probabilities are available
+	bool
+	has_stacking() const { return has_stacking_; }
+
+	//! @brief consensus cutoff probability (weighted geometric
+	//! mean of the cutoffs)
+	double
+	arc_cutoff_prob() const { return exp(log_cut_sum_/weight_); }
+
+	/**
+	 * @brief Consensus base pair probability
+	 * @param i left end
+	 * @param j right end
+	 * @return probability, 0 if the pair is not stored
+	 */
+	double
+	arc_prob(pos_type i, pos_type j) const;
+
+	/**
+	 * @brief Consensus stacking probability
+	 * @param i left end
+	 * @param j right end
+	 * @return probability of (i,j) and (i+1,j-1), 0 if not stored
+	 */
+	double
+	joint_arc_prob(pos_type i, pos_type j) const;
+
+	//! @brief begin of stored base pairs (keys of the sum matrix)
+	const_iterator
+	begin() const { return sums_.begin(); }
+
+	//! @brief end of stored base pairs
+	const_iterator
+	end() const { return sums_.end(); }
+
+	//! @brief number of stored base pairs
+	size_type
+	size() const { return sums_.size(); }
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_PROFILE_DOT_PLOT_HH
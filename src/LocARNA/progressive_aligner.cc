@@ -0,0 +1,844 @@
+#include "progressive_aligner.hh"
+
+#include <set>
+#include <algorithm>
+
+#include "rna_data.hh"
+#include "sequence.hh"
+#include "multiple_alignment.hh"
+#include "alignment.hh"
+#include "arc_matches.hh"
+#include "scoring.hh"
+#include "aligner.hh"
+#include "anchor_constraints.hh"
+#include "trace_controller.hh"
+#include "thread_pool.hh"
+#include "profile_dot_plot.hh"
+#include "arena.hh"
+#include "library_extension.hh"
+#include "pair_prefilter.hh"
+
+namespace LocARNA {
+
+    ProfileAlignmentParams::ProfileAlignmentParams()
+	: match(50),
+	  mismatch(0),
+	  indel(-350),
+	  indel_opening(-500),
+	  unpaired_penalty(0),
+	  struct_weight(200),
+	  tau_factor(0),
+	  exclusion(0),
+	  temperature(150),
+	  exp_prob(-1),
+	  ribosum(NULL),
+	  ribofit(NULL),
+	  stacking(false),
+	  new_stacking(false),
+	  no_lonely_pairs(false),
+	  struct_local(false),
+	  sequ_local(false),
+	  free_endgaps("----"),
+	  max_diff(-1),
+	  max_diff_am(-1),
+	  max_diff_at_am(-1),
+	  min_prob(0.0005),
+	  min_am_prob(0.0005),
+	  min_bm_prob(0.0005),
+	  arcmatch_score_memory(0)
+    {}
+
+    //! @brief expected base pair probability for a profile length
+    static
+    double
+    exp_prob(const ProfileAlignmentParams &params, size_t len) {
+	return params.exp_prob>=0 ? params.exp_prob : prob_exp_f(len);
+    }
+
+    // ------------------------------------------------------------
+    // tasks
+
+    //! @brief compute pairwise scores of one row of the score matrix
+    class ProgressiveAligner::PairwiseTask : public ThreadPool::Task {
+	ProgressiveAligner *pa_;
+	size_type i_;
+	std::vector<size_type> partners_; //!< RNAs j<i to align with i
+    public:
+	PairwiseTask(ProgressiveAligner *pa, size_type i,
+		     const std::vector<size_type> &partners)
+	    : pa_(pa), i_(i), partners_(partners) {}
+
+	void
+	run() {
+	    bool trace = pa_->library_extension_!=NULL;
+
+	    // one problem for all partners; resetting it keeps the
+	    // matrices of the aligner, which are allocated from the
+	    // arena of the worker thread
+	    ProfileAlignmentProblem *problem=NULL;
+	    try {
+		for (size_type k=0; k<partners_.size(); ++k) {
+		    size_type j = partners_[k];
+		    if (problem==NULL) {
+			problem = new ProfileAlignmentProblem(*pa_->inputs_[i_],
+							      *pa_->inputs_[j],
+							      pa_->params_, NULL,
+							      !trace,
+							      &Arena::thread_arena());
+		    } else {
+			problem->reset(*pa_->inputs_[i_], *pa_->inputs_[j],
+				       NULL, !trace);
+		    }
+		    Aligner &aligner = problem->aligner();
+
+		    infty_score_t score = aligner.align();
+		    if (trace) {
+			aligner.trace();
+			pa_->library_extension_->set_alignment(i_,j,
+							       aligner.get_alignment()
+							       .alignment_edges(false));
+		    }
+		    double s = score.is_finite() ? (double)score.finite_value() : -1e10;
+		    pa_->scores_(i_,j) = s;
+		    pa_->scores_(j,i_) = s;
+		}
+	    } catch (...) {
+		if (problem) delete problem;
+		throw;
+	    }
+	    if (problem) delete problem;
+	}
+    };
+
+    //! @brief align the children of an inner tree node
+    class ProgressiveAligner::NodeTask : public ThreadPool::Task {
+	ProgressiveAligner *pa_;
+	size_type x_;
+    public:
+	NodeTask(ProgressiveAligner *pa, size_type x): pa_(pa), x_(x) {}
+
+	void
+	run() { pa_->align_node(x_); }
+    };
+
+    //! @brief align two profiles
+    class ProgressiveAligner::ProfileTask : public ThreadPool::Task {
+	const RnaData &rna_dataA_;
+	const RnaData &rna_dataB_;
+	const ProfileAlignmentParams &params_;
+	const MultipleAlignment *reference_;
+	bool trace_;
+    public:
+	infty_score_t score; //!< alignment score
+	Alignment::edges_t edges; //!< alignment edges (if traced)
+
+	ProfileTask(const RnaData &rna_dataA,
+		    const RnaData &rna_dataB,
+		    const ProfileAlignmentParams &params,
+		    const MultipleAlignment *reference,
+		    bool trace)
+	    : rna_dataA_(rna_dataA),
+	      rna_dataB_(rna_dataB),
+	      params_(params),
+	      reference_(reference),
+	      trace_(trace),
+	      score(infty_score_t::neg_infty),
+	      edges(Alignment::edge_ends_t(),Alignment::edge_ends_t())
+	{}
+
+	void
+	run() {
+	    score = align_profiles(rna_dataA_, rna_dataB_, params_, reference_,
+				   trace_ ? &edges : NULL);
+	}
+    };
+
+    // ------------------------------------------------------------
+    // ProgressiveAligner
+
+    ProgressiveAligner::ProgressiveAligner(const std::vector<const RnaData *> &inputs,
+					   const ProfileAlignmentParams &params,
+					   size_type num_threads)
+	: inputs_(inputs),
+	  params_(params),
+	  pool_(NULL),
+	  scores_(),
+	  have_scores_(false),
+	  library_extension_(NULL),
+	  prefilter_(NULL),
+	  prefilter_neighbors_(0),
+	  tree_(NULL),
+	  profiles_(),
+	  dot_plots_(),
+	  complements_(),
+	  complement_dot_plots_(),
+	  result_(NULL),
+	  score_(infty_score_t::neg_infty),
+	  open_children_(),
+	  node_tasks_(),
+	  result_owned_(false)
+    {
+	if (inputs_.empty()) {
+	    throw failure("ProgressiveAligner: no input RNAs.");
+	}
+
+	std::set<std::string> names;
+	for (size_type i=0; i<inputs_.size(); ++i) {
+	    const MultipleAlignment &ma = inputs_[i]->multiple_alignment();
+	    for (size_type k=0; k<ma.num_of_rows(); ++k) {
+		const std::string &name = ma.seqentry(k).name();
+		if (!names.insert(name).second) {
+		    throw failure("ProgressiveAligner: duplicate sequence name "+name+".");
+		}
+	    }
+	}
+
+	pthread_mutex_init(&mutex_,NULL);
+	pool_ = new ThreadPool(num_threads);
+    }
+
+    ProgressiveAligner::~ProgressiveAligner() {
+	clear_complements();
+	if (result_owned_) delete result_;
+	for (size_type x=inputs_.size(); x<profiles_.size(); ++x) {
+	    if (profiles_[x]) delete profiles_[x];
+	}
+	for (size_type x=0; x<dot_plots_.size(); ++x) {
+	    if (dot_plots_[x]) delete dot_plots_[x];
+	}
+	for (size_type k=0; k<node_tasks_.size(); ++k) {
+	    delete node_tasks_[k];
+	}
+	if (tree_) delete tree_;
+	if (library_extension_) delete library_extension_;
+	if (prefilter_) delete prefilter_;
+	delete pool_;
+	pthread_mutex_destroy(&mutex_);
+    }
+
+    void
+    ProgressiveAligner::set_library_extension(double min_prob) {
+	assert(!have_scores_);
+	if (library_extension_) delete library_extension_;
+	library_extension_ = new LibraryExtension(inputs_,min_prob);
+    }
+
+    void
+    ProgressiveAligner::set_prefilter(size_type neighbors, size_type kmer_length,
+				      double struct_weight) {
+	assert(!have_scores_);
+	if (prefilter_) delete prefilter_;
+	prefilter_ = new PairPrefilter(inputs_,kmer_length,struct_weight);
+	prefilter_neighbors_ = neighbors;
+    }
+
+    const Matrix<double> &
+    ProgressiveAligner::compute_pairwise_scores() {
+	size_type n = inputs_.size();
+	scores_.resize(n,n);
+	scores_.fill(0.0);
+
+	// partners[i] are the RNAs j<i that are aligned with i
+	std::vector<std::vector<size_type> > partners(n);
+	bool prefiltered = prefilter_ && prefilter_neighbors_+1 < n;
+	if (prefiltered) {
+	    std::vector<std::vector<size_type> > neighbors =
+		prefilter_->neighbors(prefilter_neighbors_,pool_->size());
+	    for (size_type i=0; i<n; ++i) {
+		for (size_type k=0; k<neighbors[i].size(); ++k) {
+		    size_type j = neighbors[i][k];
+		    partners[std::max(i,j)].push_back(std::min(i,j));
+		}
+	    }
+	    for (size_type i=0; i<n; ++i) {
+		std::sort(partners[i].begin(),partners[i].end());
+		partners[i].erase(std::unique(partners[i].begin(),partners[i].end()),
+				  partners[i].end());
+	    }
+	} else {
+	    for (size_type i=0; i<n; ++i) {
+		for (size_type j=0; j<i; ++j) {
+		    partners[i].push_back(j);
+		}
+	    }
+	}
+
+	std::vector<PairwiseTask *> tasks;
+	// submit long rows first for better load balance
+	for (size_type i=n; i>1; --i) {
+	    if (partners[i-1].empty()) continue;
+	    tasks.push_back(new PairwiseTask(this,i-1,partners[i-1]));
+	    pool_->submit(tasks.back());
+	}
+	try {
+	    pool_->wait();
+	} catch (failure &f) {
+	    for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+	    throw;
+	}
+	for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+
+	if (prefiltered) {
+	    estimate_scores(partners);
+	}
+
+	if (library_extension_) {
+	    library_extension_->extend(pool_->size());
+	    for (size_type i=0; i<n; ++i) {
+		inputs_[i] = &library_extension_->extended(i);
+	    }
+	}
+
+	have_scores_=true;
+	return scores_;
+    }
+
+    void
+    ProgressiveAligner::estimate_scores(const std::vector<std::vector<size_type> > &partners) {
+	size_type n = inputs_.size();
+
+	// least squares fit score = a + b*similarity over the aligned
+	// pairs with finite scores
+	double sx=0.0, sy=0.0, sxx=0.0, sxy=0.0;
+	size_type m=0;
+	for (size_type i=0; i<n; ++i) {
+	    for (size_type k=0; k<partners[i].size(); ++k) {
+		size_type j = partners[i][k];
+		double y = scores_(i,j);
+		if (y <= -1e10) continue;
+		double x = prefilter_->similarity(i,j);
+		sx += x; sy += y; sxx += x*x; sxy += x*y;
+		++m;
+	    }
+	}
+	double a=0.0;
+	double b=0.0;
+	if (m>0) {
+	    double vx = sxx - sx*sx/m;
+	    b = (vx > 0.0) ? (sxy - sx*sy/m)/vx : 0.0;
+	    a = (sy - b*sx)/m;
+	}
+
+	for (size_type i=0; i<n; ++i) {
+	    const std::vector<size_type> &p = partners[i];
+	    size_type k=0;
+	    for (size_type j=0; j<i; ++j) {
+		if (k<p.size() && p[k]==j) {
+		    ++k;
+		    continue;
+		}
+		double s = a + b*prefilter_->similarity(i,j);
+		scores_(i,j) = s;
+		scores_(j,i) = s;
+	    }
+	}
+    }
+
+    void
+    ProgressiveAligner::set_pairwise_scores(const Matrix<double> &scores) {
+	if (scores.sizes().first!=inputs_.size()
+	    || scores.sizes().second!=inputs_.size()) {
+	    throw failure("ProgressiveAligner: score matrix size does not match number of inputs.");
+	}
+	scores_=scores;
+	have_scores_=true;
+    }
+
+    const GuideTree &
+    ProgressiveAligner::build_tree(GuideTree::method_t method) {
+	if (!have_scores_) {
+	    compute_pairwise_scores();
+	}
+	if (tree_) delete tree_;
+	tree_ = new GuideTree(scores_,method,pool_->size());
+	return *tree_;
+    }
+
+    infty_score_t
+    ProgressiveAligner::align() {
+	if (!tree_) {
+	    build_tree(GuideTree::UPGMA);
+	}
+
+	size_type n = tree_->num_leaves();
+
+	profiles_.resize(tree_->num_nodes(),NULL);
+	dot_plots_.resize(tree_->num_nodes(),NULL);
+	for (size_type i=0; i<n; ++i) {
+	    profiles_[i] = inputs_[i];
+	    dot_plots_[i] = new ProfileDotPlot(*inputs_[i],
+					       exp_prob(params_,inputs_[i]->length()));
+	}
+	complements_.resize(tree_->num_nodes(),NULL);
+	complement_dot_plots_.resize(tree_->num_nodes(),NULL);
+
+	if (n==1) {
+	    result_ = profiles_[0];
+	    score_ = infty_score_t(0);
+	    return score_;
+	}
+
+	open_children_.resize(tree_->num_nodes());
+	std::vector<size_type> ready;
+	for (size_type x=n; x<tree_->num_nodes(); ++x) {
+	    open_children_[x] = (tree_->is_leaf(tree_->left(x))?0:1)
+		+ (tree_->is_leaf(tree_->right(x))?0:1);
+	    node_tasks_.push_back(new NodeTask(this,x));
+	    if (open_children_[x]==0) {
+		ready.push_back(x);
+	    }
+	}
+
+	// inner nodes become ready in node_done()
+	for (size_type k=0; k<ready.size(); ++k) {
+	    pool_->submit(node_tasks_[ready[k]-n]);
+	}
+	pool_->wait();
+
+	result_ = profiles_[tree_->root()];
+	return score_;
+    }
+
+    void
+    ProgressiveAligner::align_node(size_type x) {
+	size_type left = tree_->left(x);
+	size_type right = tree_->right(x);
+
+	Alignment::edges_t edges((Alignment::edge_ends_t()),Alignment::edge_ends_t());
+	infty_score_t score = align_profiles(*profiles_[left],
+					     *profiles_[right],
+					     params_,
+					     NULL,
+					     &edges);
+	dot_plots_[x] = new ProfileDotPlot(*dot_plots_[left],*dot_plots_[right],edges);
+	profiles_[x] = new RnaData(*dot_plots_[x]);
+	if (x==tree_->root()) {
+	    score_ = score;
+	}
+	node_done(x);
+    }
+
+    void
+    ProgressiveAligner::node_done(size_type x) {
+	size_type p = tree_->parent(x);
+	if (p==GuideTree::none) return;
+
+	pthread_mutex_lock(&mutex_);
+	bool ready = (--open_children_[p] == 0);
+	pthread_mutex_unlock(&mutex_);
+
+	if (ready) {
+	    pool_->submit(node_tasks_[p-tree_->num_leaves()]);
+	}
+    }
+
+    void
+    ProgressiveAligner::clear_complements() {
+	for (size_type x=0; x<complements_.size(); ++x) {
+	    if (complements_[x]) {
+		delete complements_[x];
+		complements_[x]=NULL;
+	    }
+	    if (complement_dot_plots_[x]) {
+		delete complement_dot_plots_[x];
+		complement_dot_plots_[x]=NULL;
+	    }
+	}
+    }
+
+    const ProfileDotPlot &
+    ProgressiveAligner::dot_plot(size_type x) {
+	if (!dot_plots_[x]) {
+	    dot_plots_[x] = merge_profiles(dot_plot(tree_->left(x)),
+					   dot_plot(tree_->right(x)),
+					   result_->multiple_alignment());
+	}
+	return *dot_plots_[x];
+    }
+
+    const RnaData &
+    ProgressiveAligner::profile(size_type x) {
+	if (!profiles_[x]) {
+	    profiles_[x] = new RnaData(dot_plot(x));
+	}
+	return *profiles_[x];
+    }
+
+    void
+    ProgressiveAligner::invalidate_ancestors(size_type x) {
+	// the root profile is superseded by result_ and never used
+	// during refinement
+	for (size_type p=tree_->parent(x); p!=tree_->root(); p=tree_->parent(p)) {
+	    if (profiles_[p]) {
+		delete profiles_[p];
+		profiles_[p]=NULL;
+	    }
+	    if (dot_plots_[p]) {
+		delete dot_plots_[p];
+		dot_plots_[p]=NULL;
+	    }
+	}
+    }
+
+    //! @brief sibling of a non-root tree node
+    static
+    GuideTree::size_type
+    sibling(const GuideTree &tree, GuideTree::size_type x) {
+	GuideTree::size_type p = tree.parent(x);
+	return (tree.left(p)==x) ? tree.right(p) : tree.left(p);
+    }
+
+    const ProfileDotPlot &
+    ProgressiveAligner::complement_dot_plot(size_type x) {
+	size_type p = tree_->parent(x);
+	if (p==tree_->root()) {
+	    return dot_plot(sibling(*tree_,x));
+	}
+
+	if (!complement_dot_plots_[x]) {
+	    complement_dot_plots_[x] = merge_profiles(dot_plot(sibling(*tree_,x)),
+						      complement_dot_plot(p),
+						      result_->multiple_alignment());
+	}
+	return *complement_dot_plots_[x];
+    }
+
+    const RnaData &
+    ProgressiveAligner::complement(size_type x) {
+	size_type p = tree_->parent(x);
+	if (p==tree_->root()) {
+	    return profile(sibling(*tree_,x));
+	}
+
+	if (!complements_[x]) {
+	    complements_[x] = new RnaData(complement_dot_plot(x));
+	}
+	return *complements_[x];
+    }
+
+    ProgressiveAligner::size_type
+    ProgressiveAligner::refine(size_type max_rounds) {
+	size_type accepted=0;
+
+	if (tree_->num_leaves()<=2) return accepted;
+
+	size_type root = tree_->root();
+
+	for (size_type round=0; round<max_rounds; ++round) {
+	    size_type round_accepted=0;
+
+	    for (size_type x=0; x<root; ++x) {
+		// the right child of the root induces the same split as the left
+		if (x==tree_->right(root)) continue;
+
+		const RnaData &rna_dataA = profile(x);
+		const RnaData &rna_dataB = complement(x);
+
+		ProfileTask current(rna_dataA,rna_dataB,params_,
+				    &result_->multiple_alignment(),false);
+		ProfileTask realigned(rna_dataA,rna_dataB,params_,NULL,true);
+		pool_->submit(&current);
+		pool_->submit(&realigned);
+		pool_->wait();
+
+		if (realigned.score > current.score) {
+		    ProfileDotPlot merged(dot_plot(x),complement_dot_plot(x),
+					  realigned.edges);
+		    clear_complements();
+		    invalidate_ancestors(x);
+		    if (result_owned_) delete result_;
+		    result_ = new RnaData(merged);
+		    result_owned_ = true;
+		    score_ = realigned.score;
+		    round_accepted++;
+		}
+	    }
+
+	    accepted += round_accepted;
+	    if (round_accepted==0) break; // converged
+	}
+
+	return accepted;
+    }
+
+    //! @brief test whether any of the given rows has a non-gap in a column
+    static
+    bool
+    has_non_gap(const std::vector<const string1 *> &rows, size_t col) {
+	for (size_t k=0; k<rows.size(); ++k) {
+	    if (!is_gap_symbol((*rows[k])[col])) return true;
+	}
+	return false;
+    }
+
+    //! @brief rows of a multiple alignment that belong to a profile
+    static
+    std::vector<const string1 *>
+    profile_rows(const MultipleAlignment &pma, const MultipleAlignment &ma) {
+	std::vector<const string1 *> rows;
+	for (size_t k=0; k<pma.num_of_rows(); ++k) {
+	    const std::string &name = pma.seqentry(k).name();
+	    if (!ma.contains(name)) {
+		throw failure("ProgressiveAligner: sequence "+name+" not in alignment.");
+	    }
+	    rows.push_back(&ma.seqentry(name).seq());
+	}
+	return rows;
+    }
+
+    /**
+     * @brief Pairwise alignment of two profiles induced by a multiple alignment
+     *
+     * @param seqA sequences of the first profile
+     * @param seqB sequences of the second profile
+     * @param ma multiple alignment containing the rows of both profiles
+     * @param[out] alistrA alignment string of A ('N' for a column of A, '-' for gap)
+     * @param[out] alistrB alignment string of B
+     *
+     * @throw failure if ma is inconsistent with the profiles
+     */
+    static
+    void
+    profile_alignment_strings(const MultipleAlignment &seqA,
+			      const MultipleAlignment &seqB,
+			      const MultipleAlignment &ma,
+			      std::string &alistrA,
+			      std::string &alistrB) {
+	std::vector<const string1 *> rowsA = profile_rows(seqA,ma);
+	std::vector<const string1 *> rowsB = profile_rows(seqB,ma);
+
+	alistrA="";
+	alistrB="";
+
+	size_t lenA=0;
+	size_t lenB=0;
+	for (size_t col=1; col<=ma.length(); ++col) {
+	    bool inA = has_non_gap(rowsA,col);
+	    bool inB = has_non_gap(rowsB,col);
+
+	    if (!inA && !inB) continue;
+
+	    alistrA += inA ? 'N' : '-';
+	    alistrB += inB ? 'N' : '-';
+	    if (inA) lenA++;
+	    if (inB) lenB++;
+	}
+
+	if (lenA!=seqA.length() || lenB!=seqB.length()) {
+	    throw failure("ProgressiveAligner: alignment inconsistent with profiles.");
+	}
+    }
+
+    // ------------------------------------------------------------
+    // ProfileAlignmentProblem
+
+    ProfileAlignmentProblem::ProfileAlignmentProblem(const RnaData &rna_dataA,
+						     const RnaData &rna_dataB,
+						     const ProfileAlignmentParams &params,
+						     const MultipleAlignment *reference,
+						     bool score_only,
+						     Arena *arena)
+	: params_(params),
+	  arena_(arena),
+	  pw_reference_(NULL),
+	  trace_controller_(NULL),
+	  constraints_(NULL),
+	  arc_matches_(NULL),
+	  scoring_params_(NULL),
+	  scoring_(NULL),
+	  aligner_(NULL)
+    {
+	init(rna_dataA,rna_dataB,reference,score_only);
+    }
+
+    void
+    ProfileAlignmentProblem::reset(const RnaData &rna_dataA,
+				   const RnaData &rna_dataB,
+				   const MultipleAlignment *reference,
+				   bool score_only) {
+	free_pair_objects();
+	init(rna_dataA,rna_dataB,reference,score_only);
+    }
+
+    void
+    ProfileAlignmentProblem::init(const RnaData &rna_dataA,
+				  const RnaData &rna_dataB,
+				  const MultipleAlignment *reference,
+				  bool score_only) {
+	typedef size_t size_type;
+
+	const Sequence &seqA=rna_dataA.sequence();
+	const Sequence &seqB=rna_dataB.sequence();
+
+	size_type lenA=seqA.length();
+	size_type lenB=seqB.length();
+
+	try {
+	    // restrict to the reference by a trace controller for the
+	    // pairwise alignment of the profiles (gap pattern only); this
+	    // allows exactly the reference alignment for max-diff 0
+	    if (reference) {
+		std::string alistrA;
+		std::string alistrB;
+		profile_alignment_strings(seqA,seqB,*reference,alistrA,alistrB);
+		pw_reference_ = new MultipleAlignment("A","B",alistrA,alistrB);
+	    }
+
+	    trace_controller_ =
+		new TraceController(reference ? Sequence("A",std::string(lenA,'N')) : seqA,
+				    reference ? Sequence("B",std::string(lenB,'N')) : seqB,
+				    pw_reference_,
+				    reference ? 0 : params_.max_diff);
+
+	    constraints_ =
+		new AnchorConstraints(lenA,
+				      seqA.annotation(MultipleAlignment::AnnoType::anchors).single_string(),
+				      lenB,
+				      seqB.annotation(MultipleAlignment::AnnoType::anchors).single_string());
+
+	    arc_matches_ = new ArcMatches(rna_dataA,
+					  rna_dataB,
+					  params_.min_prob,
+					  params_.max_diff_am!=-1
+					  ? (size_type)params_.max_diff_am
+					  : std::max(lenA,lenB),
+					  params_.max_diff_at_am!=-1
+					  ? (size_type)params_.max_diff_at_am
+					  : std::max(lenA,lenB),
+					  *trace_controller_,
+					  *constraints_);
+
+	    scoring_params_ = new ScoringParams(params_.match,
+						params_.mismatch,
+						params_.indel,
+						0, // indel loop score
+						params_.indel_opening,
+						0, // indel opening loop score
+						params_.ribosum,
+						params_.ribofit,
+						params_.unpaired_penalty,
+						params_.struct_weight,
+						params_.tau_factor,
+						params_.exclusion,
+						exp_prob(params_,lenA),
+						exp_prob(params_,lenB),
+						params_.temperature,
+						params_.stacking,
+						params_.new_stacking,
+						false, // no mea scoring
+						0,
+						200,
+						100,
+						10000);
+
+	    scoring_ = new Scoring(seqA,
+				   seqB,
+				   rna_dataA,
+				   rna_dataB,
+				   *arc_matches_,
+				   NULL,
+				   *scoring_params_,
+				   false);
+
+	    // profile alignments run in parallel already; tabulate sequentially
+	    scoring_->precompute_arcmatch_scores(params_.arcmatch_score_memory,1);
+
+	    AlignerParams aligner_params = Aligner::create()
+				   . seqA(seqA)
+				   . seqB(seqB)
+				   . arc_matches(*arc_matches_)
+				   . scoring(*scoring_)
+				   . no_lonely_pairs(params_.no_lonely_pairs)
+				   . struct_local(params_.struct_local)
+				   . sequ_local(params_.sequ_local)
+				   . free_endgaps(params_.free_endgaps)
+				   . max_diff_am(params_.max_diff_am)
+				   . max_diff_at_am(params_.max_diff_at_am)
+				   . trace_controller(*trace_controller_)
+				   . min_am_prob(params_.min_am_prob)
+				   . min_bm_prob(params_.min_bm_prob)
+				   . stacking(params_.stacking || params_.new_stacking)
+				   . constraints(*constraints_)
+				   . score_only(score_only);
+	    if (arena_) {
+		aligner_params.arena(*arena_);
+	    }
+
+	    if (aligner_) {
+		// keeps the capacity of the matrices
+		aligner_->reset(aligner_params);
+	    } else {
+		aligner_ = new Aligner(aligner_params);
+	    }
+	} catch (...) {
+	    free_objects();
+	    throw;
+	}
+    }
+
+    ProfileAlignmentProblem::~ProfileAlignmentProblem() {
+	free_objects();
+    }
+
+    void
+    ProfileAlignmentProblem::free_objects() {
+	delete aligner_;
+	aligner_=NULL;
+	free_pair_objects();
+    }
+
+    void
+    ProfileAlignmentProblem::free_pair_objects() {
+	delete scoring_;
+	delete scoring_params_;
+	delete arc_matches_;
+	delete constraints_;
+	delete trace_controller_;
+	if (pw_reference_) delete pw_reference_;
+	scoring_=NULL;
+	scoring_params_=NULL;
+	arc_matches_=NULL;
+	constraints_=NULL;
+	trace_controller_=NULL;
+	pw_reference_=NULL;
+    }
+
+    infty_score_t
+    ProgressiveAligner::align_profiles(const RnaData &rna_dataA,
+				       const RnaData &rna_dataB,
+				       const ProfileAlignmentParams &params,
+				       const MultipleAlignment *reference,
+				       Alignment::edges_t *edges) {
+	// allocate the D and M matrices of the alignment from the
+	// arena of the (worker) thread, which recycles its memory from
+	// the previous alignment
+	ProfileAlignmentProblem problem(rna_dataA,rna_dataB,params,reference,edges==NULL,
+					&Arena::thread_arena());
+	Aligner &aligner = problem.aligner();
+
+	infty_score_t score = aligner.align();
+
+	if (edges) {
+	    aligner.trace();
+	    *edges = aligner.get_alignment().alignment_edges(false);
+	}
+
+	return score;
+    }
+
+    ProfileDotPlot *
+    ProgressiveAligner::merge_profiles(const ProfileDotPlot &dot_plotA,
+				       const ProfileDotPlot &dot_plotB,
+				       const MultipleAlignment &ma) {
+	std::string alistrA;
+	std::string alistrB;
+	profile_alignment_strings(dot_plotA.sequence(),dot_plotB.sequence(),
+				  ma,alistrA,alistrB);
+
+	return new ProfileDotPlot(dot_plotA,
+				  dot_plotB,
+				  Alignment::edges_t(Alignment::alistr_to_edge_ends(alistrA),
+						     Alignment::alistr_to_edge_ends(alistrB)));
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,514 @@
+#ifndef LOCARNA_PROGRESSIVE_ALIGNER_HH
+#define LOCARNA_PROGRESSIVE_ALIGNER_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+#include <string>
+#include <pthread.h>
+
+#include "aux.hh"
+#include "scoring_fwd.hh"
+#include "matrix.hh"
+#include "guide_tree.hh"
+#include "alignment.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+    class MultipleAlignment;
+    class RibosumFreq;
+    class Ribofit;
+    class ThreadPool;
+    class ProfileDotPlot;
+    class ScoringParams;
+    class ArcMatches;
+    class Aligner;
+    class TraceController;
+    class AnchorConstraints;
+    class LibraryExtension;
+    class PairPrefilter;
+    class Arena;
+
+    /**
+     * @brief Parameters for the pairwise profile alignments of the
+     * progressive aligner
+     *
+     * The members mirror the scoring, locality and heuristic options
+     * of the locarna executable; defaults are the locarna defaults.
+     */
+    struct ProfileAlignmentParams {
+	score_t match; //!< match score
+	score_t mismatch; //!< mismatch score
+	score_t indel; //!< indel extension score
+	score_t indel_opening; //!< indel opening score
+	score_t unpaired_penalty; //!< penalty for unpaired bases
+	score_t struct_weight; //!< maximal weight of 1/2 arc match
+	score_t tau_factor; //!< tau factor in percent
+	score_t exclusion; //!< exclusion weight
+	double temperature; //!< temperature (for exp scores, unused here)
+
+	//! expected base pair probability; if negative, use
+	//! prob_exp_f() of the profile length
+	double exp_prob;
+
+	RibosumFreq *ribosum; //!< ribosum or NULL (not owned)
+	Ribofit *ribofit; //!< ribofit or NULL (not owned)
+
+	bool stacking; //!< use stacking terms
+	bool new_stacking; //!< use new stacking terms
+	bool no_lonely_pairs; //!< no lonely pairs
+	bool struct_local; //!< structure local alignment
+	bool sequ_local; //!< sequence local alignment
+	std::string free_endgaps; //!< free end gap specification
+
+	int max_diff; //!< maximal difference of alignment traces (-1=off)
+	int max_diff_am; //!< maximal difference of matched arc sizes (-1=off)
+	int max_diff_at_am; //!< maximal trace difference at arc matches (-1=off)
+	double min_prob; //!< minimal base pair probability
+	double min_am_prob; //!< minimal arc match probability
+	double min_bm_prob; //!< minimal base match probability
+
+	//! memory budget for precomputed arc match scores in bytes
+	//! (see Scoring::precompute_arcmatch_scores()); 0 for none
+	size_t arcmatch_score_memory;
+
+	//! @brief construct with locarna defaults
+	ProfileAlignmentParams();
+    };
+
+    /**
+     * @brief Set up of the pairwise alignment of two profiles
+     *
+     * Holds the trace controller, anchor constraints, arc matches,
+     * scoring and aligner for aligning two RNAs with
+     * ProfileAlignmentParams, as used by
+     * ProgressiveAligner::align_profiles(). Keeping the objects
+     * allows to reuse the computed matrices after align(), e.g. by
+     * Aligner::align_reusing(). Retargeting the problem to another
+     * pair of RNAs by reset() also keeps the matrices of the aligner.
+     *
+     * @note keeps references to the RNAs and copies the parameters
+     */
+    class ProfileAlignmentProblem {
+	ProfileAlignmentParams params_; //!< parameters
+	Arena *arena_; //!< arena for the matrices of the aligner (or NULL)
+	MultipleAlignment *pw_reference_; //!< pairwise reference (or NULL)
+	TraceController *trace_controller_; //!< trace controller
+	AnchorConstraints *constraints_; //!< anchor constraints
+	ArcMatches *arc_matches_; //!< arc matches
+	ScoringParams *scoring_params_; //!< scoring parameters
+	Scoring *scoring_; //!< scoring
+	Aligner *aligner_; //!< aligner
+
+	//! @brief delete the owned objects
+	void
+	free_objects();
+
+	//! @brief delete the owned objects except for the aligner
+	void
+	free_pair_objects();
+
+	//! @brief set up the objects for a pair of RNAs (see reset())
+	void
+	init(const RnaData &rna_dataA,
+	     const RnaData &rna_dataB,
+	     const MultipleAlignment *reference,
+	     bool score_only);
+
+	//! @brief no copy
+	ProfileAlignmentProblem(const ProfileAlignmentProblem &);
+
+	//! @brief no assignment
+	ProfileAlignmentProblem &
+	operator =(const ProfileAlignmentProblem &);
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param rna_dataA first profile
+	 * @param rna_dataB second profile
+	 * @param params parameters
+	 * @param reference if not NULL, restrict to the alignment of
+	 * the two profiles that is induced by this multiple alignment
+	 * (see ProgressiveAligner::align_profiles())
+	 * @param score_only if true, the aligner computes only the
+	 * score (see AlignerParams::score_only())
+	 * @param arena if not NULL, the D and M matrices of the aligner
+	 * are allocated from this arena of the calling thread (see
+	 * AlignerParams::arena())
+	 */
+	ProfileAlignmentProblem(const RnaData &rna_dataA,
+				const RnaData &rna_dataB,
+				const ProfileAlignmentParams &params,
+				const MultipleAlignment *reference,
+				bool score_only=false,
+				Arena *arena=NULL);
+
+	//! @brief destructor
+	~ProfileAlignmentProblem();
+
+	/**
+	 * @brief Retarget to another pair of profiles
+	 *
+	 * Sets up the problem like on construction with the same
+	 * parameters and arena, however resets the aligner (see
+	 * Aligner::reset()), such that its matrices keep their
+	 * capacity. This avoids memory allocation when aligning many
+	 * pairs in a loop.
+	 *
+	 * @param rna_dataA first profile
+	 * @param rna_dataB second profile
+	 * @param reference if not NULL, restrict to the alignment of
+	 * the two profiles that is induced by this multiple alignment
+	 * @param score_only if true, the aligner computes only the
+	 * score
+	 *
+	 * @note if reset() throws, the problem can only be destroyed
+	 */
+	void
+	reset(const RnaData &rna_dataA,
+	      const RnaData &rna_dataB,
+	      const MultipleAlignment *reference,
+	      bool score_only=false);
+
+	//! @brief arc matches
+	const ArcMatches &
+	arc_matches() const { return *arc_matches_; }
+
+	//! @brief scoring
+	const Scoring &
+	scoring() const { return *scoring_; }
+
+	//! @brief aligner
+	Aligner &
+	aligner() { return *aligner_; }
+
+	//! @brief aligner (read only)
+	const Aligner &
+	aligner() const { return *aligner_; }
+    };
+
+    /**
+     * @brief Progressive multiple alignment of RNAs
+     *
+     * Aligns a set of RNAs (given as RnaData objects, which may
+     * already be alignments) along a guide tree. The profile of each
+     * inner node of the tree is the averaged consensus dot plot of its
+     * children; it is maintained incrementally by ProfileDotPlot, such
+     * that merging two profiles costs O(number of base pairs).
+     * Profiles are kept in memory and never written to or read from
+     * disk.
+     *
+     * Work is distributed over a thread pool: the pairwise alignments
+     * for the score matrix are independent; an inner node of the
+     * guide tree is aligned as soon as both of its children are done,
+     * such that independent subtrees are aligned concurrently.
+     *
+     * Iterative refinement realigns the profiles of each split of the
+     * guide tree. Since realigning two profiles does not change the
+     * alignment within either profile, accepting the realignment of
+     * the split at node x only invalidates the profiles of the
+     * ancestors of x. All other subtree profiles are reused from the
+     * progressive phase; the profiles of the complements and of
+     * invalidated subtrees are rebuilt from cached profiles.
+     *
+     * Typical usage: construct, compute_pairwise_scores() (or
+     * set_pairwise_scores()), build_tree(), align(), refine(), and
+     * finally result().
+     *
+     * @note All input names must be unique.
+     */
+    class ProgressiveAligner {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	//! input RNAs (not owned; owned by library_extension_ after
+	//! library extension)
+	std::vector<const RnaData *> inputs_;
+	ProfileAlignmentParams params_; //!< alignment parameters
+	ThreadPool *pool_; //!< worker pool
+
+	Matrix<double> scores_; //!< pairwise similarity scores
+	bool have_scores_; //!< whether scores_ is set
+	//! library extension of the inputs (or NULL if turned off)
+	LibraryExtension *library_extension_;
+	//! prefilter of the pairs to align (or NULL if turned off)
+	PairPrefilter *prefilter_;
+	size_type prefilter_neighbors_; //!< number of aligned neighbors per RNA
+
+	GuideTree *tree_; //!< guide tree
+
+	//! profile for each tree node; leaves point to inputs_, inner
+	//! nodes are owned (NULL if invalidated by refinement or not
+	//! yet built from dot_plots_)
+	std::vector<const RnaData *> profiles_;
+
+	//! consensus dot plot for each tree node (owned; NULL if
+	//! invalidated by refinement)
+	std::vector<ProfileDotPlot *> dot_plots_;
+
+	//! profiles of the complements of tree nodes (owned); valid for
+	//! the current result only
+	std::vector<const RnaData *> complements_;
+
+	//! consensus dot plots of the complements of tree nodes
+	//! (owned); valid for the current result only
+	std::vector<ProfileDotPlot *> complement_dot_plots_;
+
+	//! profile of the complete alignment
+	const RnaData *result_;
+
+	//! score of the latest alignment yielding result_
+	infty_score_t score_;
+
+	//! remaining unaligned children per inner node (progressive phase)
+	std::vector<size_type> open_children_;
+
+	//! protects open_children_
+	pthread_mutex_t mutex_;
+
+	class PairwiseTask;
+	class NodeTask;
+	class ProfileTask;
+	friend class PairwiseTask;
+	friend class NodeTask;
+
+	//! tasks of the inner nodes (progressive phase)
+	std::vector<NodeTask *> node_tasks_;
+
+	//! whether result_ is owned (and not a node profile)
+	bool result_owned_;
+
+	/**
+	 * @brief estimate the scores of the pairs that are not aligned
+	 *
+	 * @param partners for each RNA i, the sorted RNAs j<i that are
+	 * aligned with i
+	 */
+	void
+	estimate_scores(const std::vector<std::vector<size_type> > &partners);
+
+	//! @brief align the profile of an inner node from its children
+	void
+	align_node(size_type x);
+
+	//! @brief report a finished node; schedule parent if ready
+	void
+	node_done(size_type x);
+
+	//! @brief dot plot of a node in result_; rebuilt if invalidated
+	const ProfileDotPlot &
+	dot_plot(size_type x);
+
+	//! @brief profile of a node in result_; rebuilt if invalidated
+	const RnaData &
+	profile(size_type x);
+
+	//! @brief invalidate the profiles of the proper ancestors of a
+	//! node (except the root)
+	void
+	invalidate_ancestors(size_type x);
+
+	//! @brief dot plot of the complement of a node in result_
+	const ProfileDotPlot &
+	complement_dot_plot(size_type x);
+
+	//! @brief profile of the complement of a node in result_
+	const RnaData &
+	complement(size_type x);
+
+	//! @brief free all complement profiles
+	void
+	clear_complements();
+
+	//! @brief no copy
+	ProgressiveAligner(const ProgressiveAligner &);
+
+	//! @brief no assignment
+	ProgressiveAligner &
+	operator =(const ProgressiveAligner &);
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param inputs input RNAs (must live as long as the aligner)
+	 * @param params parameters of the pairwise profile alignments
+	 * @param num_threads number of threads (0 for number of
+	 * processors)
+	 *
+	 * @throw failure if inputs is empty or names are not unique
+	 */
+	ProgressiveAligner(const std::vector<const RnaData *> &inputs,
+			   const ProfileAlignmentParams &params,
+			   size_type num_threads);
+
+	//! @brief destructor
+	~ProgressiveAligner();
+
+	/**
+	 * @brief Turn on library extension
+	 *
+	 * The pairwise alignments of compute_pairwise_scores() are
+	 * then used to extend the base pair probabilities of the
+	 * inputs (see LibraryExtension); the progressive alignment
+	 * aligns the extended inputs.
+	 *
+	 * @param min_prob minimal probability of base pairs that
+	 * support each other
+	 *
+	 * @pre compute_pairwise_scores() was not called yet
+	 */
+	void
+	set_library_extension(double min_prob);
+
+	/**
+	 * @brief Turn on prefiltering of the pairwise alignments
+	 *
+	 * compute_pairwise_scores() then aligns only the pairs of each
+	 * RNA with its nearest neighbors by the alignment-free
+	 * similarity of PairPrefilter. The scores of all other pairs
+	 * are estimated from their similarities by a linear fit to the
+	 * scores of the aligned pairs. Thus, the number of alignments is
+	 * linear instead of quadratic in the number of RNAs.
+	 *
+	 * @param neighbors number of nearest neighbors per RNA
+	 * @param kmer_length k-mer length of the similarity
+	 * @param struct_weight weight of the structure similarity
+	 *
+	 * @pre compute_pairwise_scores() was not called yet
+	 */
+	void
+	set_prefilter(size_type neighbors, size_type kmer_length, double struct_weight);
+
+	/**
+	 * @brief Compute all pairwise alignment scores (in parallel)
+	 *
+	 * @return matrix of pairwise scores
+	 *
+	 * Extends the inputs if library extension is turned on; then,
+	 * only aligned pairs support each other.
+	 */
+	const Matrix<double> &
+	compute_pairwise_scores();
+
+	/**
+	 * @brief Set pairwise similarity scores
+	 *
+	 * @param scores symmetric matrix of similarity scores
+	 */
+	void
+	set_pairwise_scores(const Matrix<double> &scores);
+
+	//! @brief pairwise similarity scores
+	const Matrix<double> &
+	pairwise_scores() const { return scores_; }
+
+	/**
+	 * @brief Build the guide tree from the pairwise scores
+	 *
+	 * @param method tree construction method
+	 * @return guide tree
+	 *
+	 * Computes pairwise scores, unless they are already available.
+	 */
+	const GuideTree &
+	build_tree(GuideTree::method_t method);
+
+	//! @brief guide tree
+	//! @pre build_tree() was called
+	const GuideTree &
+	tree() const { return *tree_; }
+
+	/**
+	 * @brief Align progressively along the guide tree
+	 *
+	 * @return score of the alignment at the root
+	 *
+	 * Builds the tree by UPGMA, unless build_tree() was called.
+	 */
+	infty_score_t
+	align();
+
+	/**
+	 * @brief Iterative refinement
+	 *
+	 * In each round, realign the two sides of each split of the
+	 * guide tree; accept the realignment if its score improves
+	 * over the score of the current alignment of the split. The
+	 * latter is computed by aligning the same profiles restricted
+	 * to the current alignment (max-diff 0).
+	 *
+	 * @param max_rounds maximal number of rounds
+	 * @return number of accepted realignments
+	 *
+	 * @pre align() was called
+	 */
+	size_type
+	refine(size_type max_rounds);
+
+	/**
+	 * @brief Profile of the complete alignment
+	 *
+	 * @return consensus RNA data; its sequence() is the multiple
+	 * alignment of all inputs
+	 *
+	 * @pre align() was called
+	 */
+	const RnaData &
+	result() const { return *result_; }
+
+	//! @brief score of the latest alignment yielding result()
+	infty_score_t
+	score() const { return score_; }
+
+	/**
+	 * @brief Align two profiles
+	 *
+	 * @param rna_dataA first profile
+	 * @param rna_dataB second profile
+	 * @param params parameters
+	 * @param reference if not NULL, restrict to the alignment of
+	 * the two profiles that is induced by this multiple alignment
+	 * (which must contain all rows of both profiles)
+	 * @param[out] edges if not NULL, trace back and return the
+	 * alignment edges; otherwise, only the score is computed
+	 * (with the smaller working set of score-only alignment)
+	 *
+	 * @return alignment score
+	 */
+	static
+	infty_score_t
+	align_profiles(const RnaData &rna_dataA,
+		       const RnaData &rna_dataB,
+		       const ProfileAlignmentParams &params,
+		       const MultipleAlignment *reference,
+		       Alignment::edges_t *edges);
+
+	/**
+	 * @brief Merge two profiles according to a multiple alignment
+	 *
+	 * @param dot_plotA first profile
+	 * @param dot_plotB second profile
+	 * @param ma multiple alignment containing all rows of both
+	 * profiles, such that its projections to the rows of the
+	 * profiles are the profile alignments
+	 *
+	 * @return consensus dot plot (caller owns the object)
+	 * @throw failure if ma is inconsistent with the profiles
+	 */
+	static
+	ProfileDotPlot *
+	merge_profiles(const ProfileDotPlot &dot_plotA,
+		       const ProfileDotPlot &dot_plotB,
+		       const MultipleAlignment &ma);
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_PROGRESSIVE_ALIGNER_HH
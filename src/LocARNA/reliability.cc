@@ -0,0 +1,232 @@
+#include "reliability.hh"
+
+#include <iostream>
+#include <sstream>
+
+#include "aux.hh"
+#include "multiple_alignment.hh"
+#include "consistency.hh"
+#include "rna_data.hh"
+#include "basepairs.hh"
+#include "thread_pool.hh"
+
+namespace LocARNA {
+
+    //! @brief task of collecting the contributions of one pair of sequences
+    class ReliabilityTask : public ThreadPool::Task {
+    public:
+	typedef ReliabilityProfile::size_type size_type; //!< size type
+
+	//! contribution of a base match to a column
+	typedef std::pair<size_type,double> bm_contrib_t;
+
+	//! contribution of an arc match to a pair of columns
+	typedef std::pair<std::pair<size_type,size_type>,double> am_contrib_t;
+
+	size_type a_; //!< first sequence
+	size_type b_; //!< second sequence
+	std::vector<bm_contrib_t> bm_contribs_; //!< base match contributions
+	std::vector<am_contrib_t> am_contribs_; //!< arc match contributions
+
+    private:
+	const ReliabilityProfile *profile_;
+	const MatchProbsSet *bm_probs_;
+	const MatchProbsSet *am_probs_;
+
+	//! @brief column of a position (0 if out of range)
+	size_type
+	col(size_type s, size_type pos) const {
+	    const std::vector<size_type> &pos2col = profile_->pos2col_[s];
+	    return pos<pos2col.size() ? pos2col[pos] : 0;
+	}
+
+    public:
+	//! @brief construct for pair (a,b)
+	ReliabilityTask(const ReliabilityProfile *profile,
+			const MatchProbsSet *bm_probs,
+			const MatchProbsSet *am_probs,
+			size_type a, size_type b)
+	    : a_(a), b_(b),
+	      profile_(profile), bm_probs_(bm_probs), am_probs_(am_probs)
+	{}
+
+	void
+	run() {
+	    // base matches of the pair that are aligned by the alignment
+	    const MatchProbsSet::rows_t &bm_rows = bm_probs_->rows(a_,b_);
+	    for (size_type x=0; x<bm_rows.size(); ++x) {
+		size_type i = col(a_,x);
+		if (i==0) continue;
+		for (MatchProbsSet::row_t::const_iterator it=bm_rows[x].begin();
+		     bm_rows[x].end()!=it; ++it) {
+		    if (col(b_,it->first)==i) {
+			bm_contribs_.push_back(bm_contrib_t(i,it->second));
+		    }
+		}
+	    }
+
+	    if (am_probs_==NULL) return;
+
+	    // arc matches of the pair that are aligned by the alignment
+	    const MatchProbsSet::rows_t &am_rows = am_probs_->rows(a_,b_);
+	    for (size_type x=0; x<am_rows.size(); ++x) {
+		const MatchProbsSet::arc_t &arcA = am_probs_->arc(a_,x);
+		size_type i = col(a_,arcA.first);
+		size_type j = col(a_,arcA.second);
+		if (i==0 || j==0) continue;
+		for (MatchProbsSet::row_t::const_iterator it=am_rows[x].begin();
+		     am_rows[x].end()!=it; ++it) {
+		    const MatchProbsSet::arc_t &arcB = am_probs_->arc(b_,it->first);
+		    if (col(b_,arcB.first)==i && col(b_,arcB.second)==j) {
+			am_contribs_.push_back(am_contrib_t(std::make_pair(i,j),it->second));
+		    }
+		}
+	    }
+	}
+    };
+
+    ReliabilityProfile::ReliabilityProfile(const MultipleAlignment &ma,
+					   const MatchProbsSet &bm_probs,
+					   const MatchProbsSet *am_probs,
+					   size_type num_threads)
+	: length_(ma.length()),
+	  num_seqs_(ma.num_of_rows()),
+	  seq_rel_(length_+1,0.0),
+	  str_rel_(length_+1,0.0),
+	  arc_rel_(),
+	  single_seq_rel_(num_seqs_,column_rel_t(length_+1,0.0)),
+	  single_str_rel_(num_seqs_,column_rel_t(length_+1,0.0)),
+	  single_arc_rel_(num_seqs_),
+	  pos2col_(num_seqs_)
+    {
+	if (bm_probs.num_seqs()!=num_seqs_
+	    || (am_probs!=NULL && am_probs->num_seqs()!=num_seqs_)) {
+	    std::ostringstream err;
+	    err << "ReliabilityProfile: match probabilities of "<<bm_probs.num_seqs()
+		<<" sequences do not fit alignment of "<<num_seqs_<<" sequences.";
+	    throw failure(err.str());
+	}
+
+	// map positions to columns once, since
+	// SeqEntry::pos_to_col() takes linear time
+	for (size_type s=0; s<num_seqs_; ++s) {
+	    const string1 &seq = ma.seqentry(s).seq();
+	    pos2col_[s].push_back(0);
+	    for (size_type col=1; col<=length_; ++col) {
+		if (!is_gap_symbol(seq[col])) {
+		    pos2col_[s].push_back(col);
+		}
+	    }
+	}
+
+	std::vector<ReliabilityTask> tasks;
+	for (size_type a=0; a<num_seqs_; ++a) {
+	    for (size_type b=a+1; b<num_seqs_; ++b) {
+		tasks.push_back(ReliabilityTask(this,&bm_probs,am_probs,a,b));
+	    }
+	}
+
+	ThreadPool pool(num_threads);
+	for (size_type k=0; k<tasks.size(); ++k) {
+	    pool.submit(&tasks[k]);
+	}
+	pool.wait();
+
+	// sum up the contributions in the order of the pairs, such
+	// that the result does not depend on the number of threads
+	for (size_type k=0; k<tasks.size(); ++k) {
+	    const ReliabilityTask &task = tasks[k];
+	    size_type a = task.a_;
+	    size_type b = task.b_;
+
+	    for (std::vector<ReliabilityTask::bm_contrib_t>::const_iterator it=task.bm_contribs_.begin();
+		 task.bm_contribs_.end()!=it; ++it) {
+		seq_rel_[it->first] += it->second;
+		single_seq_rel_[a][it->first] += it->second;
+		single_seq_rel_[b][it->first] += it->second;
+	    }
+
+	    for (std::vector<ReliabilityTask::am_contrib_t>::const_iterator it=task.am_contribs_.begin();
+		 task.am_contribs_.end()!=it; ++it) {
+		size_type i = it->first.first;
+		size_type j = it->first.second;
+		double p = it->second;
+
+		arc_rel_[it->first] += p;
+		str_rel_[i] += p;
+		str_rel_[j] += p;
+
+		single_arc_rel_[a][it->first] += p;
+		single_arc_rel_[b][it->first] += p;
+		single_str_rel_[a][i] += p;
+		single_str_rel_[a][j] += p;
+		single_str_rel_[b][i] += p;
+		single_str_rel_[b][j] += p;
+	    }
+	}
+
+	// normalize
+	if (num_seqs_<2) return;
+
+	double num_pairs = num_seqs_*(num_seqs_-1)/2;
+	for (size_type i=1; i<=length_; ++i) {
+	    seq_rel_[i] /= num_pairs;
+	    str_rel_[i] /= num_pairs;
+	}
+	for (arc_rel_t::iterator it=arc_rel_.begin(); arc_rel_.end()!=it; ++it) {
+	    it->second /= num_pairs;
+	}
+
+	for (size_type s=0; s<num_seqs_; ++s) {
+	    for (size_type i=1; i<=length_; ++i) {
+		single_seq_rel_[s][i] /= num_seqs_-1;
+		single_str_rel_[s][i] /= num_seqs_-1;
+	    }
+	    // arc reliabilities of single sequences include the base
+	    // pair probabilities, i.e. one more summand per pair
+	    for (arc_rel_t::iterator it=single_arc_rel_[s].begin(); single_arc_rel_[s].end()!=it; ++it) {
+		it->second /= num_seqs_;
+	    }
+	}
+    }
+
+    void
+    ReliabilityProfile::add_pair_probs(size_type row, const RnaData &rna_data, double min_prob) {
+	const std::vector<size_type> &pos2col = pos2col_[row];
+	if (rna_data.length()+1 != pos2col.size()) {
+	    throw failure("ReliabilityProfile: RNA data does not fit the sequence in the alignment.");
+	}
+
+	BasePairs bps(&rna_data,min_prob);
+	for (size_type idx=0; idx<bps.num_bps(); ++idx) {
+	    const BasePairs::Arc &arc = bps.arc(idx);
+	    double p = rna_data.arc_prob(arc.left(),arc.right());
+	    if (p==0.0) continue;
+	    single_arc_rel_[row][std::make_pair(pos2col[arc.left()],pos2col[arc.right()])]
+		+= p / num_seqs_;
+	}
+    }
+
+    std::ostream &
+    ReliabilityProfile::write_column_rel(std::ostream &out,
+					 const column_rel_t &seq_rel,
+					 const column_rel_t &str_rel) {
+	std::streamsize precision = out.precision(15);
+	for (size_type i=1; i<seq_rel.size(); ++i) {
+	    out << i << " " << seq_rel[i] << " " << str_rel[i] << std::endl;
+	}
+	out.precision(precision);
+	return out;
+    }
+
+    std::ostream &
+    ReliabilityProfile::write_arc_rel(std::ostream &out, const arc_rel_t &arc_rel) {
+	std::streamsize precision = out.precision(15);
+	for (arc_rel_t::const_iterator it=arc_rel.begin(); arc_rel.end()!=it; ++it) {
+	    out << it->first.first << " " << it->first.second << " " << it->second << std::endl;
+	}
+	out.precision(precision);
+	return out;
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,172 @@
+#ifndef LOCARNA_RELIABILITY_HH
+#define LOCARNA_RELIABILITY_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <iosfwd>
+#include <vector>
+#include <map>
+#include <utility>
+
+namespace LocARNA {
+
+    class MultipleAlignment;
+    class MatchProbsSet;
+    class RnaData;
+    class ReliabilityTask;
+
+    /**
+     * @brief Reliabilities of a multiple alignment
+     *
+     * Computes the column reliabilities of a multiple alignment from
+     * the base and arc match probabilities of all pairs of its
+     * sequences (as computed by AlignerP), as formerly done by
+     * mlocarna in Perl:
+     *
+     * - the sequence reliability of a column is the sum of the base
+     *   match probabilities of all pairs of bases in this column,
+     * - the structure reliability of a column is the sum of the arc
+     *   match probabilities of all pairs of arcs with one end in the
+     *   column, where the arcs are aligned by the alignment,
+     * - the arc reliability of two columns is the sum of the arc
+     *   match probabilities of the pairs of arcs between these
+     *   columns,
+     *
+     * each normalized by the number of sequence pairs. Moreover, for
+     * each single sequence, the reliabilities are computed from the
+     * probabilities of the pairs with this sequence only (normalized
+     * by the number of other sequences). Arc reliabilities of single
+     * sequences additionally contain the base pair probabilities of
+     * the sequence itself (see add_pair_probs()); then they are
+     * normalized by the number of sequences.
+     *
+     * The pairs of sequences are processed in parallel.
+     *
+     * @note columns are 1-based, vector entries at index 0 are unused
+     */
+    class ReliabilityProfile {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! column reliabilities, indexed by columns
+	typedef std::vector<double> column_rel_t;
+
+	//! arc reliabilities, indexed by pairs of columns
+	typedef std::map<std::pair<size_type,size_type>,double> arc_rel_t;
+
+    private:
+	size_type length_; //!< length of the alignment
+	size_type num_seqs_; //!< number of sequences
+
+	column_rel_t seq_rel_; //!< sequence reliabilities
+	column_rel_t str_rel_; //!< structure reliabilities
+	arc_rel_t arc_rel_; //!< arc reliabilities
+
+	std::vector<column_rel_t> single_seq_rel_; //!< sequence reliabilities of single sequences
+	std::vector<column_rel_t> single_str_rel_; //!< structure reliabilities of single sequences
+	std::vector<arc_rel_t> single_arc_rel_; //!< arc reliabilities of single sequences
+
+	//! for each sequence, the alignment columns of its positions
+	std::vector<std::vector<size_type> > pos2col_;
+
+	friend class ReliabilityTask;
+
+    public:
+	/**
+	 * @brief Compute reliabilities
+	 *
+	 * @param ma multiple alignment
+	 * @param bm_probs base match probabilities
+	 * @param am_probs arc match probabilities (NULL for none)
+	 * @param num_threads number of threads (0 for number of processors)
+	 *
+	 * @pre the sequences of the probability sets are the rows of
+	 * ma in the same order
+	 *
+	 * @throw failure if the probabilities do not fit the alignment
+	 */
+	ReliabilityProfile(const MultipleAlignment &ma,
+			   const MatchProbsSet &bm_probs,
+			   const MatchProbsSet *am_probs,
+			   size_type num_threads);
+
+	//! @brief length of the alignment
+	size_type
+	length() const {return length_;}
+
+	//! @brief sequence reliabilities
+	const column_rel_t &
+	seq_rel() const {return seq_rel_;}
+
+	//! @brief structure reliabilities
+	const column_rel_t &
+	str_rel() const {return str_rel_;}
+
+	//! @brief arc reliabilities
+	const arc_rel_t &
+	arc_rel() const {return arc_rel_;}
+
+	//! @brief sequence reliabilities of a single sequence
+	//! @param row row of the sequence in the alignment
+	const column_rel_t &
+	single_seq_rel(size_type row) const {return single_seq_rel_[row];}
+
+	//! @brief structure reliabilities of a single sequence
+	//! @param row row of the sequence in the alignment
+	const column_rel_t &
+	single_str_rel(size_type row) const {return single_str_rel_[row];}
+
+	//! @brief arc reliabilities of a single sequence
+	//! @param row row of the sequence in the alignment
+	const arc_rel_t &
+	single_arc_rel(size_type row) const {return single_arc_rel_[row];}
+
+	/**
+	 * @brief Add base pair probabilities to the arc reliabilities
+	 * of a single sequence
+	 *
+	 * @param row row of the sequence in the alignment
+	 * @param rna_data RNA data of the sequence
+	 * @param min_prob minimal probability of added base pairs
+	 *
+	 * @note call at most once per sequence
+	 */
+	void
+	add_pair_probs(size_type row, const RnaData &rna_data, double min_prob);
+
+	/**
+	 * @brief Write column reliabilities
+	 *
+	 * Writes lines "column sequence-reliability
+	 * structure-reliability".
+	 *
+	 * @param out output stream
+	 * @param seq_rel sequence reliabilities
+	 * @param str_rel structure reliabilities
+	 * @return stream
+	 */
+	static
+	std::ostream &
+	write_column_rel(std::ostream &out,
+			 const column_rel_t &seq_rel,
+			 const column_rel_t &str_rel);
+
+	/**
+	 * @brief Write arc reliabilities
+	 *
+	 * Writes lines "column column reliability".
+	 *
+	 * @param out output stream
+	 * @param arc_rel arc reliabilities
+	 * @return stream
+	 */
+	static
+	std::ostream &
+	write_arc_rel(std::ostream &out, const arc_rel_t &arc_rel);
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_RELIABILITY_HH
@@ -0,0 +1,53 @@
+#include "reverse_strand.hh"
+
+#include "rna_data.hh"
+#include "rna_ensemble.hh"
+#include "sequence.hh"
+#include "multiple_alignment.hh"
+
+namespace LocARNA {
+
+    ReverseStrand::ReverseStrand(const RnaData &forward,
+				 double p_bpcut,
+				 double max_bps_length_ratio,
+				 const PFoldParams &pfoldparams)
+	: forward_(forward),
+	  p_bpcut_(p_bpcut),
+	  max_bps_length_ratio_(max_bps_length_ratio),
+	  pfoldparams_(pfoldparams),
+	  sequence_(NULL),
+	  rna_data_(NULL)
+    {}
+
+    ReverseStrand::~ReverseStrand() {
+	if (rna_data_) delete rna_data_;
+	if (sequence_) delete sequence_;
+    }
+
+    const Sequence &
+    ReverseStrand::sequence() const {
+	if (sequence_==NULL) {
+	    sequence_ = new MultipleAlignment(forward_.sequence());
+	    sequence_->reverse_complement();
+	}
+	return sequence_->as_sequence();
+    }
+
+    const RnaData &
+    ReverseStrand::rna_data() const {
+	if (rna_data_==NULL) {
+	    RnaEnsemble rna_ensemble(sequence(),pfoldparams_,false,true);
+	    rna_data_ = new RnaData(rna_ensemble,
+				    p_bpcut_,
+				    max_bps_length_ratio_,
+				    pfoldparams_);
+	}
+	return *rna_data_;
+    }
+
+    ReverseStrand::size_type
+    ReverseStrand::forward_position(size_type pos) const {
+	return forward_.length()+1-pos;
+    }
+
+} // end namespace LocARNA
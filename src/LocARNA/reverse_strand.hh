@@ -0,0 +1,98 @@
+#ifndef LOCARNA_REVERSE_STRAND_HH
+#define LOCARNA_REVERSE_STRAND_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "aux.hh"
+#include "pfold_params.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+    class Sequence;
+    class MultipleAlignment;
+
+    /**
+     * @brief Lazy view on the reverse complement strand of an RNA
+     *
+     * The view is constructed from the RnaData of the forward
+     * strand. The reverse complement sequence is generated on first
+     * access. Since the base pairs of the reverse strand are
+     * unrelated to the ones of the forward strand, the RnaData of
+     * the reverse strand is predicted by folding the reverse
+     * complement; this is done only when it is requested.
+     *
+     * @note the view is not thread-safe; request rna_data() before
+     * sharing it between threads.
+     */
+    class ReverseStrand {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	const RnaData &forward_; //!< forward strand
+	double p_bpcut_; //!< cutoff probability for the reverse strand
+	double max_bps_length_ratio_; //!< filter for the reverse strand base pairs
+	PFoldParams pfoldparams_; //!< folding parameters
+
+	mutable MultipleAlignment *sequence_; //!< reverse complement (or NULL)
+	mutable RnaData *rna_data_; //!< data of the reverse strand (or NULL)
+
+	//! @brief no copy
+	ReverseStrand(const ReverseStrand &);
+
+	//! @brief no assignment
+	ReverseStrand &
+	operator =(const ReverseStrand &);
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param forward the forward strand
+	 * @param p_bpcut cutoff probability for the reverse strand
+	 * @param max_bps_length_ratio maximal ratio of base pairs per
+	 * sequence length for the reverse strand (0 for no effect)
+	 * @param pfoldparams parameters for folding the reverse strand
+	 *
+	 * @note keeps a reference to forward
+	 */
+	ReverseStrand(const RnaData &forward,
+		      double p_bpcut,
+		      double max_bps_length_ratio,
+		      const PFoldParams &pfoldparams);
+
+	//! @brief destructor
+	~ReverseStrand();
+
+	/**
+	 * @brief Sequence of the reverse strand
+	 * @return reverse complement of the forward sequence
+	 */
+	const Sequence &
+	sequence() const;
+
+	/**
+	 * @brief RNA data of the reverse strand
+	 *
+	 * Folds the reverse strand on first call.
+	 *
+	 * @return RNA data of the reverse complement
+	 */
+	const RnaData &
+	rna_data() const;
+
+	/**
+	 * @brief Position on the forward strand
+	 * @param pos position on the reverse strand (1-based)
+	 * @return corresponding position on the forward strand
+	 */
+	size_type
+	forward_position(size_type pos) const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_REVERSE_STRAND_HH
@@ -16,6 +16,7 @@
 #include "rna_data_impl.hh"
 #include "ext_rna_data_impl.hh"
 #include "rna_structure.hh"
+#include "profile_dot_plot.hh"
 
 #include "LocARNA/global_stopwatch.hh"
 
@@ -69,6 +70,31 @@ namespace LocARNA {
 
     }
     
+    // construct from incrementally computed consensus dot plot
+    RnaData::RnaData(const ProfileDotPlot &dot_plot)
+	: pimpl_(new RnaDataImpl(this,
+				 dot_plot.arc_cutoff_prob())) {
+	pimpl_->init_from_profile_dot_plot(dot_plot);
+    }
+
+    RnaData::RnaData(const RnaData &rna_data,
+		     const arc_prob_matrix_t &arc_probs)
+	: pimpl_(new RnaDataImpl(this,
+				 rna_data.arc_cutoff_prob())) {
+	pimpl_->sequence_ = rna_data.pimpl_->sequence_;
+	pimpl_->arc_probs_ = arc_probs;
+	pimpl_->has_stacking_ = rna_data.pimpl_->has_stacking_;
+	if (pimpl_->has_stacking_) {
+	    const arc_prob_matrix_t &arc_2_probs = rna_data.pimpl_->arc_2_probs_;
+	    for (arc_prob_matrix_t::const_iterator it=arc_2_probs.begin();
+		 arc_2_probs.end()!=it; ++it) {
+		if (arc_probs(it->first.first,it->first.second)!=0.0) {
+		    pimpl_->arc_2_probs_.set(it->first.first,it->first.second,it->second);
+		}
+	    }
+	}
+    }
+
     // do almost nothing
     RnaData::RnaData(double p_bpcut)
 	: pimpl_(new RnaDataImpl(this,
@@ -105,6 +131,37 @@ namespace LocARNA {
 	pimpl_->sequence_.set_annotation(MultipleAlignment::AnnoType::anchors,anchors);
     }
 
+    //! @brief snap entries of a sparse probability matrix (see
+    //! RnaData::snap_probabilities())
+    static
+    void
+    snap_probability_matrix(RnaData::arc_prob_matrix_t &probs,
+			    const RnaData::arc_prob_matrix_t &reference,
+			    double tolerance) {
+	typedef RnaData::arc_prob_matrix_t::key_t key_t;
+	std::vector<std::pair<key_t,double> > snapped;
+	for (RnaData::arc_prob_matrix_t::const_iterator it=probs.begin();
+	     probs.end()!=it; ++it) {
+	    double p_ref = reference(it->first.first,it->first.second);
+	    if (p_ref!=0 && p_ref!=it->second
+		&& fabs(p_ref-it->second)<=tolerance) {
+		snapped.push_back(std::make_pair(it->first,p_ref));
+	    }
+	}
+	for (size_t k=0; k<snapped.size(); ++k) {
+	    probs.set(snapped[k].first.first,snapped[k].first.second,snapped[k].second);
+	}
+    }
+
+    void
+    RnaData::snap_probabilities(const RnaData &reference, double tolerance) {
+	assert(length()==reference.length());
+	snap_probability_matrix(pimpl_->arc_probs_,reference.pimpl_->arc_probs_,tolerance);
+	if (has_stacking() && reference.has_stacking()) {
+	    snap_probability_matrix(pimpl_->arc_2_probs_,reference.pimpl_->arc_2_probs_,tolerance);
+	}
+    }
+
     // "consensus" constructor
     RnaDataImpl::RnaDataImpl(RnaData *self,
 			     const RnaData &rna_dataA,
@@ -160,12 +217,14 @@ namespace LocARNA {
     	
 	if (!complete) {
 	    // recompute all probabilities
-	    RnaEnsemble 
-		rna_ensemble(sequence(),
-			     pfoldparams,true,true); // use given parameters, in-loop, use alifold
+	    RnaEnsemble *rna_ensemble =
+		new RnaEnsemble(sequence(),
+				pfoldparams,true,true); // use given parameters, in-loop, use alifold
 	    
-	    // initialize
-	    init_from_rna_ensemble(rna_ensemble,pfoldparams);
+	    // initialize; in loop probabilities are computed on
+	    // demand, which transfers ownership of the ensemble
+	    RnaData::init_from_rna_ensemble(*rna_ensemble,pfoldparams);
+	    ext_pimpl_->init_lazy_from_ext_rna_ensemble(rna_ensemble);
 	}
 	
 	if (max_bps_length_ratio > 0) {
@@ -180,6 +239,8 @@ namespace LocARNA {
 
     }
 
+    const size_t ExtRnaDataImpl::no_loop;
+
     ExtRnaDataImpl::ExtRnaDataImpl(ExtRnaData *self,
 				   double p_bpilcut,
 				   double p_uilcut)
@@ -188,8 +249,21 @@ namespace LocARNA {
 	 p_uilcut_(p_uilcut),
 	 arc_in_loop_probs_(arc_prob_matrix_t(0.0)),
 	 unpaired_in_loop_probs_(arc_prob_vector_t(0.0)),
-	 has_in_loop_probs_(false)
+	 has_in_loop_probs_(false),
+	 rna_ensemble_(NULL),
+	 right_ends_(),
+	 lazy_loop_idx_(no_loop),
+	 in_loop_computed_(),
+	 lazy_bpil_length_ratio_(0.0)
     {
+	pthread_mutex_init(&mutex_,NULL);
+    }
+
+    ExtRnaDataImpl::~ExtRnaDataImpl() {
+	if (rna_ensemble_) {
+	    delete rna_ensemble_;
+	}
+	pthread_mutex_destroy(&mutex_);
     }
 
     ExtRnaData::ExtRnaData(const RnaEnsemble &rna_ensemble,
@@ -500,11 +574,15 @@ namespace LocARNA {
 	sequence_ = rna_ensemble.multiple_alignment();
 	size_t len = sequence_.length();
 
+	// for bounded span, visit only the band of potential base pairs
+	size_t max_span = rna_ensemble.max_bp_span();
+	
 	// ----------------------------------------
 	// init base pair probabilities
 	arc_probs_.clear();
 	for( size_t i=1; i <= len; i++ ) {
-	    for( size_t j=i+TURN+1; j <= len; j++ ) {
+	    size_t max_j = (max_span>0) ? std::min(len,i+max_span) : len;
+	    for( size_t j=i+TURN+1; j <= max_j; j++ ) {
 		
 		double p = rna_ensemble.arc_prob(i,j);
 		
@@ -531,10 +609,11 @@ namespace LocARNA {
 	// ----------------------------------------
 	// init stacking probabilities
 	arc_2_probs_.clear();
-	has_stacking_ = pfoldparams.stacking();	
+	has_stacking_ = pfoldparams.stacking() && rna_ensemble.has_stacking_probs();
 	if (has_stacking_) {
 	    for( size_t i=1; i <= len; i++ ) {
-		for( size_t j=i+TURN+3; j <= len; j++ ) {
+		size_t max_j = (max_span>0) ? std::min(len,i+max_span) : len;
+		for( size_t j=i+TURN+3; j <= max_j; j++ ) {
 		    double p2 = rna_ensemble.arc_2_prob(i,j);
 		    if (p2 > p_bpcut_) { // apply filter to joint probability !
 			arc_2_probs_(i,j)=p2;
@@ -548,122 +627,93 @@ namespace LocARNA {
     }
 
     void
-    ExtRnaDataImpl::init_from_ext_rna_ensemble(const RnaEnsemble &rna_ensemble) {
-	// initialize in loop probabilities
-	// (usually, this is called after RnaDataImpl::init_from_rna_ensemble)
-	assert(rna_ensemble.has_in_loop_probs());
-
-	size_t len = self_->length();
-	
-	// ----------------------------------------
-	// init base pair probabilities
-	arc_in_loop_probs_.clear();
-	
-	// ------------------------------
-	// construct helper data structure for efficiency:
+    ExtRnaDataImpl::init_right_ends() {
 	// map left ends to right ends of all arcs in arc_probs_
-	std::vector<std::vector<size_t> > right_ends;
-	right_ends.resize(len+1);
+	right_ends_.clear();
+	right_ends_.resize(self_->length()+1);
 	for(arc_prob_matrix_t::const_iterator it = self_->arc_probs_begin();
 	    self_->arc_probs_end()!=it; ++it) {
 	    pos_type i = it->first.first;
 	    pos_type j = it->first.second;
-	    right_ends[i].push_back(j);
+	    right_ends_[i].push_back(j);
 	}
-	for(std::vector<std::vector<size_t> >::iterator it = right_ends.begin();
-	    right_ends.end()!=it; ++it) {
+	for(std::vector<std::vector<size_t> >::iterator it = right_ends_.begin();
+	    right_ends_.end()!=it; ++it) {
 	    sort(it->begin(),it->end());
 	}
-	// end constructing helper data structure
-
-	// in loop
-	for(arc_prob_matrix_t::const_iterator it = self_->arc_probs_begin();
-	    self_->arc_probs_end()!=it; ++it) {
-	    pos_type i = it->first.first;
-	    pos_type j = it->first.second;
-	    arc_prob_matrix_t m_ij(0.0);
-	    
-	    for(size_t ip=i+1; ip < j; ip++ ) {
-		// for( size_t jp=ip+TURN+1; jp < j; jp++ ) {
-		for(std::vector<size_t>::const_iterator jpit = right_ends[ip].begin();
-		    right_ends[ip].end()!=jpit && *jpit<j; ++jpit) {
-		    size_t jp = *jpit;
-
-		    double p = rna_ensemble.arc_in_loop_prob(ip,jp,i,j);
-		    
-	    	    if ( p > p_bpilcut_ ) {
-	    		m_ij(ip,jp)=p;
-	    	    }
-	    	}
-	    }
+    }
 
-	    
-	    // set only if not empty; use set instead of assignment,
-	    // to avoid the comparison of complex SparseMatrix objects
-	    if (!m_ij.empty()) {
-		arc_in_loop_probs_.set(i,j,m_ij);
-	    }
-	}
+    void
+    ExtRnaDataImpl::compute_in_loop_probs(const RnaEnsemble &rna_ensemble,
+					  size_t i, size_t j) {
+	// the external loop is represented by (0,len+1)
+	bool external = (i==0);
 
-	// external
-	arc_prob_matrix_t m_ext(0.0);
-	for( size_t ip=1; ip < len; ip++ ) {
-	    for(std::vector<size_t>::const_iterator jpit = right_ends[ip].begin();
-		right_ends[ip].end()!=jpit; ++jpit) {
+	// ----------------------------------------
+	// base pairs in loop
+	arc_prob_matrix_t m_ij(0.0);
+	
+	for(size_t ip=i+1; ip < j; ip++ ) {
+	    // for( size_t jp=ip+TURN+1; jp < j; jp++ ) {
+	    for(std::vector<size_t>::const_iterator jpit = right_ends_[ip].begin();
+		right_ends_[ip].end()!=jpit && *jpit<j; ++jpit) {
 		size_t jp = *jpit;
 
-		double p = rna_ensemble.arc_external_prob(ip,jp);
+		double p = external
+		    ? rna_ensemble.arc_external_prob(ip,jp)
+		    : rna_ensemble.arc_in_loop_prob(ip,jp,i,j);
 		
 		if ( p > p_bpilcut_ ) {
-		    m_ext(ip,jp) = p;
+		    m_ij(ip,jp)=p;
 		}
 	    }
 	}
-
-	// set only if not empty; see above
-	if (!m_ext.empty()) {
-	    arc_in_loop_probs_.set(0,self_->length()+1,m_ext);
+	
+	// set only if not empty; use set instead of assignment,
+	// to avoid the comparison of complex SparseMatrix objects
+	if (!m_ij.empty()) {
+	    arc_in_loop_probs_.set(i,j,m_ij);
 	}
 	
 	// ----------------------------------------
-	// init unpaired probabilities
+	// unpaired bases in loop
+	arc_prob_vector_t v_ij(0.0);
+	
+	for( size_t k=i+1; k < j; k++ ) {
+	    double p = external
+		? rna_ensemble.unpaired_external_prob(k)
+		: rna_ensemble.unpaired_in_loop_prob(k,i,j);
+	    if ( p > p_uilcut_ ) {
+		v_ij[k] = p;
+	    }
+	}
+	
+	// set only if not empty; see above
+	if (!v_ij.empty()) {
+	    unpaired_in_loop_probs_.set(i,j,v_ij);
+	}
+    }
+
+    void
+    ExtRnaDataImpl::init_from_ext_rna_ensemble(const RnaEnsemble &rna_ensemble) {
+	// initialize in loop probabilities
+	// (usually, this is called after RnaDataImpl::init_from_rna_ensemble)
+	assert(rna_ensemble.has_in_loop_probs());
+
+	arc_in_loop_probs_.clear();
 	unpaired_in_loop_probs_.clear();
 	
+	// construct helper data structure for efficiency
+	init_right_ends();
+
 	// in loop
 	for(arc_prob_matrix_t::const_iterator it = self_->arc_probs_begin();
 	    self_->arc_probs_end()!=it; ++it) {
-	    pos_type i = it->first.first;
-	    pos_type j = it->first.second;
-	    arc_prob_vector_t v_ij(0.0);
-	    
-	    for( size_t k=i+1; k < j; k++ ) {
-		double p = rna_ensemble.unpaired_in_loop_prob(k,i,j);
-		if ( p > p_uilcut_ ) {
-		    v_ij[k] = p;
-		}
-	    }
-	    
-	    // set only if not empty; see above
-	    if (!v_ij.empty()) {
-		unpaired_in_loop_probs_.set(i,j,v_ij);
-	    }
+	    compute_in_loop_probs(rna_ensemble,it->first.first,it->first.second);
 	}
 
 	// external
-	arc_prob_vector_t v_ext(0.0);
-	for( size_t k=1; k <= len; k++ ) {
-	    double p = rna_ensemble.unpaired_external_prob(k);
-	    
-	    if ( p > p_uilcut_ ) {
-		v_ext[k] = p;
-	    }
-	}
-
-	// set only if not empty; see above
-	if (!v_ext.empty()) {
-	    unpaired_in_loop_probs_.set(0,self_->length()+1,v_ext);
-	}
-	
+	compute_in_loop_probs(rna_ensemble,0,self_->length()+1);
 	
 	// set flag
 	has_in_loop_probs_=true;
@@ -672,6 +722,113 @@ namespace LocARNA {
 	return;
     } // end method init_from_ext_rna_ensemble
 
+    void
+    ExtRnaDataImpl::init_lazy_from_ext_rna_ensemble(RnaEnsemble *rna_ensemble) {
+	assert(rna_ensemble->has_in_loop_probs());
+
+	if (rna_ensemble_) {
+	    delete rna_ensemble_;
+	}
+	rna_ensemble_ = rna_ensemble;
+
+	arc_in_loop_probs_.clear();
+	unpaired_in_loop_probs_.clear();
+	lazy_loop_idx_.clear();
+	in_loop_computed_.clear();
+
+	init_right_ends();
+	init_lazy_loops();
+
+	has_in_loop_probs_=true;
+    }
+
+    void
+    ExtRnaDataImpl::init_lazy_loops() {
+	SparseMatrix<size_t> loop_idx(no_loop);
+	std::vector<int> computed;
+
+	// loops are closed by base pairs in arc_probs_ or are external
+	std::vector<std::pair<size_t,size_t> > loops;
+	for(arc_prob_matrix_t::const_iterator it = self_->arc_probs_begin();
+	    self_->arc_probs_end()!=it; ++it) {
+	    loops.push_back(it->first);
+	}
+	loops.push_back(std::make_pair((size_t)0,self_->length()+1));
+
+	for (size_t k=0; k<loops.size(); ++k) {
+	    size_t i=loops[k].first;
+	    size_t j=loops[k].second;
+
+	    loop_idx.set(i,j,k);
+	    size_t old_k = lazy_loop_idx_(i,j);
+	    computed.push_back(old_k!=no_loop && in_loop_computed_[old_k]);
+
+	    // computing the loop must not insert entries
+	    arc_in_loop_probs_.ref(i,j);
+	    unpaired_in_loop_probs_.ref(i,j);
+	}
+
+	lazy_loop_idx_=loop_idx;
+	in_loop_computed_.swap(computed);
+    }
+
+    void
+    ExtRnaDataImpl::provide_in_loop_probs(size_t i, size_t j) {
+	if (rna_ensemble_==NULL) {
+	    return;
+	}
+
+	const SparseMatrix<size_t> &loop_idx = lazy_loop_idx_;
+	size_t k = loop_idx(i,j);
+	if (k==no_loop) {
+	    return;
+	}
+
+	// double-checked: the acquire load pairs with the release
+	// store below, such that the probabilities of a computed
+	// loop are visible without locking
+	if (__atomic_load_n(&in_loop_computed_[k],__ATOMIC_ACQUIRE)) {
+	    return;
+	}
+
+	pthread_mutex_lock(&mutex_);
+	if (!in_loop_computed_[k]) {
+	    compute_in_loop_probs(*rna_ensemble_,i,j);
+	    if (lazy_bpil_length_ratio_ > 0) {
+		drop_worst_bpil_precise(i,j,lazy_bpil_length_ratio_);
+	    }
+	    __atomic_store_n(&in_loop_computed_[k],1,__ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&mutex_);
+    }
+
+    void
+    ExtRnaDataImpl::compute_all_in_loop_probs() {
+	if (rna_ensemble_==NULL) {
+	    return;
+	}
+	
+	for(arc_prob_matrix_t::const_iterator it = self_->arc_probs_begin();
+	    self_->arc_probs_end()!=it; ++it) {
+	    provide_in_loop_probs(it->first.first,it->first.second);
+	}
+	provide_in_loop_probs(0,self_->length()+1);
+    }
+
+    double
+    ExtRnaDataImpl::arc_in_loop_prob(size_t ip, size_t jp, size_t i, size_t j) {
+	provide_in_loop_probs(i,j);
+	const arc_prob_matrix_matrix_t &probs = arc_in_loop_probs_;
+	return probs(i,j)(ip,jp);
+    }
+
+    double
+    ExtRnaDataImpl::unpaired_in_loop_prob(size_t k, size_t i, size_t j) {
+	provide_in_loop_probs(i,j);
+	const arc_prob_vector_matrix_t &probs = unpaired_in_loop_probs_;
+	return probs(i,j)[k];
+    }
+
     bool
     ExtRnaData::inloopprobs_ok() const {
 	return ext_pimpl_->has_in_loop_probs_;
@@ -707,6 +864,16 @@ namespace LocARNA {
 	return pimpl_->arc_probs_.begin();
     }
 
+    size_type
+    RnaData::max_arc_span() const {
+	size_type max_span=0;
+	for (arc_probs_const_iterator it=arc_probs_begin(); arc_probs_end()!=it; ++it) {
+	    max_span = std::max(max_span,
+				(size_type)(it->first.second - it->first.first));
+	}
+	return max_span;
+    }
+
     RnaData::arc_probs_const_iterator
     RnaData::arc_probs_end() const {
 	return pimpl_->arc_probs_.end();
@@ -765,14 +932,12 @@ namespace LocARNA {
 	
     double 
     ExtRnaData::arc_in_loop_prob(pos_type i, pos_type j,pos_type p, pos_type q) const {
-	ExtRnaDataImpl::arc_prob_matrix_t m_pq = ext_pimpl_->arc_in_loop_probs_(p,q);
-	return m_pq(i,j);
+	return ext_pimpl_->arc_in_loop_prob(i,j,p,q);
     }
     
     double 
     ExtRnaData::arc_external_prob(pos_type i, pos_type j) const {
-	ExtRnaDataImpl::arc_prob_matrix_t m_ext = ext_pimpl_->arc_in_loop_probs_(0,length()+1);
-	return m_ext(i,j);
+	return ext_pimpl_->arc_in_loop_prob(i,j,0,length()+1);
     }
     
     double
@@ -782,14 +947,12 @@ namespace LocARNA {
     
     double 
     ExtRnaData::unpaired_in_loop_prob(pos_type k,pos_type p, pos_type q) const {
-	ExtRnaDataImpl::arc_prob_vector_t v_pq = ext_pimpl_->unpaired_in_loop_probs_(p,q);
-	return v_pq[k];
+	return ext_pimpl_->unpaired_in_loop_prob(k,p,q);
     }
     
     double 
     ExtRnaData::unpaired_external_prob(pos_type k) const {
-	ExtRnaDataImpl::arc_prob_vector_t v_ext = ext_pimpl_->unpaired_in_loop_probs_(0,length()+1);
-	return v_ext[k];
+	return ext_pimpl_->unpaired_in_loop_prob(k,0,length()+1);
     }
 
     void RnaData::read_ps(const std::string &filename) {
@@ -1239,6 +1402,7 @@ namespace LocARNA {
 	
 	RnaData::write_pp(out,p_outbpcut);
 	
+	ext_pimpl_->compute_all_in_loop_probs();
 	ext_pimpl_->write_pp_in_loop_probabilities(out,
 					       p_outbpcut,
 					       p_outbpilcut,
@@ -1444,6 +1608,8 @@ namespace LocARNA {
 	// count unpaired bases in loop
 	size_t num_unpaired_in_loop=0;
 
+	ext_pimpl_->compute_all_in_loop_probs();
+
 	size_t len = length();
 	for( size_t i=1; i <= len; i++ ) {
 	    for( size_t j=i+1; j <= len; j++ ) {
@@ -1526,6 +1692,22 @@ namespace LocARNA {
 	}
     }
     
+    void
+    RnaDataImpl::init_from_profile_dot_plot(const ProfileDotPlot &dot_plot) {
+	sequence_ = dot_plot.sequence();
+	has_stacking_ = dot_plot.has_stacking();
+
+	for (ProfileDotPlot::const_iterator it=dot_plot.begin();
+	     dot_plot.end()!=it; ++it) {
+	    size_type i = it->first.first;
+	    size_type j = it->first.second;
+	    arc_probs_(i,j) = dot_plot.arc_prob(i,j);
+	    if (has_stacking_) {
+		arc_2_probs_(i,j) = dot_plot.joint_arc_prob(i,j);
+	    }
+	}
+    }
+    
     double
     RnaDataImpl::consensus_probability(double pA, double pB,
 				       size_t sizeA,size_t sizeB,
@@ -1580,6 +1762,11 @@ namespace LocARNA {
         // access pimpl_ of parent RnaData object
 	RnaDataImpl *rdimpl = static_cast<RnaData *>(self_)->pimpl_;
 	rdimpl->drop_worst_bps(keep);
+
+	// lazily computed loops contain only the remaining base pairs
+	if (rna_ensemble_) {
+	    init_right_ends();
+	}
 	
 	// free unpaired in loop where arc prob is 0
 	for (arc_prob_vector_matrix_t::const_iterator it = unpaired_in_loop_probs_.begin();
@@ -1613,10 +1800,16 @@ namespace LocARNA {
 	    }
 	}
 
+	if (rna_ensemble_) {
+	    init_lazy_loops();
+	}
     }
 
     void
     ExtRnaDataImpl::drop_worst_uil(size_t keep) {
+
+	// requires all in loop probabilities
+	compute_all_in_loop_probs();
 	
 	typedef std::pair< arc_prob_vector_matrix_t::key_t, arc_prob_vector_t::key_t > key_t;
 
@@ -1652,6 +1845,9 @@ namespace LocARNA {
 
     void
     ExtRnaDataImpl::drop_worst_bpil(size_t keep) {
+
+	// requires all in loop probabilities
+	compute_all_in_loop_probs();
 	
 	typedef std::pair< arc_prob_matrix_matrix_t::key_t, arc_prob_matrix_t::key_t > key_t;
 	
@@ -1689,39 +1885,48 @@ namespace LocARNA {
     void
     ExtRnaDataImpl::drop_worst_bpil_precise(double ratio) {
 
-	typedef std::pair< arc_prob_matrix_matrix_t::key_t, arc_prob_matrix_t::key_t > key_t;
-
-	typedef RnaDataImpl::keyvec<key_t> kv_t;
-
-
-	// push all uil probs with their key to vector vec
 	for (arc_prob_matrix_matrix_t::const_iterator it=arc_in_loop_probs_.begin();
 	     arc_in_loop_probs_.end() != it;
 	     ++it ) {
-		kv_t::vec_t vec;
-		vec.clear();
-	    for (arc_prob_matrix_t::const_iterator it2=it->second.begin();
-		 it->second.end() != it2;
-		 ++it2 ) {
-
-		vec.push_back(kv_t::kvpair_t(key_t(it->first,it2->first), it2->second));
-	    }
-		double keep =  ratio * ((double)(it->first.second)- (double)(it->first.first) + 1) ;
-		if (vec.size()> keep)
-		{
-			std::make_heap(vec.begin(),vec.end(),kv_t::comp);
-			while(vec.size()> keep ) {
-				const key_t &key = vec.front().first;
-				arc_in_loop_probs_.ref(key.first.first,key.first.second).reset(key.second.first,key.second.second);
-
-				std::pop_heap(vec.begin(),vec.end(),kv_t::comp);
-				vec.pop_back();
-			}
-		}
+	    drop_worst_bpil_precise(it->first.first,it->first.second,ratio);
+	}
 
+	// loops that are computed later
+	if (rna_ensemble_) {
+	    lazy_bpil_length_ratio_ = ratio;
 	}
+    }
+
+    void
+    ExtRnaDataImpl::drop_worst_bpil_precise(size_t i, size_t j, double ratio) {
 
+	typedef std::pair< arc_prob_matrix_matrix_t::key_t, arc_prob_matrix_t::key_t > key_t;
 
+	typedef RnaDataImpl::keyvec<key_t> kv_t;
+
+	const arc_prob_matrix_matrix_t &probs = arc_in_loop_probs_;
+	const arc_prob_matrix_t &probs_ij = probs(i,j);
+
+	// push all bpil probs of the loop with their key to vector vec
+	kv_t::vec_t vec;
+	for (arc_prob_matrix_t::const_iterator it2=probs_ij.begin();
+	     probs_ij.end() != it2;
+	     ++it2 ) {
+	    vec.push_back(kv_t::kvpair_t(key_t(arc_prob_matrix_matrix_t::key_t(i,j),it2->first),
+					 it2->second));
+	}
+
+	double keep =  ratio * ((double)j - (double)i + 1) ;
+	if (vec.size()> keep) {
+	    std::make_heap(vec.begin(),vec.end(),kv_t::comp);
+	    while(vec.size()> keep ) {
+		const key_t &key = vec.front().first;
+		arc_in_loop_probs_.ref(i,j).reset(key.second.first,key.second.second);
+
+		std::pop_heap(vec.begin(),vec.end(),kv_t::comp);
+		vec.pop_back();
+	    }
+	}
     }
 
 } // end namespace LocARNA
@@ -18,6 +18,7 @@ namespace LocARNA {
     class RnaDataImpl;
     class PFoldParams;
     class SequenceAnnotation;
+    class ProfileDotPlot;
     
     /**
      * @brief represent sparsified data of RNA ensemble
@@ -116,6 +117,34 @@ namespace LocARNA {
 		double p_expB, 
 		bool only_local=false
 		);
+
+	/** 
+	 * @brief Construct from consensus dot plot of a profile
+	 * 
+	 * @param dot_plot incrementally computed consensus dot plot
+	 *
+	 * Copies the sequences and the normalized probabilities of
+	 * all stored pairs in O(number of base pairs). This is the
+	 * cheap alternative to the consensus constructor for
+	 * progressive alignment, where profiles are merged repeatedly.
+	 */
+	explicit
+	RnaData(const ProfileDotPlot &dot_plot);
+
+	/** 
+	 * @brief Construct with changed base pair probabilities
+	 * 
+	 * @param rna_data RNA data
+	 * @param arc_probs base pair probabilities
+	 *
+	 * Copies the sequence, cutoff and stacking probabilities of
+	 * rna_data, but replaces its base pair probabilities; joint
+	 * stacking probabilities of pairs that are not in arc_probs
+	 * are dropped. Used for library extension (see
+	 * LibraryExtension).
+	 */
+	RnaData(const RnaData &rna_data,
+		const arc_prob_matrix_t &arc_probs);
 	
     protected:
     	/** 
@@ -187,7 +216,18 @@ namespace LocARNA {
 	double 
 	arc_prob(pos_type i, pos_type j) const;
 
-    protected:
+	/**
+	 * @brief Get maximal span of arcs
+	 *
+	 * @return maximum of j-i over all arcs (i,j) with probability
+	 * above cutoff; 0 if there are none
+	 *
+	 * @note iterates over all arcs; for bounded span, clients can
+	 * restrict traversals of potential arcs to this band
+	 */
+	size_type
+	max_arc_span() const;
+
 	//! type of constant iterator over arcs with probability above cutoff
 	typedef arc_prob_matrix_t::const_iterator arc_probs_const_iterator;
 	
@@ -200,13 +240,12 @@ namespace LocARNA {
 	arc_probs_begin() const;
 
 	/**
-	 * @brief begin of arcs with probability above cutoff
+	 * @brief end of arcs with probability above cutoff
 	 * Supports iteration over arcs
 	 * @returns constant iterator
 	 */
 	arc_probs_const_iterator
 	arc_probs_end() const;
-    public:
 	
 
 	/**
@@ -306,6 +345,23 @@ namespace LocARNA {
 	void
 	set_anchors(const SequenceAnnotation &anchors);
 
+	/**
+	 * @brief Keep almost equal probabilities of a reference
+	 *
+	 * Sets each base pair (and joint stacking) probability, which
+	 * differs from the one of reference by at most tolerance, to
+	 * the probability in reference. Pairs that are stored only in
+	 * one of the objects are not changed.
+	 *
+	 * @param reference RNA data of a sequence of the same length
+	 * @param tolerance maximal difference of probabilities
+	 *
+	 * @note limits the effect of small sequence changes to the
+	 * base pairs that change significantly (see VariantAligner)
+	 */
+	void
+	snap_probabilities(const RnaData &reference, double tolerance);
+
     protected:
 	
 	/** 
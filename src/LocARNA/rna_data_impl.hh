@@ -91,6 +91,14 @@ namespace LocARNA {
 	init_from_fixed_structure(const SequenceAnnotation &structure,
 				  bool stacking);
 
+	/** 
+	 * @brief initialize from consensus dot plot of a profile
+	 * 
+	 * @param dot_plot consensus dot plot
+	 */
+	void
+	init_from_profile_dot_plot(const ProfileDotPlot &dot_plot);
+
 	/** 
 	 * @brief initialize from rna ensemble 
 	 * 
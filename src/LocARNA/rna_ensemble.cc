@@ -2,6 +2,9 @@
 #include <sstream>
 #include <map>
 #include <limits>
+#include <algorithm>
+
+#include <pthread.h>
 
 #include "aux.hh"
 #include "rna_ensemble_impl.hh"
@@ -22,6 +25,7 @@ extern "C" {
 #   include <ViennaRNA/params.h>
 #   include <ViennaRNA/pair_mat.h>
 #   include <ViennaRNA/alifold.h>
+#   include <ViennaRNA/LPfold.h>
 
     FLT_OR_DBL *alipf_export_bppm(void);
 }
@@ -30,6 +34,22 @@ extern "C" {
     
 namespace LocARNA {
     
+    const float RnaEnsembleImpl::window_prob_cutoff = 1e-5;
+
+    //! @brief serializes the calls to the Vienna RNA library, which
+    //! is not reentrant
+    static pthread_mutex_t vienna_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    //! @brief lock the Vienna RNA library for the lifetime of the object
+    class ViennaLock {
+    public:
+	//! @brief lock
+	ViennaLock() { pthread_mutex_lock(&vienna_mutex); }
+
+	//! @brief unlock
+	~ViennaLock() { pthread_mutex_unlock(&vienna_mutex); }
+    };
+
     // ------------------------------------------------------------
     // implementation of class RnaEnsemble
     //
@@ -87,8 +107,16 @@ namespace LocARNA {
 	return pimpl_->sequence_.length();
     }
 
+    size_type
+    RnaEnsemble::max_bp_span() const {
+	return pimpl_->max_bp_span_;
+    }
+
     double 
     RnaEnsemble::arc_prob(size_type i, size_type j) const {
+	if (pimpl_->used_window_folding_) {
+	    return pimpl_->window_probs_(i,j);
+	}
 	return pimpl_->McCmat_->bppm(i,j);
     }
     
@@ -113,6 +141,9 @@ namespace LocARNA {
 	in_loop_probs_available_(false),
 	McCmat_(0L), // 0 pointer
 	used_alifold_(false),
+	used_window_folding_(false),
+	window_probs_(0.0),
+	max_bp_span_(0),
 	min_free_energy_(std::numeric_limits<double>::infinity()),
 	min_free_energy_structure_("")
     {
@@ -135,22 +166,34 @@ namespace LocARNA {
 
 	used_alifold_=use_alifold;
 
+	// the window bounds the span
+	max_bp_span_ = params.max_bp_span();
+	if (params.window_size()>0
+	    && (max_bp_span_==0 || max_bp_span_>params.window_size())) {
+	    max_bp_span_ = params.window_size();
+	}
+
+	if (params.window_size()>0
+	    && !inLoopProbs
+	    && sequence_.num_of_rows()==1
+	    && !sequence_.has_annotation(MultipleAlignment::AnnoType::structure)) {
+	    compute_window_probs(params);
+
+	    pair_probs_available_=true;
+	    stacking_probs_available_=false;
+	    in_loop_probs_available_=false;
+
+	    stopwatch.stop("bpp");
+	    return;
+	}
+
 	// run McCaskill and get access to results
 	// in McCaskill_matrices
 	if (!use_alifold) {
 	    compute_McCaskill_matrices(params,inLoopProbs,true);
 	} else {
-	    make_pair_matrix();
 	    compute_McCaskill_alifold_matrices(params,inLoopProbs,true);
 	}
-	
-	// since we have local copies of all McCaskill pf arrays
-	// we can free the ones of the Vienna lib
-	if (!used_alifold_) {
-	    free_pf_arrays();
-	} else {
-	    free_alipf_arrays();
-	}
 
 	pair_probs_available_=true;
 	stacking_probs_available_=true;
@@ -162,14 +205,7 @@ namespace LocARNA {
     void
     RnaEnsembleImpl::compute_McCaskill_matrices(const PFoldParams &params, bool inLoopProbs, bool local_copy) {
 	assert(sequence_.num_of_rows()==1);
-
-	// global settings for Vienna RNA lib
-	fold_constrained=false; // this is potentially changed below
-	if (params.noLP()) {noLonelyPairs=1;}
-
 	assert(params.dangling() >=0 && params.dangling() <=3);
-	dangles = params.dangling();
-	
 
 	// use MultipleAlignment to get pointer to c-string of the
 	// first (and only) sequence in object sequence.
@@ -187,57 +223,76 @@ namespace LocARNA {
 	assert(!sequence_.has_annotation(MultipleAlignment::AnnoType::structure) || structure_anno.length()==length);
 	
 	char *c_structure = new char[length+1];
-	
-	// copy structure annotation to c_structure to use as
-	// constraint for fold
-	if (structure_anno.length()==length) {
-	    strncpy(c_structure,structure_anno.c_str(),length);
-	    c_structure[length]=0;
-	    fold_constrained=true;
-	}
-	
-	// ----------------------------------------
-	// call fold for setting the pf_scale
-	if (length>0) { // workaround, since fold(char*,char*) fails on empty input
-            min_free_energy_ = fold(c_sequence,c_structure);
-	} else {
-            min_free_energy_=0;
-        }
-        min_free_energy_structure_ = static_cast<std::string>(c_structure);
-        
-	// std::cout << "MFE: "<<min_free_energy_<<std::endl;
-	// std::cout << c_structure << std::endl;
-	if (length>0) { // free arrays only if we called fold()
-            free_arrays();
-        } 
-	
-	// set pf_scale
-	double kT = (temperature+273.15)*1.98717/1000.;  /* kT in kcal/mol */
-	pf_scale = exp(-min_free_energy_/kT/length);
-
-	// copy structure annotation to c_structure to use as
-	// constraint for pf_fold
-	if (structure_anno.length()==length) {
-	    strncpy(c_structure,structure_anno.c_str(),length);
-	    c_structure[length]=0;
+	double scaling_factor; // pf_scale of the partition function
+
+	{
+	    // the Vienna RNA library keeps its settings and dynamic
+	    // programming matrices in global variables
+	    ViennaLock lock;
+
+	    fold_constrained=false; // this is potentially changed below
+	    noLonelyPairs = params.noLP() ? 1 : 0;
+	    dangles = params.dangling();
+	    ::max_bp_span = max_bp_span_>0 ? (int)max_bp_span_ : -1;
+
+	    // copy structure annotation to c_structure to use as
+	    // constraint for fold
+	    if (structure_anno.length()==length) {
+		strncpy(c_structure,structure_anno.c_str(),length);
+		c_structure[length]=0;
+		fold_constrained=true;
+	    }
+
+	    // ----------------------------------------
+	    // call fold for setting the pf_scale
+	    if (length>0) { // workaround, since fold(char*,char*) fails on empty input
+		min_free_energy_ = fold(c_sequence,c_structure);
+	    } else {
+		min_free_energy_=0;
+	    }
+	    min_free_energy_structure_ = static_cast<std::string>(c_structure);
+
+	    // std::cout << "MFE: "<<min_free_energy_<<std::endl;
+	    // std::cout << c_structure << std::endl;
+	    if (length>0) { // free arrays only if we called fold()
+		free_arrays();
+	    } 
+
+	    // set pf_scale
+	    double kT = (temperature+273.15)*1.98717/1000.;  /* kT in kcal/mol */
+	    pf_scale = exp(-min_free_energy_/kT/length);
+
+	    // copy structure annotation to c_structure to use as
+	    // constraint for pf_fold
+	    if (structure_anno.length()==length) {
+		strncpy(c_structure,structure_anno.c_str(),length);
+		c_structure[length]=0;
+	    }
+
+	    // ----------------------------------------
+	    // call pf_fold
+	    if (length>0) { // workaround for pf_fold() on empty input
+		pf_fold(c_sequence,c_structure);
+	    }
+
+	    // ----------------------------------------
+	    // get McC data structures and copy
+	    // 
+	    // since the space referenced by pointers in McCmat will be
+	    // overwritten by the next call to pf_fold, we have to copy
+	    // the data structures if we want to keep them.
+	    //
+	    McCmat_ = 
+		new McC_matrices_t(c_sequence,local_copy && (length>0), // optionally makes local copy
+				   span_retention(params));
+
+	    // since we have a local copy of all McCaskill pf arrays we
+	    // can free the ones of the Vienna lib
+	    free_pf_arrays();
+
+	    scaling_factor = pf_scale;
 	}
 
-	// ----------------------------------------
-	// call pf_fold
-        if (length>0) { // workaround for pf_fold() on empty input
-            pf_fold(c_sequence,c_structure);
-        }
- 
-	// ----------------------------------------
-	// get McC data structures and copy
-	// 
-	// since the space referenced by pointers in McCmat will be
-	// overwritten by the next call to pf_fold, we have to copy
-	// the data structures if we want to keep them.
-	//
-	McCmat_ = 
-	    new McC_matrices_t(c_sequence,local_copy && (length>0)); // optionally makes local copy
-	
 	// precompute further tables expMLbase and scale for computations
 	// of probabilities 
 	
@@ -249,18 +304,18 @@ namespace LocARNA {
 	// double scaling_factor=McCmat_->pf_params_->pf_scale;
 	// std::cerr << "scaling_factor "<<scaling_factor<<" pf_scale " << pf_scale << std::endl;
 	
-	kT = McCmat_->pf_params_->kT;   /* kT in cal/mol  */
+	double kT = McCmat_->pf_params_->kT;   /* kT in cal/mol  */
 	
 	/* scaling factors (to avoid overflows) */
-	if (pf_scale == -1) { /* mean energy for random sequences: 184.3*length cal */
-	    pf_scale = 
+	if (scaling_factor == -1) { /* mean energy for random sequences: 184.3*length cal */
+	    scaling_factor = 
 		exp(-(-185+(McCmat_->pf_params_->temperature-37.)*7.27)/kT);
-	    if (pf_scale<1) pf_scale=1;
+	    if (scaling_factor<1) scaling_factor=1;
 	}
 	
 	scale_[0] = 1.;
         if (length>0) { // avoid write to invalid entry
-            scale_[1] = 1./pf_scale;
+            scale_[1] = 1./scaling_factor;
         }
 
 	expMLbase_.resize(length+1);
@@ -287,25 +342,83 @@ namespace LocARNA {
 	    
 	    // ----------------------------------------
 	    // compute the Qm2 matrix
-	    compute_Qm2();
+	    compute_Qm2(span_retention(params));
 	}
 
         delete [] c_structure;
         delete [] c_sequence;
     }
 
+    McCRetention
+    RnaEnsembleImpl::span_retention(const PFoldParams &params) const {
+	const McCRetention &retention = params.McC_retention();
+	size_t max_span = retention.max_span();
+	if (max_bp_span_>0
+	    && (max_span==0 || max_bp_span_<max_span)) {
+	    max_span = max_bp_span_;
+	}
+	return McCRetention(retention.single_precision(),
+			    max_span,
+			    retention.spill_dir());
+    }
+
+    void
+    RnaEnsembleImpl::compute_window_probs(const PFoldParams &params) {
+	assert(sequence_.num_of_rows()==1);
+	assert(params.dangling() >=0 && params.dangling() <=3);
+
+	size_t length = sequence_.length();
+
+	size_t window_size = std::min(params.window_size(),length);
+	size_t span = std::min(max_bp_span_,window_size);
+
+	used_window_folding_=true;
+	window_probs_.clear();
+
+	if (length<=(size_t)TURN+1) { // no base pairs; pfl_fold fails on short input
+	    return;
+	}
+
+	char *c_sequence = new char[length+1];
+	strcpy(c_sequence,sequence_.seqentry(0).seq().str().c_str());
+
+	plist *pl;
+	{
+	    // the Vienna RNA library keeps its settings in global
+	    // variables
+	    ViennaLock lock;
+
+	    fold_constrained=false;
+	    noLonelyPairs = params.noLP() ? 1 : 0;
+	    dangles = params.dangling();
+
+	    // let Vienna estimate the scaling within each window
+	    pf_scale = -1;
+
+	    // ----------------------------------------
+	    // call pfl_fold; its pair list ends with an entry with i==0
+	    pl = pfl_fold(c_sequence,
+			  (int)window_size,
+			  (int)span,
+			  window_prob_cutoff,
+			  NULL,NULL,NULL,NULL);
+	}
+
+	for (plist *it=pl; it!=NULL && it->i>0; ++it) {
+	    window_probs_.set(it->i,it->j,it->p);
+	}
+
+	free(pl);
+	delete [] c_sequence;
+    }
+
     //! @todo resolve code duplication in
     //! compute_McCaskill_alifold_matrices and
     //! compute_McCaskill_matrices (computing scale_, expMLbase_ ...)
     void
     RnaEnsembleImpl::compute_McCaskill_alifold_matrices(const PFoldParams &params, bool inLoopProbs, bool local_copy) {
 	
-	// global settings for Vienna RNA lib
-	fold_constrained=false; // this is potentially changed below
-	if (params.noLP()) {noLonelyPairs=1;}
-
 	assert(params.dangling() >=0 && params.dangling() <=3);
-	dangles = params.dangling();
 
 	size_t length = sequence_.length();
 	size_t n_seq = sequence_.num_of_rows();
@@ -329,60 +442,77 @@ namespace LocARNA {
 	// reserve space for structure
 	char *c_structure = new char [length+1];
 	
-	// copy structure annotation to c_structure to use as
-	// constraint for alifold
-	if (structure_anno.length()==length) {
-	    strncpy(c_structure,structure_anno.c_str(),length);
-	    c_structure[length]=0;
-	    fold_constrained=true;
-	}
-	
-	// ----------------------------------------
-	// call fold for setting the pf_scale
-	if (length>0) { // don't call alifold for 0 length (necessary
-			// workaround, since alifold cannot handle
-			// empty sequences)
-	    min_free_energy_ = alifold(c_sequences,c_structure);
-	    min_free_energy_structure_ = c_structure;
-	    // std::cout << c_structure << std::endl;
-	    free_alifold_arrays();
-	} else {
-	    min_free_energy_ = 0;
-	    min_free_energy_structure_ = c_structure;
-	}
-	
-	// set pf_scale
-	double kT = (temperature+273.15)*1.98717/1000.;  /* kT in kcal/mol */
-	pf_scale = exp(-min_free_energy_/kT/length);
-	
-	
-	// copy structure annotation to c_structure to use as
-	// constraint for alipf_fold
-	if (structure_anno.length()==length) {
-	    strncpy(c_structure,structure_anno.c_str(),length);
-	    c_structure[length]=0;
-	}
+	{
+	    // the Vienna RNA library keeps its settings and dynamic
+	    // programming matrices in global variables
+	    ViennaLock lock;
 
-	// ----------------------------------------
-	// call alipf_fold
-	if (length>0) { // don't call alifold for 0 length (necessary
-			// workaround, since alifold cannot handle
-			// empty sequences)
-	    alipf_fold(c_sequences,c_structure,NULL);
+	    make_pair_matrix();
+
+	    fold_constrained=false; // this is potentially changed below
+	    noLonelyPairs = params.noLP() ? 1 : 0;
+	    dangles = params.dangling();
+	    ::max_bp_span = max_bp_span_>0 ? (int)max_bp_span_ : -1;
+
+	    // copy structure annotation to c_structure to use as
+	    // constraint for alifold
+	    if (structure_anno.length()==length) {
+		strncpy(c_structure,structure_anno.c_str(),length);
+		c_structure[length]=0;
+		fold_constrained=true;
+	    }
+
+	    // ----------------------------------------
+	    // call fold for setting the pf_scale
+	    if (length>0) { // don't call alifold for 0 length (necessary
+			    // workaround, since alifold cannot handle
+			    // empty sequences)
+		min_free_energy_ = alifold(c_sequences,c_structure);
+		min_free_energy_structure_ = c_structure;
+		// std::cout << c_structure << std::endl;
+		free_alifold_arrays();
+	    } else {
+		min_free_energy_ = 0;
+		min_free_energy_structure_ = c_structure;
+	    }
+
+	    // set pf_scale
+	    double kT = (temperature+273.15)*1.98717/1000.;  /* kT in kcal/mol */
+	    pf_scale = exp(-min_free_energy_/kT/length);
+
+
+	    // copy structure annotation to c_structure to use as
+	    // constraint for alipf_fold
+	    if (structure_anno.length()==length) {
+		strncpy(c_structure,structure_anno.c_str(),length);
+		c_structure[length]=0;
+	    }
+
+	    // ----------------------------------------
+	    // call alipf_fold
+	    if (length>0) { // don't call alifold for 0 length (necessary
+			    // workaround, since alifold cannot handle
+			    // empty sequences)
+		alipf_fold(c_sequences,c_structure,NULL);
+	    }
+
+	    // ----------------------------------------
+	    // get McC data structures and copy
+	    // 
+	    // since the space referenced by pointers in McCmat will be
+	    // overwritten by the next call to pf_fold, we have to copy
+	    // the data structures if we want to keep them.
+	    //
+	    // optionally makes local copy (only if length>0: alifold workaround!)
+	    McCmat_ =
+		new McC_ali_matrices_t(n_seq,length,local_copy && (length>0),
+				       span_retention(params));
+
+	    // since we have a local copy of all McCaskill pf arrays we
+	    // can free the ones of the Vienna lib
+	    free_alipf_arrays();
 	}
-        
-	// ----------------------------------------
-	// get McC data structures and copy
-	// 
-	// since the space referenced by pointers in McCmat will be
-	// overwritten by the next call to pf_fold, we have to copy
-	// the data structures if we want to keep them.
-	//
-	// optionally makes local copy (only if length>0: alifold workaround!)
-	McCmat_ =
-	    new McC_ali_matrices_t(n_seq,length,local_copy && (length>0));
-	
-	
+
 	// precompute further tables expMLbase and scale for computations
 	// of probabilities 
 	
@@ -394,7 +524,7 @@ namespace LocARNA {
 	double scaling_factor=McCmat_->pf_params_->pf_scale;
 	// std::cerr << "scaling_factor "<<scaling_factor<<" pf_scale " << pf_scale << std::endl;
 	
-	kT = McCmat_->pf_params_->kT / n_seq;   /* kT in cal/mol  */
+	double kT = McCmat_->pf_params_->kT / n_seq;   /* kT in cal/mol  */
 	
 	/* scaling factors (to avoid overflows) */
 	if (scaling_factor == -1) { /* mean energy for random sequences: 184.3*length cal */
@@ -427,7 +557,7 @@ namespace LocARNA {
 
 	    // ----------------------------------------
 	    // compute the Qm2 matrix
-	    compute_Qm2_ali();
+	    compute_Qm2_ali(span_retention(params));
 	}
 
 	delete [] c_structure;
@@ -439,10 +569,21 @@ namespace LocARNA {
     }
     
     void
-    RnaEnsembleImpl::compute_Qm2(){
+    RnaEnsembleImpl::init_Qm2(const McCRetention &retention) {
+	size_type len = sequence_.length();
+	
+	if (McCmat_->compact()) {
+	    compact_qm2_.init(len,retention);
+	} else {
+	    qm2_.resize((len+1)*(len+2)/2);
+	}
+    }
+
+    void
+    RnaEnsembleImpl::compute_Qm2(const McCRetention &retention){
 	assert(!used_alifold_);
 	
-	if (fold_constrained) {
+	if (sequence_.has_annotation(MultipleAlignment::AnnoType::structure)) {
 	    std::cerr << "Warning: computation of in loop probabilities with constraints."<<std::endl;
 	}
 
@@ -456,7 +597,7 @@ namespace LocARNA {
 	std::vector<FLT_OR_DBL> qqm1(len+2,0);
 	
 	//qm1.resize((len+1)*(len+2)/2);
-	qm2_.resize((len+1)*(len+2)/2);
+	init_Qm2(retention);
 	
 	// initialize qqm1
 	for (size_type i=1; i<=len; i++) {
@@ -467,7 +608,8 @@ namespace LocARNA {
 	for(size_type j=TURN+2; j<=len; j++) {
 	    // --------------------
 	    // one column of Qm1, which will be needed in the calculation of Qm2  
-	    for(size_type i=j-TURN-1; i>=1; i--) {
+	    // (only in the band of retained entries)
+	    for(size_type i=j-TURN-1; i>=1 && MCm->in_band(i,j); i--) {
 		char type=MCm->ptype(i,j);
 		qqm[i]= qqm1[i]*expMLbase_[1];
 		if(type) {
@@ -481,20 +623,21 @@ namespace LocARNA {
 		
 		//qm1[McCmat->iidx(i,j)]=qqm[i];
 
-		assert(qqm[i] <= MCm->qm(i,j));
-		assert((!frag_len_geq(i,j-1,TURN+2)) || qqm1[i] <= MCm->qm(i,j-1));
+		assert(retention.single_precision() || qqm[i] <= MCm->qm(i,j));
+		assert(retention.single_precision()
+		       || (!frag_len_geq(i,j-1,TURN+2)) || qqm1[i] <= MCm->qm(i,j-1));
 	    }
 	    	    
 	    // --------------------
 	    // calculates column "j" of the Qm2 matrix
 	    if(j >= (2*(TURN+2))) {
-		for(size_type i = j-2*(TURN+2)+1; i>=1; i--) {
-		    qm2_[MCm->iidx(i,j)] = 0;
+		for(size_type i = j-2*(TURN+2)+1; i>=1 && MCm->in_band(i,j); i--) {
+		    FLT_OR_DBL qm2_ij = 0;
 		    for(size_type k = i + TURN+1; (k+1)+TURN+1 <= j; k++) {
-			qm2_[MCm->iidx(i,j)] +=
-			    MCm->qm(i,k)*qqm[k+1];
+			qm2_ij += MCm->qm(i,k)*qqm[k+1];
 		    }
-		    assert(qm2_[MCm->iidx(i,j)] <= MCm->qm(i,j));
+		    set_qm2(i,j,qm2_ij);
+		    assert(retention.single_precision() || qm2_ij <= MCm->qm(i,j));
 		}
 	    }
 	    	    
@@ -506,11 +649,11 @@ namespace LocARNA {
 
 
     void
-    RnaEnsembleImpl::compute_Qm2_ali(){
+    RnaEnsembleImpl::compute_Qm2_ali(const McCRetention &retention){
 	assert(used_alifold_);
 	assert(McCmat_);
 
-	if (fold_constrained) {
+	if (sequence_.has_annotation(MultipleAlignment::AnnoType::structure)) {
 	    std::cerr << "Warning: computation of in loop probabilities with constraints."<<std::endl;
 	}
 
@@ -523,7 +666,7 @@ namespace LocARNA {
 	std::vector<FLT_OR_DBL> qqm1(len+2,0);
 	std::vector<int> type(n_seq);
 	
-	qm2_.resize((len+1)*(len+2)/2);
+	init_Qm2(retention);
 	
 	// initialize qqm1
 	for (size_type i=1; i<=len; i++)
@@ -535,7 +678,8 @@ namespace LocARNA {
 	    // first, calculate one row of matrix Qm1, which is needed
 	    // in the subsequent calculation of Qm2
 	    //
-	    for(size_type i=j-TURN-1; i>=1; i--) {
+	    // (only in the band of retained entries)
+	    for(size_type i=j-TURN-1; i>=1 && MCm->in_band(i,j); i--) {
 		
 		// get base pair types for i,j of all sequences
 		for (size_t s=0; s<n_seq; ++s) {
@@ -560,12 +704,12 @@ namespace LocARNA {
 	    // calculate a row of the matrix Qm2
 	    //
 	    if(j >= (2*(TURN+2))) {
-		for(size_type i = j-2*TURN-3; i>=1; i--) {
-		    qm2_[MCm->iidx(i+1,j-1)] = 0;
+		for(size_type i = j-2*TURN-3; i>=1 && MCm->in_band(i+1,j-1); i--) {
+		    FLT_OR_DBL qm2_ij = 0;
 		    for(size_type k = i+TURN+2; k< j-TURN-2; k++) {
-			qm2_[MCm->iidx(i+1,j-1)] +=
-			    MCm->qm(i+1,k)*qqm1[k+1];
+			qm2_ij += MCm->qm(i+1,k)*qqm1[k+1];
 		    }
+		    set_qm2(i+1,j-1,qm2_ij);
 		}
 	    }
 	    
@@ -800,12 +944,12 @@ namespace LocARNA {
 	// valid entries of qm2_ have space for 2 inner base pairs,
 	// i.e. at least length of "(...)(...)" (for TURN=3)
 	if ( frag_len_geq(k+1, j-1, 2*(TURN+2)) ) {
-	    M += qm2_[MCm->iidx(k+1,j-1)] * expMLbase_[k-i];
+	    M += qm2(k+1,j-1) * expMLbase_[k-i];
 	}
 	
 	// no base pair >= k
 	if ( frag_len_geq(i+1,k-1,2*(TURN+2)) ) {
-	    M += qm2_[MCm->iidx(i+1,k-1)] * expMLbase_[j-k];
+	    M += qm2(i+1,k-1) * expMLbase_[j-k];
 	}
 	
 	// base pairs <k and >k
@@ -921,12 +1065,12 @@ namespace LocARNA {
 
 	// bases <=k unpaired
 	if ( frag_len_geq(k+1, j-1, 2*(TURN+2)) ) {
-	    M1 = expMLbase_[frag_len(i+1,k)] * qm2_[MCm->iidx(k+1,j-1)];
+	    M1 = expMLbase_[frag_len(i+1,k)] * qm2(k+1,j-1);
 	}
 	
 	// bases >=k unpaired
 	if ( frag_len_geq(i+1, k-1, 2*(TURN+2)) ) {
-	    M2 = qm2_[MCm->iidx(i+1,k-1)] * expMLbase_[frag_len(k,j-1)];
+	    M2 = qm2(i+1,k-1) * expMLbase_[frag_len(k,j-1)];
 	}
 	
 	// innner base pairs left and right of k
@@ -29,6 +29,28 @@ namespace LocARNA {
      * structure constraint string; if existant, the string has to be
      * valid! Fixed structure annotation is ignored.
      *
+     * Folding is global unless the folding parameters limit the base
+     * pair span or set a window size (see PFoldParams):
+     *
+     * - with a maximal span L, pairs (i,j) are restricted to j-i<=L
+     *   and only the band of the McCaskill matrices up to L is kept
+     *   (see McCRetention); thus, the kept data is linear in the
+     *   sequence length.
+     *
+     * - with a window size W, single sequences without constraints
+     *   and without in loop probabilities are folded locally
+     *   (RNAplfold-style), i.e. the probabilities are averaged over
+     *   all windows of size W and no matrices are kept; stacking
+     *   probabilities are not available then. Otherwise, the window
+     *   only bounds the span.
+     *
+     * Objects can be constructed concurrently by several threads:
+     * since the Vienna RNA library keeps its state in global
+     * variables, the calls to the library are serialized, while the
+     * remaining computations (e.g. the Qm2 matrix and, later, the in
+     * loop probabilities) run in parallel on the local copies of the
+     * McCaskill matrices.
+     *
      * @todo support constraints for in loop probabilities
      *
      * @todo split up RnaEnsemble into two classes; one with and one
@@ -131,6 +153,14 @@ namespace LocARNA {
 	 */
 	size_type length() const;	
 
+	/**
+	 * @brief Maximal span of base pairs
+	 *
+	 * @return bound on j-i of all base pairs (i,j) with non-zero
+	 * probability; 0 for no bound
+	 */
+	size_type max_bp_span() const;
+
 	/** 
 	 * \brief get minimum free energy
 	 *
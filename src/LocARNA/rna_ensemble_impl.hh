@@ -33,6 +33,7 @@ namespace LocARNA {
 		
 	// std::vector<FLT_OR_DBL> qm1; // store qm1 for debugging
 	std::vector<FLT_OR_DBL> qm2_;     //!< matrix qm2_ (stored VRNA-style in a vector)
+	McC_pf_band_matrix compact_qm2_; //!< matrix qm2_ for compact retention
 	std::vector<FLT_OR_DBL> scale_;   //!< table for precomputed scaling of pf values
 	std::vector<FLT_OR_DBL> expMLbase_; //!< table for precomputed multi loop terms
 	
@@ -41,6 +42,21 @@ namespace LocARNA {
 	//! whether alifold was used to compute the McCaskill matrices
 	bool used_alifold_;
 
+	//! whether the probabilities were computed by local folding
+	//! in windows (RNAplfold-style); then there are no McCaskill
+	//! matrices
+	bool used_window_folding_;
+
+	//! base pair probabilities of local folding in windows
+	SparseMatrix<double> window_probs_;
+
+	//! maximal span of base pairs (0 for no limit)
+	size_type max_bp_span_;
+
+	//! minimal probability of base pairs kept from local folding
+	//! in windows
+	static const float window_prob_cutoff;
+
 	double min_free_energy_; //!< minimum free energy (if computed anyway)
 	std::string min_free_energy_structure_; //!< minimum free energy structure (if computed)
 
@@ -207,10 +223,12 @@ namespace LocARNA {
 	 * The method creates and fills the Qm2 matrix needed for
 	 * prob_unpaired_in_loop().
 	 * 
+	 * @param retention retention of the McCaskill matrices
+	 *
 	 * @pre McCaskill matrices are computed and accessible.
 	 */
 	void
-	compute_Qm2();
+	compute_Qm2(const McCRetention &retention);
 
 	/** 
 	 * \brief Computes the Qm2 matrix (alifold)
@@ -218,10 +236,50 @@ namespace LocARNA {
 	 * The method creates and fills the Qm2 matrix needed for
 	 * prob_unpaired_in_loop() if alifold is used.
 	 * 
+	 * @param retention retention of the McCaskill matrices
+	 *
 	 * @pre McCaskill alifold matrices are computed and accessible.
 	 */
 	void
-	compute_Qm2_ali();
+	compute_Qm2_ali(const McCRetention &retention);
+
+	/**
+	 * @brief Allocate the Qm2 matrix
+	 * @param retention retention of the McCaskill matrices
+	 */
+	void
+	init_Qm2(const McCRetention &retention);
+
+	/**
+	 * @brief Read access matrix Qm2
+	 *
+	 * @param i first index
+	 * @param j second index
+	 *
+	 * @return matrix entry
+	 */
+	FLT_OR_DBL
+	qm2(size_type i, size_type j) const {
+	    return McCmat_->compact()
+		? compact_qm2_.get(i,j)
+		: qm2_[McCmat_->iidx(i,j)];
+	}
+
+	/**
+	 * @brief Write access matrix Qm2
+	 *
+	 * @param i first index
+	 * @param j second index
+	 * @param x value
+	 */
+	void
+	set_qm2(size_type i, size_type j, FLT_OR_DBL x) {
+	    if (McCmat_->compact()) {
+		compact_qm2_.set(i,j,x);
+	    } else {
+		qm2_[McCmat_->iidx(i,j)] = x;
+	    }
+	}
 
 	/** 
 	 * \brief Computes the McCaskill matrices and keeps them accessible
@@ -255,6 +313,35 @@ namespace LocARNA {
 	void
 	compute_McCaskill_alifold_matrices(const PFoldParams &params, bool inLoopProbs, bool local_copy=true);
 
+	/**
+	 * @brief Computes base pair probabilities by local folding
+	 *
+	 * Folds RNAplfold-style, i.e. averages the base pair
+	 * probabilities over all windows of the window size, and
+	 * keeps only the probabilities; memory is linear in the
+	 * sequence length.
+	 *
+	 * @param params parameters for partition folding
+	 *
+	 * @pre single sequence without structure constraint
+	 * @note requires linking to librna
+	 */
+	void
+	compute_window_probs(const PFoldParams &params);
+
+	/**
+	 * @brief Retention of the McCaskill matrices for folding
+	 * parameters
+	 *
+	 * Restricts the band of the retention to max_bp_span_, such that the kept matrices are linear in the
+	 * sequence length. Entries outside of this band are 0 anyway.
+	 *
+	 * @param params parameters for partition folding
+	 * @return retention
+	 */
+	McCRetention
+	span_retention(const PFoldParams &params) const;
+
 
     };
 
@@ -1,6 +1,7 @@
 #include "alphabet.hh"
 #include "sequence.hh"
 #include "scoring.hh"
+#include "thread_pool.hh"
 #include "rna_data.hh"
 #include "arc_matches.hh"
 #include "match_probs.hh"
@@ -14,15 +15,6 @@
 
 namespace LocARNA {
 
-    //! vector for unpaired probabilities temporarily required by
-    //! sigma_
-    //! @note initialized in precompute sigma, if needed
-    std::vector<double> punA_tab;
-
-    //! vector for unpaired probabilities
-    //! @see punB_tab
-    std::vector<double> punB_tab;
-
     Scoring::Scoring(const Sequence &seqA_,
 		     const Sequence &seqB_,
 		     const RnaData &rna_dataA_,
@@ -30,7 +22,8 @@ namespace LocARNA {
 		     const ArcMatches &arc_matches_,
 		     const MatchProbs *match_probs_,
 		     const ScoringParams &params_,
-		     bool exp_scores
+		     bool exp_scores,
+		     size_type num_threads
 		     ):
 	params(&params_),
 	arc_matches(&arc_matches_),
@@ -39,7 +32,8 @@ namespace LocARNA {
 	rna_dataB(rna_dataB_),
 	seqA(seqA_),
 	seqB(seqB_),
-	lambda_(0)
+	lambda_(0),
+	use_compositions(false)
     {
 
 #ifndef NDEBUG
@@ -56,20 +50,20 @@ namespace LocARNA {
 	
 	if (params->ribofit) {
 	    precompute_sequence_identities();
+	} else if (seqA.num_of_rows()>1 || seqB.num_of_rows()>1) {
+	    precompute_compositions();
 	}
 
-
-	precompute_sigma();
+	precompute_symbol_similarities();
+	precompute_sigma(exp_scores,num_threads);
 	precompute_gapcost();
 	precompute_weights();
 
-	apply_unpaired_penalty();
 	if (exp_scores) {
 	    exp_indel_opening_score =
 		boltzmann_weight(params->indel_opening);
 	    exp_indel_opening_loop_score =
 		boltzmann_weight(params->indel_opening_loop);
-	    precompute_exp_sigma();
 	    precompute_exp_gapcost();
 	}
     }
@@ -90,7 +84,6 @@ namespace LocARNA {
     void
     Scoring::apply_unpaired_penalty() {
 
-
 	// subtract unpaired_penalty from precomputed tables
 	// * sigma_tab
 	// * gapcost_tabA
@@ -139,13 +132,153 @@ namespace LocARNA {
 	}
     }
 
-    
+
+    void
+    Scoring::precompute_compositions() {
+	use_compositions = true;
+	precompute_compositions(seqA,arc_matches->get_base_pairsA(),
+				col_compositionA,bp_compositionA);
+	precompute_compositions(seqB,arc_matches->get_base_pairsB(),
+				col_compositionB,bp_compositionB);
+    }
+
+    void
+    Scoring::precompute_compositions(const Sequence &seq,
+				     const BasePairs &bps,
+				     std::vector<ColumnComposition> &col_composition,
+				     std::vector<BasePairComposition> &bp_composition) {
+	size_type len = seq.length();
+	size_type rows = seq.num_of_rows();
+
+	col_composition.resize(len+1);
+	for (size_type i=1; i<=len; ++i) {
+	    const Sequence::AliColumn &col=seq[i];
+	    ColumnComposition &comp = col_composition[i];
+	    comp.clear();
+	    for (size_type k=0; k<rows; ++k) {
+		// the number of distinct symbols is small; linear search
+		ColumnComposition::iterator it=comp.begin();
+		while (comp.end()!=it && it->first!=col[k]) ++it;
+		if (comp.end()!=it) {
+		    it->second++;
+		} else {
+		    comp.push_back(std::make_pair(col[k],(size_type)1));
+		}
+	    }
+	}
+
+	bp_composition.resize(bps.num_bps());
+	for (size_type idx=0; idx<bps.num_bps(); ++idx) {
+	    const Arc &arc = bps.arc(idx);
+	    const Sequence::AliColumn &colL=seq[arc.left()];
+	    const Sequence::AliColumn &colR=seq[arc.right()];
+	    BasePairComposition &comp = bp_composition[idx];
+	    comp.clear();
+	    for (size_type k=0; k<rows; ++k) {
+		if (colL[k]=='-' || colR[k]=='-') continue;
+		std::pair<char,char> bp(colL[k],colR[k]);
+		BasePairComposition::iterator it=comp.begin();
+		while (comp.end()!=it && it->first!=bp) ++it;
+		if (comp.end()!=it) {
+		    it->second++;
+		} else {
+		    comp.push_back(std::make_pair(bp,(size_type)1));
+		}
+	    }
+	}
+    }
+
+    //! @brief compute a range of rows of the base similarity tables
+    class Scoring::SigmaTask : public ThreadPool::Task {
+	Scoring *scoring_;
+	size_type from_;
+	size_type to_;
+	bool exp_scores_;
+    public:
+	SigmaTask(Scoring *scoring, size_type from, size_type to, bool exp_scores)
+	    : scoring_(scoring), from_(from), to_(to), exp_scores_(exp_scores) {}
+
+	void
+	run() {
+	    Scoring &sc = *scoring_;
+	    size_type lenB = sc.seqB.length();
+	    score_t penalty = 2*sc.params->unpaired_penalty;
+
+	    // for two single sequences without ribofit and mea, the
+	    // similarity of a column pair is the symbol similarity;
+	    // then, a row is a sequence of table look ups
+	    bool single_symbols = !sc.params->mea_scoring && !sc.use_compositions
+		&& !sc.params->ribofit
+		&& sc.seqA.num_of_rows()==1 && sc.seqB.num_of_rows()==1;
+
+	    std::vector<size_type> idxB;
+	    if (single_symbols) {
+		const std::string &rowB = sc.seqB.seqentry(0).seq().str();
+		idxB.resize(lenB+1);
+		for (size_type j=1; j<=lenB; ++j) {
+		    idxB[j] = sc.symbol_idx[(unsigned char)rowB[j-1]];
+		}
+	    }
+
+	    for (size_type i=from_; i<to_; ++i) {
+		if (single_symbols) {
+		    size_type idxA = sc.symbol_idx[(unsigned char)sc.seqA[i][0]];
+		    for (size_type j=1; j<=lenB; ++j) {
+			sc.sigma_tab(i,j) = sc.symbol_sim_tab(idxA,idxB[j]) - penalty;
+		    }
+		} else {
+		    for (size_type j=1; j<=lenB; ++j) {
+			sc.sigma_tab(i,j) = sc.sigma_(i,j) - penalty;
+		    }
+		}
+		if (exp_scores_) {
+		    for (size_type j=1; j<=lenB; ++j) {
+			sc.exp_sigma_tab(i,j) = sc.boltzmann_weight(sc.sigma_tab(i,j));
+		    }
+		}
+	    }
+	}
+    };
+
+    void
+    Scoring::precompute_symbol_similarities() {
+	// collect the symbols of A and B
+	symbol_idx.assign(256,0);
+	std::vector<char> symbols;
+	std::vector<bool> seen(256,false);
+	const Sequence *seqs[2] = {&seqA,&seqB};
+	for (size_type s=0; s<2; ++s) {
+	    const Sequence &seq = *seqs[s];
+	    for (size_type k=0; k<seq.num_of_rows(); ++k) {
+		const std::string &row = seq.seqentry(k).seq().str();
+		for (size_type i=0; i<row.length(); ++i) {
+		    unsigned char c = row[i];
+		    if (!seen[c]) {
+			seen[c] = true;
+			symbol_idx[c] = symbols.size();
+			symbols.push_back(row[i]);
+		    }
+		}
+	    }
+	}
+
+	symbol_sim_tab.resize(symbols.size(),symbols.size());
+	for (size_type x=0; x<symbols.size(); ++x) {
+	    for (size_type y=0; y<symbols.size(); ++y) {
+		symbol_sim_tab(x,y) = symbol_similarity_(symbols[x],symbols[y]);
+	    }
+	}
+    }
+
     void
-    Scoring::precompute_sigma() {
+    Scoring::precompute_sigma(bool exp_scores, size_type num_threads) {
 	size_type lenA = seqA.length();
 	size_type lenB = seqB.length();
 
 	sigma_tab.resize(lenA+1,lenB+1);
+	if (exp_scores) {
+	    exp_sigma_tab.resize(lenA+1,lenB+1);
+	}
 
 	// precompute the unpaired probabilities and store in vectors
 	if (params->mea_scoring) {
@@ -159,28 +292,37 @@ namespace LocARNA {
 	    }
 	}
 
+	// the unpaired penalty applies to the whole table (including
+	// row and column 0)
+	score_t penalty = 2*params->unpaired_penalty;
+	for (size_type j=0; j<=lenB; ++j) {
+	    sigma_tab(0,j) = -penalty;
+	}
 	for (size_type i=1; i<=lenA; ++i) {
-	    for (size_type j=1; j<=lenB; ++j) {
-		sigma_tab(i,j) = sigma_(i,j);
-	    }
+	    sigma_tab(i,0) = -penalty;
 	}
-    }
 
+	if (lenA==0) return;
 
-    void Scoring::precompute_exp_sigma() {
-	size_type lenA = seqA.length();
-	size_type lenB = seqB.length();
-
-	exp_sigma_tab.resize(lenA+1,lenB+1);
+	ThreadPool pool(num_threads);
 
-	for (size_type i=1; i<=lenA; ++i) {
-	    for (size_type j=1; j<=lenB; ++j) {
-		exp_sigma_tab(i,j) = boltzmann_weight(sigma_tab(i,j));
-	    }
+	// several contiguous row ranges per thread for load balance
+	size_type chunks = std::min(lenA, 8*pool.size());
+	std::vector<SigmaTask *> tasks;
+	for (size_type k=0; k<chunks; ++k) {
+	    tasks.push_back(new SigmaTask(this, 1+lenA*k/chunks, 1+lenA*(k+1)/chunks,
+					  exp_scores));
+	    pool.submit(tasks.back());
+	}
+	try {
+	    pool.wait();
+	} catch (failure &f) {
+	    for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+	    throw;
 	}
+	for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
     }
 
-
     /**
        returns similarity of two alignment columns
     */
@@ -208,6 +350,25 @@ namespace LocARNA {
 		      )
 		   )
 		 );
+	} else if (use_compositions) {
+	    // compute average score for aligning the two alignment
+	    // columns from their compositions; same as below, but
+	    // each pair of distinct symbols is scored only once
+
+	    const ColumnComposition &compA=col_compositionA[ia];
+	    const ColumnComposition &compB=col_compositionB[ib];
+
+	    score_t score=0;
+
+	    for (ColumnComposition::const_iterator itA=compA.begin(); compA.end()!=itA; ++itA) {
+		for (ColumnComposition::const_iterator itB=compB.begin(); compB.end()!=itB; ++itB) {
+		    score += 
+			(score_t)(itA->second*itB->second)
+			* symbol_similarity(itA->first,itB->first);
+		}
+	    }
+
+	    return  round2score(score / (int)(seqA.num_of_rows()*seqB.num_of_rows())) ;
 	} else {
 	    // compute average score for aligning the two alignment columns
 
@@ -233,19 +394,8 @@ namespace LocARNA {
 
 			score +=
 			    round2score(100.0 * params->ribofit->basematch_score(colA[i],colB[j],identity(i,j)));
-		    } else if (params->ribosum
-			&& params->ribosum->alphabet().in(colA[i])
-			&& params->ribosum->alphabet().in(colB[j])) {
-
-			score +=
-			    round2score(100.0 * params->ribosum->basematch_score_corrected(colA[i],colB[j]));
 		    } else {
-			if (colA[i]!='N' && colB[j]!='N') {
-			    score +=
-				(colA[i]==colB[j])
-				?params->basematch
-				:params->basemismatch;
-			}
+			score += symbol_similarity(colA[i],colB[j]);
 		    }
 		}
 	    }
@@ -254,6 +404,19 @@ namespace LocARNA {
 	}
     }
 
+    score_t
+    Scoring::symbol_similarity_(char x, char y) const {
+	if (params->ribosum
+	    && params->ribosum->alphabet().in(x)
+	    && params->ribosum->alphabet().in(y)) {
+	    return round2score(100.0 * params->ribosum->basematch_score_corrected(x,y));
+	}
+	if (x!='N' && y!='N') {
+	    return (x==y) ? params->basematch : params->basemismatch;
+	}
+	return 0;
+    }
+
     void
     Scoring::precompute_weights(const RnaData &rna_data,
 				const BasePairs &bps,
@@ -332,6 +495,8 @@ namespace LocARNA {
 	// resize and create tables
 	gapcost_tabA.resize(lenA+1);
 	gapcost_tabB.resize(lenB+1);
+	gapcost_tabA[0] = -params->unpaired_penalty;
+	gapcost_tabB[0] = -params->unpaired_penalty;
 	std::vector<float> gapfreqA(lenA+1,0);
 	std::vector<float> gapfreqB(lenB+1,0);
 
@@ -358,11 +523,13 @@ namespace LocARNA {
 	// compute position specific gap cost
 
 	for (size_type i=1; i<lenA+1; i++) {
-	    gapcost_tabA[i] = round2score((1-gapfreqA[i]) * params->indel);
+	    gapcost_tabA[i] = round2score((1-gapfreqA[i]) * params->indel)
+		- params->unpaired_penalty;
 	}
 
 	for (size_type i=1; i<lenB+1; i++) {
-	    gapcost_tabB[i] = round2score((1-gapfreqB[i]) * params->indel);
+	    gapcost_tabB[i] = round2score((1-gapfreqB[i]) * params->indel)
+		- params->unpaired_penalty;
 	}
 
     }
@@ -407,6 +574,46 @@ namespace LocARNA {
 
 	const Alphabet<char> &alphabet = ribosum->alphabet();
 
+	if (use_compositions) {
+	    // same as below, but iterate over the distinct symbol
+	    // pairs of the (gapless) rows
+	    assert(arcA.idx()<bp_compositionA.size());
+	    assert(arcB.idx()<bp_compositionB.size());
+	    const BasePairComposition &compA = bp_compositionA[arcA.idx()];
+	    const BasePairComposition &compB = bp_compositionB[arcB.idx()];
+
+	    size_type gaplessA=0;
+	    for (BasePairComposition::const_iterator itA=compA.begin(); compA.end()!=itA; ++itA) {
+		gaplessA += itA->second;
+	    }
+	    size_type gaplessB=0;
+	    for (BasePairComposition::const_iterator itB=compB.begin(); compB.end()!=itB; ++itB) {
+		gaplessB += itB->second;
+	    }
+	    gapless_combinations = gaplessA*gaplessB;
+
+	    for (BasePairComposition::const_iterator itA=compA.begin(); compA.end()!=itA; ++itA) {
+		const char &al = itA->first.first;
+		const char &ar = itA->first.second;
+		if (!alphabet.in(al) || !alphabet.in(ar)) continue;
+
+		for (BasePairComposition::const_iterator itB=compB.begin(); compB.end()!=itB; ++itB) {
+		    const char &bl = itB->first.first;
+		    const char &br = itB->first.second;
+		    if (!alphabet.in(bl) || !alphabet.in(br)) continue;
+
+		    score += (double)(itA->second*itB->second) *
+			log( ribosum->arcmatch_prob(al,ar,bl,br)
+			     /
+			     ( ribosum->basematch_prob(al,bl)
+			       *
+			       ribosum->basematch_prob(ar,br)) );
+		}
+	    }
+
+	    return exp(score / gapless_combinations);
+	}
+
 	// compute geometric mean
 	for(size_type i=0; i<rowsA; i++) { // run through all combinations of rows in A and B
 	    for(size_type j=0; j<rowsB; j++) {
@@ -464,6 +671,42 @@ namespace LocARNA {
 	// ribosum alphabet contain the same characters
 	const Alphabet<char> &alphabet = ribosum->alphabet();
 	
+	if (use_compositions) {
+	    // ribosum only (compositions are not used with ribofit);
+	    // same as below, but iterate over the distinct symbol
+	    // pairs of the (gapless) rows
+	    assert(arcA.idx()<bp_compositionA.size());
+	    assert(arcB.idx()<bp_compositionB.size());
+	    const BasePairComposition &compA = bp_compositionA[arcA.idx()];
+	    const BasePairComposition &compB = bp_compositionB[arcB.idx()];
+
+	    for (BasePairComposition::const_iterator itA=compA.begin(); compA.end()!=itA; ++itA) {
+		const char &al = itA->first.first;
+		const char &ar = itA->first.second;
+		if (!alphabet.in(al) || !alphabet.in(ar)) continue;
+
+		for (BasePairComposition::const_iterator itB=compB.begin(); compB.end()!=itB; ++itB) {
+		    const char &bl = itB->first.first;
+		    const char &br = itB->first.second;
+		    if (!alphabet.in(bl) || !alphabet.in(br)) continue;
+
+		    size_type count = itA->second*itB->second;
+		    considered_combinations += count;
+
+		    score += (double)count *
+			log( ribosum->arcmatch_prob(al,ar,bl,br)
+			     /
+			     ( ribosum->basepair_prob(al,ar)
+			       * ribosum->basepair_prob(bl,br) ) )
+			/ log(2);
+		}
+	    }
+	    
+	    if (considered_combinations==0) return 0;
+	    
+	    return round2score(100.0 * score / considered_combinations);
+	}
+	
 	for(size_type i=0; i<rowsA; i++) { // run through all combinations of rows in A and B
 	    for(size_type j=0; j<rowsB; j++) {
 		// how to handle gaps?
@@ -651,6 +894,10 @@ namespace LocARNA {
 	score_t score;
 	if (arc_matches->explicit_scores()) { // does not take stacking into account!!!
 	    score = arc_matches->get_score(am)  - 4*lambda_;
+	} else if (!arcmatch_tab.empty() && (!stacked || is_stackable_am(am))) {
+	    // the stacked table has no entries for non-stackable arc
+	    // matches; these are not looked up
+	    score = (stacked ? stacked_arcmatch_tab : arcmatch_tab)[am.idx()] - 4*lambda_;
 	} else {
 	    const  Arc &arcA = am.arcA();
 	    const  Arc &arcB = am.arcB();
@@ -661,6 +908,72 @@ namespace LocARNA {
 	return score; // modify for normalized alignment
     }
 
+    //! @brief compute a range of the arc match score tables
+    class Scoring::ArcmatchScoreTask : public ThreadPool::Task {
+	Scoring *scoring_;
+	size_type from_;
+	size_type to_;
+    public:
+	ArcmatchScoreTask(Scoring *scoring, size_type from, size_type to)
+	    : scoring_(scoring), from_(from), to_(to) {}
+
+	void
+	run() {
+	    const ArcMatches &arc_matches = *scoring_->arc_matches;
+	    bool stacking = !scoring_->stacked_arcmatch_tab.empty();
+	    // tables are stored for lambda=0
+	    score_t offset = 4*scoring_->lambda_;
+
+	    for (size_type idx=from_; idx<to_; ++idx) {
+		const ArcMatch &am = arc_matches.arcmatch(idx);
+		scoring_->arcmatch_tab[idx] =
+		    scoring_->arcmatch(am.arcA(),am.arcB(),false) + offset;
+		if (stacking && scoring_->is_stackable_am(am)) {
+		    scoring_->stacked_arcmatch_tab[idx] =
+			scoring_->arcmatch(am.arcA(),am.arcB(),true) + offset;
+		}
+	    }
+	}
+    };
+
+    bool
+    Scoring::precompute_arcmatch_scores(size_type max_memory, size_type num_threads) {
+	if (arc_matches->explicit_scores()) return false;
+
+	bool stacking = params->stacking || params->new_stacking;
+	size_type n = arc_matches->num_arc_matches();
+
+	if (n * sizeof(score_t) * (stacking?2:1) > max_memory) {
+	    arcmatch_tab.clear();
+	    stacked_arcmatch_tab.clear();
+	    return false;
+	}
+
+	// the tasks compute the scores from the arcs, which does not
+	// look up the tables
+	arcmatch_tab.resize(n);
+	stacked_arcmatch_tab.resize(stacking?n:0);
+
+	ThreadPool pool(num_threads);
+
+	// several contiguous chunks per thread for load balance
+	size_type chunks = std::min(n, 8*pool.size());
+	std::vector<ArcmatchScoreTask *> tasks;
+	for (size_type k=0; k<chunks; ++k) {
+	    tasks.push_back(new ArcmatchScoreTask(this, n*k/chunks, n*(k+1)/chunks));
+	    pool.submit(tasks.back());
+	}
+	try {
+	    pool.wait();
+	} catch (failure &f) {
+	    for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+	    throw;
+	}
+	for (size_type k=0; k<tasks.size(); ++k) delete tasks[k];
+
+	return true;
+    }
+
     // Very basic interface
     score_t
     Scoring::arcDel(const Arc &arcX, bool isA, bool stacked) const { //TODO Important Scoring scheme for aligning an arc to a gap is not defined and implemented!
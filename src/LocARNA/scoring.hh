@@ -7,6 +7,7 @@
 
 #include <math.h>
 #include <vector>
+#include <utility>
 
 #include "aux.hh"
 
@@ -320,6 +321,8 @@ namespace LocARNA {
 	 * @param exp_scores only if true, the results of the exp_*
 	 * scoring functions are defined, otherwise precomputations
 	 * can be ommitted.
+	 * @param num_threads number of threads for precomputing the
+	 * base match similarities (0 for number of processors)
 	 */
 	Scoring(const Sequence &seqA,
 		const Sequence &seqB,
@@ -328,7 +331,8 @@ namespace LocARNA {
 		const ArcMatches &arc_matches,
 		const MatchProbs *match_probs,
 		const ScoringParams &params,
-		bool exp_scores=false
+		bool exp_scores=false,
+		size_type num_threads=1
 		);
 
     
@@ -349,6 +353,9 @@ namespace LocARNA {
 	 * subtract the fixed unpaired_penalty from base match and base indel scores
 	 * it is similar to @modify_by_parameter method
 	 * Please note that the base match and gap scores of ALL bases including the paired ones will be modified!
+	 *
+	 * @note the constructor already includes the penalty in the
+	 * precomputed tables; calling this subtracts it once more.
 	 */
 	void
 	apply_unpaired_penalty();
@@ -359,6 +366,27 @@ namespace LocARNA {
 	 * @return lambda
 	 */
 	score_t lambda() const {return lambda_;}
+
+	/**
+	 * @brief Precompute the scores of all arc matches
+	 *
+	 * @param max_memory memory budget for the score tables in bytes
+	 * @param num_threads number of threads (0 for number of processors)
+	 *
+	 * @return whether the tables were computed, i.e. whether they
+	 * fit into the memory budget
+	 *
+	 * Afterwards, arcmatch(const ArcMatch &, bool) looks up the
+	 * scores in a table in the order of the arc match indices;
+	 * stacked scores are tabulated if stacking is turned on. This
+	 * pays off for multiple alignments, where each score sums over
+	 * all pairs of rows, and since arc match scores are queried
+	 * several times (recursion, trace back).
+	 *
+	 * @note without effect for explicit arc match scores
+	 */
+	bool
+	precompute_arcmatch_scores(size_type max_memory, size_type num_threads=1);
     
     private:
 	// ------------------------------
@@ -389,9 +417,85 @@ namespace LocARNA {
 	
 	Matrix<size_t> identity; //!< sequence identities in percent
 
+	std::vector<double> punA_tab; //!< unpaired probabilities in A (mea scoring only)
+	std::vector<double> punB_tab; //!< unpaired probabilities in B (mea scoring only)
+
+	//! index of each symbol (as unsigned char) in symbol_sim_tab
+	std::vector<size_type> symbol_idx;
+
+	//! similarities of the symbols of A and B (without ribofit)
+	//! @see symbol_similarity()
+	Matrix<score_t> symbol_sim_tab;
+
+	/**
+	 * optional table of arc match scores, indexed by arc match
+	 * index; empty if not precomputed. Entries are stored without
+	 * the modification by lambda_ (i.e. for lambda=0)
+	 * @see precompute_arcmatch_scores()
+	 */
+	std::vector<score_t> arcmatch_tab;
+
+	//! optional table of stacked arc match scores (analogous to
+	//! arcmatch_tab; entries of non-stackable arc matches are
+	//! undefined and never looked up, see is_stackable_am())
+	std::vector<score_t> stacked_arcmatch_tab;
+
+	class ArcmatchScoreTask;
+	class SigmaTask;
+
+	//! symbols of a profile column with their number of occurrences
+	typedef std::vector<std::pair<char,size_type> > ColumnComposition;
+
+	//! symbol pairs of the rows of a base pair (rows with gaps at
+	//! either end are omitted) with their number of occurrences
+	typedef std::vector<std::pair<std::pair<char,char>,size_type> > BasePairComposition;
+
+	/**
+	 * whether sequence similarities of columns and base pairs are
+	 * computed from compositions instead of all pairs of rows.
+	 * Set for multiple alignments unless ribofit is used (since
+	 * ribofit scores depend on the identity of each pair of rows).
+	 */
+	bool use_compositions;
+
+	std::vector<ColumnComposition> col_compositionA; //!< compositions of columns in A
+	std::vector<ColumnComposition> col_compositionB; //!< compositions of columns in B
+
+	//! compositions of base pairs in A, indexed by arc index
+	std::vector<BasePairComposition> bp_compositionA;
+	//! compositions of base pairs in B, indexed by arc index
+	std::vector<BasePairComposition> bp_compositionB;
+
 	void
 	precompute_sequence_identities();
 
+	/**
+	 * @brief Precompute column and base pair compositions
+	 *
+	 * Turns the sum-of-pairs similarities of two profiles into sums
+	 * over pairs of distinct symbols (weighted by their counts);
+	 * this costs O(d_A*d_B) instead of O(k_A*k_B) per column pair,
+	 * where d is the number of distinct symbols (at most the
+	 * alphabet size) and k the number of rows.
+	 */
+	void
+	precompute_compositions();
+
+	/**
+	 * @brief Precompute compositions for one sequence
+	 *
+	 * @param seq sequence (alignment)
+	 * @param bps base pairs of seq
+	 * @param[out] col_composition column compositions
+	 * @param[out] bp_composition base pair compositions
+	 */
+	static
+	void
+	precompute_compositions(const Sequence &seq,
+				const BasePairs &bps,
+				std::vector<ColumnComposition> &col_composition,
+				std::vector<BasePairComposition> &bp_composition);
+
 	/**
 	 * \brief Round a double to score_t.
 	 *
@@ -417,22 +521,60 @@ namespace LocARNA {
 	sigma_(int i, int j) const;
 
 	/**
-	 * \brief Precompute all base similarities
-	 * 
-	 * Precomputed similarities are stored in the sigma table.
+	 * \brief Similarity of two symbols (without ribofit)
+	 *
+	 * @param x symbol in A
+	 * @param y symbol in B
+	 *
+	 * @return ribosum score of x and y, or match/mismatch score if
+	 * no ribosum is given or x or y is not in its alphabet
+	 * @note used for precomputing the symbol similarities
+	 */
+	score_t
+	symbol_similarity_(char x, char y) const;
+
+	/**
+	 * \brief Similarity of two symbols (without ribofit)
+	 *
+	 * @param x symbol in A
+	 * @param y symbol in B
+	 *
+	 * @return symbol_similarity_(x,y), looked up in table
+	 * @pre x occurs in A and y occurs in B
+	 */
+	score_t
+	symbol_similarity(char x, char y) const {
+	    return symbol_sim_tab(symbol_idx[(unsigned char)x],
+				  symbol_idx[(unsigned char)y]);
+	}
+
+	/**
+	 * \brief Precompute the similarities of all symbols of A and B
+	 *
+	 * Precomputed similarities are stored in symbol_sim_tab; the
+	 * number of distinct symbols is small.
 	 */
 	void
-	precompute_sigma();
-	
+	precompute_symbol_similarities();
+
 	/**
-	 * \brief Precompute all Boltzmann weights of base similarities
-	 * 
-	 * Precomputed similarities are stored in the exp_sigma table.
+	 * \brief Precompute all base similarities
+	 *
+	 * @param exp_scores whether to precompute the Boltzmann
+	 * weights as well
+	 * @param num_threads number of threads (0 for number of processors)
+	 *
+	 * Precomputed similarities, which include the unpaired
+	 * penalty, are stored in the sigma table and their Boltzmann
+	 * weights in the exp_sigma table. The rows of the tables are
+	 * split into ranges that are computed in parallel; each weight
+	 * is computed in the same pass as the similarity.
 	 */
 	void
-	precompute_exp_sigma();
+	precompute_sigma(bool exp_scores, size_type num_threads);
 
-	//! \brief Precompute the tables for gapcost
+	//! \brief Precompute the tables for gapcost (including the
+	//! unpaired penalty)
 	void
 	precompute_gapcost();
 
@@ -0,0 +1,168 @@
+#include "sparse_mea_aligner.hh"
+
+#include <algorithm>
+
+namespace LocARNA {
+
+    //! @brief weighted match (cell of the sparse recursion)
+    struct MEACell {
+	pos_type i; //!< position in A
+	pos_type k; //!< position in B
+	double w; //!< weight
+
+	//! @brief order by rows, then columns
+	bool
+	operator <(const MEACell &x) const {
+	    return i<x.i || (i==x.i && k<x.k);
+	}
+    };
+
+    /**
+     * @brief Prefix maximum tree (Fenwick tree) over the columns
+     *
+     * Stores for each column the best score of a cell in this column
+     * (and the cell) and answers maximum queries over prefixes of
+     * columns. For equal scores, the earlier inserted cell wins.
+     */
+    class PrefixMaxTree {
+	std::vector<double> value_; //!< maximum scores
+	std::vector<size_t> cell_; //!< cells of the maximum scores
+    public:
+	//! no cell
+	static const size_t none = (size_t)-1;
+
+	//! @brief construct for columns 1..n, all scores 0
+	explicit
+	PrefixMaxTree(size_t n): value_(n+1,0.0), cell_(n+1,none) {}
+
+	//! @brief update column k by score of cell
+	void
+	update(size_t k, double value, size_t cell) {
+	    for (; k<value_.size(); k+=k&(-k)) {
+		if (value > value_[k]) {
+		    value_[k]=value;
+		    cell_[k]=cell;
+		}
+	    }
+	}
+
+	//! @brief maximum over columns 1..k
+	void
+	query(size_t k, double &value, size_t &cell) const {
+	    value=0.0;
+	    cell=none;
+	    for (; k>0; k-=k&(-k)) {
+		if (value_[k] > value || (value_[k]==value && cell_[k]<cell)) {
+		    value=value_[k];
+		    cell=cell_[k];
+		}
+	    }
+	}
+    };
+
+    SparseMEAAligner::SparseMEAAligner(size_type lenA, size_type lenB, double am_weight)
+	: lenA_(lenA),
+	  lenB_(lenB),
+	  am_weight_(am_weight),
+	  weights_(0.0),
+	  matches_(),
+	  score_(0.0)
+    {}
+
+    void
+    SparseMEAAligner::add_basematch_prob(pos_type i, pos_type k, double p) {
+	assert(1<=i && i<=lenA_ && 1<=k && k<=lenB_);
+	weights_(i,k) += p;
+    }
+
+    void
+    SparseMEAAligner::add_arcmatch_prob(pos_type al, pos_type ar,
+					pos_type bl, pos_type br, double p) {
+	assert(1<=al && ar<=lenA_ && 1<=bl && br<=lenB_);
+	weights_(al,bl) += am_weight_*p;
+	weights_(ar,br) += am_weight_*p;
+    }
+
+    double
+    SparseMEAAligner::align() {
+	std::vector<MEACell> cells;
+	for (SparseMatrix<double>::const_iterator it=weights_.begin();
+	     weights_.end()!=it; ++it) {
+	    if (it->second > 0.0) {
+		MEACell c;
+		c.i=it->first.first;
+		c.k=it->first.second;
+		c.w=it->second;
+		cells.push_back(c);
+	    }
+	}
+	// determines the order of summation and tie breaking
+	std::sort(cells.begin(),cells.end());
+
+	std::vector<double> best(cells.size());
+	std::vector<size_t> pred(cells.size());
+
+	PrefixMaxTree tree(lenB_);
+
+	size_t best_cell=PrefixMaxTree::none;
+	score_=0.0;
+
+	for (size_t first=0; first<cells.size(); ) {
+	    // cells of the current row; they cannot precede each other,
+	    // therefore update the tree only after the whole row
+	    size_t last=first;
+	    while (last<cells.size() && cells[last].i==cells[first].i) ++last;
+
+	    for (size_t c=first; c<last; ++c) {
+		double value;
+		tree.query(cells[c].k-1,value,pred[c]);
+		best[c] = value + cells[c].w;
+		if (best[c] > score_) {
+		    score_=best[c];
+		    best_cell=c;
+		}
+	    }
+	    for (size_t c=first; c<last; ++c) {
+		tree.update(cells[c].k,best[c],c);
+	    }
+	    first=last;
+	}
+
+	// traceback
+	matches_.clear();
+	for (size_t c=best_cell; c!=PrefixMaxTree::none; c=pred[c]) {
+	    matches_.push_back(std::make_pair(cells[c].i,cells[c].k));
+	}
+	std::reverse(matches_.begin(),matches_.end());
+
+	return score_;
+    }
+
+    Alignment::edges_t
+    SparseMEAAligner::alignment_edges() const {
+	Alignment::edge_ends_t endsA;
+	Alignment::edge_ends_t endsB;
+
+	pos_type i=1;
+	pos_type k=1;
+	for (size_type m=0; m<=matches_.size(); ++m) {
+	    pos_type next_i = (m<matches_.size()) ? matches_[m].first : lenA_+1;
+	    pos_type next_k = (m<matches_.size()) ? matches_[m].second : lenB_+1;
+	    for (; i<next_i; ++i) {
+		endsA.push_back(i);
+		endsB.push_back(Gap::regular);
+	    }
+	    for (; k<next_k; ++k) {
+		endsA.push_back(Gap::regular);
+		endsB.push_back(k);
+	    }
+	    if (m<matches_.size()) {
+		endsA.push_back(i++);
+		endsB.push_back(k++);
+	    }
+	}
+
+	return Alignment::edges_t(endsA,endsB);
+    }
+
+} // end namespace LocARNA
@@ -0,0 +1,122 @@
+#ifndef LOCARNA_SPARSE_MEA_ALIGNER_HH
+#define LOCARNA_SPARSE_MEA_ALIGNER_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+
+#include "aux.hh"
+#include "alignment.hh"
+#include "sparse_matrix.hh"
+
+namespace LocARNA {
+
+    /**
+     * @brief Sparse maximum expected accuracy alignment
+     *
+     * Computes the alignment of two sequences that maximizes the sum
+     * of the weights of its matches (in the spirit of ProbCons,
+     * posterior decoding), where the weights are given sparsely by
+     * base and arc match probabilities (e.g. from AlignerP): each base
+     * match probability P(i~k) adds to the weight of (i,k); each arc
+     * match probability adds, multiplied by the arc match weight, to
+     * the weights of the matches of the left and of the right arc
+     * ends. Gaps are free.
+     *
+     * Only matches of positive weight are visited: the recursion
+     *
+     *   best(i,k) = w(i,k) + max(0, max { best(i',k') | i'<i, k'<k })
+     *
+     * is evaluated row by row with a prefix maximum tree over the
+     * columns in O(K log lenB) time and O(K+lenB) space for K
+     * weighted matches; there are no dense lenA x lenB matrices.
+     *
+     * Typical usage: construct, add probabilities, align(), and then
+     * alignment_edges().
+     */
+    class SparseMEAAligner {
+    public:
+	typedef size_t size_type; //!< size type
+
+    private:
+	size_type lenA_; //!< length of A
+	size_type lenB_; //!< length of B
+	double am_weight_; //!< weight of arc match probabilities
+
+	SparseMatrix<double> weights_; //!< weights of matches
+
+	std::vector<std::pair<pos_type,pos_type> > matches_; //!< matches of the alignment
+	double score_; //!< expected accuracy of the alignment
+
+    public:
+	/**
+	 * @brief Construct
+	 *
+	 * @param lenA length of sequence A
+	 * @param lenB length of sequence B
+	 * @param am_weight weight of arc match probabilities for the
+	 * matches of their ends
+	 */
+	SparseMEAAligner(size_type lenA, size_type lenB, double am_weight);
+
+	/**
+	 * @brief Add base match probability
+	 *
+	 * @param i position in A
+	 * @param k position in B
+	 * @param p probability of match i~k
+	 */
+	void
+	add_basematch_prob(pos_type i, pos_type k, double p);
+
+	/**
+	 * @brief Add arc match probability
+	 *
+	 * @param al left end of arc in A
+	 * @param ar right end of arc in A
+	 * @param bl left end of arc in B
+	 * @param br right end of arc in B
+	 * @param p probability of the arc match
+	 */
+	void
+	add_arcmatch_prob(pos_type al, pos_type ar, pos_type bl, pos_type br, double p);
+
+	/**
+	 * @brief Compute the MEA alignment
+	 *
+	 * @return expected accuracy, i.e. sum of the weights of the
+	 * matches
+	 */
+	double
+	align();
+
+	//! @brief expected accuracy of the alignment
+	//! @pre align() was called
+	double
+	score() const {return score_;}
+
+	/**
+	 * @brief Matches of the alignment
+	 *
+	 * @return matched positions, increasing in both sequences
+	 * @pre align() was called
+	 */
+	const std::vector<std::pair<pos_type,pos_type> > &
+	matches() const {return matches_;}
+
+	/**
+	 * @brief Edges of the alignment
+	 *
+	 * @return alignment edges of the global alignment, where
+	 * unmatched positions are deleted/inserted between the matches
+	 * @pre align() was called
+	 */
+	Alignment::edges_t
+	alignment_edges() const;
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_SPARSE_MEA_ALIGNER_HH
@@ -67,7 +67,7 @@ void SparsificationMapper::compute_mapping_idx_left_ends(){
 		info_valid_seq_pos_vecs.at(cur_left_end).push_back(struct_pos);
 		valid_mat_pos_vecs_before_eq.at(cur_left_end).push_back(0);
 		pos_type max_right_end= (bps.left_adjlist(cur_left_end).begin()==bps.left_adjlist(cur_left_end).end()) ? 0
-				:(--bps.left_adjlist(cur_left_end).end())->right();
+				:(bps.left_adjlist(cur_left_end).end()-1)->right();
 		if (cur_left_end == 0)
 		    max_right_end = seq_length+1;
 		for(pos_type cur_pos=cur_left_end+1;cur_pos<max_right_end;cur_pos++){
@@ -7,16 +7,30 @@
 
 
 namespace LocARNA {
+    //! @brief lock a mutex for the lifetime of the object
+    class StopWatchLock {
+	pthread_mutex_t *mutex_;
+    public:
+	//! @brief lock
+	explicit
+	StopWatchLock(pthread_mutex_t &mutex): mutex_(&mutex) { pthread_mutex_lock(mutex_); }
+
+	//! @brief unlock
+	~StopWatchLock() { pthread_mutex_unlock(mutex_); }
+    };
+
     // ------------------------------------------------------------
     // implement StopWatch
     
     StopWatch::StopWatch(bool print_on_exit_): print_on_exit(print_on_exit_) {
+	pthread_mutex_init(&mutex_,NULL);
     }
 
     StopWatch::~StopWatch() {
 	if (print_on_exit) {
 	    print_info(std::cerr);
 	}
+	pthread_mutex_destroy(&mutex_);
     }
 
     void
@@ -26,6 +40,7 @@ namespace LocARNA {
     
     bool
     StopWatch::start(const std::string &name) {
+	StopWatchLock lock(mutex_);
 	timer_t &t=timers[name];
 	
 	if (t.running) return false;
@@ -38,6 +53,7 @@ namespace LocARNA {
 
     bool
     StopWatch::stop(const std::string &name) {
+	StopWatchLock lock(mutex_);
 	assert(timers.find(name)!=timers.end());
 	
 	timer_t &t=timers[name];
@@ -53,6 +69,7 @@ namespace LocARNA {
 
     bool
     StopWatch::is_running(const std::string &name) const {
+	StopWatchLock lock(mutex_);
 	map_t::const_iterator it = timers.find(name);
 	assert(it!=timers.end());
 	const timer_t &t=it->second;
@@ -61,6 +78,7 @@ namespace LocARNA {
 
     double
     StopWatch::current_total(const std::string &name) const {
+	StopWatchLock lock(mutex_);
 	map_t::const_iterator it = timers.find(name);
 	assert(it!=timers.end());
 	const timer_t &t=it->second;
@@ -71,6 +89,7 @@ namespace LocARNA {
     }
 	
     size_t StopWatch::current_cycles(const std::string &name) const {
+	StopWatchLock lock(mutex_);
 	map_t::const_iterator it = timers.find(name);
 	assert(it!=timers.end());
 	const timer_t &t=it->second;
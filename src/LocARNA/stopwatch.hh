@@ -8,11 +8,16 @@
 #include "aux.hh"
 #include <iosfwd>
 #include <string>
+#include <pthread.h>
 
 
 namespace LocARNA {    
     /**
      * @brief control a set of named stop watch like timers
+     *
+     * Starting, stopping and querying timers is thread-safe; a timer
+     * that is started by several threads at the same time runs until
+     * the first of them stops it.
      */
     class StopWatch {
     private:
@@ -32,6 +37,8 @@ namespace LocARNA {
 	
 	bool print_on_exit;
 
+	mutable pthread_mutex_t mutex_; //!< protects timers
+
     public:
 	
 	/** 
@@ -11,10 +11,10 @@
 
 #include "aux.hh"
 #include "sequence.hh"
+#include "matrix.hh"
 
 namespace LocARNA {
 
-    template <class T> class Matrix;
     template <class T> class Alphabet;
     class RnaData;
 
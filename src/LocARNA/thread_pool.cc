@@ -0,0 +1,146 @@
+#include "thread_pool.hh"
+#include "aux.hh"
+
+#include <unistd.h>
+#include <exception>
+
+namespace LocARNA {
+
+    ThreadPool::Task::~Task() {}
+
+    ThreadPool::ThreadPool(size_type num_threads)
+	: threads_(),
+	  queue_(),
+	  pending_(0),
+	  shutdown_(false),
+	  error_(),
+	  failed_(false)
+    {
+	pthread_mutex_init(&mutex_,NULL);
+	pthread_cond_init(&work_cond_,NULL);
+	pthread_cond_init(&done_cond_,NULL);
+
+	if (num_threads==0) {
+	    num_threads = hardware_threads();
+	}
+
+	if (num_threads<=1) return; // sequential mode
+
+	threads_.resize(num_threads);
+	for (size_type i=0; i<num_threads; ++i) {
+	    if (pthread_create(&threads_[i],NULL,worker_main,this)!=0) {
+		// run with the threads we got so far
+		threads_.resize(i);
+		break;
+	    }
+	}
+    }
+
+    ThreadPool::~ThreadPool() {
+	pthread_mutex_lock(&mutex_);
+	while (pending_>0) {
+	    pthread_cond_wait(&done_cond_,&mutex_);
+	}
+	shutdown_=true;
+	pthread_cond_broadcast(&work_cond_);
+	pthread_mutex_unlock(&mutex_);
+
+	for (size_type i=0; i<threads_.size(); ++i) {
+	    pthread_join(threads_[i],NULL);
+	}
+
+	pthread_cond_destroy(&done_cond_);
+	pthread_cond_destroy(&work_cond_);
+	pthread_mutex_destroy(&mutex_);
+    }
+
+    ThreadPool::size_type
+    ThreadPool::hardware_threads() {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n<1 ? 1 : (size_type)n;
+    }
+
+    void
+    ThreadPool::run_task(Task *task) {
+	std::string msg;
+	bool ok=true;
+	try {
+	    task->run();
+	} catch (std::exception &e) {
+	    ok=false;
+	    msg=e.what();
+	} catch (...) {
+	    ok=false;
+	    msg="Unknown exception in worker thread.";
+	}
+
+	if (!ok) {
+	    pthread_mutex_lock(&mutex_);
+	    if (!failed_) {
+		failed_=true;
+		error_=msg;
+	    }
+	    pthread_mutex_unlock(&mutex_);
+	}
+    }
+
+    void *
+    ThreadPool::worker_main(void *p) {
+	ThreadPool *pool = static_cast<ThreadPool *>(p);
+
+	pthread_mutex_lock(&pool->mutex_);
+	while (true) {
+	    while (!pool->shutdown_ && pool->queue_.empty()) {
+		pthread_cond_wait(&pool->work_cond_,&pool->mutex_);
+	    }
+	    if (pool->queue_.empty()) break; // shutdown
+
+	    Task *task = pool->queue_.front();
+	    pool->queue_.pop_front();
+	    pthread_mutex_unlock(&pool->mutex_);
+
+	    pool->run_task(task);
+
+	    pthread_mutex_lock(&pool->mutex_);
+	    pool->pending_--;
+	    if (pool->pending_==0) {
+		pthread_cond_broadcast(&pool->done_cond_);
+	    }
+	}
+	pthread_mutex_unlock(&pool->mutex_);
+
+	return NULL;
+    }
+
+    void
+    ThreadPool::submit(Task *task) {
+	if (threads_.empty()) {
+	    run_task(task);
+	    return;
+	}
+
+	pthread_mutex_lock(&mutex_);
+	queue_.push_back(task);
+	pending_++;
+	pthread_cond_signal(&work_cond_);
+	pthread_mutex_unlock(&mutex_);
+    }
+
+    void
+    ThreadPool::wait() {
+	pthread_mutex_lock(&mutex_);
+	while (pending_>0) {
+	    pthread_cond_wait(&done_cond_,&mutex_);
+	}
+	bool failed=failed_;
+	std::string msg=error_;
+	failed_=false;
+	error_="";
+	pthread_mutex_unlock(&mutex_);
+
+	if (failed) {
+	    throw failure(msg);
+	}
+    }
+
+} // end namespace LocARNA
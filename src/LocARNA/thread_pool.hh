@@ -0,0 +1,136 @@
+#ifndef LOCARNA_THREAD_POOL_HH
+#define LOCARNA_THREAD_POOL_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace LocARNA {
+
+    /**
+     * @brief Fixed size pool of worker threads (based on pthreads)
+     *
+     * Tasks are objects derived from ThreadPool::Task; they are
+     * executed in submission order by the first idle worker. Tasks
+     * may submit further tasks to the pool they run in, which allows
+     * to schedule dependent work (e.g. a parent node of a tree as
+     * soon as both children are done).
+     *
+     * A pool with at most one thread does not start any threads, but
+     * runs each task directly in submit(). In consequence, code using
+     * the pool behaves identical in sequential and parallel mode.
+     *
+     * Exceptions thrown by tasks are caught in the workers; wait()
+     * rethrows the first of them as failure.
+     *
+     * @note The pool does not take ownership of the tasks.
+     */
+    class ThreadPool {
+    public:
+	typedef size_t size_type; //!< size type
+
+	/**
+	 * @brief Unit of work for the thread pool
+	 */
+	class Task {
+	public:
+	    //! @brief virtual destructor
+	    virtual
+	    ~Task();
+
+	    //! @brief perform the work
+	    virtual
+	    void
+	    run()=0;
+	};
+
+    private:
+	std::vector<pthread_t> threads_; //!< worker threads
+	std::deque<Task *> queue_; //!< tasks waiting for a worker
+
+	pthread_mutex_t mutex_; //!< protects all members below
+	pthread_cond_t work_cond_; //!< signals new work or shutdown
+	pthread_cond_t done_cond_; //!< signals that all work is done
+
+	size_type pending_; //!< number of submitted, unfinished tasks
+	bool shutdown_; //!< whether workers shall terminate
+	std::string error_; //!< message of first failed task
+	bool failed_; //!< whether a task failed
+
+	//! @brief main loop of a worker
+	static
+	void *
+	worker_main(void *pool);
+
+	//! @brief run a task and record its failure
+	void
+	run_task(Task *task);
+
+	//! @brief no copy
+	ThreadPool(const ThreadPool &);
+
+	//! @brief no assignment
+	ThreadPool &
+	operator =(const ThreadPool &);
+
+    public:
+	/**
+	 * @brief Construct with number of threads
+	 *
+	 * @param num_threads number of worker threads; if 0, use the
+	 * number of online processors; for 1, run sequentially
+	 */
+	explicit
+	ThreadPool(size_type num_threads);
+
+	/**
+	 * @brief Destructor
+	 *
+	 * Waits for all pending tasks and joins the workers.
+	 */
+	~ThreadPool();
+
+	/**
+	 * @brief Number of (virtual) worker threads
+	 *
+	 * @return number of threads (1 in sequential mode)
+	 */
+	size_type
+	size() const { return threads_.empty() ? 1 : threads_.size(); }
+
+	/**
+	 * @brief Submit a task
+	 *
+	 * @param task task to be run
+	 *
+	 * @note in sequential mode, the task is run immediately
+	 */
+	void
+	submit(Task *task);
+
+	/**
+	 * @brief Wait until all submitted tasks are finished
+	 *
+	 * @throw failure if some task threw an exception
+	 */
+	void
+	wait();
+
+	/**
+	 * @brief Number of online processors
+	 *
+	 * @return number of processors (at least 1)
+	 */
+	static
+	size_type
+	hardware_threads();
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_THREAD_POOL_HH
@@ -0,0 +1,230 @@
+#include "variant_aligner.hh"
+
+#include <algorithm>
+#include <sstream>
+#include <cctype>
+
+#include "rna_data.hh"
+#include "rna_ensemble.hh"
+#include "sequence.hh"
+#include "multiple_alignment.hh"
+#include "sequence_annotation.hh"
+#include "arc_matches.hh"
+#include "scoring.hh"
+#include "aligner.hh"
+#include "arena.hh"
+
+namespace LocARNA {
+
+    VariantAligner::VariantAligner(const RnaData &rna_dataA,
+				   const RnaData &rna_dataB,
+				   const ProfileAlignmentParams &params,
+				   const PFoldParams &pfoldparams,
+				   double max_bps_length_ratio,
+				   double prob_tolerance)
+	: rna_dataA_(rna_dataA),
+	  rna_dataB_(rna_dataB),
+	  params_(params),
+	  pfoldparams_(pfoldparams),
+	  max_bps_length_ratio_(max_bps_length_ratio),
+	  prob_tolerance_(prob_tolerance),
+	  base_(NULL),
+	  base_score_(infty_score_t::neg_infty),
+	  reused_entries_(0),
+	  num_entries_(0)
+    {
+	// the base problem lives as long as the object; therefore it
+	// is not allocated from the thread arena; it is never traced,
+	// such that its aligner computes only the score
+	base_ = new ProfileAlignmentProblem(rna_dataA_,rna_dataB_,params_,NULL,true);
+	base_score_ = base_->aligner().align();
+    }
+
+    VariantAligner::~VariantAligner() {
+	delete base_;
+    }
+
+    //! @brief whether an arc match has equal scores in two problems
+    static
+    bool
+    equal_arcmatch_scores(const Scoring &scoring, const ArcMatch &am,
+			  const Scoring &base_scoring, const ArcMatch &base_am) {
+	if (scoring.arcmatch(am) != base_scoring.arcmatch(base_am)) {
+	    return false;
+	}
+	if (scoring.stacking()) {
+	    bool stackable = scoring.is_stackable_am(am);
+	    if (stackable != base_scoring.is_stackable_am(base_am)) {
+		return false;
+	    }
+	    if (stackable
+		&& scoring.arcmatch(am,true) != base_scoring.arcmatch(base_am,true)) {
+		return false;
+	    }
+	}
+	return true;
+    }
+
+    std::vector<size_t>
+    VariantAligner::reusable_entries(const ProfileAlignmentProblem &variant) const {
+	const ArcMatches &arc_matches = variant.arc_matches();
+	const ArcMatches &base_arc_matches = base_->arc_matches();
+	const Scoring &scoring = variant.scoring();
+	const Scoring &base_scoring = base_->scoring();
+
+	size_type lenA = rna_dataA_.length();
+	size_type lenB = rna_dataB_.length();
+
+	const size_type invalid_idx = base_arc_matches.num_arc_matches();
+	std::vector<size_t> base_idx(arc_matches.num_arc_matches(),invalid_idx);
+
+	// the scores of B must not change at all
+	for (size_type j=1; j<=lenB; ++j) {
+	    if (scoring.gapB(j)!=base_scoring.gapB(j)) {
+		return base_idx;
+	    }
+	}
+
+	// Changes are intervals of A: single positions and the arcs of
+	// changed arc matches. For each left end, keep the minimal right
+	// end of a change; an arc [l,r] encloses a change, iff the
+	// minimum over all left ends in [l,lenA] is at most r.
+	std::vector<size_type> min_right(lenA+2,lenA+1);
+
+	for (size_type i=1; i<=lenA; ++i) {
+	    bool changed = scoring.gapA(i)!=base_scoring.gapA(i);
+	    for (size_type j=1; !changed && j<=lenB; ++j) {
+		changed = scoring.basematch(i,j)!=base_scoring.basematch(i,j);
+	    }
+	    if (changed) {
+		min_right[i]=i;
+	    }
+	}
+
+	std::vector<bool> base_matched(base_arc_matches.num_arc_matches(),false);
+
+	for (ArcMatches::const_iterator it=arc_matches.begin(); arc_matches.end()!=it; ++it) {
+	    const ArcMatch::Arc &arcA = it->arcA();
+	    const ArcMatch::Arc &arcB = it->arcB();
+
+	    // find the arc match of the same arcs in the base problem
+	    size_type found = invalid_idx;
+	    const ArcMatchIdxVec &list =
+		base_arc_matches.common_left_end_list(arcA.left(),arcB.left());
+	    for (ArcMatchIdxVec::const_iterator it2=list.begin(); list.end()!=it2; ++it2) {
+		const ArcMatch &base_am = base_arc_matches.arcmatch(*it2);
+		if (base_am.arcA().right()==arcA.right()
+		    && base_am.arcB().right()==arcB.right()) {
+		    found = *it2;
+		    break;
+		}
+	    }
+
+	    if (found!=invalid_idx) {
+		base_matched[found]=true;
+		if (equal_arcmatch_scores(scoring,*it,
+					  base_scoring,base_arc_matches.arcmatch(found))) {
+		    base_idx[it->idx()]=found;
+		    continue;
+		}
+	    }
+	    min_right[arcA.left()] = std::min(min_right[arcA.left()],arcA.right());
+	}
+
+	// arc matches that exist only in the base problem
+	for (ArcMatches::const_iterator it=base_arc_matches.begin();
+	     base_arc_matches.end()!=it; ++it) {
+	    if (!base_matched[it->idx()]) {
+		const ArcMatch::Arc &arcA = it->arcA();
+		min_right[arcA.left()] = std::min(min_right[arcA.left()],arcA.right());
+	    }
+	}
+
+	for (size_type l=lenA; l>=1; --l) {
+	    min_right[l] = std::min(min_right[l],min_right[l+1]);
+	}
+
+	// only arc matches without enclosed changes are reused
+	for (ArcMatches::const_iterator it=arc_matches.begin(); arc_matches.end()!=it; ++it) {
+	    const ArcMatch::Arc &arcA = it->arcA();
+	    if (min_right[arcA.left()] <= arcA.right()) {
+		base_idx[it->idx()]=invalid_idx;
+	    }
+	}
+
+	return base_idx;
+    }
+
+    infty_score_t
+    VariantAligner::align(const substitution_vec_t &substitutions,
+			  Alignment::edges_t *edges) {
+	const Sequence &seqA = rna_dataA_.sequence();
+
+	if (seqA.num_of_rows()!=1) {
+	    throw failure("VariantAligner: substitutions require a single sequence.");
+	}
+
+	std::string seqstr = seqA.seqentry(0).seq().str();
+	for (substitution_vec_t::const_iterator it=substitutions.begin();
+	     substitutions.end()!=it; ++it) {
+	    char c = toupper(it->second);
+	    if (c=='T') c='U';
+	    if (it->first<1 || it->first>seqstr.length()
+		|| std::string("ACGU").find(c)==std::string::npos) {
+		std::ostringstream err;
+		err << "VariantAligner: invalid substitution "
+		    << it->first << it->second << ".";
+		throw failure(err.str());
+	    }
+	    seqstr[it->first-1]=c;
+	}
+
+	Sequence variant_seq(seqA.seqentry(0).name(),seqstr);
+	if (seqA.has_annotation(MultipleAlignment::AnnoType::anchors)) {
+	    variant_seq.set_annotation(MultipleAlignment::AnnoType::anchors,
+				       seqA.annotation(MultipleAlignment::AnnoType::anchors));
+	}
+
+	RnaEnsemble rna_ensemble(variant_seq,pfoldparams_,false,true);
+	RnaData variantA(rna_ensemble,
+			 params_.min_prob,
+			 max_bps_length_ratio_,
+			 pfoldparams_);
+	if (prob_tolerance_>0) {
+	    variantA.snap_probabilities(rna_dataA_,prob_tolerance_);
+	}
+
+	return align(variantA,edges);
+    }
+
+    infty_score_t
+    VariantAligner::align(const RnaData &variantA,
+			  Alignment::edges_t *edges) {
+	if (variantA.length()!=rna_dataA_.length()) {
+	    throw failure("VariantAligner: variant differs in length.");
+	}
+
+	// allocate the D and M matrices of the variant from the arena
+	// of the thread (as ProgressiveAligner::align_profiles())
+	ProfileAlignmentProblem variant(variantA,rna_dataB_,params_,NULL,edges==NULL,
+					&Arena::thread_arena());
+
+	std::vector<size_t> base_idx = reusable_entries(variant);
+
+	const size_type invalid_idx = base_->arc_matches().num_arc_matches();
+	num_entries_ = base_idx.size();
+	reused_entries_ = num_entries_
+	    - std::count(base_idx.begin(),base_idx.end(),invalid_idx);
+
+	Aligner &aligner = variant.aligner();
+	infty_score_t score = aligner.align_reusing(base_->aligner(),base_idx);
+
+	if (edges) {
+	    aligner.trace();
+	    *edges = aligner.get_alignment().alignment_edges(false);
+	}
+
+	return score;
+    }
+
+} // end namespace LocARNA
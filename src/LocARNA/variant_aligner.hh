@@ -0,0 +1,165 @@
+#ifndef LOCARNA_VARIANT_ALIGNER_HH
+#define LOCARNA_VARIANT_ALIGNER_HH
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+#include <utility>
+
+#include "aux.hh"
+#include "scoring_fwd.hh"
+#include "alignment.hh"
+#include "pfold_params.hh"
+#include "progressive_aligner.hh"
+
+namespace LocARNA {
+
+    class RnaData;
+
+    /**
+     * @brief Alignment of sequence variants against a fixed partner
+     *
+     * Aligns an RNA A to an RNA B once (the base alignment) and then
+     * aligns variants of A, which differ from A by point
+     * substitutions, to B. The D entries of all arc matches whose
+     * arc in A does not enclose any change are copied from the base
+     * alignment; pairs of left ends where all entries are reused do
+     * not recompute their M matrices (see Aligner::align_reusing()).
+     *
+     * Changes are detected by comparing the scores of the base and
+     * the variant problem: a position of A changed, if one of its
+     * base match or gap scores differs; an arc of A changed, if it
+     * occurs in only one of the problems or one of its arc match
+     * scores differs. Reuse is therefore exact, i.e. the variant
+     * score is the one of a full alignment. Note that scores that
+     * depend on the whole sequence, like ribofit scores (sequence
+     * identity), prevent reuse.
+     *
+     * Folding the variant cannot be restricted to the changed
+     * positions; the variant is refolded completely, which is cheap
+     * compared to the alignment. Since the base pair probabilities of
+     * the variant then differ slightly everywhere, base pair
+     * probabilities that changed by at most a tolerance are set to the
+     * ones of A before aligning (see RnaData::snap_probabilities()).
+     *
+     * @note A and B must live as long as the object.
+     */
+    class VariantAligner {
+    public:
+	typedef size_t size_type; //!< size type
+
+	//! point substitution: position in A (1-based) and new nucleotide
+	typedef std::pair<size_type,char> substitution_t;
+
+	//! vector of substitutions
+	typedef std::vector<substitution_t> substitution_vec_t;
+
+    private:
+	const RnaData &rna_dataA_; //!< RNA A
+	const RnaData &rna_dataB_; //!< RNA B
+	ProfileAlignmentParams params_; //!< alignment parameters
+	PFoldParams pfoldparams_; //!< folding parameters
+	double max_bps_length_ratio_; //!< filter for the variant base pairs
+	double prob_tolerance_; //!< tolerance of variant probabilities
+
+	ProfileAlignmentProblem *base_; //!< base alignment problem
+	infty_score_t base_score_; //!< score of the base alignment
+
+	size_type reused_entries_; //!< reused D entries of the last variant
+	size_type num_entries_; //!< D entries of the last variant
+
+	/**
+	 * @brief Determine the reusable D entries of a variant
+	 *
+	 * @param variant alignment problem of the variant
+	 * @return for each arc match of the variant, the index of the
+	 * arc match of the base problem with equal D entry, or the
+	 * base's number of arc matches
+	 */
+	std::vector<size_t>
+	reusable_entries(const ProfileAlignmentProblem &variant) const;
+
+	//! @brief no copy
+	VariantAligner(const VariantAligner &);
+
+	//! @brief no assignment
+	VariantAligner &
+	operator =(const VariantAligner &);
+
+    public:
+	/**
+	 * @brief Construct and compute the base alignment
+	 *
+	 * @param rna_dataA RNA A (single sequence)
+	 * @param rna_dataB RNA B
+	 * @param params alignment parameters
+	 * @param pfoldparams parameters for folding variants
+	 * @param max_bps_length_ratio maximal ratio of base pairs per
+	 * sequence length of variants (0 for no effect)
+	 * @param prob_tolerance base pair probabilities of variants
+	 * that differ by at most prob_tolerance from the ones of A
+	 * are set to the latter (0 for exact)
+	 */
+	VariantAligner(const RnaData &rna_dataA,
+		       const RnaData &rna_dataB,
+		       const ProfileAlignmentParams &params,
+		       const PFoldParams &pfoldparams,
+		       double max_bps_length_ratio,
+		       double prob_tolerance);
+
+	//! @brief destructor
+	~VariantAligner();
+
+	//! @brief score of the base alignment
+	infty_score_t
+	base_score() const { return base_score_; }
+
+	/**
+	 * @brief Align a variant given by substitutions
+	 *
+	 * Applies the substitutions to A, folds the variant and
+	 * aligns it to B.
+	 *
+	 * @param substitutions point substitutions
+	 * @param[out] edges if not NULL, trace back and return the
+	 * alignment edges
+	 * @return score of the variant alignment
+	 *
+	 * @throw failure if a substitution is out of range, the
+	 * nucleotide is not one of ACGU, or A is an alignment
+	 */
+	infty_score_t
+	align(const substitution_vec_t &substitutions,
+	      Alignment::edges_t *edges);
+
+	/**
+	 * @brief Align a variant given as RNA data
+	 *
+	 * @param variantA RNA data of the variant; same length as A
+	 * @param[out] edges if not NULL, trace back and return the
+	 * alignment edges
+	 * @return score of the variant alignment
+	 *
+	 * @note The probabilities of variantA are used as given;
+	 * prob_tolerance is not applied.
+	 *
+	 * @throw failure if the length differs from the one of A
+	 */
+	infty_score_t
+	align(const RnaData &variantA,
+	      Alignment::edges_t *edges);
+
+	//! @brief number of D entries reused for the last variant
+	size_type
+	reused_entries() const { return reused_entries_; }
+
+	//! @brief number of D entries of the last variant
+	size_type
+	num_entries() const { return num_entries_; }
+    };
+
+} // end namespace LocARNA
+
+#endif // LOCARNA_VARIANT_ALIGNER_HH
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#include <LocARNA/arena.hh>
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/aligner.hh>
+#include <LocARNA/progressive_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for Aligner::reset()
+
+    Aligns a pair of RNAs, resets the aligner to a longer and then to
+    a shorter pair, and compares the scores and traces to the ones
+    of freshly constructed aligners in several alignment modes.
+*/
+
+//! @brief write an RNA in pp format
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq,
+	 const std::string &basepairs) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< basepairs
+	<< std::endl << "#END" << std::endl;
+}
+
+//! @brief whether two vectors of alignment edge ends are equal
+static
+bool
+equal_edge_ends(const Alignment::edge_ends_t &x, const Alignment::edge_ends_t &y) {
+    if (x.size()!=y.size()) return false;
+    for (size_t k=0; k<x.size(); k++) {
+	if (x[k].is_gap()!=y[k].is_gap()) return false;
+	if (x[k].is_gap()
+	    ? x[k].gap().idx()!=y[k].gap().idx()
+	    : (pos_type)x[k]!=(pos_type)y[k]) return false;
+    }
+    return true;
+}
+
+//! @brief whether a reset problem aligns like a fresh one
+static
+bool
+check_like_fresh(ProfileAlignmentProblem &problem,
+		 const RnaData &rna_dataA,
+		 const RnaData &rna_dataB,
+		 const ProfileAlignmentParams &params,
+		 bool score_only) {
+    ProfileAlignmentProblem fresh(rna_dataA,rna_dataB,params,NULL,score_only);
+
+    if (!(problem.aligner().align() == fresh.aligner().align())) return false;
+    if (score_only) return true;
+
+    problem.aligner().trace();
+    fresh.aligner().trace();
+
+    const Alignment::edges_t edges = problem.aligner().get_alignment().alignment_edges(false);
+    const Alignment::edges_t fresh_edges = fresh.aligner().get_alignment().alignment_edges(false);
+
+    return equal_edge_ends(edges.first,fresh_edges.first)
+	&& equal_edge_ends(edges.second,fresh_edges.second);
+}
+
+//! @brief align three pairs by one problem, resetting it in between
+static
+bool
+check_reset(const std::vector<const RnaData *> &rnas,
+	    const ProfileAlignmentParams &params,
+	    bool score_only,
+	    Arena *arena) {
+    ProfileAlignmentProblem problem(*rnas[0],*rnas[1],params,NULL,score_only,arena);
+    if (!check_like_fresh(problem,*rnas[0],*rnas[1],params,score_only)) return false;
+
+    // longer pair
+    problem.reset(*rnas[2],*rnas[3],NULL,score_only);
+    if (!check_like_fresh(problem,*rnas[2],*rnas[3],params,score_only)) return false;
+
+    // shorter pair
+    problem.reset(*rnas[4],*rnas[5],NULL,score_only);
+    if (!check_like_fresh(problem,*rnas[4],*rnas[5],params,score_only)) return false;
+
+    // back to the first pair
+    problem.reset(*rnas[0],*rnas[1],NULL,score_only);
+    return check_like_fresh(problem,*rnas[0],*rnas[1],params,score_only);
+}
+
+//! @brief check_reset() with and without score-only mode and arena
+static
+bool
+check_reset_modes(const std::vector<const RnaData *> &rnas,
+		  const ProfileAlignmentParams &params) {
+    Arena &arena = Arena::thread_arena();
+    bool ok = check_reset(rnas,params,false,NULL)
+	&& check_reset(rnas,params,true,NULL)
+	&& check_reset(rnas,params,false,&arena)
+	&& check_reset(rnas,params,true,&arena);
+    return ok && arena.live()==0;
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,false);
+    ProfileAlignmentParams params;
+
+    int ok=0;
+
+    const char *names[] = {"A1","B1","A2","B2","A3","B3"};
+    const char *seqs[] = {
+	"GGGAAAUUUUCCCAAAGGGCAUUAGCCCAA",
+	"GGGAAAUUCCCAAAGGGCAUUUGCCCAAUU",
+	"GGGAAAUUUUCCCAAAGGGCAUUAGCCCAAGGGGAAACCCCAUAUA",
+	"GGGAAAUUCCCAAAGGGCAUUUGCCCAAUUGGGAAAAUCCCAGG",
+	"GGGAAAUUUUCCCAAAGG",
+	"GGGAAUUCCCAAAGG"
+    };
+    const std::string bps30 =
+	"1 14 0.8\n2 13 0.7\n3 12 0.6\n1 30 0.1\n5 25 0.05\n"
+	"18 30 0.5\n19 29 0.45\n20 28 0.4\n";
+    const std::string bps[] = {
+	bps30,
+	bps30,
+	bps30 + "31 42 0.7\n32 41 0.6\n33 40 0.5\n1 46 0.1\n",
+	bps30 + "31 42 0.7\n32 41 0.6\n33 40 0.5\n",
+	"1 14 0.8\n2 13 0.7\n3 12 0.6\n",
+	"1 10 0.8\n2 9 0.7\n3 8 0.3\n"
+    };
+
+    std::vector<const RnaData *> rnas;
+
+    try {
+	for (size_t k=0; k<6; k++) {
+	    std::string filename = std::string("Tests/aligner_reset")+names[k]+".pp";
+	    write_pp(filename,names[k],seqs[k],bps[k]);
+	    rnas.push_back(new RnaData(filename,params.min_prob,0,pfparams));
+	}
+
+	CHECK(check_reset_modes(rnas,params));
+
+	params.free_endgaps="++++";
+	CHECK(check_reset_modes(rnas,params));
+	params.free_endgaps="----";
+
+	params.sequ_local=true;
+	CHECK(check_reset_modes(rnas,params));
+
+	params.struct_local=true;
+	CHECK(check_reset_modes(rnas,params));
+	params.sequ_local=false;
+	CHECK(check_reset_modes(rnas,params));
+	params.struct_local=false;
+
+	params.no_lonely_pairs=true;
+	CHECK(check_reset_modes(rnas,params));
+	params.no_lonely_pairs=false;
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	ok=1;
+    }
+
+    for (size_t k=0; k<rnas.size(); k++) {
+	delete rnas[k];
+    }
+    for (size_t k=0; k<6; k++) {
+	std::remove((std::string("Tests/aligner_reset")+names[k]+".pp").c_str());
+    }
+
+    return ok;
+}
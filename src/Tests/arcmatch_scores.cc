@@ -0,0 +1,211 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/arc_matches.hh>
+#include <LocARNA/scoring.hh>
+#include <LocARNA/aligner.hh>
+#include <LocARNA/progressive_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for the precomputed arc match score tables
+
+    Compares the arc match scores (plain, stacked and exponentiated)
+    of a scoring with precomputed tables to the ones of a scoring
+    without tables, also after modifications by lambda, and checks
+    that alignments with tables yield the same scores.
+*/
+
+//! @brief write an RNA with stacking probabilities in pp format
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< "#STACK" << std::endl
+	<< "1 14 0.8 0.7" << std::endl
+	<< "2 13 0.7 0.6" << std::endl
+	<< "3 12 0.6" << std::endl
+	<< "1 30 0.1" << std::endl
+	<< "5 25 0.05" << std::endl
+	<< "18 30 0.5 0.45" << std::endl
+	<< "19 29 0.45 0.4" << std::endl
+	<< "20 28 0.4" << std::endl
+	<< std::endl << "#END" << std::endl;
+}
+
+//! @brief whether two scorings agree on the scores of all arc matches
+static
+bool
+equal_arcmatch_scores(const Scoring &x,
+		      const Scoring &y,
+		      const ArcMatches &arc_matches) {
+    for (size_t idx=0; idx<arc_matches.num_arc_matches(); idx++) {
+	const ArcMatch &am = arc_matches.arcmatch(idx);
+	if (x.arcmatch(am) != y.arcmatch(am)) return false;
+	if (x.exp_arcmatch(am) != y.exp_arcmatch(am)) return false;
+	if (x.stacking() && x.is_stackable_am(am)
+	    && x.arcmatch(am,true) != y.arcmatch(am,true)) return false;
+    }
+    return true;
+}
+
+//! @brief number of stackable arc matches
+static
+size_t
+count_stackable(const Scoring &scoring, const ArcMatches &arc_matches) {
+    size_t count=0;
+    for (size_t idx=0; idx<arc_matches.num_arc_matches(); idx++) {
+	if (scoring.is_stackable_am(arc_matches.arcmatch(idx))) count++;
+    }
+    return count;
+}
+
+//! @brief compare scorings with and without tables for given scoring parameters
+static
+bool
+check_tables(const RnaData &rna_dataA,
+	     const RnaData &rna_dataB,
+	     const ArcMatches &arc_matches,
+	     const ScoringParams &scoring_params) {
+    const Sequence &seqA=rna_dataA.sequence();
+    const Sequence &seqB=rna_dataB.sequence();
+
+    Scoring plain(seqA,seqB,rna_dataA,rna_dataB,arc_matches,NULL,scoring_params,true);
+    Scoring tab(seqA,seqB,rna_dataA,rna_dataB,arc_matches,NULL,scoring_params,true);
+    Scoring tab2(seqA,seqB,rna_dataA,rna_dataB,arc_matches,NULL,scoring_params,true);
+
+    bool ok = !plain.stacking() || count_stackable(plain,arc_matches)>0;
+
+    // a too small memory budget leaves the scoring without tables
+    ok = ok && !tab.precompute_arcmatch_scores(1,1);
+    ok = ok && equal_arcmatch_scores(plain,tab,arc_matches);
+
+    ok = ok && tab.precompute_arcmatch_scores(1<<20,1);
+    ok = ok && equal_arcmatch_scores(plain,tab,arc_matches);
+
+    // tables are filled in parallel, while lambda!=0
+    plain.modify_by_parameter(-3);
+    tab.modify_by_parameter(-3);
+    tab2.modify_by_parameter(-3);
+    ok = ok && plain.lambda()!=0;
+    ok = ok && equal_arcmatch_scores(plain,tab,arc_matches);
+
+    ok = ok && tab2.precompute_arcmatch_scores(1<<20,2);
+    ok = ok && equal_arcmatch_scores(plain,tab2,arc_matches);
+
+    // another lambda and back to lambda=0
+    plain.modify_by_parameter(2);
+    tab.modify_by_parameter(2);
+    tab2.modify_by_parameter(2);
+    ok = ok && equal_arcmatch_scores(plain,tab,arc_matches);
+    ok = ok && equal_arcmatch_scores(plain,tab2,arc_matches);
+
+    plain.modify_by_parameter(0);
+    tab.modify_by_parameter(0);
+    tab2.modify_by_parameter(0);
+    ok = ok && plain.lambda()==0;
+    ok = ok && equal_arcmatch_scores(plain,tab,arc_matches);
+    ok = ok && equal_arcmatch_scores(plain,tab2,arc_matches);
+
+    return ok;
+}
+
+//! @brief whether alignments with and without tables yield the same score
+static
+bool
+check_alignment(const RnaData &rna_dataA,
+		const RnaData &rna_dataB,
+		ProfileAlignmentParams params) {
+    params.arcmatch_score_memory=0;
+    ProfileAlignmentProblem plain(rna_dataA,rna_dataB,params,NULL);
+    params.arcmatch_score_memory=1<<20;
+    ProfileAlignmentProblem tab(rna_dataA,rna_dataB,params,NULL);
+
+    return plain.aligner().align() == tab.aligner().align();
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,true);
+    ProfileAlignmentParams params;
+    params.stacking=true;
+
+    int ok=0;
+
+    try {
+	write_pp("Tests/arcmatch_scoresA.pp","seqA","GGGAAAUUUUCCCAAAGGGCAUUAGCCCAA");
+	write_pp("Tests/arcmatch_scoresB.pp","seqB","GGGAAAUUCCCAAAGGGCAUUUGCCCAAUU");
+
+	RnaData rna_dataA("Tests/arcmatch_scoresA.pp",params.min_prob,0,pfparams);
+	RnaData rna_dataB("Tests/arcmatch_scoresB.pp",params.min_prob,0,pfparams);
+
+	ProfileAlignmentProblem problem(rna_dataA,rna_dataB,params,NULL);
+	const ArcMatches &arc_matches = problem.arc_matches();
+	CHECK(arc_matches.num_arc_matches()>0);
+
+	size_t lenA = rna_dataA.sequence().length();
+	size_t lenB = rna_dataB.sequence().length();
+
+	for (size_t variant=0; variant<3; variant++) {
+	    bool stacking = (variant==1);
+	    bool new_stacking = (variant==2);
+
+	    ScoringParams scoring_params(params.match,
+					 params.mismatch,
+					 params.indel,
+					 0, // indel loop score
+					 params.indel_opening,
+					 0, // indel opening loop score
+					 params.ribosum,
+					 params.ribofit,
+					 params.unpaired_penalty,
+					 params.struct_weight,
+					 params.tau_factor,
+					 params.exclusion,
+					 prob_exp_f(lenA),
+					 prob_exp_f(lenB),
+					 params.temperature,
+					 stacking,
+					 new_stacking,
+					 false, // no mea scoring
+					 0,
+					 200,
+					 100,
+					 10000);
+
+	    CHECK(check_tables(rna_dataA,rna_dataB,arc_matches,scoring_params));
+	}
+
+	CHECK(check_alignment(rna_dataA,rna_dataB,params));
+	params.struct_local=true;
+	CHECK(check_alignment(rna_dataA,rna_dataB,params));
+	params.struct_local=false;
+	params.stacking=false;
+	CHECK(check_alignment(rna_dataA,rna_dataB,params));
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	ok=1;
+    }
+
+    std::remove("Tests/arcmatch_scoresA.pp");
+    std::remove("Tests/arcmatch_scoresB.pp");
+
+    return ok;
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <LocARNA/arena.hh>
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/aligner.hh>
+#include <LocARNA/progressive_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for the arena allocator
+
+    Allocates from the arenas of two threads, checks that each thread
+    owns its arena and that the arena recycles its memory, and that
+    alignments with matrices from the arena (and copies of such
+    aligners) yield the scores of alignments on the heap.
+*/
+
+//! @brief write an RNA in pp format
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< "1 14 0.8" << std::endl
+	<< "2 13 0.7" << std::endl
+	<< "3 12 0.6" << std::endl
+	<< "1 30 0.1" << std::endl
+	<< "5 25 0.05" << std::endl
+	<< "18 30 0.5" << std::endl
+	<< "19 29 0.45" << std::endl
+	<< "20 28 0.4" << std::endl
+	<< std::endl << "#END" << std::endl;
+}
+
+//! @brief input and results of a worker thread
+struct worker_t {
+    const RnaData *rna_dataA; //!< first RNA
+    const RnaData *rna_dataB; //!< second RNA
+    const ProfileAlignmentParams *params; //!< alignment parameters
+    infty_score_t heap_score; //!< score of the alignment on the heap
+
+    Arena *arena; //!< arena of the thread
+    bool ok; //!< whether all checks passed
+};
+
+//! barrier, such that the arenas of both workers exist at the same time
+static pthread_barrier_t barrier;
+
+//! @brief allocate from the thread arena and align from it
+static
+void *
+work(void *arg) {
+    worker_t &w = *static_cast<worker_t *>(arg);
+
+    Arena &arena = Arena::thread_arena();
+    w.arena = &arena;
+    w.ok = (&arena == &Arena::thread_arena());
+    pthread_barrier_wait(&barrier);
+
+    // allocations of one round are freed completely; the next
+    // round of the same size reuses the memory
+    Arena::size_type capacity=0;
+    for (size_t round=0; round<3; round++) {
+	typedef std::vector<size_t, ArenaAllocator<size_t> > vec_t;
+	std::vector<vec_t> vecs;
+	for (size_t k=0; k<10; k++) {
+	    vecs.push_back(vec_t(1000*(k+1),k,ArenaAllocator<size_t>(&arena)));
+	}
+	for (size_t k=0; k<vecs.size(); k++) {
+	    for (size_t i=0; i<vecs[k].size(); i++) {
+		w.ok = w.ok && vecs[k][i]==k;
+	    }
+	}
+	w.ok = w.ok && arena.live()==vecs.size();
+	if (round>0) {
+	    w.ok = w.ok && arena.capacity()==capacity;
+	}
+	vecs.clear();
+	w.ok = w.ok && arena.live()==0;
+	capacity = arena.capacity();
+    }
+
+    // the copy of an aligner allocates from the heap, even if the
+    // original allocates from the arena
+    ProfileAlignmentProblem *problem =
+	new ProfileAlignmentProblem(*w.rna_dataA,*w.rna_dataB,*w.params,NULL,false,&arena);
+    w.ok = w.ok && problem->aligner().align() == w.heap_score;
+    w.ok = w.ok && arena.live()>0;
+
+    Aligner *copy = new Aligner(problem->aligner());
+    w.ok = w.ok && copy->align() == w.heap_score;
+    delete problem;
+    w.ok = w.ok && arena.live()==0;
+    delete copy;
+
+    return NULL;
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,false);
+    ProfileAlignmentParams params;
+
+    int ok=0;
+
+    try {
+	write_pp("Tests/arenaA.pp","seqA","GGGAAAUUUUCCCAAAGGGCAUUAGCCCAA");
+	write_pp("Tests/arenaB.pp","seqB","GGGAAAUUCCCAAAGGGCAUUUGCCCAAUU");
+
+	RnaData rna_dataA("Tests/arenaA.pp",params.min_prob,0,pfparams);
+	RnaData rna_dataB("Tests/arenaB.pp",params.min_prob,0,pfparams);
+
+	ProfileAlignmentProblem heap_problem(rna_dataA,rna_dataB,params,NULL);
+	infty_score_t heap_score = heap_problem.aligner().align();
+
+	Arena &main_arena = Arena::thread_arena();
+
+	worker_t workers[2];
+	pthread_t threads[2];
+	CHECK(pthread_barrier_init(&barrier,NULL,2)==0);
+	for (size_t t=0; t<2; t++) {
+	    workers[t].rna_dataA = &rna_dataA;
+	    workers[t].rna_dataB = &rna_dataB;
+	    workers[t].params = &params;
+	    workers[t].heap_score = heap_score;
+	    workers[t].arena = NULL;
+	    workers[t].ok = false;
+	    CHECK(pthread_create(&threads[t],NULL,work,&workers[t])==0);
+	}
+	for (size_t t=0; t<2; t++) {
+	    CHECK(pthread_join(threads[t],NULL)==0);
+	    CHECK(workers[t].ok);
+	}
+	pthread_barrier_destroy(&barrier);
+
+	// each thread owns its arena
+	CHECK(workers[0].arena != workers[1].arena);
+	CHECK(workers[0].arena != &main_arena);
+	CHECK(workers[1].arena != &main_arena);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	ok=1;
+    }
+
+    std::remove("Tests/arenaA.pp");
+    std::remove("Tests/arenaB.pp");
+
+    return ok;
+}
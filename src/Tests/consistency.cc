@@ -0,0 +1,105 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/consistency.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for MatchProbsSet
+
+    Transforms the base match probabilities of three small sequences,
+    compares to the consistency transformation computed by hand, and
+    checks binary output and input.
+*/
+
+//! @brief whether two probabilities are equal up to rounding
+static
+bool
+equal_probs(double x, double y) {
+    return std::fabs(x-y) < 1e-9;
+}
+
+int
+main(int argc, char **argv) {
+    std::vector<std::string> names;
+    names.push_back("seqA");
+    names.push_back("seqB");
+    names.push_back("seqC");
+
+    try {
+	MatchProbsSet probs(names,false);
+
+	probs.set_prob(0,1,probs.item(0,1),probs.item(1,1),0.8);
+	probs.set_prob(0,1,probs.item(0,2),probs.item(1,2),0.6);
+	probs.set_prob(0,1,probs.item(0,2),probs.item(1,3),0.3);
+	probs.set_prob(0,2,probs.item(0,1),probs.item(2,1),0.9);
+	probs.set_prob(0,2,probs.item(0,2),probs.item(2,2),0.5);
+	probs.set_prob(1,2,probs.item(1,1),probs.item(2,1),0.7);
+	probs.set_prob(1,2,probs.item(1,3),probs.item(2,2),0.4);
+
+	CHECK(probs.prob(1,0,1,0)==0.0);
+	CHECK(probs.prob(1,0,3,2)==0.3);
+
+	MatchProbsSet transformed(names,false);
+	probs.consistency_transform(transformed,0.01,2,false);
+
+	// P'_AB(x,y) = 1/3 (2 P_AB(x,y) + sum_z P_AC(x,z) P_CB(z,y))
+	CHECK(equal_probs(transformed.prob(0,1,1,1),(2*0.8+0.9*0.7)/3));
+	CHECK(equal_probs(transformed.prob(0,1,2,2),(2*0.6)/3));
+	CHECK(equal_probs(transformed.prob(0,1,2,3),(2*0.3+0.5*0.4)/3));
+	CHECK(equal_probs(transformed.prob(1,0,3,2),(2*0.3+0.5*0.4)/3));
+	CHECK(equal_probs(transformed.prob(0,2,1,1),(2*0.9+0.8*0.7)/3));
+	CHECK(equal_probs(transformed.prob(1,2,2,2),(0.6*0.5)/3));
+
+	// entries below the minimal probability are dropped
+	MatchProbsSet filtered(names,false);
+	probs.consistency_transform(filtered,0.2,1,false);
+	CHECK(filtered.prob(1,2,2,2)==0.0);
+	CHECK(equal_probs(filtered.prob(0,1,2,2),(2*0.6)/3));
+
+	// scaling keeps the sum of probabilities
+	MatchProbsSet scaled(names,false);
+	probs.consistency_transform(scaled,0.01,1,true);
+	CHECK(equal_probs(scaled.sum_probs(),probs.sum_probs()));
+
+	// binary output and input
+	std::stringstream bin;
+	transformed.write_binary(bin);
+	MatchProbsSet reread(std::vector<std::string>(),false);
+	reread.read_binary(bin);
+
+	CHECK(reread.names()==names);
+	std::ostringstream out1, out2;
+	for (size_t a=0; a<names.size(); a++) {
+	    for (size_t b=0; b<names.size(); b++) {
+		if (a==b) continue;
+		transformed.write_pair(a,b,out1);
+		reread.write_pair(a,b,out2);
+	    }
+	}
+	CHECK(out1.str()==out2.str());
+
+	// arc matches
+	MatchProbsSet arc_probs(names,true);
+	arc_probs.set_prob(0,1,arc_probs.item(0,1,10),arc_probs.item(1,2,12),0.5);
+	arc_probs.set_prob(0,2,arc_probs.item(0,1,10),arc_probs.item(2,1,9),0.5);
+	arc_probs.set_prob(1,2,arc_probs.item(1,2,12),arc_probs.item(2,1,9),0.5);
+
+	MatchProbsSet arc_transformed(names,true);
+	arc_probs.consistency_transform(arc_transformed,0.01,1,false);
+	CHECK(equal_probs(arc_transformed.prob(0,1,0,0),(2*0.5+0.5*0.5)/3));
+	CHECK(arc_transformed.arc(1,0)==MatchProbsSet::arc_t(2,12));
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	return 1;
+    }
+
+    return 0;
+}
@@ -3,9 +3,12 @@
 #include <fstream>
 #include <sstream>
 #include <stdio.h>
+#include <vector>
 
 #include <LocARNA/pfold_params.hh>
 #include <LocARNA/ext_rna_data.hh>
+#include <LocARNA/sequence.hh>
+#include <LocARNA/rna_ensemble.hh>
 
 #include "check.hh" 
 
@@ -50,6 +53,61 @@ main(int argc, char **argv) {
 
     CHECK(sizeinfo1.str() == sizeinfo2.str());
     
+    // in loop probabilities computed on demand are the ones computed
+    // from the ensemble in advance
+    try {
+	ExtRnaData lazy_data("Tests/archaea.aln",0.01,0.0001,0.0001,0,0,0,pfparams);
+
+	RnaEnsemble rna_ensemble(lazy_data.sequence(),pfparams,true,true);
+	ExtRnaData eager_data(rna_ensemble,0.01,0.0001,0.0001,0,0,0,pfparams);
+
+	size_t len=eager_data.length();
+	std::vector<std::pair<size_t,size_t> > arcs;
+	for (size_t i=1; i<=len; i++) {
+	    for (size_t j=i+1; j<=len; j++) {
+		if (eager_data.arc_prob(i,j)>0) {
+		    arcs.push_back(std::pair<size_t,size_t>(i,j));
+		}
+	    }
+	}
+
+	size_t fails=0;
+	for (size_t x=0; x<arcs.size(); x++) {
+	    size_t i=arcs[x].first;
+	    size_t j=arcs[x].second;
+	    
+	    for (size_t k=i+1; k<j; k++) {
+		if (lazy_data.unpaired_in_loop_prob(k,i,j)
+		    != eager_data.unpaired_in_loop_prob(k,i,j)) {
+		    fails++;
+		}
+	    }
+	    for (size_t y=0; y<arcs.size(); y++) {
+		size_t ip=arcs[y].first;
+		size_t jp=arcs[y].second;
+		if (lazy_data.arc_in_loop_prob(ip,jp,i,j)
+		    != eager_data.arc_in_loop_prob(ip,jp,i,j)) {
+		    fails++;
+		}
+	    }
+	    if (lazy_data.arc_external_prob(i,j)
+		!= eager_data.arc_external_prob(i,j)) {
+		fails++;
+	    }
+	}
+	CHECK(fails==0);
+
+	std::ostringstream lazy_sizeinfo;
+	std::ostringstream eager_sizeinfo;
+	lazy_data.write_size_info(lazy_sizeinfo);
+	eager_data.write_size_info(eager_sizeinfo);
+	CHECK(lazy_sizeinfo.str() == eager_sizeinfo.str());
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	return 1;
+    }
+
 
     return 0;
 }
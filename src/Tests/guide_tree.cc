@@ -0,0 +1,85 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include <LocARNA/matrix.hh>
+#include <LocARNA/guide_tree.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for GuideTree
+*/
+
+int
+main(int argc, char **argv) {
+
+    // two pairs of similar sequences {0,1} and {2,3}; 4 is an outlier
+    double s[5][5] = { {  0, 90, 20, 25, 10 },
+		       { 90,  0, 22, 21, 10 },
+		       { 20, 22,  0, 80, 10 },
+		       { 25, 21, 80,  0, 10 },
+		       { 10, 10, 10, 10,  0 } };
+
+    Matrix<double> scores(5,5);
+    for (size_t i=0; i<5; i++) {
+	for (size_t j=0; j<5; j++) {
+	    scores(i,j)=s[i][j];
+	}
+    }
+
+    {
+	GuideTree tree(scores,GuideTree::UPGMA);
+
+	CHECK(tree.num_leaves()==5);
+	CHECK(tree.num_nodes()==9);
+	CHECK(tree.size(tree.root())==5);
+	CHECK(tree.parent(tree.root())==GuideTree::none);
+
+	// first join is {0,1}, second {2,3}
+	CHECK(tree.left(5)==0 && tree.right(5)==1);
+	CHECK(tree.left(6)==2 && tree.right(6)==3);
+	CHECK(tree.parent(4)==tree.root());
+
+	std::vector<size_t> leaves = tree.leaves(tree.root());
+	CHECK(leaves.size()==5);
+
+	// {0,1} and {2,3} can be merged concurrently
+	std::vector<std::vector<size_t> > schedule = tree.merge_schedule();
+	CHECK(schedule.size()==3);
+	CHECK(schedule[0].size()==2);
+	CHECK(schedule[2].size()==1 && schedule[2][0]==tree.root());
+
+	std::vector<std::string> names;
+	names.push_back("a");
+	names.push_back("b");
+	names.push_back("c d");
+	names.push_back("e");
+	names.push_back("f");
+	std::ostringstream newick;
+	tree.write_newick(newick,names);
+	CHECK(newick.str()=="(((a,b),('c d',e)),f);");
+
+	// the tree does not depend on the number of threads
+	GuideTree tree_par(scores,GuideTree::UPGMA,3);
+	std::ostringstream newick_par;
+	tree_par.write_newick(newick_par,names);
+	CHECK(newick_par.str()==newick.str());
+    }
+    std::cerr << "ok -- upgma"<<std::endl;
+
+    {
+	GuideTree tree(scores,GuideTree::method_from_string("nj"));
+
+	CHECK(tree.num_nodes()==9);
+	CHECK(tree.size(tree.root())==5);
+
+	// the most similar pair is joined first
+	CHECK(tree.left(5)==0 && tree.right(5)==1);
+    }
+    std::cerr << "ok -- neighbor joining"<<std::endl;
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <string>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/alignment_server.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for JobRequest (jobs of the alignment server)
+*/
+
+int
+main(int argc, char **argv) {
+
+    {
+	JobRequest job(" {\"id\": 7, \"a\":\"x.pp\", \"seqB\" : \"ACGU\\\"\\n\","
+		       " \"struct-weight\":-180, \"exp-prob\":1.5e-2, \"noLP\":true,"
+		       " \"trace\":false, \"nothing\":null } ");
+
+	CHECK(job.has("id"));
+	CHECK(!job.has("b"));
+	CHECK(job.json("id")=="7");
+	CHECK(job.json("a")=="\"x.pp\"");
+	CHECK(job.json("b")=="null");
+	CHECK(job.get_string("a","")=="x.pp");
+	CHECK(job.get_string("seqB","")=="ACGU\"\n");
+	CHECK(job.get_string("b","dflt")=="dflt");
+	CHECK(job.get_int("struct-weight",0)==-180);
+	CHECK(job.get_int("match",50)==50);
+	CHECK(job.get_double("exp-prob",0)==1.5e-2);
+	CHECK(job.get_bool("noLP",false));
+	CHECK(!job.get_bool("trace",true));
+    }
+    std::cerr << "ok -- parse"<<std::endl;
+
+    {
+	JobRequest job("{\"a\":\"x\",\"n\":1.5}");
+
+	bool thrown=false;
+	try { job.get_int("a",0); } catch (failure &f) { thrown=true; }
+	CHECK(thrown);
+
+	thrown=false;
+	try { job.get_int("n",0); } catch (failure &f) { thrown=true; }
+	CHECK(thrown);
+
+	thrown=false;
+	try { job.get_bool("n",false); } catch (failure &f) { thrown=true; }
+	CHECK(thrown);
+    }
+    std::cerr << "ok -- type errors"<<std::endl;
+
+    {
+	const char *invalid[] = { "", "[1]", "{\"a\":1", "{\"a\" 1}", "{\"a\":{\"b\":1}}",
+				  "{\"a\":[1]}", "{\"a\":1}x", "{\"a\":\"x}", "{a:1}",
+				  "{\"a\":abc}", "{\"a\":01}", "{\"a\":1.}", "{\"a\":\"\\x\"}",
+				  "{\"a\":\"\\u12\"}", "{\"a\":\"\\u12g4\"}",
+				  "{\"a\":\"\\ud83d\"}", "{\"a\":\"\\ude00\"}",
+				  "{\"a\":\"\\ud83d\\u0041\"}" };
+	for (size_t i=0; i<sizeof(invalid)/sizeof(invalid[0]); i++) {
+	    bool thrown=false;
+	    try { JobRequest job(invalid[i]); } catch (failure &f) { thrown=true; }
+	    CHECK(thrown);
+	}
+	JobRequest empty("{}");
+	CHECK(!empty.has("id"));
+    }
+    std::cerr << "ok -- syntax errors"<<std::endl;
+
+    {
+	JobRequest job("{\"s\":\"\\u0041\\u00e9\\u20AC\\ud83d\\ude00\"}");
+	CHECK(job.get_string("s","")=="A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    }
+    std::cerr << "ok -- unicode escapes"<<std::endl;
+
+    {
+	CHECK(JobRequest("{\"id\":-1.5e3}").id()=="-1.5e3");
+	CHECK(JobRequest("{\"id\":\"a\\\"b\"}").id()=="\"a\\\"b\"");
+	CHECK(JobRequest("{}").id()=="null");
+
+	const char *invalid[] = { "{\"id\":true}", "{\"id\":null}" };
+	for (size_t i=0; i<sizeof(invalid)/sizeof(invalid[0]); i++) {
+	    bool thrown=false;
+	    try { JobRequest(invalid[i]).id(); } catch (failure &f) { thrown=true; }
+	    CHECK(thrown);
+	}
+    }
+    std::cerr << "ok -- id"<<std::endl;
+
+    {
+	CHECK(json_quote("a\"b\\c\n\x01")=="\"a\\\"b\\\\c\\n\\u0001\"");
+
+	// quoting and parsing are inverse
+	std::string s="tab\there \"quoted\" back\\slash";
+	JobRequest job("{\"s\":"+json_quote(s)+"}");
+	CHECK(job.get_string("s","")==s);
+    }
+    std::cerr << "ok -- quote"<<std::endl;
+
+    return 0;
+}
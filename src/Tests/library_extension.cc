@@ -0,0 +1,149 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <stdio.h>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/alignment.hh>
+#include <LocARNA/multiple_alignment.hh>
+#include <LocARNA/library_extension.hh>
+#include <LocARNA/progressive_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for LibraryExtension
+
+    Extends the base pair probabilities of three small RNAs by
+    hand-made pairwise alignments and compares to values computed by
+    hand.
+*/
+
+//! @brief write an RNA in pp format
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq,
+	 const std::string &bps) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< bps
+	<< std::endl << "#END" << std::endl;
+}
+
+//! @brief alignment edges, where position i of A is aligned to
+//! position i+shift of B; unaligned positions are deleted/inserted
+static
+Alignment::edges_t
+shifted_edges(size_t lenA, size_t lenB, int shift) {
+    Alignment::edge_ends_t endsA;
+    Alignment::edge_ends_t endsB;
+    for (int i=1, j=1; i<=(int)lenA || j<=(int)lenB; ) {
+	if (i<=(int)lenA && j<=(int)lenB && j==i+shift) {
+	    endsA.push_back((pos_type)i++);
+	    endsB.push_back((pos_type)j++);
+	} else if (i<=(int)lenA && (j>(int)lenB || j>i+shift)) {
+	    endsA.push_back((pos_type)i++);
+	    endsB.push_back(Gap::regular);
+	} else {
+	    endsA.push_back(Gap::regular);
+	    endsB.push_back((pos_type)j++);
+	}
+    }
+    return Alignment::edges_t(endsA,endsB);
+}
+
+//! @brief whether two probabilities are equal up to rounding
+static
+bool
+equal_probs(double x, double y) {
+    return std::fabs(x-y) < 1e-9;
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,false);
+
+    try {
+	write_pp("Tests/extA.pp","extA","GGGAAACCC",
+		 "1 9 0.8\n2 8 0.6\n3 7 0.5\n1 5 0.1\n");
+	write_pp("Tests/extB.pp","extB","GGGAAACCCA",
+		 "1 9 0.5\n2 8 0.4\n3 7 0.0002\n");
+	write_pp("Tests/extC.pp","extC","AGGGAAACCC",
+		 "2 10 0.9\n");
+
+	RnaData rna_dataA("Tests/extA.pp",0.0001,0,pfparams);
+	RnaData rna_dataB("Tests/extB.pp",0.0001,0,pfparams);
+	RnaData rna_dataC("Tests/extC.pp",0.0001,0,pfparams);
+
+	std::remove("Tests/extA.pp");
+	std::remove("Tests/extB.pp");
+	std::remove("Tests/extC.pp");
+
+	std::vector<const RnaData *> inputs;
+	inputs.push_back(&rna_dataA);
+	inputs.push_back(&rna_dataB);
+	inputs.push_back(&rna_dataC);
+
+	// no alignment of B and C, i.e. they do not support each other
+	LibraryExtension ext(inputs,0.001);
+	ext.set_alignment(0,1,shifted_edges(9,10,0));
+	ext.set_alignment(2,0,shifted_edges(10,9,-1));
+	ext.extend(1);
+
+	const RnaData &extA = ext.extended(0);
+	const RnaData &extB = ext.extended(1);
+	const RnaData &extC = ext.extended(2);
+
+	CHECK(extA.length()==9);
+
+	// supported by B and C
+	CHECK(equal_probs(extA.arc_prob(1,9),pow(0.8,1/(1.5*1.9))));
+	// supported by B only
+	CHECK(equal_probs(extA.arc_prob(2,8),pow(0.6,1/1.4)));
+	// support below minimal probability
+	CHECK(extA.arc_prob(3,7)==0.5);
+	// no support
+	CHECK(extA.arc_prob(1,5)==0.1);
+
+	CHECK(equal_probs(extB.arc_prob(1,9),pow(0.5,1/1.8)));
+	CHECK(equal_probs(extB.arc_prob(2,8),pow(0.4,1/1.6)));
+	CHECK(extB.arc_prob(3,7)==0.0002);
+
+	CHECK(equal_probs(extC.arc_prob(2,10),pow(0.9,1/1.8)));
+
+	// the result does not depend on the number of threads
+	LibraryExtension ext_par(inputs,0.001);
+	ext_par.set_alignment(0,1,shifted_edges(9,10,0));
+	ext_par.set_alignment(2,0,shifted_edges(10,9,-1));
+	ext_par.extend(3);
+	CHECK(ext_par.extended(0).arc_prob(1,9)==extA.arc_prob(1,9));
+	CHECK(ext_par.extended(2).arc_prob(2,10)==extC.arc_prob(2,10));
+
+	// progressive alignment of the extended RNAs
+	ProfileAlignmentParams params;
+	ProgressiveAligner aligner(inputs,params,2);
+	aligner.set_library_extension(params.min_prob);
+	aligner.compute_pairwise_scores();
+	aligner.align();
+	CHECK(aligner.result().multiple_alignment().num_of_rows()==3);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	return 1;
+    }
+
+    return 0;
+}
@@ -118,5 +118,19 @@ main(int argc, char **argv) {
 	CHECK(seq.length() == seq2.length());
     }
 
+    {
+	// reverse complement of all rows; twice gives the original
+	// up to T, which becomes U
+	MultipleAlignment rc("seqA","seqB",
+			     "A-CGT-U",
+			     "CCCG-cu");
+	rc.reverse_complement();
+	CHECK(rc.seqentry(0).seq().str() == "A-ACG-U");
+	CHECK(rc.seqentry(1).seq().str() == "ag-CGGG");
+	rc.reverse_complement();
+	CHECK(rc.seqentry(0).seq().str() == "A-CGU-U");
+	CHECK(rc.seqentry(1).seq().str() == "CCCG-cu");
+    }
+
     return 0;
 }
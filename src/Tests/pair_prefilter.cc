@@ -0,0 +1,120 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <stdio.h>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/multiple_alignment.hh>
+#include <LocARNA/pair_prefilter.hh>
+#include <LocARNA/progressive_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for PairPrefilter
+
+    Computes the alignment-free similarities of two pairs of similar
+    RNAs and checks the nearest neighbors.
+*/
+
+//! @brief write an RNA in pp format
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq,
+	 const std::string &bps) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< bps
+	<< std::endl << "#END" << std::endl;
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,false);
+
+    try {
+	// two hairpins and two unstructured RNAs
+	write_pp("Tests/pfA.pp","pfA","GGGGAAAACCCC",
+		 "1 12 0.9\n2 11 0.9\n3 10 0.8\n4 9 0.7\n");
+	write_pp("Tests/pfB.pp","pfB","GGGGAAAUCCCC",
+		 "1 12 0.8\n2 11 0.9\n3 10 0.9\n");
+	write_pp("Tests/pfC.pp","pfC","UCUCUCUCUCAU","");
+	write_pp("Tests/pfD.pp","pfD","UCUCUCUCUCUCAU","");
+
+	RnaData rna_dataA("Tests/pfA.pp",0.0001,0,pfparams);
+	RnaData rna_dataB("Tests/pfB.pp",0.0001,0,pfparams);
+	RnaData rna_dataC("Tests/pfC.pp",0.0001,0,pfparams);
+	RnaData rna_dataD("Tests/pfD.pp",0.0001,0,pfparams);
+
+	std::remove("Tests/pfA.pp");
+	std::remove("Tests/pfB.pp");
+	std::remove("Tests/pfC.pp");
+	std::remove("Tests/pfD.pp");
+
+	std::vector<const RnaData *> inputs;
+	inputs.push_back(&rna_dataA);
+	inputs.push_back(&rna_dataB);
+	inputs.push_back(&rna_dataC);
+	inputs.push_back(&rna_dataD);
+
+	PairPrefilter prefilter(inputs,3,0.5);
+
+	// an RNA is most similar to itself
+	CHECK(std::fabs(prefilter.similarity(0,0)-1.0) < 1e-9);
+
+	CHECK(prefilter.similarity(0,1)==prefilter.similarity(1,0));
+	CHECK(prefilter.similarity(0,1) > prefilter.similarity(0,2));
+	CHECK(prefilter.similarity(2,3) > prefilter.similarity(1,3));
+
+	std::vector<std::vector<size_t> > neighbors = prefilter.neighbors(1,1);
+	CHECK(neighbors.size()==4);
+	CHECK(neighbors[0].size()==1 && neighbors[0][0]==1);
+	CHECK(neighbors[1][0]==0);
+	CHECK(neighbors[2][0]==3);
+	CHECK(neighbors[3][0]==2);
+
+	// the result does not depend on the number of threads
+	CHECK(prefilter.neighbors(2,3)==prefilter.neighbors(2,1));
+
+	// more neighbors than other RNAs
+	CHECK(prefilter.neighbors(5,1)[0].size()==3);
+
+	// k-mer length out of range
+	bool failed=false;
+	try {
+	    PairPrefilter wrong(inputs,0,0.5);
+	} catch(failure &f) {
+	    failed=true;
+	}
+	CHECK(failed);
+
+	// progressive alignment with prefiltered pairwise alignments
+	ProfileAlignmentParams params;
+	ProgressiveAligner aligner(inputs,params,2);
+	aligner.set_prefilter(1,3,0.5);
+	const Matrix<double> &scores = aligner.compute_pairwise_scores();
+	// the estimated scores of unaligned pairs are symmetric
+	CHECK(scores(0,2)==scores(2,0));
+	aligner.align();
+	CHECK(aligner.result().multiple_alignment().num_of_rows()==4);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/pp_archive.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for PPArchiveWriter and PPArchiveReader
+
+    Writes a small archive and reads back its index and texts.
+*/
+
+int
+main(int argc, char **argv) {
+
+    std::string filename = "pp_archive.test.tmp";
+
+    try {
+	{
+	    PPArchiveWriter writer(filename);
+	    writer.add("seqA","#PP 2.0\n\nseqA ACGU\n\n#END\n");
+	    writer.add("seq B","");
+	    writer.add("seqC","#PP 2.0\n\nseqC GGGAAACCC\n\n#SECTION BASEPAIRS\n1 9 0.9\n#END\n");
+	    CHECK(writer.size()==3);
+	    writer.close();
+	}
+
+	PPArchiveReader reader(filename);
+	CHECK(reader.size()==3);
+	CHECK(reader.name(0)=="seqA");
+	CHECK(reader.name(1)=="seq B");
+	CHECK(reader.name(2)=="seqC");
+
+	// random access
+	CHECK(reader.text(2)=="#PP 2.0\n\nseqC GGGAAACCC\n\n#SECTION BASEPAIRS\n1 9 0.9\n#END\n");
+	CHECK(reader.text(1)=="");
+	CHECK(reader.text(0)=="#PP 2.0\n\nseqA ACGU\n\n#END\n");
+
+	CHECK(reader.find("seqC")==2);
+	CHECK(reader.find("seqD")==reader.size());
+
+	// the writer writes the index on destruction
+	{
+	    PPArchiveWriter writer(filename);
+	}
+	PPArchiveReader empty_reader(filename);
+	CHECK(empty_reader.size()==0);
+
+	// reject other files
+	{
+	    std::ofstream out(filename.c_str());
+	    out << "#PP 2.0" << std::endl;
+	}
+	bool rejected=false;
+	try {
+	    PPArchiveReader other_reader(filename);
+	} catch (failure &f) {
+	    rejected=true;
+	}
+	CHECK(rejected);
+
+    } catch (failure &f) {
+	std::cerr << "Exception: " << f.what() << std::endl;
+	std::remove(filename.c_str());
+	return -1;
+    }
+
+    std::remove(filename.c_str());
+    return 0;
+}
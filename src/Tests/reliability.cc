@@ -0,0 +1,113 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/multiple_alignment.hh>
+#include <LocARNA/consistency.hh>
+#include <LocARNA/reliability.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for ReliabilityProfile
+
+    Computes the reliabilities of a small alignment of three
+    sequences and compares to values computed by hand.
+*/
+
+//! @brief whether two reliabilities are equal up to rounding
+static
+bool
+equal_rels(double x, double y) {
+    return std::fabs(x-y) < 1e-9;
+}
+
+int
+main(int argc, char **argv) {
+    std::istringstream aln("CLUSTAL W\n\n"
+			   "seqA ACGU-U\n"
+			   "seqB AC-GUU\n"
+			   "seqC ACGGUU\n");
+
+    try {
+	MultipleAlignment ma(aln);
+
+	std::vector<std::string> names;
+	for (size_t row=0; row<ma.num_of_rows(); row++) {
+	    names.push_back(ma.seqentry(row).name());
+	}
+
+	MatchProbsSet bm_probs(names,false);
+	// aligned in columns 1 and 6
+	bm_probs.set_prob(0,1,bm_probs.item(0,1),bm_probs.item(1,1),0.9);
+	bm_probs.set_prob(0,1,bm_probs.item(0,5),bm_probs.item(1,5),0.8);
+	// not aligned (columns 3 and 4)
+	bm_probs.set_prob(0,1,bm_probs.item(0,3),bm_probs.item(1,3),0.5);
+	// aligned in columns 1 and 2
+	bm_probs.set_prob(0,2,bm_probs.item(0,1),bm_probs.item(2,1),0.6);
+	bm_probs.set_prob(0,2,bm_probs.item(0,2),bm_probs.item(2,2),0.4);
+
+	MatchProbsSet am_probs(names,true);
+	// aligned between columns 1 and 6, and 2 and 4
+	am_probs.set_prob(0,1,am_probs.item(0,1,5),am_probs.item(1,1,5),0.3);
+	am_probs.set_prob(0,1,am_probs.item(0,2,4),am_probs.item(1,2,3),0.2);
+	// not aligned
+	am_probs.set_prob(0,2,am_probs.item(0,1,5),am_probs.item(2,1,5),0.5);
+
+	ReliabilityProfile profile(ma,bm_probs,&am_probs,1);
+
+	CHECK(profile.length()==6);
+
+	// normalized by the number of pairs
+	CHECK(equal_rels(profile.seq_rel()[1],(0.9+0.6)/3));
+	CHECK(equal_rels(profile.seq_rel()[2],0.4/3));
+	CHECK(profile.seq_rel()[3]==0.0);
+	CHECK(equal_rels(profile.seq_rel()[6],0.8/3));
+
+	CHECK(equal_rels(profile.str_rel()[1],0.3/3));
+	CHECK(equal_rels(profile.str_rel()[6],0.3/3));
+	CHECK(equal_rels(profile.str_rel()[4],0.2/3));
+	CHECK(profile.str_rel()[5]==0.0);
+
+	CHECK(profile.arc_rel().size()==2);
+	CHECK(equal_rels(profile.arc_rel().find(std::make_pair(1ul,6ul))->second,0.3/3));
+
+	// single sequences: normalized by the number of other sequences,
+	// arc reliabilities by the number of sequences
+	CHECK(equal_rels(profile.single_seq_rel(0)[1],(0.9+0.6)/2));
+	CHECK(equal_rels(profile.single_seq_rel(2)[1],0.6/2));
+	CHECK(equal_rels(profile.single_str_rel(1)[1],0.3/2));
+	CHECK(profile.single_str_rel(2)[1]==0.0);
+	CHECK(equal_rels(profile.single_arc_rel(1).find(std::make_pair(2ul,4ul))->second,0.2/3));
+	CHECK(profile.single_arc_rel(2).empty());
+
+	// the result does not depend on the number of threads
+	ReliabilityProfile profile_par(ma,bm_probs,&am_probs,3);
+	std::ostringstream out1, out2;
+	ReliabilityProfile::write_column_rel(out1,profile.seq_rel(),profile.str_rel());
+	ReliabilityProfile::write_arc_rel(out1,profile.arc_rel());
+	ReliabilityProfile::write_column_rel(out2,profile_par.seq_rel(),profile_par.str_rel());
+	ReliabilityProfile::write_arc_rel(out2,profile_par.arc_rel());
+	CHECK(out1.str()==out2.str());
+
+	// probabilities must fit the alignment
+	names.pop_back();
+	bool failed=false;
+	try {
+	    ReliabilityProfile wrong(ma,MatchProbsSet(names,false),NULL,1);
+	} catch(failure &f) {
+	    failed=true;
+	}
+	CHECK(failed);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	return 1;
+    }
+
+    return 0;
+}
@@ -1,8 +1,11 @@
 #include <stdio.h>
+#include <math.h>
+#include <iostream>
 #include <LocARNA/sequence.hh>
 #include <LocARNA/rna_ensemble.hh>
 #include <LocARNA/basepairs.hh>
 #include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
 
 using namespace LocARNA;
 
@@ -143,6 +146,90 @@ test_in_loop_probs(const Sequence &seq, const RnaEnsemble &rna_ensemble) {
     }
 }
 
+//! @brief compare in loop probabilities of compact and full retention
+bool
+test_compact_retention(const Sequence &seq, bool use_alifold) {
+    size_t max_span=40;
+    PFoldParams pfoldparams(true,false);
+    PFoldParams compact_pfoldparams(true,false,2,McCRetention(true,max_span,"."));
+    
+    RnaEnsemble rna_ensemble(seq,pfoldparams,true,use_alifold);
+    RnaEnsemble compact_ensemble(seq,compact_pfoldparams,true,use_alifold);
+    
+    size_t fails=0;
+    for (size_t i=1; i<=seq.length(); ++i) {
+	for (size_t j=i+TURN+1; j<=seq.length(); ++j) {
+	    if (j-i > max_span) {
+		// long base pairs are dropped
+		if (compact_ensemble.arc_prob(i,j)!=0.0) fails++;
+		continue;
+	    }
+	    if (fabs(compact_ensemble.arc_prob(i,j)-rna_ensemble.arc_prob(i,j))>1e-5) fails++;
+	    
+	    for (size_t k=i+1; k<j; ++k) {
+		if (fabs(compact_ensemble.unpaired_in_loop_prob(k,i,j)
+			 -rna_ensemble.unpaired_in_loop_prob(k,i,j))>1e-5) fails++;
+	    }
+	    for (size_t ip=i+1; ip<j; ++ip) {
+		for (size_t jp=ip+TURN+1; jp<j; ++jp) {
+		    if (fabs(compact_ensemble.arc_in_loop_prob(ip,jp,i,j)
+			     -rna_ensemble.arc_in_loop_prob(ip,jp,i,j))>1e-5) fails++;
+		}
+	    }
+	}
+    }
+    
+    if (fails>0) {
+	std::cerr << fails << " Fails of compact retention."<<std::endl;
+    }
+    return fails==0;
+}
+
+//! @brief check the bounded span of global folding with maximal
+//! span and of local folding in windows
+bool
+test_local_folding(const Sequence &seq) {
+    size_t max_span=40;
+    PFoldParams span_pfoldparams(true,false,2,McCRetention(),max_span);
+    PFoldParams window_pfoldparams(true,false,2,McCRetention(),max_span,60);
+    
+    RnaEnsemble span_ensemble(seq,span_pfoldparams,true,false);
+    RnaEnsemble window_ensemble(seq,window_pfoldparams,false,false);
+    
+    size_t fails=0;
+    
+    if (span_ensemble.max_bp_span()!=max_span) fails++;
+    if (window_ensemble.max_bp_span()!=max_span) fails++;
+    if (!span_ensemble.has_in_loop_probs()) fails++;
+    if (window_ensemble.has_stacking_probs()) fails++;
+    
+    for (size_t k=1; k<=seq.length(); ++k) {
+	double p_span=0.0;
+	double p_window=0.0;
+	for (size_t l=1; l<=seq.length(); ++l) {
+	    if (l+TURN+1<=k) {
+		p_span += span_ensemble.arc_prob(l,k);
+		p_window += window_ensemble.arc_prob(l,k);
+	    } else if (k+TURN+1<=l) {
+		p_span += span_ensemble.arc_prob(k,l);
+		p_window += window_ensemble.arc_prob(k,l);
+		if (l-k > max_span
+		    && (span_ensemble.arc_prob(k,l)!=0.0
+			|| window_ensemble.arc_prob(k,l)!=0.0)) fails++;
+	    }
+	}
+	// each base is paired at most once
+	if (p_span>1.0+theta2 || p_window>1.0+theta2) fails++;
+    }
+    
+    RnaData rna_data(window_ensemble,0.01,0,window_pfoldparams);
+    if (rna_data.max_arc_span()>max_span) fails++;
+    
+    if (fails>0) {
+	std::cerr << fails << " Fails of local folding."<<std::endl;
+    }
+    return fails==0;
+}
 
 int
 main(int argc,char **argv) {
@@ -195,6 +282,17 @@ main(int argc,char **argv) {
     delete rna_ensemble;
     delete mrna_ensemble;
     
+    if (! test_compact_retention(mseq,false)) {
+	throw(failure("test compact retention failed"));
+    }
+    
+    if (! test_compact_retention(mseq,true)) {
+	throw(failure("test compact retention failed for alifold"));
+    }
+    
+    if (! test_local_folding(mseq)) {
+	throw(failure("test local folding failed"));
+    }
     
     return 0;
 }
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/aligner.hh>
+#include <LocARNA/progressive_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for score-only alignment
+
+    Compares the scores of score-only alignment to the scores of
+    the standard alignment in several alignment modes.
+*/
+
+//! @brief write an RNA in pp format
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< "1 14 0.8" << std::endl
+	<< "2 13 0.7" << std::endl
+	<< "3 12 0.6" << std::endl
+	<< "1 30 0.1" << std::endl
+	<< "5 25 0.05" << std::endl
+	<< "18 30 0.5" << std::endl
+	<< "19 29 0.45" << std::endl
+	<< "20 28 0.4" << std::endl
+	<< std::endl << "#END" << std::endl;
+}
+
+//! @brief whether score-only alignment yields the standard score
+static
+bool
+check_score_only(const RnaData &rna_dataA,
+		 const RnaData &rna_dataB,
+		 const ProfileAlignmentParams &params) {
+    ProfileAlignmentProblem problem(rna_dataA,rna_dataB,params,NULL);
+    ProfileAlignmentProblem score_only_problem(rna_dataA,rna_dataB,params,NULL,true);
+
+    infty_score_t score = problem.aligner().align();
+    infty_score_t score_only = score_only_problem.aligner().align();
+
+    const Aligner &aligner = score_only_problem.aligner();
+
+    return score == score_only
+	&& aligner.dp_memory() <= aligner.full_dp_memory()
+	&& problem.aligner().dp_memory() == problem.aligner().full_dp_memory();
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,false);
+    ProfileAlignmentParams params;
+
+    int ok=0;
+
+    try {
+	write_pp("Tests/score_onlyA.pp","seqA","GGGAAAUUUUCCCAAAGGGCAUUAGCCCAA");
+	write_pp("Tests/score_onlyB.pp","seqB","GGGAAAUUCCCAAAGGGCAUUUGCCCAAUU");
+
+	RnaData rna_dataA("Tests/score_onlyA.pp",params.min_prob,0,pfparams);
+	RnaData rna_dataB("Tests/score_onlyB.pp",params.min_prob,0,pfparams);
+
+	CHECK(check_score_only(rna_dataA,rna_dataB,params));
+
+	params.free_endgaps="++++";
+	CHECK(check_score_only(rna_dataA,rna_dataB,params));
+	params.free_endgaps="----";
+
+	params.sequ_local=true;
+	CHECK(check_score_only(rna_dataA,rna_dataB,params));
+
+	params.struct_local=true;
+	CHECK(check_score_only(rna_dataA,rna_dataB,params));
+	params.sequ_local=false;
+	CHECK(check_score_only(rna_dataA,rna_dataB,params));
+	params.struct_local=false;
+
+	params.no_lonely_pairs=true;
+	CHECK(check_score_only(rna_dataA,rna_dataB,params));
+	params.no_lonely_pairs=false;
+
+	// the score is also reported without trace by align_profiles()
+	Alignment::edge_ends_t no_edges;
+	Alignment::edges_t edges(no_edges,no_edges);
+	CHECK(ProgressiveAligner::align_profiles(rna_dataA,rna_dataB,params,NULL,NULL)
+	      == ProgressiveAligner::align_profiles(rna_dataA,rna_dataB,params,NULL,&edges));
+
+	// there is no trace back in score-only mode
+	ProfileAlignmentProblem problem(rna_dataA,rna_dataB,params,NULL,true);
+	problem.aligner().align();
+	bool rejected=false;
+	try {
+	    problem.aligner().trace();
+	} catch (failure &f) {
+	    rejected=true;
+	}
+	CHECK(rejected);
+
+	rejected=false;
+	try {
+	    problem.aligner().get_alignment();
+	} catch (failure &f) {
+	    rejected=true;
+	}
+	CHECK(rejected);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	ok=1;
+    }
+
+    std::remove("Tests/score_onlyA.pp");
+    std::remove("Tests/score_onlyB.pp");
+
+    return ok;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include <LocARNA/aux.hh>
+#include <LocARNA/alignment.hh>
+#include <LocARNA/sparse_mea_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for SparseMEAAligner
+
+    Decodes alignments from small hand-made sets of match
+    probabilities and compares to the optimal alignments determined
+    by hand.
+*/
+
+//! @brief whether two scores are equal up to rounding
+static
+bool
+equal_scores(double x, double y) {
+    return std::fabs(x-y) < 1e-9;
+}
+
+int
+main(int argc, char **argv) {
+
+    try {
+	// base match probabilities only
+	SparseMEAAligner mea(5,4,1.0);
+	mea.add_basematch_prob(1,1,0.9);
+	mea.add_basematch_prob(2,3,0.5);
+	mea.add_basematch_prob(3,2,0.6);
+	mea.add_basematch_prob(4,3,0.7);
+	mea.add_basematch_prob(5,4,0.8);
+
+	CHECK(equal_scores(mea.align(),0.9+0.6+0.7+0.8));
+	CHECK(mea.matches().size()==4);
+	CHECK(mea.matches()[1]==std::make_pair((pos_type)3,(pos_type)2));
+
+	// position 2 of A is deleted
+	Alignment::edges_t edges = mea.alignment_edges();
+	CHECK(edges.size()==5);
+	CHECK(edges.first[1]==(pos_type)2 && edges.second[1].is_gap());
+	CHECK(edges.first[4]==(pos_type)5 && edges.second[4]==(pos_type)4);
+
+	// arc match probabilities support the matches of their ends
+	SparseMEAAligner mea_am(3,3,1.0);
+	mea_am.add_basematch_prob(1,2,0.7);
+	mea_am.add_basematch_prob(2,1,0.6);
+	CHECK(equal_scores(mea_am.align(),0.7));
+	mea_am.add_arcmatch_prob(2,3,1,3,0.2);
+	CHECK(equal_scores(mea_am.align(),0.6+0.2+0.2));
+	CHECK(mea_am.matches().size()==2);
+	CHECK(mea_am.matches()[0]==std::make_pair((pos_type)2,(pos_type)1));
+
+	// deletions precede insertions between matches
+	edges = mea_am.alignment_edges();
+	CHECK(edges.size()==4);
+	CHECK(edges.first[0]==(pos_type)1 && edges.second[0].is_gap());
+	CHECK(edges.first[2].is_gap() && edges.second[2]==(pos_type)2);
+
+	// without probabilities, everything is deleted or inserted
+	SparseMEAAligner mea_empty(3,2,1.0);
+	CHECK(mea_empty.align()==0.0);
+	CHECK(mea_empty.matches().empty());
+	CHECK(mea_empty.alignment_edges().size()==5);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+
+#include <LocARNA/pfold_params.hh>
+#include <LocARNA/rna_data.hh>
+#include <LocARNA/alignment.hh>
+#include <LocARNA/progressive_aligner.hh>
+#include <LocARNA/variant_aligner.hh>
+
+#include "check.hh"
+
+using namespace LocARNA;
+
+/** @file some unit tests for VariantAligner
+
+    Aligns a variant of an RNA, which differs by a substitution and
+    the probabilities of some base pairs, to a fixed partner and
+    compares to the full alignment.
+*/
+
+//! @brief write an RNA in pp format with a hairpin at each end
+static
+void
+write_pp(const std::string &filename,
+	 const std::string &name,
+	 const std::string &seq,
+	 double p_right) {
+    std::ofstream out(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to file.");
+    }
+    out << "#PP 2.0" << std::endl << std::endl
+	<< name << " " << seq << std::endl << std::endl
+	<< "#END" << std::endl << std::endl
+	<< "#SECTION BASEPAIRS" << std::endl << std::endl
+	<< "1 14 0.8" << std::endl
+	<< "2 13 0.7" << std::endl
+	<< "3 12 0.6" << std::endl
+	<< "1 30 0.1" << std::endl
+	<< "5 25 0.05" << std::endl
+	<< "18 30 0.5" << std::endl
+	<< "19 29 " << p_right << std::endl
+	<< "20 28 0.4" << std::endl
+	<< std::endl << "#END" << std::endl;
+}
+
+//! @brief whether two edge vectors are equal
+static
+bool
+equal_edge_ends(const Alignment::edge_ends_t &x, const Alignment::edge_ends_t &y) {
+    if (x.size()!=y.size()) return false;
+    for (size_t k=0; k<x.size(); k++) {
+	if (x[k].is_pos()!=y[k].is_pos()) return false;
+	if (x[k].is_pos() && (pos_type)x[k]!=(pos_type)y[k]) return false;
+    }
+    return true;
+}
+
+int
+main(int argc, char **argv) {
+    PFoldParams pfparams(false,false);
+    ProfileAlignmentParams params;
+
+    int ok=0;
+
+    try {
+	write_pp("Tests/variantA.pp","seqA","GGGAAAUUUUCCCAAAGGGCAUUAGCCCAA",0.45);
+	write_pp("Tests/variantB.pp","seqB","GGGAAAUUUUCCCAAAGGGCAUUUGCCCAA",0.45);
+	write_pp("Tests/variantV.pp","seqA","GGGAAAUUUUCCCAAAGGGCAUUCGCCCAA",0.3);
+
+	RnaData rna_dataA("Tests/variantA.pp",params.min_prob,0,pfparams);
+	RnaData rna_dataB("Tests/variantB.pp",params.min_prob,0,pfparams);
+	RnaData variantA("Tests/variantV.pp",params.min_prob,0,pfparams);
+
+	Alignment::edge_ends_t no_edges;
+	Alignment::edges_t edges(no_edges,no_edges);
+	Alignment::edges_t full_edges(no_edges,no_edges);
+
+	VariantAligner variant_aligner(rna_dataA,rna_dataB,params,pfparams,0,0);
+
+	// the base score is the score of the full alignment
+	CHECK(variant_aligner.base_score()
+	      == ProgressiveAligner::align_profiles(rna_dataA,rna_dataB,params,NULL,NULL));
+
+	// the variant score and alignment are the ones of the full
+	// alignment, but the entries of the left hairpin are reused
+	infty_score_t score = variant_aligner.align(variantA,&edges);
+	infty_score_t full_score =
+	    ProgressiveAligner::align_profiles(variantA,rna_dataB,params,NULL,&full_edges);
+
+	CHECK(score == full_score);
+	CHECK(equal_edge_ends(edges.first,full_edges.first));
+	CHECK(equal_edge_ends(edges.second,full_edges.second));
+	CHECK(variant_aligner.reused_entries() > 0);
+	CHECK(variant_aligner.reused_entries() < variant_aligner.num_entries());
+
+	// nothing changes for the base RNA itself
+	CHECK(variant_aligner.align(rna_dataA,NULL) == variant_aligner.base_score());
+	CHECK(variant_aligner.reused_entries() == variant_aligner.num_entries());
+
+	// snapping the probabilities within the tolerance
+	variantA.snap_probabilities(rna_dataA,0.1);
+	CHECK(variantA.arc_prob(19,29) == 0.3);
+	variantA.snap_probabilities(rna_dataA,0.2);
+	CHECK(variantA.arc_prob(19,29) == 0.45);
+
+    } catch(failure &f) {
+	std::cerr << "Failure: " << f.what() << std::endl;
+	ok=1;
+    }
+
+    std::remove("Tests/variantA.pp");
+    std::remove("Tests/variantB.pp");
+    std::remove("Tests/variantV.pp");
+
+    return ok;
+}
@@ -14,6 +14,7 @@
 #include <iomanip>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 //#include <math.h>
 
@@ -34,6 +35,11 @@
 #include "LocARNA/global_stopwatch.hh"
 #include "LocARNA/pfold_params.hh"
 #include "LocARNA/rna_ensemble.hh"
+#include "LocARNA/progressive_aligner.hh"
+#include "LocARNA/alignment_server.hh"
+#include "LocARNA/reverse_strand.hh"
+#include "LocARNA/thread_pool.hh"
+#include "LocARNA/arena.hh"
 
 
 //using namespace std;
@@ -91,6 +97,8 @@ struct command_line_parameters {
     int tau_factor;
 
     bool no_lonely_pairs; //!< no lonely pairs option
+    int max_bp_span; //!< maximal base pair span in folding (0 for no limit)
+    int plfold_window; //!< window size for local folding (0 for global folding)
 
     //! allow exclusions for maximizing alignment of connected substructures
     bool struct_local;
@@ -151,6 +159,9 @@ struct command_line_parameters {
     //! second input file
     std::string fileB;
 
+    bool opt_fileA; //!< whether the first input file is given
+    bool opt_fileB; //!< whether the second input file is given
+
     std::string clustal_out; //!< name of clustal output file
 
     bool opt_clustal_out; //!< whether to write clustal output to file
@@ -230,6 +241,20 @@ struct command_line_parameters {
 
 
     bool opt_score_components; //!< whether to report score components
+
+    int threads; //!< number of threads for precomputations
+
+    int arcmatch_score_memory; //!< memory budget for arc match score table in MB
+
+    bool opt_top_level_checkpoints; //!< whether to keep only checkpoint rows of the top level
+
+    bool opt_score_only; //!< whether to compute only the score
+
+    bool opt_both_strands; //!< whether to align to both strands of input 2
+
+    bool opt_serve; //!< whether to serve alignment jobs from stdin
+    bool opt_serve_socket; //!< whether to serve alignment jobs on a socket
+    std::string serve_socket; //!< path of the server socket
 };
 
 
@@ -270,6 +295,7 @@ option_def my_options[] = {
     {"free-endgaps",0,0,O_ARG_STRING,&clp.free_endgaps,"----","spec","Whether and which end gaps are free. order: L1,R1,L2,R2"},
     {"normalized",0,&clp.opt_normalized,O_ARG_INT,&clp.normalized_L,"0","L","Normalized local alignment with parameter L"},
     {"penalized",0,&clp.opt_penalized,O_ARG_INT,&clp.position_penalty,"0","PP","Penalized local alignment with penalty PP"},
+    {"both-strands",0,&clp.opt_both_strands,O_NO_ARG,0,O_NODEFAULT,"","Align input 1 to both strands of input 2 (the reverse complement is folded); positions in HIT lines refer to the forward strand"},
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
 
@@ -296,7 +322,15 @@ option_def my_options[] = {
     {"max-diff-relax",0,&clp.opt_max_diff_relax,O_NO_ARG,0,O_NODEFAULT,"","Relax deviation constraints in multiple aligmnent"},
     {"min-am-prob",'a',0,O_ARG_DOUBLE,&clp.min_am_prob,"0.0005","amprob","Minimal Arc-match probability"},
     {"min-bm-prob",'b',0,O_ARG_DOUBLE,&clp.min_bm_prob,"0.0005","bmprob","Minimal Base-match probability"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"1","threads","Number of threads for precomputations and server jobs (0=number of processors)"},
+    {"arcmatch-score-memory",0,0,O_ARG_INT,&clp.arcmatch_score_memory,"0","MB","Memory budget for the table of precomputed arc match scores (0=off)"},
+    {"top-level-checkpoints",0,&clp.opt_top_level_checkpoints,O_NO_ARG,0,O_NODEFAULT,"","Keep only O(sqrt(n)) rows of the top level matrix and recompute the others in the trace back (saves memory for long sequences)"},
+    {"score-only",0,&clp.opt_score_only,O_NO_ARG,0,O_NODEFAULT,"","Compute only the score (no trace back and alignment output; saves memory and time)"},
     
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Server mode"},
+    {"serve",0,&clp.opt_serve,O_NO_ARG,0,O_NODEFAULT,"","Serve alignment jobs (one JSON object per line) from stdin; results are written to stdout"},
+    {"serve-socket",0,&clp.opt_serve_socket,O_ARG_STRING,&clp.serve_socket,O_NODEFAULT,"path","Serve alignment jobs on a Unix domain socket"},
+
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Special sauce options"},
     {"kbest",0,&clp.opt_subopt,O_ARG_INT,&clp.kbest_k,"-1","k","Enumerate k-best alignments"},
     {"better",0,&clp.opt_subopt,O_ARG_INT,&clp.subopt_threshold,"-1000000","t","Enumerate alignments better threshold t"},
@@ -326,6 +360,8 @@ option_def my_options[] = {
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
 
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
+    {"max-bp-span",0,0,O_ARG_INT,&clp.max_bp_span,"0","span","Maximal span of base pairs in folding (default: no limit)"},
+    {"plfold-window",0,0,O_ARG_INT,&clp.plfold_window,"0","size","Fold locally in windows of this size (RNAplfold-style; default: global folding)"},
     // {"anchorA",0,0,O_ARG_STRING,&clp.seq_anchors_A,"","string","Anchor constraints sequence A"},
     // {"anchorB",0,0,O_ARG_STRING,&clp.seq_anchors_B,"","string","Anchor constraints sequence B"},
     //{"ignore-constraints",0,&clp.opt_ignore_constraints,O_NO_ARG,0,O_NODEFAULT,"","Ignore constraints input files"},
@@ -335,14 +371,195 @@ option_def my_options[] = {
     
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files RNA sequences and pair probabilities"},
 
-    {"",0,0,O_ARG_STRING,&clp.fileA,O_NODEFAULT,"input1","Input file 1"},
-    {"",0,0,O_ARG_STRING,&clp.fileB,O_NODEFAULT,"input2","Input file 2"},
+    {"",0,&clp.opt_fileA,O_ARG_STRING,&clp.fileA,O_NODEFAULT,"input1","Input file 1"},
+    {"",0,&clp.opt_fileB,O_ARG_STRING,&clp.fileB,O_NODEFAULT,"input2","Input file 2"},
     {"",0,0,0,0,O_NODEFAULT,"",""}
 };
 
 
 // ------------------------------------------------------------
 
+/**
+ * @brief Parameters of profile alignment from the command line
+ *
+ * @param ribosum ribosum matrix (or NULL)
+ * @param ribofit ribofit (or NULL)
+ *
+ * @return parameters for ProgressiveAligner::align_profiles() and the
+ * alignment server
+ */
+ProfileAlignmentParams
+profile_alignment_params(RibosumFreq *ribosum, Ribofit *ribofit) {
+    ProfileAlignmentParams params;
+    params.match = clp.match_score;
+    params.mismatch = clp.mismatch_score;
+    params.indel = clp.indel_score;
+    params.indel_opening = clp.indel_opening_score;
+    params.unpaired_penalty = clp.unpaired_penalty;
+    params.struct_weight = clp.struct_weight;
+    params.tau_factor = clp.tau_factor;
+    params.exclusion = clp.exclusion_score;
+    params.temperature = clp.temperature;
+    params.exp_prob = clp.opt_exp_prob ? clp.exp_prob : -1;
+    params.ribosum = ribosum;
+    params.ribofit = ribofit;
+    params.stacking = clp.opt_stacking;
+    params.new_stacking = clp.opt_new_stacking;
+    params.no_lonely_pairs = clp.no_lonely_pairs;
+    params.struct_local = clp.struct_local;
+    params.sequ_local = clp.sequ_local;
+    params.free_endgaps = clp.free_endgaps;
+    params.max_diff = clp.max_diff;
+    params.max_diff_am = clp.max_diff_am;
+    params.max_diff_at_am = clp.max_diff_at_am;
+    params.min_prob = clp.min_prob;
+    params.min_am_prob = clp.min_am_prob;
+    params.min_bm_prob = clp.min_bm_prob;
+    params.arcmatch_score_memory = (size_t)std::max(clp.arcmatch_score_memory,0)<<20;
+    return params;
+}
+
+//! @brief Alignment of input 1 to one strand of input 2
+class StrandTask : public ThreadPool::Task {
+    const RnaData &rna_dataA_; //!< input 1
+    const RnaData &rna_dataB_; //!< strand of input 2
+    const ProfileAlignmentParams &params_; //!< alignment parameters
+public:
+    infty_score_t score; //!< alignment score
+    Alignment::edges_t edges; //!< alignment edges
+
+    /**
+     * @brief Construct
+     * @param rna_dataA input 1
+     * @param rna_dataB strand of input 2
+     * @param params alignment parameters
+     * @param no_edges empty edge ends (initial edges)
+     */
+    StrandTask(const RnaData &rna_dataA,
+	       const RnaData &rna_dataB,
+	       const ProfileAlignmentParams &params,
+	       const Alignment::edge_ends_t &no_edges)
+	: rna_dataA_(rna_dataA),
+	  rna_dataB_(rna_dataB),
+	  params_(params),
+	  score(infty_score_t::neg_infty),
+	  edges(no_edges,no_edges)
+    {}
+
+    void
+    run() {
+	score = ProgressiveAligner::align_profiles(rna_dataA_,rna_dataB_,params_,NULL,&edges);
+    }
+};
+
+/**
+ * @brief Align input 1 to both strands of input 2
+ *
+ * Input 1 is read (and folded) once for both strands; the alignments
+ * to the two strands run on a common thread pool.
+ *
+ * @param params alignment parameters
+ * @param pfparams folding parameters
+ *
+ * @return return code of locarna
+ */
+int
+align_both_strands(const ProfileAlignmentParams &params,
+		   const PFoldParams &pfparams) {
+    typedef size_t size_type;
+
+    RnaData *rna_dataA=NULL;
+    RnaData *rna_dataB=NULL;
+    try {
+	rna_dataA = new RnaData(clp.fileA,
+				clp.min_prob,
+				clp.max_bps_length_ratio,
+				pfparams);
+	rna_dataB = new RnaData(clp.fileB,
+				clp.min_prob,
+				clp.max_bps_length_ratio,
+				pfparams);
+    } catch (failure &f) {
+	std::cerr << "ERROR:\tfailed to read input" <<std::endl
+		  << "\t"<< f.what() <<std::endl;
+	if (rna_dataA) delete rna_dataA;
+	return -1;
+    }
+
+    int return_code=0;
+    {
+	ReverseStrand reverse(*rna_dataB,
+			      clp.min_prob,
+			      clp.max_bps_length_ratio,
+			      pfparams);
+
+	if (clp.opt_verbose) {
+	    std::cout << "Fold reverse strand of input 2."<<std::endl;
+	}
+
+	const RnaData *rna_dataB_reverse=NULL;
+	try {
+	    rna_dataB_reverse = &reverse.rna_data();
+	} catch (failure &f) {
+	    std::cerr << "ERROR:\tfailed to fold the reverse strand of input 2" <<std::endl
+		      << "\t"<< f.what() <<std::endl;
+	    delete rna_dataA;
+	    delete rna_dataB;
+	    return -1;
+	}
+
+	Alignment::edge_ends_t no_edges;
+	StrandTask forward_task(*rna_dataA,*rna_dataB,params,no_edges);
+	StrandTask reverse_task(*rna_dataA,*rna_dataB_reverse,params,no_edges);
+
+	try {
+	    ThreadPool pool((size_type)std::max(clp.threads,0));
+	    pool.submit(&forward_task);
+	    pool.submit(&reverse_task);
+	    pool.wait();
+	} catch (failure &f) {
+	    std::cerr << "ERROR: " << f.what() << std::endl;
+	    return_code=-1;
+	}
+
+	for (size_type k=0; return_code==0 && k<2; k++) {
+	    const bool fwd = (k==0);
+	    const StrandTask &task = fwd ? forward_task : reverse_task;
+	    const Sequence &seqB = fwd ? rna_dataB->sequence() : reverse.sequence();
+
+	    Alignment alignment(rna_dataA->sequence(),seqB,task.edges);
+
+	    if (clp.opt_pos_output) {
+		size_type startB = alignment.local_startB();
+		size_type endB = alignment.local_endB();
+		if (!fwd) {
+		    startB = reverse.forward_position(alignment.local_endB());
+		    endB = reverse.forward_position(alignment.local_startB());
+		}
+		std::cout << "HIT "<<task.score<<" "
+			  <<alignment.local_startA()<<" "
+			  <<startB<<" "
+			  <<alignment.local_endA()<<" "
+			  <<endB<<" "
+			  <<(fwd?"+":"-")
+			  <<std::endl;
+	    }
+	    if (!clp.opt_pos_output || clp.opt_local_output) {
+		std::cout << "Strand: "<<(fwd?"+":"-")<<std::endl;
+		std::cout << "Score: "<<task.score<<std::endl;
+		MultipleAlignment ma(alignment,clp.opt_local_output);
+		std::cout << std::endl;
+		ma.write(std::cout,clp.output_width);
+		std::cout << std::endl;
+	    }
+	}
+    }
+
+    delete rna_dataA;
+    delete rna_dataB;
+
+    return return_code;
+}
 
 // ------------------------------------------------------------
 // MAIN
@@ -396,6 +613,21 @@ main(int argc, char **argv) {
 	return -1;
     }
 
+    bool serve = clp.opt_serve || clp.opt_serve_socket;
+
+    // input files are mandatory, unless we run as server
+    if (serve ? (clp.opt_fileA || clp.opt_fileB) : !(clp.opt_fileA && clp.opt_fileB)) {
+	std::cerr << "ERROR --- "
+		  << (serve
+		      ? "Input files cannot be given in server mode."
+		      : "Mandatory argument missing: <input1> <input2>")
+		  << std::endl;
+	printf("USAGE: ");
+	print_usage(argv[0],my_options);
+	printf("\n");
+	return -1;
+    }
+
     if (clp.opt_stopwatch) {
 	stopwatch.set_print_on_exit(true);
     }
@@ -426,6 +658,38 @@ main(int argc, char **argv) {
     	return -1;
     }
 
+    if (clp.opt_both_strands
+	&& (serve || clp.opt_subopt || clp.opt_normalized || clp.opt_penalized
+	    || clp.opt_mea_alignment || clp.opt_write_matchprobs || clp.opt_read_matchprobs
+	    || clp.opt_write_arcmatch_scores || clp.opt_read_arcmatch_scores
+	    || clp.opt_read_arcmatch_probs || clp.opt_clustal_out || clp.opt_pp_out
+	    || clp.opt_write_structure)) {
+	std::cerr << "ERROR: Option both-strands supports only plain score optimization;"
+		  << " it cannot be combined with server mode, kbest, normalized, penalized,"
+		  << " mea alignment, match/arcmatch probability files, or file output."
+		  <<std::endl;
+	return -1;
+    }
+
+    if (clp.opt_score_only
+	&& (serve || clp.opt_subopt || clp.opt_normalized || clp.opt_penalized
+	    || clp.opt_both_strands || clp.opt_clustal_out || clp.opt_pp_out
+	    || clp.opt_pos_output || clp.opt_local_output
+	    || clp.opt_write_structure || clp.opt_score_components)) {
+	std::cerr << "ERROR: Option score-only cannot be combined with server mode, kbest,"
+		  << " normalized, penalized, both-strands, or alignment output."
+		  <<std::endl;
+	return -1;
+    }
+
+    if (serve
+	&& (clp.opt_subopt || clp.opt_normalized || clp.opt_penalized)) {
+	std::cerr << "ERROR: Server mode cannot be combined with kbest, normalized,"
+		  << " or penalized alignment."
+		  <<std::endl;
+	return -1;
+    }
+
     // ----------------------------------------
     // temporarily turn off stacking unless background prob is set
     //
@@ -484,11 +748,60 @@ main(int argc, char **argv) {
 	}
     }
     
+    if (clp.max_bp_span<0 || clp.plfold_window<0) {
+	std::cerr << "ERROR: negative value of max-bp-span or plfold-window."<<std::endl;
+	return -1;
+    }
+    
+    PFoldParams pfparams(clp.no_lonely_pairs, clp.opt_stacking || clp.opt_new_stacking,2,
+			 McCRetention(),clp.max_bp_span,clp.plfold_window);
+
     // ------------------------------------------------------------
-    // Get input data and generate data objects
+    // Server mode: run jobs with the parameters as defaults
     //
+    if (serve) {
+	ProfileAlignmentParams params = profile_alignment_params(ribosum,ribofit);
+
+	int return_code=0;
+	std::cout.flush(); // results are written directly to the descriptor
+	try {
+	    AlignmentServer server(params,
+				   pfparams,
+				   clp.max_bps_length_ratio,
+				   (size_type)std::max(clp.threads,0));
+	    if (clp.opt_serve_socket) {
+		server.serve_socket(clp.serve_socket);
+	    } else {
+		server.serve(0,1);
+	    }
+	} catch (failure &f) {
+	    std::cerr << "ERROR: " << f.what() << std::endl;
+	    return_code=-1;
+	}
+
+	if (ribofit) delete ribofit;
+	if (ribosum) delete ribosum;
+	stopwatch.stop("total");
+	return return_code;
+    }
 
-    PFoldParams pfparams(clp.no_lonely_pairs, clp.opt_stacking || clp.opt_new_stacking);
+    // ------------------------------------------------------------
+    // Align to both strands of the second input
+    //
+    if (clp.opt_both_strands) {
+	ProfileAlignmentParams params = profile_alignment_params(ribosum,ribofit);
+
+	int return_code = align_both_strands(params,pfparams);
+
+	if (ribofit) delete ribofit;
+	if (ribosum) delete ribosum;
+	stopwatch.stop("total");
+	return return_code;
+    }
+
+    // ------------------------------------------------------------
+    // Get input data and generate data objects
+    //
     
     RnaData *rna_dataA=0;
     try {
@@ -788,9 +1101,14 @@ main(int argc, char **argv) {
 		    *arc_matches,
 		    match_probs,
 		    scoring_params,
-		    false // no Boltzmann weights (as required for LocARNA-P)
+		    false, // no Boltzmann weights (as required for LocARNA-P)
+		    (size_type)std::max(clp.threads,0)
 		    );    
 
+    // tabulate the arc match scores, if they fit into the budget
+    scoring.precompute_arcmatch_scores((size_t)std::max(clp.arcmatch_score_memory,0)<<20,
+				       (size_t)std::max(clp.threads,0));
+
     if (clp.opt_write_arcmatch_scores) {
 	if (clp.opt_verbose) {
 	    std::cout << "Write arcmatch scores to file "<< clp.arcmatch_scores_file<<" and exit."<<std::endl;
@@ -820,7 +1138,10 @@ main(int argc, char **argv) {
 	. min_am_prob(clp.min_am_prob)
 	. min_bm_prob(clp.min_bm_prob)
 	. stacking(clp.opt_stacking || clp.opt_new_stacking)
-	. constraints(seq_constraints);
+	. constraints(seq_constraints)
+	. top_level_checkpoints(clp.opt_top_level_checkpoints)
+	. score_only(clp.opt_score_only)
+	. arena(Arena::thread_arena());
 
     // enumerate suboptimal alignments (using interval splitting)
     if (clp.opt_subopt) {
@@ -862,11 +1183,17 @@ main(int argc, char **argv) {
     //
     std::cout << "Score: "<<score<<std::endl;
 
+    if (clp.opt_verbose) {
+	std::cout << "Memory of DP matrices: "
+		  << (aligner.dp_memory()>>10) << " kB"
+		  << " (without restriction of M: "
+		  << (aligner.full_dp_memory()>>10) << " kB)" << std::endl;
+    }
 
     // ------------------------------------------------------------
     // Traceback
     //
-    if ((!clp.opt_normalized && !clp.opt_penalized) && DO_TRACE) {
+    if ((!clp.opt_normalized && !clp.opt_penalized && !clp.opt_score_only) && DO_TRACE) {
 	    
 	if (clp.opt_verbose) {
 	    std::cout << "Traceback."<<std::endl;
@@ -937,7 +1264,7 @@ main(int argc, char **argv) {
     
     bool return_code=0;
 
-    if (clp.opt_normalized || clp.opt_penalized || DO_TRACE) {
+    if ((clp.opt_normalized || clp.opt_penalized || DO_TRACE) && !clp.opt_score_only) {
 	// if we did a trace (one way or the other)
 	
 	const Alignment &alignment = aligner.get_alignment();
@@ -0,0 +1,232 @@
+/**
+ * \file locarna_consistency.cc
+ *
+ * \brief Defines main function of locarna_consistency
+ *
+ * Probabilistic consistency transformation of base and arc match
+ * probabilities of all pairs of a set of RNAs (as computed by
+ * locarna_p). Replaces the transformation in Perl by mlocarna.
+ *
+ * Input is a file that lists the names of the sequences (one per
+ * line). Match probabilities are read from and written to
+ * directories with one file nameA-nameB per pair (as written by
+ * mlocarna), or from and to a single binary file.
+ *
+ * Copyright (C) Sebastian Will <will(@)informatik.uni-freiburg.de>
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "LocARNA/aux.hh"
+#include "LocARNA/global_stopwatch.hh"
+#include "LocARNA/consistency.hh"
+
+using namespace LocARNA;
+
+//! Version string (from configure.ac via autoconf system)
+const std::string
+VERSION_STRING = (std::string)PACKAGE_STRING;
+
+// ------------------------------------------------------------
+//
+// Options
+//
+#include "LocARNA/options.hh"
+
+//! \brief Structure for command line parameters of locarna_consistency
+//!
+//! Encapsulating all command line parameters in a common structure
+//! avoids name conflicts and makes downstream code more informative.
+//!
+struct command_line_parameters {
+    bool opt_bm_probs; //!< whether to read base match probabilities
+    std::string bm_probs; //!< input of base match probabilities
+    bool opt_am_probs; //!< whether to read arc match probabilities
+    std::string am_probs; //!< input of arc match probabilities
+
+    bool opt_write_bm_probs; //!< whether to write base match probabilities
+    std::string write_bm_probs; //!< output of base match probabilities
+    bool opt_write_am_probs; //!< whether to write arc match probabilities
+    std::string write_am_probs; //!< output of arc match probabilities
+    bool opt_binary; //!< whether to write binary output
+
+    double min_bm_prob; //!< minimal base match probability
+    double min_am_prob; //!< minimal arc match probability
+    bool opt_scale; //!< whether to scale after the transformation
+    int threads; //!< number of threads
+
+    bool opt_help; //!< whether to print help
+    bool opt_version; //!< whether to print version
+    bool opt_verbose; //!< whether to print verbose output
+    bool opt_stopwatch; //!< whether to print run time information
+
+    std::string names_list; //!< file listing the sequence names
+};
+
+//! \brief holds command line parameters of locarna_consistency
+command_line_parameters clp;
+
+//! defines command line parameters
+option_def my_options[] = {
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","cmd_only"},
+
+    {"help",'h',&clp.opt_help,O_NO_ARG,0,O_NODEFAULT,"","Help"},
+    {"version",'V',&clp.opt_version,O_NO_ARG,0,O_NODEFAULT,"","Version info"},
+    {"verbose",'v',&clp.opt_verbose,O_NO_ARG,0,O_NODEFAULT,"","Verbose"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Match_probabilities"},
+
+    {"bm-probs",0,&clp.opt_bm_probs,O_ARG_STRING,&clp.bm_probs,O_NODEFAULT,"dir/file","Base match probabilities (directory or binary file)"},
+    {"am-probs",0,&clp.opt_am_probs,O_ARG_STRING,&clp.am_probs,O_NODEFAULT,"dir/file","Arc match probabilities (directory or binary file)"},
+    {"min-bm-prob",'b',0,O_ARG_DOUBLE,&clp.min_bm_prob,"0.0005","bmprob","Minimal transformed base match probability"},
+    {"min-am-prob",'a',0,O_ARG_DOUBLE,&clp.min_am_prob,"0.0005","amprob","Minimal transformed arc match probability"},
+    {"scale",0,&clp.opt_scale,O_NO_ARG,0,O_NODEFAULT,"","Scale transformed probabilities to the sum of the original ones"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"1","n","Number of threads (0 for number of processors)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
+
+    {"write-bm-probs",0,&clp.opt_write_bm_probs,O_ARG_STRING,&clp.write_bm_probs,O_NODEFAULT,"dir/file","Write transformed base match probabilities"},
+    {"write-am-probs",0,&clp.opt_write_am_probs,O_ARG_STRING,&clp.write_am_probs,O_NODEFAULT,"dir/file","Write transformed arc match probabilities"},
+    {"binary",0,&clp.opt_binary,O_NO_ARG,0,O_NODEFAULT,"","Write binary files instead of directories"},
+    {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files"},
+
+    {"",0,0,O_ARG_STRING,&clp.names_list,O_NODEFAULT,"names-list","File listing the sequence names (one per line)"},
+    {"",0,0,0,0,O_NODEFAULT,"",""}
+};
+
+
+// ------------------------------------------------------------
+
+/**
+ * @brief Read list of names
+ *
+ * @param filename name of list file
+ * @param[out] names names (empty lines and lines starting with '#' are skipped)
+ *
+ * @throw failure if file cannot be read
+ */
+void
+read_names_list(const std::string &filename, std::vector<std::string> &names) {
+    std::ifstream in(filename.c_str());
+    if (!in.good()) {
+	throw failure("Cannot read from "+filename+".");
+    }
+    std::string line;
+    while (std::getline(in,line)) {
+	std::istringstream ls(line);
+	std::string name;
+	if (ls >> name && name[0]!='#') {
+	    names.push_back(name);
+	}
+    }
+}
+
+
+// ------------------------------------------------------------
+// MAIN
+
+/**
+ * \brief Main method of executable locarna_consistency
+ *
+ * @param argc argument counter
+ * @param argv argument vector
+ *
+ * @return success
+ */
+int
+main(int argc, char **argv) {
+    stopwatch.start("total");
+
+    // ------------------------------------------------------------
+    // Process options
+
+    bool process_success=process_options(argc,argv,my_options);
+
+    if (clp.opt_help) {
+	std::cout << "locarna_consistency - consistency transformation of match probabilities."<<std::endl<<std::endl;
+
+	print_help(argv[0],my_options);
+
+	std::cout << "Report bugs to <will (at) informatik.uni-freiburg.de>."<<std::endl<<std::endl;
+	return 0;
+    }
+
+    if (clp.opt_version || clp.opt_verbose) {
+	std::cout << VERSION_STRING<<std::endl;
+	if (clp.opt_version) return 0; else std::cout <<std::endl;
+    }
+
+    if (!process_success) {
+	std::cerr << "ERROR --- "
+		  <<O_error_msg<<std::endl;
+	printf("USAGE: ");
+	print_usage(argv[0],my_options);
+	printf("\n");
+	return -1;
+    }
+
+    if (clp.opt_stopwatch) {
+	stopwatch.set_print_on_exit(true);
+    }
+
+    if (clp.opt_verbose) {
+	print_options(my_options);
+    }
+
+    if (clp.threads<0) {
+	std::cerr << "Number of threads must be greater equal 0."<<std::endl;
+	return -1;
+    }
+
+    try {
+	std::vector<std::string> names;
+	read_names_list(clp.names_list,names);
+
+	// base and arc match probabilities are transformed
+	// independently of each other
+	for (size_t k=0; k<2; ++k) {
+	    bool arc_matches = (k==1);
+	    bool opt_input = arc_matches ? clp.opt_am_probs : clp.opt_bm_probs;
+	    if (!opt_input) continue;
+
+	    const std::string &input = arc_matches ? clp.am_probs : clp.bm_probs;
+	    bool opt_output = arc_matches ? clp.opt_write_am_probs : clp.opt_write_bm_probs;
+	    const std::string &output = arc_matches ? clp.write_am_probs : clp.write_bm_probs;
+	    double min_prob = arc_matches ? clp.min_am_prob : clp.min_bm_prob;
+
+	    stopwatch.start(arc_matches?"read am":"read bm");
+	    MatchProbsSet probs(names,arc_matches);
+	    probs.read(input);
+	    stopwatch.stop(arc_matches?"read am":"read bm");
+
+	    stopwatch.start(arc_matches?"transform am":"transform bm");
+	    MatchProbsSet transformed(names,arc_matches);
+	    probs.consistency_transform(transformed,min_prob,clp.threads,clp.opt_scale);
+	    stopwatch.stop(arc_matches?"transform am":"transform bm");
+
+	    if (clp.opt_verbose) {
+		std::cout << "Transformed "<<(arc_matches?"arc":"base")<<" match probabilities: "
+			  << "sum "<<probs.sum_probs()<<" -> "<<transformed.sum_probs()<<std::endl;
+	    }
+
+	    if (opt_output) {
+		stopwatch.start(arc_matches?"write am":"write bm");
+		transformed.write(output,clp.opt_binary);
+		stopwatch.stop(arc_matches?"write am":"write bm");
+	    }
+	}
+    } catch (failure &f) {
+	std::cerr << "ERROR: " << f.what() << std::endl;
+	return -1;
+    }
+
+    stopwatch.stop("total");
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * \file locarna_guide_tree.cc
+ *
+ * \brief Defines main function of locarna_guide_tree
+ *
+ * Computes the guide tree of a progressive multiple alignment by
+ * UPGMA or neighbor joining from a matrix of pairwise similarity
+ * scores. Replaces the tree construction in Perl by mlocarna.
+ *
+ * Input is a square score matrix (whitespace separated rows) and a
+ * file that lists the names of the sequences (one per line, in the
+ * order of the matrix rows). The tree is written in Newick format to
+ * standard output; optionally, the merge schedule is written, which
+ * groups the merges into levels of independent subtrees.
+ *
+ * Copyright (C) Sebastian Will <will(@)informatik.uni-freiburg.de>
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "LocARNA/aux.hh"
+#include "LocARNA/global_stopwatch.hh"
+#include "LocARNA/matrix.hh"
+#include "LocARNA/guide_tree.hh"
+
+using namespace LocARNA;
+
+//! Version string (from configure.ac via autoconf system)
+const std::string
+VERSION_STRING = (std::string)PACKAGE_STRING;
+
+// ------------------------------------------------------------
+//
+// Options
+//
+#include "LocARNA/options.hh"
+
+//! \brief Structure for command line parameters of locarna_guide_tree
+//!
+//! Encapsulating all command line parameters in a common structure
+//! avoids name conflicts and makes downstream code more informative.
+//!
+struct command_line_parameters {
+    std::string tree_method; //!< guide tree method
+    int threads; //!< number of threads
+
+    bool opt_write_schedule; //!< whether to write the merge schedule
+    std::string write_schedule; //!< output of the merge schedule
+
+    bool opt_help; //!< whether to print help
+    bool opt_version; //!< whether to print version
+    bool opt_verbose; //!< whether to print verbose output
+    bool opt_stopwatch; //!< whether to print run time information
+
+    std::string score_matrix; //!< score matrix file
+    std::string names_list; //!< file listing the sequence names
+};
+
+//! \brief holds command line parameters of locarna_guide_tree
+command_line_parameters clp;
+
+//! defines command line parameters
+option_def my_options[] = {
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","cmd_only"},
+
+    {"help",'h',&clp.opt_help,O_NO_ARG,0,O_NODEFAULT,"","Help"},
+    {"version",'V',&clp.opt_version,O_NO_ARG,0,O_NODEFAULT,"","Version info"},
+    {"verbose",'v',&clp.opt_verbose,O_NO_ARG,0,O_NODEFAULT,"","Verbose"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Guide_tree"},
+
+    {"tree-method",0,0,O_ARG_STRING,&clp.tree_method,"upgma","method","Guide tree method (upgma or nj)"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"1","n","Number of threads (0 for number of processors)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
+
+    {"write-schedule",0,&clp.opt_write_schedule,O_ARG_STRING,&clp.write_schedule,O_NODEFAULT,"file","Write merge schedule (lines: level node left right)"},
+    {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files"},
+
+    {"",0,0,O_ARG_STRING,&clp.score_matrix,O_NODEFAULT,"score-matrix","File of pairwise similarity scores"},
+    {"",0,0,O_ARG_STRING,&clp.names_list,O_NODEFAULT,"names-list","File listing the sequence names (one per line)"},
+    {"",0,0,0,0,O_NODEFAULT,"",""}
+};
+
+
+// ------------------------------------------------------------
+
+/**
+ * @brief Read list of names
+ *
+ * @param filename name of list file
+ * @param[out] names names, one per line (empty lines are skipped)
+ *
+ * @throw failure if file cannot be read
+ */
+void
+read_names_list(const std::string &filename, std::vector<std::string> &names) {
+    std::ifstream in(filename.c_str());
+    if (!in.good()) {
+	throw failure("Cannot read from "+filename+".");
+    }
+    std::string line;
+    while (std::getline(in,line)) {
+	if (!line.empty()) {
+	    names.push_back(line);
+	}
+    }
+}
+
+/**
+ * @brief Read square matrix of doubles
+ *
+ * @param filename input file
+ * @param n number of rows and columns
+ * @param[out] m matrix
+ *
+ * @throw failure if file cannot be read or has too few entries
+ */
+void
+read_score_matrix(const std::string &filename, size_t n, Matrix<double> &m) {
+    std::ifstream in(filename.c_str());
+    if (!in.good()) {
+	throw failure("Cannot read from "+filename+".");
+    }
+    m.resize(n,n);
+    for (size_t i=0; i<n; ++i) {
+	for (size_t j=0; j<n; ++j) {
+	    if (!(in >> m(i,j))) {
+		throw failure("Score matrix "+filename+" is too small.");
+	    }
+	}
+    }
+}
+
+
+// ------------------------------------------------------------
+// MAIN
+
+/**
+ * \brief Main method of executable locarna_guide_tree
+ *
+ * @param argc argument counter
+ * @param argv argument vector
+ *
+ * @return success
+ */
+int
+main(int argc, char **argv) {
+    stopwatch.start("total");
+
+    // ------------------------------------------------------------
+    // Process options
+
+    bool process_success=process_options(argc,argv,my_options);
+
+    if (clp.opt_help) {
+	std::cout << "locarna_guide_tree - guide tree from pairwise similarity scores."<<std::endl<<std::endl;
+
+	print_help(argv[0],my_options);
+
+	std::cout << "Report bugs to <will (at) informatik.uni-freiburg.de>."<<std::endl<<std::endl;
+	return 0;
+    }
+
+    if (clp.opt_version) {
+	std::cout << VERSION_STRING<<std::endl;
+	return 0;
+    }
+
+    if (!process_success) {
+	std::cerr << "ERROR --- "
+		  <<O_error_msg<<std::endl;
+	printf("USAGE: ");
+	print_usage(argv[0],my_options);
+	printf("\n");
+	return -1;
+    }
+
+    if (clp.opt_stopwatch) {
+	stopwatch.set_print_on_exit(true);
+    }
+
+    // the tree is written to standard output, therefore verbose
+    // information goes to standard error
+    if (clp.opt_verbose) {
+	std::cerr << VERSION_STRING<<std::endl<<std::endl;
+    }
+
+    if (clp.threads<0) {
+	std::cerr << "Number of threads must be greater equal 0."<<std::endl;
+	return -1;
+    }
+
+    try {
+	GuideTree::method_t tree_method = GuideTree::method_from_string(clp.tree_method);
+
+	std::vector<std::string> names;
+	read_names_list(clp.names_list,names);
+	if (names.empty()) {
+	    throw failure("No names in "+clp.names_list+".");
+	}
+
+	Matrix<double> scores;
+	stopwatch.start("read");
+	read_score_matrix(clp.score_matrix,names.size(),scores);
+	stopwatch.stop("read");
+
+	if (clp.opt_verbose) {
+	    std::cerr << "Compute guide tree of "<<names.size()<<" sequences ("
+		      << clp.tree_method<<")."<<std::endl;
+	}
+
+	stopwatch.start("tree");
+	GuideTree tree(scores,tree_method,(size_t)clp.threads);
+	stopwatch.stop("tree");
+
+	tree.write_newick(std::cout,names);
+	std::cout << std::endl;
+
+	if (clp.opt_write_schedule) {
+	    std::ofstream out(clp.write_schedule.c_str());
+	    if (!out.good()) {
+		throw failure("Cannot write to "+clp.write_schedule+".");
+	    }
+	    std::vector<std::vector<size_t> > schedule = tree.merge_schedule();
+	    for (size_t level=0; level<schedule.size(); ++level) {
+		for (size_t k=0; k<schedule[level].size(); ++k) {
+		    size_t x = schedule[level][k];
+		    out << (level+1) << " " << x << " "
+			<< tree.left(x) << " " << tree.right(x) << std::endl;
+		}
+	    }
+	}
+    } catch (failure &f) {
+	std::cerr << "ERROR: " << f.what() << std::endl;
+	return -1;
+    }
+
+    stopwatch.stop("total");
+
+    return 0;
+}
@@ -24,6 +24,8 @@
 #include "LocARNA/sequence.hh"
 #include "LocARNA/basepairs.hh"
 #include "LocARNA/aligner_p.hh"
+#include "LocARNA/sparse_mea_aligner.hh"
+#include "LocARNA/alignment.hh"
 #include "LocARNA/rna_data.hh"
 #include "LocARNA/arc_matches.hh"
 #include "LocARNA/match_probs.hh"
@@ -35,6 +37,7 @@
 #include "LocARNA/ribosum85_60.icc"
 #include "LocARNA/pfold_params.hh"
 #include "LocARNA/global_stopwatch.hh"
+#include "LocARNA/arena.hh"
 
 using namespace std;
 
@@ -91,6 +94,9 @@ int output_width=70; //!< output_width=70
 bool opt_write_arcmatch_probs; //!< opt_write_arcmatch_probs
 bool opt_write_basematch_probs; //!< opt_write_basematch_probs
 
+bool opt_mea_alignment; //!< whether to compute the MEA alignment
+int mea_beta; //!< weight of arc match probabilities in MEA alignment (percent)
+
 bool opt_stopwatch; //!< whether to print verbose output
 
 // ------------------------------------------------------------
@@ -183,6 +189,9 @@ option_def my_options[] = {
     {"write-arcmatch-probs",0,&opt_write_arcmatch_probs,O_ARG_STRING,&arcmatch_probs_file,O_NODEFAULT,"file","Write arcmatch probabilities"},
     {"write-basematch-probs",0,&opt_write_basematch_probs,O_ARG_STRING,&basematch_probs_file,O_NODEFAULT,"file","Write basematch probabilities"},
     {"width",'w',0,O_ARG_INT,&output_width,"120","columns","Output width"},
+    {"mea-alignment",0,&opt_mea_alignment,O_NO_ARG,0,O_NODEFAULT,"","Compute maximum expected accuracy alignment from the match probabilities"},
+    {"mea-beta",0,0,O_ARG_INT,&mea_beta,"0","beta","Additional weight of arc match probabilities in MEA alignment in percent"},
+    {"clustal",0,&opt_clustal_out,O_ARG_STRING,&clustal_out,O_NODEFAULT,"file","Clustal output of MEA alignment"},
 
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Heuristics for speed accuracy trade off"},
 
@@ -268,6 +277,11 @@ main(int argc, char **argv) {
 	stopwatch.set_print_on_exit(true);
     }
 
+    if (opt_clustal_out && !opt_mea_alignment) {
+	std::cerr << "ERROR: Clustal output requires option mea-alignment."<<std::endl;
+	return -1;
+    }
+
     if (opt_verbose)
 	print_options(my_options);
 
@@ -478,7 +492,8 @@ main(int argc, char **argv) {
 	. min_am_prob(min_am_prob)
 	. min_bm_prob(min_bm_prob)
 	. stacking(false)
-	. constraints(seq_constraints);
+	. constraints(seq_constraints)
+	. arena(Arena::thread_arena());
     
     if (opt_verbose) {
 	std::cout << "Run inside algorithm."<<std::endl;
@@ -546,6 +561,46 @@ main(int argc, char **argv) {
 	}
     }
 
+    // ----------------------------------------
+    // optionally, compute the maximum expected accuracy alignment
+    //
+    // The MEA alignment is decoded directly from the sparse match
+    // probabilities. The probability of a match i~k is its base
+    // match probability plus the probabilities of the arc matches
+    // with ends i and k, unless the latter are already included.
+    //
+    if (opt_mea_alignment) {
+	if (opt_verbose) {
+	    std::cout << "Compute MEA alignment."<<std::endl;
+	}
+	
+	double am_weight = (basematch_probs_include_arcmatch ? 0.0 : 1.0) + mea_beta/100.0;
+	SparseMEAAligner mea(lenA,lenB,am_weight);
+	aligner.add_match_probabilities(mea);
+	double mea_score = mea.align();
+	
+	Alignment alignment(seqA,seqB,mea.alignment_edges());
+	
+	std::cout << "MEA score: "<<mea_score<<std::endl;
+	std::cout << std::endl;
+	MultipleAlignment ma(alignment);
+	ma.write(std::cout,output_width);
+	std::cout << std::endl;
+	
+	if (opt_clustal_out) {
+	    ofstream out(clustal_out.c_str());
+	    if (out.good()) {
+		out << "CLUSTAL W --- "<<PACKAGE_STRING
+		    << " --- MEA score: " << mea_score
+		    << std::endl << std::endl;
+		ma.write(out,output_width);
+	    } else {
+		cerr << "Cannot write to "<<clustal_out<<"! Exit."<<endl;
+		return -1;
+	    }
+	}
+    }
+
     // ----------------------------------------
     // optionally, compute probabilities that certain ranges are matched
     //
@@ -0,0 +1,510 @@
+/**
+ * \file locarna_progressive.cc
+ *
+ * \brief Defines main function of locarna_progressive
+ *
+ * Progressive multiple alignment of RNAs along a guide tree (UPGMA
+ * or neighbor joining) with in-memory profiles, parallel alignment
+ * of independent subtrees and optional iterative refinement.
+ *
+ * Input is a file that lists the input files (pp, clustal or fasta
+ * format; one file name per line). All computations take place in
+ * memory; in particular, intermediary profiles are never written to
+ * disk.
+ *
+ * Copyright (C) Sebastian Will <will(@)informatik.uni-freiburg.de>
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "LocARNA/sequence.hh"
+#include "LocARNA/rna_data.hh"
+#include "LocARNA/ribosum.hh"
+#include "LocARNA/ribofit.hh"
+#include "LocARNA/ribosum85_60.icc"
+#include "LocARNA/global_stopwatch.hh"
+#include "LocARNA/pfold_params.hh"
+#include "LocARNA/guide_tree.hh"
+#include "LocARNA/progressive_aligner.hh"
+
+using namespace LocARNA;
+
+//! Version string (from configure.ac via autoconf system)
+const std::string
+VERSION_STRING = (std::string)PACKAGE_STRING;
+
+// ------------------------------------------------------------
+//
+// Options
+//
+#include "LocARNA/options.hh"
+
+//! \brief Structure for command line parameters of locarna_progressive
+//!
+//! Encapsulating all command line parameters in a common structure
+//! avoids name conflicts and makes downstream code more informative.
+//!
+struct command_line_parameters {
+    double min_prob; //!< minimal base pair probability
+
+    //! maximal ratio of number of base pairs divided by sequence
+    //! length.
+    double max_bps_length_ratio;
+
+    int match_score; //!< match score
+    int mismatch_score; //!< mismatch score
+    int indel_score; //!< indel extension score
+    int indel_opening_score; //!< indel opening score
+    int struct_weight; //!< structure weight
+    int tau_factor; //!< contribution of sequence similarity in an arc match (in percent)
+    int exclusion_score; //!< score contribution per exclusion
+
+    double exp_prob; //!< expected probability of a base pair (null-model)
+    bool opt_exp_prob; //!< expected probability given?
+
+    bool no_lonely_pairs; //!< no lonely pairs option
+    bool struct_local; //!< structure local alignment
+    bool sequ_local; //!< sequence local alignment
+    std::string free_endgaps; //!< specification of free end gaps
+
+    int max_diff; //!< maximal difference for alignment traces
+    int max_diff_am; //!< maximal difference between two arc ends, -1 is off
+    int max_diff_at_am; //!< maximal difference for alignment traces at arc match positions
+    double min_am_prob; //!< minimal arc match probability
+    double min_bm_prob; //!< minimal base match probability
+    int arcmatch_score_memory; //!< memory budget for arc match score tables in MB
+
+    bool opt_stacking; //!< whether to use special stacking arcmatch score
+    bool opt_new_stacking; //!< whether to use new stacking contributions
+
+    std::string ribosum_file; //!< ribosum_file
+    bool use_ribosum; //!< use_ribosum
+    bool opt_ribofit; //!< use ribofit base and arc match scores
+
+    std::string tree_method; //!< guide tree method
+    int threads; //!< number of threads
+    int iterations; //!< maximal number of iterative refinement rounds
+    bool opt_extend_library; //!< whether to extend base pair probabilities by pairwise alignments
+    int prefilter_neighbors; //!< number of aligned nearest neighbors per RNA (0 for all pairs)
+    int prefilter_kmer; //!< k-mer length of the prefilter similarity
+    double prefilter_struct_weight; //!< weight of the structure similarity in the prefilter
+
+    bool opt_score_matrix; //!< whether to read score matrix
+    std::string score_matrix_file; //!< score matrix input file
+    bool opt_write_score_matrix; //!< whether to write score matrix
+    std::string write_score_matrix_file; //!< score matrix output file
+
+    int output_width; //!< width of alignment output
+    bool opt_clustal_out; //!< whether to write clustal output to file
+    std::string clustal_out; //!< name of clustal output file
+    bool opt_pp_out; //!< whether to write pp output to file
+    std::string pp_out; //!< name of pp output file
+
+    bool opt_help; //!< whether to print help
+    bool opt_version; //!< whether to print version
+    bool opt_verbose; //!< whether to print verbose output
+    bool opt_stopwatch; //!< whether to print run time information
+
+    std::string input_list; //!< file listing the input files
+};
+
+//! \brief holds command line parameters of locarna_progressive
+command_line_parameters clp;
+
+//! defines command line parameters
+option_def my_options[] = {
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","cmd_only"},
+
+    {"help",'h',&clp.opt_help,O_NO_ARG,0,O_NODEFAULT,"","Help"},
+    {"version",'V',&clp.opt_version,O_NO_ARG,0,O_NODEFAULT,"","Version info"},
+    {"verbose",'v',&clp.opt_verbose,O_NO_ARG,0,O_NODEFAULT,"","Verbose"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Scoring_parameters"},
+
+    {"match",'m',0,O_ARG_INT,&clp.match_score,"50","score","Match score"},
+    {"mismatch",'M',0,O_ARG_INT,&clp.mismatch_score,"0","score","Mismatch score"},
+    {"ribosum-file",0,0,O_ARG_STRING,&clp.ribosum_file,"RIBOSUM85_60","f","Ribosum file"},
+    {"use-ribosum",0,0,O_ARG_BOOL,&clp.use_ribosum,"true","bool","Use ribosum scores"},
+    {"indel",'i',0,O_ARG_INT,&clp.indel_score,"-350","score","Indel score"},
+    {"indel-opening",0,0,O_ARG_INT,&clp.indel_opening_score,"-500","score","Indel opening score"},
+    {"struct-weight",'s',0,O_ARG_INT,&clp.struct_weight,"200","score","Maximal weight of 1/2 arc match"},
+    {"exp-prob",'e',&clp.opt_exp_prob,O_ARG_DOUBLE,&clp.exp_prob,O_NODEFAULT,"prob","Expected probability"},
+    {"tau",'t',0,O_ARG_INT,&clp.tau_factor,"0","factor","Tau factor in percent"},
+    {"exclusion",'E',0,O_ARG_INT,&clp.exclusion_score,"0","score","Exclusion weight"},
+    {"stacking",0,&clp.opt_stacking,O_NO_ARG,0,O_NODEFAULT,"","Use stacking terms (needs stack-probs by RNAfold -p2)"},
+    {"new-stacking",0,&clp.opt_new_stacking,O_NO_ARG,0,O_NODEFAULT,"","Use new stacking terms (needs stack-probs by RNAfold -p2)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Locality_type"},
+
+    {"struct-local",0,0,O_ARG_BOOL,&clp.struct_local,"false","bool","Structure local"},
+    {"sequ-local",0,0,O_ARG_BOOL,&clp.sequ_local,"false","bool","Sequence local"},
+    {"free-endgaps",0,0,O_ARG_STRING,&clp.free_endgaps,"----","spec","Whether and which end gaps are free. order: L1,R1,L2,R2"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Progressive_alignment"},
+
+    {"tree-method",0,0,O_ARG_STRING,&clp.tree_method,"upgma","method","Guide tree method (upgma or nj)"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"1","n","Number of threads (0 for number of processors)"},
+    {"iterations",0,0,O_ARG_INT,&clp.iterations,"0","n","Maximal number of iterative refinement rounds"},
+    {"extend-library",0,&clp.opt_extend_library,O_NO_ARG,0,O_NODEFAULT,"","Extend the base pair probabilities by the pairwise alignments (T-Coffee-style library extension)"},
+    {"prefilter-neighbors",0,0,O_ARG_INT,&clp.prefilter_neighbors,"0","k","Align only each RNA and its k nearest neighbors by alignment-free similarity for the guide tree; estimate the other scores (0=align all pairs)"},
+    {"prefilter-kmer",0,0,O_ARG_INT,&clp.prefilter_kmer,"3","k","K-mer length of the prefilter similarity"},
+    {"prefilter-struct-weight",0,0,O_ARG_DOUBLE,&clp.prefilter_struct_weight,"0.5","weight","Weight of the structure similarity in the prefilter (between 0 and 1)"},
+    {"score-matrix",0,&clp.opt_score_matrix,O_ARG_STRING,&clp.score_matrix_file,O_NODEFAULT,"file","Read pairwise similarity scores (skip pairwise alignments)"},
+    {"write-score-matrix",0,&clp.opt_write_score_matrix,O_ARG_STRING,&clp.write_score_matrix_file,O_NODEFAULT,"file","Write pairwise similarity scores"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
+
+    {"width",'w',0,O_ARG_INT,&clp.output_width,"120","columns","Output width"},
+    {"clustal",0,&clp.opt_clustal_out,O_ARG_STRING,&clp.clustal_out,O_NODEFAULT,"file","Clustal output"},
+    {"pp",0,&clp.opt_pp_out,O_ARG_STRING,&clp.pp_out,O_NODEFAULT,"file","PP output"},
+    {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Heuristics for speed accuracy trade off"},
+
+    {"min-prob",'p',0,O_ARG_DOUBLE,&clp.min_prob,"0.0005","prob","Minimal probability"},
+    {"max-bps-length-ratio",0,0,O_ARG_DOUBLE,&clp.max_bps_length_ratio,"0.0","factor","Maximal ratio of #base pairs divided by sequence length (default: no effect)"},
+    {"max-diff-am",'D',0,O_ARG_INT,&clp.max_diff_am,"-1","diff","Maximal difference for sizes of matched arcs"},
+    {"max-diff",'d',0,O_ARG_INT,&clp.max_diff,"-1","diff","Maximal difference for alignment traces"},
+    {"max-diff-at-am",0,0,O_ARG_INT,&clp.max_diff_at_am,"-1","diff","Maximal difference for alignment traces, only at arc match positions"},
+    {"min-am-prob",'a',0,O_ARG_DOUBLE,&clp.min_am_prob,"0.0005","amprob","Minimal Arc-match probability"},
+    {"min-bm-prob",'b',0,O_ARG_DOUBLE,&clp.min_bm_prob,"0.0005","bmprob","Minimal Base-match probability"},
+    {"arcmatch-score-memory",0,0,O_ARG_INT,&clp.arcmatch_score_memory,"0","MB","Memory budget for the table of precomputed arc match scores per alignment (0=off)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
+
+    {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
+
+    {"",0,0,O_SECTION_HIDE,0,O_NODEFAULT,"","Hidden Options"},
+    {"ribofit",0,0,O_ARG_BOOL,&clp.opt_ribofit,"false","bool","Use Ribofit base and arc match scores (overrides ribosum)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files"},
+
+    {"",0,0,O_ARG_STRING,&clp.input_list,O_NODEFAULT,"input-list","File listing the input files (one per line)"},
+    {"",0,0,0,0,O_NODEFAULT,"",""}
+};
+
+
+// ------------------------------------------------------------
+
+/**
+ * @brief Read list of file names
+ *
+ * @param filename name of list file
+ * @param[out] files file names (empty lines and lines starting with '#' are skipped)
+ *
+ * @throw failure if file cannot be read
+ */
+void
+read_file_list(const std::string &filename, std::vector<std::string> &files) {
+    std::ifstream in(filename.c_str());
+    if (!in.good()) {
+	throw failure("Cannot read from "+filename+".");
+    }
+    std::string line;
+    while (std::getline(in,line)) {
+	std::istringstream ls(line);
+	std::string name;
+	if (ls >> name && name[0]!='#') {
+	    files.push_back(name);
+	}
+    }
+}
+
+/**
+ * @brief Read square matrix of doubles
+ *
+ * @param filename input file
+ * @param n number of rows and columns
+ * @param[out] m matrix
+ *
+ * @throw failure if file cannot be read or has too few entries
+ */
+void
+read_score_matrix(const std::string &filename, size_t n, Matrix<double> &m) {
+    std::ifstream in(filename.c_str());
+    if (!in.good()) {
+	throw failure("Cannot read from "+filename+".");
+    }
+    m.resize(n,n);
+    for (size_t i=0; i<n; ++i) {
+	for (size_t j=0; j<n; ++j) {
+	    if (!(in >> m(i,j))) {
+		throw failure("Score matrix "+filename+" is too small.");
+	    }
+	}
+    }
+}
+
+/**
+ * @brief Write square matrix of doubles
+ *
+ * @param out output stream
+ * @param m matrix
+ */
+void
+write_score_matrix(std::ostream &out, const Matrix<double> &m) {
+    for (size_t i=0; i<m.sizes().first; ++i) {
+	for (size_t j=0; j<m.sizes().second; ++j) {
+	    if (j>0) out << " ";
+	    out << m(i,j);
+	}
+	out << std::endl;
+    }
+}
+
+
+// ------------------------------------------------------------
+// MAIN
+
+/**
+ * \brief Main method of executable locarna_progressive
+ *
+ * @param argc argument counter
+ * @param argv argument vector
+ *
+ * @return success
+ */
+int
+main(int argc, char **argv) {
+    stopwatch.start("total");
+
+    // ------------------------------------------------------------
+    // Process options
+
+    bool process_success=process_options(argc,argv,my_options);
+
+    if (clp.opt_help) {
+	std::cout << "locarna_progressive - progressive multiple alignment of RNAs."<<std::endl<<std::endl;
+
+	print_help(argv[0],my_options);
+
+	std::cout << "Report bugs to <will (at) informatik.uni-freiburg.de>."<<std::endl<<std::endl;
+	return 0;
+    }
+
+    if (clp.opt_version || clp.opt_verbose) {
+	std::cout << VERSION_STRING<<std::endl;
+	if (clp.opt_version) return 0; else std::cout <<std::endl;
+    }
+
+    if (!process_success) {
+	std::cerr << "ERROR --- "
+		  <<O_error_msg<<std::endl;
+	printf("USAGE: ");
+	print_usage(argv[0],my_options);
+	printf("\n");
+	return -1;
+    }
+
+    if (clp.opt_stopwatch) {
+	stopwatch.set_print_on_exit(true);
+    }
+
+    if (clp.opt_verbose) {
+	print_options(my_options);
+    }
+
+    if (clp.threads<0 || clp.iterations<0) {
+	std::cerr << "Number of threads and iterations must be greater equal 0."<<std::endl;
+	return -1;
+    }
+
+    if (clp.opt_stacking && !clp.opt_exp_prob) {
+	std::cerr << "WARNING: stacking turned off. "
+		  << "Stacking requires setting a background probability "
+		  << "explicitely (option --exp-prob)." << std::endl;
+	clp.opt_stacking=false;
+    }
+
+    // ----------------------------------------
+    // Ribosum matrix
+    //
+    RibosumFreq *ribosum=NULL;
+    Ribofit *ribofit=NULL;
+
+    if (clp.opt_ribofit) {
+	ribofit = new Ribofit_will2014;
+    }
+
+    if (clp.use_ribosum) {
+	if (clp.ribosum_file == "RIBOSUM85_60") {
+	    ribosum = new Ribosum85_60;
+	} else {
+	    ribosum = new RibosumFreq(clp.ribosum_file);
+	}
+    }
+
+    int return_code=0;
+
+    PFoldParams pfparams(clp.no_lonely_pairs, clp.opt_stacking || clp.opt_new_stacking);
+
+    std::vector<const RnaData *> rna_data;
+
+    try {
+	GuideTree::method_t tree_method = GuideTree::method_from_string(clp.tree_method);
+
+	// ------------------------------------------------------------
+	// Get input data
+	//
+	std::vector<std::string> files;
+	read_file_list(clp.input_list,files);
+
+	stopwatch.start("input");
+	for (size_t i=0; i<files.size(); ++i) {
+	    try {
+		rna_data.push_back(new RnaData(files[i],
+					       clp.min_prob,
+					       clp.max_bps_length_ratio,
+					       pfparams));
+	    } catch (failure &f) {
+		throw failure("failed to read from file "+files[i]+"\n\t"+f.what());
+	    }
+	}
+	stopwatch.stop("input");
+
+	// ------------------------------------------------------------
+	// Parameters of the profile alignments
+	//
+	ProfileAlignmentParams params;
+	params.match = clp.match_score;
+	params.mismatch = clp.mismatch_score;
+	params.indel = clp.indel_score;
+	params.indel_opening = clp.indel_opening_score;
+	params.struct_weight = clp.struct_weight;
+	params.tau_factor = clp.tau_factor;
+	params.exclusion = clp.exclusion_score;
+	params.exp_prob = clp.opt_exp_prob ? clp.exp_prob : -1;
+	params.ribosum = ribosum;
+	params.ribofit = ribofit;
+	params.stacking = clp.opt_stacking;
+	params.new_stacking = clp.opt_new_stacking;
+	params.no_lonely_pairs = clp.no_lonely_pairs;
+	params.struct_local = clp.struct_local;
+	params.sequ_local = clp.sequ_local;
+	params.free_endgaps = clp.free_endgaps;
+	params.max_diff = clp.max_diff;
+	params.max_diff_am = clp.max_diff_am;
+	params.max_diff_at_am = clp.max_diff_at_am;
+	params.min_prob = clp.min_prob;
+	params.min_am_prob = clp.min_am_prob;
+	params.min_bm_prob = clp.min_bm_prob;
+	params.arcmatch_score_memory = (size_t)std::max(clp.arcmatch_score_memory,0)<<20;
+
+	ProgressiveAligner aligner(rna_data,params,clp.threads);
+
+	// ------------------------------------------------------------
+	// Pairwise scores and guide tree
+	//
+	if (clp.opt_extend_library) {
+	    if (clp.opt_score_matrix) {
+		throw failure("Library extension requires the pairwise alignments; it cannot be combined with --score-matrix.");
+	    }
+	    aligner.set_library_extension(clp.min_prob);
+	}
+
+	if (clp.prefilter_neighbors>0) {
+	    if (clp.opt_score_matrix) {
+		throw failure("Prefiltering selects the pairwise alignments; it cannot be combined with --score-matrix.");
+	    }
+	    if (clp.prefilter_kmer<1) {
+		throw failure("K-mer length of the prefilter must be positive.");
+	    }
+	    aligner.set_prefilter((size_t)clp.prefilter_neighbors,
+				  (size_t)clp.prefilter_kmer,
+				  clp.prefilter_struct_weight);
+	}
+
+	if (clp.opt_score_matrix) {
+	    Matrix<double> scores;
+	    read_score_matrix(clp.score_matrix_file,rna_data.size(),scores);
+	    aligner.set_pairwise_scores(scores);
+	} else {
+	    if (clp.opt_verbose) {
+		std::cout << "Compute pairwise alignment scores."<<std::endl;
+	    }
+	    stopwatch.start("pairwise");
+	    aligner.compute_pairwise_scores();
+	    stopwatch.stop("pairwise");
+	}
+
+	if (clp.opt_write_score_matrix) {
+	    std::ofstream out(clp.write_score_matrix_file.c_str());
+	    if (!out.good()) {
+		throw failure("Cannot write to "+clp.write_score_matrix_file+".");
+	    }
+	    write_score_matrix(out,aligner.pairwise_scores());
+	}
+
+	aligner.build_tree(tree_method);
+
+	// ------------------------------------------------------------
+	// Progressive alignment and refinement
+	//
+	stopwatch.start("progressive");
+	infty_score_t score = aligner.align();
+	stopwatch.stop("progressive");
+
+	if (clp.iterations>0) {
+	    stopwatch.start("refinement");
+	    size_t accepted = aligner.refine(clp.iterations);
+	    stopwatch.stop("refinement");
+	    if (clp.opt_verbose) {
+		std::cout << "Iterative refinement accepted "
+			  << accepted << " realignments."<<std::endl;
+	    }
+	    score = aligner.score();
+	}
+
+	// ------------------------------------------------------------
+	// Output
+	//
+	const MultipleAlignment &ma = aligner.result().multiple_alignment();
+
+	std::cout << "Score: "<<score<<std::endl<<std::endl;
+	ma.write(std::cout,clp.output_width);
+	std::cout<<std::endl;
+
+	if (clp.opt_clustal_out) {
+	    std::ofstream out(clp.clustal_out.c_str());
+	    if (out.good()) {
+		out << "CLUSTAL W --- "<<PACKAGE_STRING <<std::endl<<std::endl;
+		ma.write(out,clp.output_width);
+	    } else {
+		std::cerr << "Cannot write to "<<clp.clustal_out<<"! Exit."<<std::endl;
+		return_code=-1;
+	    }
+	}
+
+	if (clp.opt_pp_out) {
+	    std::ofstream out(clp.pp_out.c_str());
+	    if (out.good()) {
+		aligner.result().write_pp(out);
+	    } else {
+		std::cerr << "Cannot write to "<<clp.pp_out<<"! Exit."<<std::endl;
+		return_code=-1;
+	    }
+	}
+    } catch (failure &f) {
+	std::cerr << "ERROR: "<< f.what() <<std::endl;
+	return_code=-1;
+    }
+
+    // ----------------------------------------
+    //  clean up
+    //
+    for (size_t i=0; i<rna_data.size(); ++i) {
+	delete rna_data[i];
+    }
+    if (ribofit) delete ribofit;
+    if (ribosum) delete ribosum;
+
+    stopwatch.stop("total");
+
+    return return_code;
+}
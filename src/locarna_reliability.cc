@@ -0,0 +1,281 @@
+/**
+ * \file locarna_reliability.cc
+ *
+ * \brief Defines main function of locarna_reliability
+ *
+ * Computes the reliability profile of a multiple alignment from the
+ * base and arc match probabilities of all pairs of its sequences (as
+ * computed by locarna_p). Replaces the computation in Perl by
+ * mlocarna; the written files are read by reliability-profile.pl.
+ *
+ * Input is an alignment in clustal format. Match probabilities are
+ * read from directories with one file nameA-nameB per pair (as
+ * written by mlocarna) or from a binary file (as written by
+ * locarna_consistency).
+ *
+ * Copyright (C) Sebastian Will <will(@)informatik.uni-freiburg.de>
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "LocARNA/aux.hh"
+#include "LocARNA/global_stopwatch.hh"
+#include "LocARNA/multiple_alignment.hh"
+#include "LocARNA/rna_data.hh"
+#include "LocARNA/pfold_params.hh"
+#include "LocARNA/consistency.hh"
+#include "LocARNA/reliability.hh"
+
+using namespace LocARNA;
+
+//! Version string (from configure.ac via autoconf system)
+const std::string
+VERSION_STRING = (std::string)PACKAGE_STRING;
+
+// ------------------------------------------------------------
+//
+// Options
+//
+#include "LocARNA/options.hh"
+
+//! \brief Structure for command line parameters of locarna_reliability
+//!
+//! Encapsulating all command line parameters in a common structure
+//! avoids name conflicts and makes downstream code more informative.
+//!
+struct command_line_parameters {
+    std::string bm_probs; //!< input of base match probabilities
+    bool opt_am_probs; //!< whether to read arc match probabilities
+    std::string am_probs; //!< input of arc match probabilities
+    bool opt_names; //!< whether names of the probabilities are given
+    std::string names; //!< file listing the names of the probabilities
+    bool opt_pp_dir; //!< whether pp files of the sequences are given
+    std::string pp_dir; //!< directory of the pp files
+
+    bool opt_write_bm_reliability; //!< whether to write column reliabilities to file
+    std::string write_bm_reliability; //!< output of column reliabilities
+    bool opt_write_am_reliability; //!< whether to write arc reliabilities
+    std::string write_am_reliability; //!< output of arc reliabilities
+    bool opt_single_dir; //!< whether to write reliabilities of single sequences
+    std::string single_dir; //!< directory for reliabilities of single sequences
+
+    int threads; //!< number of threads
+
+    bool opt_help; //!< whether to print help
+    bool opt_version; //!< whether to print version
+    bool opt_verbose; //!< whether to print verbose output
+    bool opt_stopwatch; //!< whether to print run time information
+
+    std::string alignment; //!< alignment file
+};
+
+//! \brief holds command line parameters of locarna_reliability
+command_line_parameters clp;
+
+//! defines command line parameters
+option_def my_options[] = {
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","cmd_only"},
+
+    {"help",'h',&clp.opt_help,O_NO_ARG,0,O_NODEFAULT,"","Help"},
+    {"version",'V',&clp.opt_version,O_NO_ARG,0,O_NODEFAULT,"","Version info"},
+    {"verbose",'v',&clp.opt_verbose,O_NO_ARG,0,O_NODEFAULT,"","Verbose"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Match_probabilities"},
+
+    {"bm-probs",0,0,O_ARG_STRING,&clp.bm_probs,O_NODEFAULT,"dir/file","Base match probabilities (directory or binary file)"},
+    {"am-probs",0,&clp.opt_am_probs,O_ARG_STRING,&clp.am_probs,O_NODEFAULT,"dir/file","Arc match probabilities (directory or binary file)"},
+    {"names",0,&clp.opt_names,O_ARG_STRING,&clp.names,O_NODEFAULT,"file","Names of the sequences in the probabilities, one per alignment row (default: alignment names)"},
+    {"pp-dir",0,&clp.opt_pp_dir,O_ARG_STRING,&clp.pp_dir,O_NODEFAULT,"dir","Directory of pp files of the sequences (adds base pair probabilities to the arc reliabilities of single sequences)"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"1","n","Number of threads (0 for number of processors)"},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Controlling_output"},
+
+    {"write-bm-reliability",0,&clp.opt_write_bm_reliability,O_ARG_STRING,&clp.write_bm_reliability,O_NODEFAULT,"file","Write column reliabilities (default: to stdout)"},
+    {"write-am-reliability",0,&clp.opt_write_am_reliability,O_ARG_STRING,&clp.write_am_reliability,O_NODEFAULT,"file","Write arc reliabilities"},
+    {"single-dir",0,&clp.opt_single_dir,O_ARG_STRING,&clp.single_dir,O_NODEFAULT,"dir","Write reliabilities of the single sequences to files name.bmreliability and name.amreliability"},
+    {"stopwatch",0,&clp.opt_stopwatch,O_NO_ARG,0,O_NODEFAULT,"","Print run time information."},
+
+    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Input_files"},
+
+    {"",0,0,O_ARG_STRING,&clp.alignment,O_NODEFAULT,"alignment","Multiple alignment (clustal format)"},
+    {"",0,0,0,0,O_NODEFAULT,"",""}
+};
+
+
+// ------------------------------------------------------------
+
+/**
+ * @brief Read list of names
+ *
+ * @param filename name of list file
+ * @param[out] names names (empty lines and lines starting with '#' are skipped)
+ *
+ * @throw failure if file cannot be read
+ */
+void
+read_names_list(const std::string &filename, std::vector<std::string> &names) {
+    std::ifstream in(filename.c_str());
+    if (!in.good()) {
+	throw failure("Cannot read from "+filename+".");
+    }
+    std::string line;
+    while (std::getline(in,line)) {
+	std::istringstream ls(line);
+	std::string name;
+	if (ls >> name && name[0]!='#') {
+	    names.push_back(name);
+	}
+    }
+}
+
+/**
+ * @brief Open file for writing
+ *
+ * @param filename file name
+ * @param[out] out output stream
+ *
+ * @throw failure if file cannot be written
+ */
+void
+open_output(const std::string &filename, std::ofstream &out) {
+    out.open(filename.c_str());
+    if (!out.is_open()) {
+	throw failure("Cannot write to "+filename+".");
+    }
+}
+
+
+// ------------------------------------------------------------
+// MAIN
+
+/**
+ * \brief Main method of executable locarna_reliability
+ *
+ * @param argc argument counter
+ * @param argv argument vector
+ *
+ * @return success
+ */
+int
+main(int argc, char **argv) {
+    stopwatch.start("total");
+
+    // ------------------------------------------------------------
+    // Process options
+
+    bool process_success=process_options(argc,argv,my_options);
+
+    if (clp.opt_help) {
+	std::cout << "locarna_reliability - reliability profile of a multiple alignment."<<std::endl<<std::endl;
+
+	print_help(argv[0],my_options);
+
+	std::cout << "Report bugs to <will (at) informatik.uni-freiburg.de>."<<std::endl<<std::endl;
+	return 0;
+    }
+
+    if (clp.opt_version || clp.opt_verbose) {
+	std::cout << VERSION_STRING<<std::endl;
+	if (clp.opt_version) return 0; else std::cout <<std::endl;
+    }
+
+    if (!process_success) {
+	std::cerr << "ERROR --- "
+		  <<O_error_msg<<std::endl;
+	printf("USAGE: ");
+	print_usage(argv[0],my_options);
+	printf("\n");
+	return -1;
+    }
+
+    if (clp.opt_stopwatch) {
+	stopwatch.set_print_on_exit(true);
+    }
+
+    if (clp.opt_verbose) {
+	print_options(my_options);
+    }
+
+    if (clp.threads<0) {
+	std::cerr << "Number of threads must be greater equal 0."<<std::endl;
+	return -1;
+    }
+
+    try {
+	MultipleAlignment ma(clp.alignment);
+
+	// the sequences of the probabilities are the alignment rows
+	std::vector<std::string> names;
+	if (clp.opt_names) {
+	    read_names_list(clp.names,names);
+	    if (names.size()!=ma.num_of_rows()) {
+		throw failure("Number of names does not fit the alignment.");
+	    }
+	} else {
+	    for (size_t row=0; row<ma.num_of_rows(); ++row) {
+		names.push_back(ma.seqentry(row).name());
+	    }
+	}
+
+	stopwatch.start("read");
+	MatchProbsSet bm_probs(names,false);
+	bm_probs.read(clp.bm_probs);
+	MatchProbsSet am_probs(names,true);
+	if (clp.opt_am_probs) {
+	    am_probs.read(clp.am_probs);
+	}
+	stopwatch.stop("read");
+
+	stopwatch.start("reliability");
+	ReliabilityProfile profile(ma,bm_probs,clp.opt_am_probs?&am_probs:NULL,clp.threads);
+	stopwatch.stop("reliability");
+
+	if (clp.opt_write_bm_reliability) {
+	    std::ofstream out;
+	    open_output(clp.write_bm_reliability,out);
+	    ReliabilityProfile::write_column_rel(out,profile.seq_rel(),profile.str_rel());
+	} else {
+	    ReliabilityProfile::write_column_rel(std::cout,profile.seq_rel(),profile.str_rel());
+	}
+
+	if (clp.opt_write_am_reliability) {
+	    std::ofstream out;
+	    open_output(clp.write_am_reliability,out);
+	    ReliabilityProfile::write_arc_rel(out,profile.arc_rel());
+	}
+
+	if (clp.opt_single_dir) {
+	    PFoldParams pfparams(false,false);
+
+	    for (size_t row=0; row<ma.num_of_rows(); ++row) {
+		if (clp.opt_pp_dir) {
+		    RnaData rna_data(clp.pp_dir+"/"+names[row],0.0,0.0,pfparams);
+		    profile.add_pair_probs(row,rna_data,0.0);
+		}
+
+		std::string prefix = clp.single_dir+"/"+names[row];
+
+		std::ofstream bm_out;
+		open_output(prefix+".bmreliability",bm_out);
+		ReliabilityProfile::write_column_rel(bm_out,
+						     profile.single_seq_rel(row),
+						     profile.single_str_rel(row));
+
+		std::ofstream am_out;
+		open_output(prefix+".amreliability",am_out);
+		ReliabilityProfile::write_arc_rel(am_out,profile.single_arc_rel(row));
+	    }
+	}
+    } catch (failure &f) {
+	std::cerr << "ERROR: " << f.what() << std::endl;
+	return -1;
+    }
+
+    stopwatch.stop("total");
+
+    return 0;
+}
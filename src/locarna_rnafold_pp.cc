@@ -12,6 +12,11 @@
  *
  * Reads sequence in fasta from cin and writes pp-files to cout
  *
+ * In batch mode (option --batch), each sequence of a multi-fasta file
+ * or stream is folded separately; the sequences are folded in
+ * parallel and the results are written either as one pp-file per
+ * sequence or into a single indexed archive (see PPArchiveWriter).
+ *
  * command line argument --TEST provides a way to test for linking to
  * the ViennaLib. (This should be eventually replaced by a less
  * idiosyncratic mechanism.)
@@ -30,8 +35,14 @@
 #include <math.h>
 
 #include <string.h>
+#include <ctype.h>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <set>
+
+#include <sys/stat.h>
+#include <errno.h>
 
 #include <LocARNA/options.hh>
 #include <LocARNA/multiple_alignment.hh>
@@ -39,6 +50,8 @@
 #include <LocARNA/rna_ensemble.hh>
 #include <LocARNA/rna_data.hh>
 #include <LocARNA/ext_rna_data.hh>
+#include <LocARNA/thread_pool.hh>
+#include <LocARNA/pp_archive.hh>
 
 
 
@@ -107,6 +120,8 @@ struct command_line_parameters {
     std::string input_file; 		//!< input_file
     bool use_struct_constraints; 	//!< -C use structural constraints
     bool no_lonely_pairs; 		//!< no lonely pairs option
+    int max_bp_span; //!< maximal base pair span in folding (0 for no limit)
+    int plfold_window; //!< window size for local folding (0 for global folding)
     bool opt_stacking; 		//!< whether to stacking
     int opt_dangling; 		//!< dangling option value
     bool opt_in_loop; 		//!< whether to compute in-loop probabilities
@@ -115,6 +130,12 @@ struct command_line_parameters {
     double prob_basepair_in_loop_threshold; //!< threshold for prob_basepait_in_loop
     std::string output_file; 	//!< output file name
     bool force_alifold; 	//!< use alifold even for single sequences.
+    bool opt_batch; 	//!< whether to fold each sequence separately
+    int threads; 	//!< number of threads in batch mode
+    bool opt_batch_dir; 	//!< whether to write one pp file per sequence
+    std::string batch_dir; 	//!< directory of the pp files in batch mode
+    bool opt_archive; 	//!< whether to write a pp archive
+    std::string archive; 	//!< pp archive file in batch mode
 };
 //! \brief holds command line parameters of locarna
 command_line_parameters clp;
@@ -126,6 +147,8 @@ option_def my_options[] = {
     {"verbose",'v',&clp.opt_verbose,O_NO_ARG,0,O_NODEFAULT,"","Verbose"},
     {"use-struct-constraints",'C',&clp.use_struct_constraints, O_NO_ARG, 0, O_NODEFAULT, "","Use structural constraints"},
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
+    {"max-bp-span",0,0,O_ARG_INT,&clp.max_bp_span,"0","span","Maximal span of base pairs in folding (default: no limit)"},
+    {"plfold-window",0,0,O_ARG_INT,&clp.plfold_window,"0","size","Fold locally in windows of this size (RNAplfold-style; default: global folding)"},
     {"stacking",0,&clp.opt_stacking,O_NO_ARG,0,O_NODEFAULT,"","Compute stacking terms"},
     {"dangling",0,0,O_ARG_INT,&clp.opt_dangling,"2","","Dangling option value"},
     {"in-loop",0,&clp.opt_in_loop,O_NO_ARG,0,O_NODEFAULT,"","Compute in-loop probabilities"},
@@ -134,11 +157,282 @@ option_def my_options[] = {
     {"p_basepair_in_loop",0,0,O_ARG_DOUBLE,&clp.prob_basepair_in_loop_threshold,"0.0005","threshold","Threshold for prob_basepair_in_loop"}, //todo: is the default threshold value reasonable?
     {"output",'o',0,O_ARG_STRING,&clp.output_file,"","filename","Output file"},
     {"force-alifold",0,&clp.force_alifold,O_NO_ARG,0,O_NODEFAULT,"","Force alifold for single sequnces"},
+    {"batch",0,&clp.opt_batch,O_NO_ARG,0,O_NODEFAULT,"","Fold each sequence of the multi-fasta input separately"},
+    {"threads",0,0,O_ARG_INT,&clp.threads,"1","n","Number of threads in batch mode (0 for number of processors)"},
+    {"batch-dir",0,&clp.opt_batch_dir,O_ARG_STRING,&clp.batch_dir,O_NODEFAULT,"dir","Write pp files dir/name.pp in batch mode"},
+    {"archive",0,&clp.opt_archive,O_ARG_STRING,&clp.archive,O_NODEFAULT,"file","Write indexed pp archive in batch mode"},
     {"",0,0,O_ARG_STRING,&clp.input_file,"-","filename","Input file"},
     {"",0,0,0,0,O_NODEFAULT,"",""}
 };
 
 
+/**
+ * @brief Fold RNA and write its pair probabilities in pp-format
+ *
+ * @param out output stream
+ * @param mseq sequence or alignment
+ * @param pfoldparams folding parameters
+ * @param use_alifold whether to use alifold
+ *
+ * The in loop probabilities are computed and written if requested
+ * by the command line parameters.
+ */
+void
+fold_and_write_pp(std::ostream &out,
+		  const MultipleAlignment &mseq,
+		  const PFoldParams &pfoldparams,
+		  bool use_alifold) {
+
+    RnaEnsemble rna_ensemble(mseq, pfoldparams, clp.opt_in_loop, use_alifold);
+
+    if (clp.opt_in_loop)
+    {
+	ExtRnaData ext_rna_data(rna_ensemble, 
+				clp.min_prob, 
+				clp.prob_basepair_in_loop_threshold,
+				clp.prob_unpaired_in_loop_threshold,
+				0, // don't filter output by max_bps_length_ratio
+				0, // don't filter output by max_uil_length_ratio
+				0, // don't filter output by max_bpil_length_ratio
+				pfoldparams);
+
+	ext_rna_data.write_pp(out); // (no need to filter again => don't specify output cutoff)
+    }
+    else
+    {
+	RnaData rna_data(rna_ensemble,
+			 clp.min_prob,
+			 0, // don't filter output by max_bps_length_ratio
+			 pfoldparams);
+
+	rna_data.write_pp(out); // (no need to filter again => don't specify output cutoff)
+    }
+}
+
+// ------------------------------------------------------------
+// batch mode
+
+//! @brief sequence of the batch input
+struct batch_record_t {
+    std::string name; //!< sequence name
+    std::string seq; //!< sequence string
+};
+
+/**
+ * @brief Read sequences one by one from a multi-fasta stream
+ *
+ * The name of a sequence is the first word of its header line;
+ * annotation lines (starting with #) are skipped.
+ */
+class FastaRecordReader {
+    std::istream &in_; //!< input stream
+    std::string header_; //!< header line of the next sequence
+    bool has_next_; //!< whether there is a next sequence
+public:
+    /**
+     * @brief Construct
+     * @param in input stream
+     */
+    explicit
+    FastaRecordReader(std::istream &in): in_(in), header_(), has_next_(false) {
+	std::string line;
+	while (std::getline(in_,line)) {
+	    if (line.length()>0 && line[0]=='>') {
+		header_=line;
+		has_next_=true;
+		break;
+	    }
+	}
+    }
+
+    /**
+     * @brief Read next sequence
+     * @param[out] record sequence
+     * @return whether a sequence was read
+     */
+    bool
+    next(batch_record_t &record) {
+	if (!has_next_) return false;
+
+	std::istringstream header(header_.substr(1));
+	record.name="";
+	header >> record.name;
+	record.seq="";
+
+	has_next_=false;
+	std::string line;
+	while (std::getline(in_,line)) {
+	    if (line.length()>0 && line[0]=='>') {
+		header_=line;
+		has_next_=true;
+		break;
+	    }
+	    if (line.length()>0 && line[0]=='#') continue;
+	    for (size_t i=0; i<line.length(); ++i) {
+		if (!isspace(line[i])) record.seq += line[i];
+	    }
+	}
+	return true;
+    }
+};
+
+//! @brief task of folding one sequence of the batch input
+class FoldTask : public ThreadPool::Task {
+    const batch_record_t &record_;
+    const PFoldParams &pfoldparams_;
+    std::string &pp_;
+    std::string &error_;
+public:
+    FoldTask(const batch_record_t &record, const PFoldParams &pfoldparams,
+	     std::string &pp, std::string &error)
+	: record_(record), pfoldparams_(pfoldparams), pp_(pp), error_(error)
+    {}
+
+    void
+    run() {
+	try {
+	    MultipleAlignment mseq(record_.name,record_.seq);
+	    std::ostringstream out;
+	    fold_and_write_pp(out, mseq, pfoldparams_, clp.force_alifold);
+	    pp_ = out.str();
+	} catch (failure &f) {
+	    error_ = f.what();
+	}
+    }
+};
+
+/**
+ * @brief File name of the pp file of a sequence in batch mode
+ *
+ * @param name sequence name
+ * @return name.pp, where special characters of name are replaced by '_'
+ */
+std::string
+batch_pp_filename(const std::string &name) {
+    std::string filename=name;
+    for (size_t i=0; i<filename.length(); ++i) {
+	char c=filename[i];
+	if (!isalnum(c) && c!='.' && c!='-' && c!='_') {
+	    filename[i]='_';
+	}
+    }
+    return filename+".pp";
+}
+
+/**
+ * @brief Fold all sequences of the input separately
+ *
+ * Reads the input in blocks of sequences, which are folded in
+ * parallel; the results of each block are written in input order
+ * before the next block is read, such that streams of arbitrary
+ * length can be processed.
+ *
+ * @param in input stream
+ * @param pfoldparams folding parameters
+ *
+ * @return success (false, if some sequence could not be folded or
+ * written)
+ *
+ * @throw failure if the output cannot be written
+ */
+bool
+fold_batch(std::istream &in, const PFoldParams &pfoldparams) {
+    ThreadPool pool((size_t)clp.threads);
+
+    if (clp.opt_batch_dir) {
+	if (mkdir(clp.batch_dir.c_str(),0777)!=0 && errno!=EEXIST) {
+	    throw failure("Cannot create directory "+clp.batch_dir+".");
+	}
+    }
+
+    PPArchiveWriter *archive = NULL;
+    if (clp.opt_archive) {
+	archive = new PPArchiveWriter(clp.archive);
+    }
+
+    bool success=true;
+    size_t num_folded=0;
+
+    std::set<std::string> filenames;
+
+    // one task per sequence, since the folding time strongly depends
+    // on the sequence length
+    size_t block_size = 16*pool.size();
+
+    FastaRecordReader reader(in);
+    std::vector<batch_record_t> records(block_size);
+    std::vector<std::string> pps(block_size);
+    std::vector<std::string> errors(block_size);
+
+    try {
+	size_t n;
+	do {
+	    n=0;
+	    while (n<block_size && reader.next(records[n])) {
+		++n;
+	    }
+
+	    std::vector<FoldTask *> tasks;
+	    for (size_t i=0; i<n; ++i) {
+		pps[i]="";
+		errors[i]="";
+		tasks.push_back(new FoldTask(records[i],pfoldparams,pps[i],errors[i]));
+		pool.submit(tasks.back());
+	    }
+	    try {
+		pool.wait();
+	    } catch (failure &f) {
+		for (size_t i=0; i<tasks.size(); ++i) delete tasks[i];
+		throw;
+	    }
+	    for (size_t i=0; i<tasks.size(); ++i) delete tasks[i];
+
+	    for (size_t i=0; i<n; ++i) {
+		const std::string &name = records[i].name;
+		if (!errors[i].empty()) {
+		    std::cerr << "ERROR: cannot fold "<<name<<": "<<errors[i]<<std::endl;
+		    success=false;
+		    continue;
+		}
+		if (clp.opt_batch_dir) {
+		    std::string filename = batch_pp_filename(name);
+		    if (!filenames.insert(filename).second) {
+			std::cerr << "ERROR: duplicate pp file name "<<filename
+				  <<" for sequence "<<name<<"."<<std::endl;
+			success=false;
+		    } else {
+			std::string path = clp.batch_dir+"/"+filename;
+			std::ofstream out(path.c_str());
+			out << pps[i];
+			if (!out.good()) {
+			    throw failure("Cannot write to "+path+".");
+			}
+		    }
+		}
+		if (archive) {
+		    archive->add(name,pps[i]);
+		}
+		++num_folded;
+	    }
+	} while (n==block_size);
+
+	if (archive) {
+	    archive->close();
+	}
+    } catch (failure &f) {
+	if (archive) delete archive;
+	throw;
+    }
+    if (archive) delete archive;
+
+    if (clp.opt_verbose) {
+	std::cout << "Folded "<<num_folded<<" sequences."<<std::endl;
+    }
+
+    return success;
+}
+
+
 /** 
  * \brief Main function of locarna_rnafold_pp when Vienna RNA lib is linked
  */
@@ -171,6 +465,57 @@ main(int argc, char **argv) {
 	return -1;
     }
 
+    if (clp.max_bp_span<0 || clp.plfold_window<0) {
+	std::cerr << "ERROR: negative value of max-bp-span or plfold-window."<<std::endl;
+	return -1;
+    }
+
+    if (clp.opt_batch_dir || clp.opt_archive) {
+	if (!clp.opt_batch) {
+	    std::cerr << "ERROR: --batch-dir and --archive require --batch."<<std::endl;
+	    return -1;
+	}
+    }
+
+    if (clp.opt_batch) {
+	if (!clp.opt_batch_dir && !clp.opt_archive) {
+	    std::cerr << "ERROR: batch mode requires --batch-dir or --archive."<<std::endl;
+	    return -1;
+	}
+	if (clp.output_file.length()>0) {
+	    std::cerr << "ERROR: --output cannot be combined with --batch."<<std::endl;
+	    return -1;
+	}
+	if (clp.use_struct_constraints) {
+	    std::cerr << "ERROR: structure constraints are not supported in batch mode."<<std::endl;
+	    return -1;
+	}
+	if (clp.threads<0) {
+	    std::cerr << "ERROR: number of threads must be greater equal 0."<<std::endl;
+	    return -1;
+	}
+
+	PFoldParams pfoldparams(clp.no_lonely_pairs, clp.opt_stacking, clp.opt_dangling,
+				McCRetention(),clp.max_bp_span,clp.plfold_window);
+
+	bool success;
+	try {
+	    if (clp.input_file=="-") {
+		success = fold_batch(std::cin,pfoldparams);
+	    } else {
+		std::ifstream in(clp.input_file.c_str());
+		if (!in.good()) {
+		    throw failure("Cannot read from "+clp.input_file+".");
+		}
+		success = fold_batch(in,pfoldparams);
+	    }
+	} catch (failure &f) {
+	    std::cerr << "ERROR: " << f.what() << std::endl;
+	    return -1;
+	}
+	return success ? 0 : -1;
+    }
+
     //Reading from stdinput with autodetect of file format works by copying the entire stdinput
     //to memory. Then, autodetection can work on this copy.
     
@@ -266,9 +611,8 @@ main(int argc, char **argv) {
 
     }
     
-    PFoldParams pfoldparams(clp.no_lonely_pairs, clp.opt_stacking, clp.opt_dangling);
-
-    RnaEnsemble rna_ensemble(*mseq, pfoldparams, clp.opt_in_loop, use_alifold);
+    PFoldParams pfoldparams(clp.no_lonely_pairs, clp.opt_stacking, clp.opt_dangling,
+			    McCRetention(),clp.max_bp_span,clp.plfold_window);
 
     // write pp file
 
@@ -286,28 +630,7 @@ main(int argc, char **argv) {
     }
     std::ostream out_stream(buff);
 
-    if (clp.opt_in_loop)
-    {
-	ExtRnaData ext_rna_data(rna_ensemble, 
-				clp.min_prob, 
-				clp.prob_basepair_in_loop_threshold,
-				clp.prob_unpaired_in_loop_threshold,
-				0, // don't filter output by max_bps_length_ratio
-				0, // don't filter output by max_uil_length_ratio
-				0, // don't filter output by max_bpil_length_ratio
-				pfoldparams);
-
-	ext_rna_data.write_pp(out_stream); // (no need to filter again => don't specify output cutoff)
-    }
-    else
-    {
-	RnaData rna_data(rna_ensemble,
-			 clp.min_prob,
-			 0, // don't filter output by max_bps_length_ratio
-			 pfoldparams);
-
-	rna_data.write_pp(out_stream); // (no need to filter again => don't specify output cutoff)
-    }
+    fold_and_write_pp(out_stream, *mseq, pfoldparams, use_alifold);
 
     return 0;
 }
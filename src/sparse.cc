@@ -30,6 +30,7 @@
 #include "LocARNA/sparsification_mapper.hh"
 #include "LocARNA/global_stopwatch.hh"
 #include "LocARNA/pfold_params.hh"
+#include "LocARNA/arena.hh"
 
 using namespace std;
 using namespace LocARNA;
@@ -89,6 +90,8 @@ struct command_line_parameters {
     int tau_factor;
 
     bool no_lonely_pairs; //!< no lonely pairs option
+    int max_bp_span; //!< maximal base pair span in folding (0 for no limit)
+    int plfold_window; //!< window size for local folding (0 for global folding)
 
     //! allow exclusions for maximizing alignment of connected substructures
     bool struct_local;
@@ -216,6 +219,10 @@ struct command_line_parameters {
     double prob_unpaired_in_loop_threshold; //!< threshold for prob_unpaired_in_loop
     double prob_basepair_in_loop_threshold; //!< threshold for prob_basepait_in_loop
 
+    bool opt_mcc_single_precision; //!< whether to keep McCaskill matrices in single precision
+    int mcc_max_span; //!< maximal span of kept McCaskill matrix entries (0 for no limit)
+    std::string mcc_spill_dir; //!< directory for temporary files of McCaskill matrices
+
 };
 
 
@@ -286,6 +293,9 @@ option_def my_options[] = {
     {"min-bm-prob",'b',0,O_ARG_DOUBLE,&clp.min_bm_prob,"0.0005","bmprob","Minimal Base-match probability"},
     {"prob-unpaired-in-loop-threshold",0,0,O_ARG_DOUBLE,&clp.prob_unpaired_in_loop_threshold,"0.00005","threshold","Threshold for prob_unpaired_in_loop"},
     {"prob-basepair-in-loop-threshold",0,0,O_ARG_DOUBLE,&clp.prob_basepair_in_loop_threshold,"0.0001","threshold","Threshold for prob_basepair_in_loop"}, //todo: is the default threshold value reasonable?
+    {"mcc-single-precision",0,&clp.opt_mcc_single_precision,O_NO_ARG,0,O_NODEFAULT,"","Keep McCaskill matrices for in loop probabilities in single precision"},
+    {"mcc-max-span",0,0,O_ARG_INT,&clp.mcc_max_span,"0","span","Keep McCaskill matrices only for base pairs up to this span, drop longer base pairs (default: no limit)"},
+    {"mcc-spill-dir",0,0,O_ARG_STRING,&clp.mcc_spill_dir,"","dir","Keep McCaskill matrices in temporary files in this directory (default: in memory)"},
     
     //    {"",0,0,O_SECTION,0,O_NODEFAULT,"","Special sauce options"},
     //    {"kbest",0,&clp.opt_subopt,O_ARG_INT,&clp.kbest_k,"-1","k","Enumerate k-best alignments"},
@@ -316,6 +326,8 @@ option_def my_options[] = {
     {"",0,0,O_SECTION,0,O_NODEFAULT,"","Constraints"},
 
     {"noLP",0,&clp.no_lonely_pairs,O_NO_ARG,0,O_NODEFAULT,"","No lonely pairs"},
+    {"max-bp-span",0,0,O_ARG_INT,&clp.max_bp_span,"0","span","Maximal span of base pairs in folding (default: no limit)"},
+    {"plfold-window",0,0,O_ARG_INT,&clp.plfold_window,"0","size","Fold locally in windows of this size (RNAplfold-style; default: global folding)"},
 
     //    {"ignore-constraints",0,&clp.opt_ignore_constraints,O_NO_ARG,0,O_NODEFAULT,"","Ignore constraints in pp-file"},
     
@@ -498,7 +510,22 @@ main(int argc, char **argv) {
     // Get input data and generate data objects
     //
 
-    PFoldParams pfparams(clp.no_lonely_pairs,clp.opt_stacking||clp.opt_new_stacking);
+    if (clp.mcc_max_span<0) {
+	std::cerr << "ERROR: negative value of mcc-max-span."<<std::endl;
+	return -1;
+    }
+    
+    if (clp.max_bp_span<0 || clp.plfold_window<0) {
+	std::cerr << "ERROR: negative value of max-bp-span or plfold-window."<<std::endl;
+	return -1;
+    }
+    
+    PFoldParams pfparams(clp.no_lonely_pairs,clp.opt_stacking||clp.opt_new_stacking,2,
+			 McCRetention(clp.opt_mcc_single_precision,
+				      clp.mcc_max_span,
+				      clp.mcc_spill_dir),
+			 clp.max_bp_span,
+			 clp.plfold_window);
     
     ExtRnaData *rna_dataA=0;
     try {
@@ -842,7 +869,8 @@ main(int argc, char **argv) {
 	. min_am_prob(clp.min_am_prob)
 	. min_bm_prob(clp.min_bm_prob)
 	. stacking(clp.opt_stacking || clp.opt_new_stacking)
-	. constraints(seq_constraints);
+	. constraints(seq_constraints)
+	. arena(Arena::thread_arena());
 
 
     